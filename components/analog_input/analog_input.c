@@ -1,32 +1,51 @@
 #include "analog_input.h"
+#include "analog_input_internals.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
-#include "esp_adc/adc_oneshot.h"
+#include "observer.h"
+#include "spsc_ring.h"
+
+//**************************************************
+// Defines
+//**************************************************
+
+#define DISPATCH_BATCH 16 // Values drained from a channel ring before moving to the next
 
 //**************************************************
 // Typedefs
 //**************************************************
 
 /**
- * @brief Linked list node representing a registered observer (handler).
+ * @brief Notification policy state of a channel.
  */
-typedef struct event_node_t
+typedef struct
 {
-  struct event_node_t *next;
-  analog_input_event_handler_t handler;
-} event_node_t;
+  analog_input_report_config_t config;
+  uint16_t last_value;    /**< Last value notified to the observers */
+  TickType_t last_report; /**< Tick of the last notification */
+  bool reported;          /**< At least one value was notified since the policy was set */
+} report_state_t;
+
+/**
+ * @brief Filter output on its way to the observers.
+ */
+typedef struct
+{
+  uint16_t value;
+#if CONFIG_ANALOG_INPUT_SAMPLE_TIME
+  int64_t time_us; /**< Acquisition time of the frame it was filtered from */
+#endif
+} ring_value_t;
 
 //**************************************************
 // Function Prototypes
 //**************************************************
 
-static void analog_reader_task(void *args);
+static void value_dispatcher_task(void *args);
 
-static esp_err_t is_handler_present(event_node_t *head, analog_input_event_handler_t handler);
-static esp_err_t foreach_node(event_node_t *head, const analog_input_num_t num, const uint16_t value);
-static esp_err_t add_node(event_node_t **head, analog_input_event_handler_t handler);
+static bool should_report(report_state_t *state, const uint16_t value, const TickType_t now);
 
 //**************************************************
 // Globals
@@ -34,182 +53,347 @@ static esp_err_t add_node(event_node_t **head, analog_input_event_handler_t hand
 
 static const char TAG[] = "analog_input";
 
-static event_node_t *s_first_event_node = NULL;     /**< Head pointer of the handlers list */
-static SemaphoreHandle_t s_event_node_mutex = NULL; /**< Mutex for thread-safe list access */
-static adc_oneshot_unit_handle_t s_adc1_handler;    /**< Handle for the ADC unit */
+static observer_registry_t s_event_observers;     /**< Registered value handlers */
+static observer_registry_t s_frame_observers;     /**< Registered frame handlers */
+static SemaphoreHandle_t s_pipeline_mutex = NULL; /**< Protection for the filter and report states */
+static TaskHandle_t s_dispatcher_task = NULL;     /**< Task draining the value rings to the observers */
+static analog_input_stats_t s_stats = {0};        /**< Sampling statistics */
 
-/**
- * @brief Maps logical input IDs to physical ADC channels.
- */
-static const uint16_t s_analog_input_num_map[] = {ADC_CHANNEL_6, ADC_CHANNEL_7};
+static analog_input_filter_t s_filters[_ANALOG_INPUT_NUM_MAX]; /**< Per-channel filter and decimation stage */
+static report_state_t s_reports[_ANALOG_INPUT_NUM_MAX];        /**< Per-channel notification policy */
+static spsc_ring_t s_value_rings[_ANALOG_INPUT_NUM_MAX];       /**< Per-channel values, sampling task to dispatcher */
+
+#if CONFIG_ANALOG_INPUT_SAMPLE_TIME
+static int64_t s_sample_time_us = 0; /**< Acquisition time of the value being notified, dispatcher task only */
+#endif
 
 //**************************************************
 // Public Functions
 //**************************************************
 
-esp_err_t analog_input_initialize(void)
+esp_err_t analog_input_initialize(const analog_input_config_t *config)
 {
-  // Initialize synchronization primitive
-  if ((s_event_node_mutex = xSemaphoreCreateMutex()) == NULL)
+  if (config == NULL)
   {
-    ESP_LOGE(TAG, "%s:Fail to create event node mutex", __func__);
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  // Initialize synchronization primitives
+  if ((s_pipeline_mutex = xSemaphoreCreateMutex()) == NULL)
+  {
+    ESP_LOGE(TAG, "%s:Fail to create pipeline mutex", __func__);
     return ESP_FAIL;
   }
 
-  // Create the background task for periodic sampling
-  if (xTaskCreate(analog_reader_task, "analog_reader_task", 2048, NULL, 1, NULL) != pdPASS)
+  if (observer_registry_init(&s_event_observers) != ESP_OK ||
+      observer_registry_init(&s_frame_observers) != ESP_OK)
   {
-    ESP_LOGE(TAG, "%s:Fail to create analog reader task", __func__);
+    ESP_LOGE(TAG, "%s:Fail to create observer registries", __func__);
     return ESP_FAIL;
   }
 
-  // Initialize ADC Unit 1 configuration
-  adc_oneshot_unit_init_cfg_t init_config = {
-      .unit_id = ADC_UNIT_1,
-  };
+  for (int i = 0; i < _ANALOG_INPUT_NUM_MAX; i++)
+  {
+    if (spsc_ring_init(&s_value_rings[i], sizeof(ring_value_t), CONFIG_ANALOG_INPUT_VALUE_RING_SIZE) != ESP_OK)
+    {
+      ESP_LOGE(TAG, "%s:Fail to create value ring %d", __func__, i);
+      return ESP_FAIL;
+    }
+  }
 
-  if (adc_oneshot_new_unit(&init_config, &s_adc1_handler) != ESP_OK)
+  // Observers run here, so a slow one never delays the sampling task
+  if (xTaskCreate(value_dispatcher_task, "analog_dispatcher_task", 3072, NULL, 2, &s_dispatcher_task) != pdPASS)
   {
-    ESP_LOGE(TAG, "%s:Fail to init oneshot adc1", __func__);
+    ESP_LOGE(TAG, "%s:Fail to create value dispatcher task", __func__);
     return ESP_FAIL;
   }
 
-  // Configure specific channels with default bitwidth and attenuation
-  adc_oneshot_chan_cfg_t config = {
-      .bitwidth = ADC_BITWIDTH_DEFAULT,
-      .atten = ADC_ATTEN_DB_12,
-  };
+  // Default stage: continuous mode reduces each frame to its mean
+  analog_input_filter_config_t filter_config = ANALOG_INPUT_FILTER_DEFAULT_CONFIG();
+  if (config->mode == ANALOG_INPUT_MODE_CONTINUOUS)
+  {
+    filter_config.decimation = ANALOG_INPUT_CHANNEL_FRAME_SAMPLES;
+  }
+
+  for (int i = 0; i < _ANALOG_INPUT_NUM_MAX; i++)
+  {
+    analog_input_filter_init(&s_filters[i], &filter_config);
+  }
 
+  const analog_input_report_config_t report_config = ANALOG_INPUT_REPORT_DEFAULT_CONFIG();
   for (int i = 0; i < _ANALOG_INPUT_NUM_MAX; i++)
   {
-    if (adc_oneshot_config_channel(s_adc1_handler, s_analog_input_num_map[i], &config) != ESP_OK)
+    s_reports[i] = (report_state_t){.config = report_config};
+  }
+
+  // Prefer the DMA backend, keep oneshot as fallback
+  if (config->mode == ANALOG_INPUT_MODE_CONTINUOUS)
+  {
+    if (analog_input_continuous_start(config) == ESP_OK)
     {
-      ESP_LOGE(TAG, "%s:Fail to config channel %d", __func__, i);
-      return ESP_FAIL;
+      s_stats.mode = ANALOG_INPUT_MODE_CONTINUOUS;
+      return ESP_OK;
+    }
+
+    ESP_LOGW(TAG, "%s:Fail to start continuous mode, falling back to oneshot", __func__);
+
+    filter_config.decimation = 1;
+    for (int i = 0; i < _ANALOG_INPUT_NUM_MAX; i++)
+    {
+      analog_input_filter_init(&s_filters[i], &filter_config);
     }
   }
 
+  if (analog_input_oneshot_start(config) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Fail to start oneshot mode", __func__);
+    return ESP_FAIL;
+  }
+
+  s_stats.mode = ANALOG_INPUT_MODE_ONESHOT;
   return ESP_OK;
 }
 
 esp_err_t analog_input_add_event_handler(analog_input_event_handler_t handler)
 {
-  if (handler == NULL)
+  return observer_registry_add(&s_event_observers, (observer_handler_t)handler);
+}
+
+esp_err_t analog_input_remove_event_handler(analog_input_event_handler_t handler)
+{
+  return observer_registry_remove(&s_event_observers, (observer_handler_t)handler);
+}
+
+esp_err_t analog_input_add_frame_handler(analog_input_frame_handler_t handler)
+{
+  return observer_registry_add(&s_frame_observers, (observer_handler_t)handler);
+}
+
+esp_err_t analog_input_remove_frame_handler(analog_input_frame_handler_t handler)
+{
+  return observer_registry_remove(&s_frame_observers, (observer_handler_t)handler);
+}
+
+esp_err_t analog_input_set_filter(analog_input_num_t num, const analog_input_filter_config_t *config)
+{
+  if (num >= _ANALOG_INPUT_NUM_MAX || config == NULL)
   {
     return ESP_ERR_INVALID_ARG;
   }
 
-  // Secure the list modification with a mutex
-  if (xSemaphoreTake(s_event_node_mutex, portMAX_DELAY) != pdTRUE)
+  if (s_pipeline_mutex == NULL)
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  // The sampling task holds the mutex while running the stage
+  if (xSemaphoreTake(s_pipeline_mutex, portMAX_DELAY) != pdTRUE)
   {
     return ESP_FAIL;
   }
 
-  esp_err_t err = add_node(&s_first_event_node, handler);
+  esp_err_t err = analog_input_filter_init(&s_filters[num], config);
 
-  xSemaphoreGive(s_event_node_mutex);
+  xSemaphoreGive(s_pipeline_mutex);
   return err;
 }
 
+esp_err_t analog_input_set_report(analog_input_num_t num, const analog_input_report_config_t *config)
+{
+  if (num >= _ANALOG_INPUT_NUM_MAX || config == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  if (config->max_interval_ms != 0 && config->max_interval_ms < config->min_interval_ms)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  if (s_pipeline_mutex == NULL)
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  if (xSemaphoreTake(s_pipeline_mutex, portMAX_DELAY) != pdTRUE)
+  {
+    return ESP_FAIL;
+  }
+
+  s_reports[num] = (report_state_t){.config = *config};
+
+  xSemaphoreGive(s_pipeline_mutex);
+  return ESP_OK;
+}
+
+esp_err_t analog_input_get_stats(analog_input_stats_t *stats)
+{
+  if (stats == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  *stats = s_stats;
+
+  for (int i = 0; i < _ANALOG_INPUT_NUM_MAX; i++)
+  {
+    stats->ring_overruns[i] = spsc_ring_overruns(&s_value_rings[i]);
+  }
+
+  return ESP_OK;
+}
+
+#if CONFIG_ANALOG_INPUT_SAMPLE_TIME
+int64_t analog_input_get_sample_time(void)
+{
+  return s_sample_time_us;
+}
+#endif
+
 //**************************************************
-// Static Functions
+// Pipeline Functions
 //**************************************************
 
-/**
- * @brief Periodic task that samples ADC channels and notifies all observers.
- */
-static void analog_reader_task(void *args)
+void analog_input_process_frame(const analog_input_frame_t *frame)
 {
-  TickType_t last_wake_time = xTaskGetTickCount();
+  const TickType_t now = xTaskGetTickCount();
+  bool pushed = false;
 
-  while (true)
+  for (int i = 0; i < _ANALOG_INPUT_NUM_MAX; i++)
   {
-    // Run loop every 50ms
-    xTaskDelayUntil(&last_wake_time, pdMS_TO_TICKS(50));
-
-    // Lock list during the notification process
-    if ((xSemaphoreTake(s_event_node_mutex, portMAX_DELAY)) != pdTRUE)
+    const uint16_t count = frame->count[i];
+    if (count == 0)
     {
       continue;
     }
 
-    for (int i = 0; i < _ANALOG_INPUT_NUM_MAX; i++)
+    OBSERVER_NOTIFY(&s_frame_observers, analog_input_frame_handler_t, i, frame->samples[i], count);
+
+    if ((xSemaphoreTake(s_pipeline_mutex, portMAX_DELAY)) != pdTRUE)
     {
-      int raw = 0;
-      // Only notify if ADC conversion was successful
-      if (adc_oneshot_read(s_adc1_handler, s_analog_input_num_map[i], &raw) == ESP_OK)
+      return;
+    }
+
+    // Value observers only get the filtered, decimated output, through the
+    // channel ring. On overrun the value is dropped and counted by the ring
+    for (uint16_t j = 0; j < count; j++)
+    {
+      uint16_t value;
+      if (!analog_input_filter_push(&s_filters[i], frame->samples[i][j], &value))
       {
-        foreach_node(s_first_event_node, i, raw);
+        continue;
       }
-      else
+
+      if (!should_report(&s_reports[i], value, now))
       {
-        ESP_LOGE(TAG, "%s:Fail to reac adc %d", __func__, i);
+        s_stats.suppressed[i]++;
+        continue;
       }
+
+      const ring_value_t entry = {
+          .value = value,
+#if CONFIG_ANALOG_INPUT_SAMPLE_TIME
+          .time_us = frame->time_us,
+#endif
+      };
+      spsc_ring_push(&s_value_rings[i], &entry);
+      pushed = true;
     }
 
-    xSemaphoreGive(s_event_node_mutex);
+    xSemaphoreGive(s_pipeline_mutex);
+
+    s_stats.samples += count;
   }
 
-  vTaskDelete(NULL);
-}
+  s_stats.frames++;
 
-/**
- * @brief Search for a specific handler in the list to avoid duplicate entries.
- * @return ESP_OK if found, ESP_FAIL otherwise.
- */
-static esp_err_t is_handler_present(event_node_t *head, analog_input_event_handler_t handler)
-{
-  event_node_t *current = head;
-  while (current != NULL)
+  if (pushed)
   {
-    if (current->handler == handler)
-    {
-      return ESP_OK;
-    }
-    current = current->next;
+    xTaskNotifyGive(s_dispatcher_task);
   }
-  return ESP_FAIL;
 }
 
+void analog_input_report_overrun(uint32_t frames)
+{
+  s_stats.overruns += frames;
+}
+
+//**************************************************
+// Static Functions
+//**************************************************
+
 /**
- * @brief Allocates and inserts a new node at the head of the list (LIFO).
+ * @brief Drains the value rings to the observers, one batch per channel in
+ *        turn so a busy channel does not starve the others.
  */
-static esp_err_t add_node(event_node_t **head, analog_input_event_handler_t handler)
+static void value_dispatcher_task(void *args)
 {
-  // Check if handler already exists in the list
-  if (is_handler_present(*head, handler) == ESP_OK)
-  {
-    ESP_LOGE(TAG, "%s:Handler is already present", __func__);
-    return ESP_OK;
-  }
+  ring_value_t batch[DISPATCH_BATCH];
 
-  event_node_t *new_node = malloc(sizeof(event_node_t));
-  if (new_node == NULL)
+  while (true)
   {
-    ESP_LOGE(TAG, "%s:Fail to alloc new node", __func__);
-    return ESP_ERR_NO_MEM;
+    // Blocks until the sampling task pushes new values
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    bool pending = true;
+    while (pending)
+    {
+      pending = false;
+
+      for (int i = 0; i < _ANALOG_INPUT_NUM_MAX; i++)
+      {
+        size_t count = 0;
+        while (count < DISPATCH_BATCH && spsc_ring_pop(&s_value_rings[i], &batch[count]))
+        {
+          count++;
+        }
+
+        for (size_t j = 0; j < count; j++)
+        {
+#if CONFIG_ANALOG_INPUT_SAMPLE_TIME
+          s_sample_time_us = batch[j].time_us;
+#endif
+          OBSERVER_NOTIFY(&s_event_observers, analog_input_event_handler_t, i, batch[j].value);
+        }
+
+        s_stats.delivered[i] += count;
+        pending |= count == DISPATCH_BATCH;
+      }
+    }
   }
 
-  new_node->handler = handler;
-  new_node->next = *head;
-  *head = new_node;
-  return ESP_OK;
+  vTaskDelete(NULL);
 }
 
 /**
- * @brief Traverses the list and executes each registered handler callback.
+ * @brief Applies the deadband and report interval policy to a filter output.
+ *        Updates the channel state when the value is to be reported.
+ * @return true if the observers must be notified.
  */
-static esp_err_t foreach_node(event_node_t *head, const analog_input_num_t num, const uint16_t value)
+static bool should_report(report_state_t *state, const uint16_t value, const TickType_t now)
 {
-  event_node_t *current = head;
-  while (current != NULL)
+  const analog_input_report_config_t *config = &state->config;
+
+  if (state->reported)
   {
-    if (current->handler != NULL)
+    const uint32_t elapsed_ms = pdTICKS_TO_MS(now - state->last_report);
+    const uint16_t delta = value > state->last_value ? value - state->last_value : state->last_value - value;
+
+    // Heartbeat: report even if the value did not move
+    const bool heartbeat = config->max_interval_ms != 0 && elapsed_ms >= config->max_interval_ms;
+
+    // Changes inside the minimum interval stay pending and are re-evaluated
+    // against the newer samples once it expires
+    const bool changed = delta > config->deadband && elapsed_ms >= config->min_interval_ms;
+
+    if (!heartbeat && !changed)
     {
-      current->handler(num, value);
+      return false;
     }
-    current = current->next;
   }
 
-  return ESP_OK;
-}
\ No newline at end of file
+  state->last_value = value;
+  state->last_report = now;
+  state->reported = true;
+  return true;
+}
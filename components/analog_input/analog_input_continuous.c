@@ -0,0 +1,226 @@
+#include "analog_input_internals.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_adc/adc_continuous.h"
+
+//**************************************************
+// Defines
+//**************************************************
+
+#if CONFIG_IDF_TARGET_ESP32 || CONFIG_IDF_TARGET_ESP32S2
+#define ADC_OUTPUT_TYPE ADC_DIGI_OUTPUT_FORMAT_TYPE1
+#define ADC_GET_CHANNEL(p_data) ((p_data)->type1.channel)
+#define ADC_GET_DATA(p_data) ((p_data)->type1.data)
+#else
+#define ADC_OUTPUT_TYPE ADC_DIGI_OUTPUT_FORMAT_TYPE2
+#define ADC_GET_CHANNEL(p_data) ((p_data)->type2.channel)
+#define ADC_GET_DATA(p_data) ((p_data)->type2.data)
+#endif
+
+/**
+ * @brief Size in bytes of one DMA frame (must be a multiple of the conversion size).
+ */
+#define FRAME_BYTES                                                             \
+  ((ANALOG_INPUT_FRAME_SAMPLES * SOC_ADC_DIGI_RESULT_BYTES + SOC_ADC_DIGI_DATA_BYTES_PER_CONV - 1) / \
+   SOC_ADC_DIGI_DATA_BYTES_PER_CONV * SOC_ADC_DIGI_DATA_BYTES_PER_CONV)
+
+/**
+ * @brief Number of frames the driver pool can hold before overflowing.
+ */
+#define POOL_FRAMES 4
+
+//**************************************************
+// Function Prototypes
+//**************************************************
+
+static void continuous_reader_task(void *args);
+
+static bool on_conv_done(adc_continuous_handle_t handle, const adc_continuous_evt_data_t *edata, void *user_data);
+static bool on_pool_ovf(adc_continuous_handle_t handle, const adc_continuous_evt_data_t *edata, void *user_data);
+static void demux_frame(const uint8_t *buf, uint32_t len, analog_input_frame_t *frame);
+
+//**************************************************
+// Globals
+//**************************************************
+
+static const char TAG[] = "analog_input:continuous";
+
+static adc_continuous_handle_t s_adc_handle = NULL; /**< Handle for the continuous ADC driver */
+static TaskHandle_t s_reader_task = NULL;           /**< Task notified on every completed frame */
+static uint8_t *s_dma_buf = NULL;                   /**< Raw frame read from the driver pool */
+static analog_input_frame_t *s_frame = NULL;        /**< Demultiplexed frame handed to the pipeline */
+static volatile uint32_t s_pool_overflows = 0;      /**< Frames dropped by the driver (ISR context) */
+
+//**************************************************
+// Backend Functions
+//**************************************************
+
+esp_err_t analog_input_continuous_start(const analog_input_config_t *config)
+{
+  if ((s_dma_buf = malloc(FRAME_BYTES)) == NULL || (s_frame = calloc(1, sizeof(analog_input_frame_t))) == NULL)
+  {
+    ESP_LOGE(TAG, "%s:Fail to alloc frame buffers", __func__);
+    goto fail;
+  }
+
+  adc_continuous_handle_cfg_t handle_config = {
+      .max_store_buf_size = FRAME_BYTES * POOL_FRAMES,
+      .conv_frame_size = FRAME_BYTES,
+  };
+
+  if (adc_continuous_new_handle(&handle_config, &s_adc_handle) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Fail to create continuous adc handle", __func__);
+    goto fail;
+  }
+
+  // Scan pattern: every mapped channel once per pattern round
+  adc_digi_pattern_config_t pattern[_ANALOG_INPUT_NUM_MAX] = {0};
+  for (int i = 0; i < _ANALOG_INPUT_NUM_MAX; i++)
+  {
+    pattern[i].atten = ADC_ATTEN_DB_12;
+    pattern[i].channel = analog_input_adc_channel_map[i] & 0x7;
+    pattern[i].unit = ADC_UNIT_1;
+    pattern[i].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+  }
+
+  adc_continuous_config_t adc_config = {
+      .pattern_num = _ANALOG_INPUT_NUM_MAX,
+      .adc_pattern = pattern,
+      .sample_freq_hz = config->sample_freq_hz,
+      .conv_mode = ADC_CONV_SINGLE_UNIT_1,
+      .format = ADC_OUTPUT_TYPE,
+  };
+
+  if (adc_continuous_config(s_adc_handle, &adc_config) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Fail to config continuous adc (%lu Hz)", __func__, (unsigned long)config->sample_freq_hz);
+    goto fail;
+  }
+
+  // Higher priority than the oneshot reader: the pool only holds a few frames
+  if (xTaskCreate(continuous_reader_task, "analog_reader_task", 3072, NULL, 4, &s_reader_task) != pdPASS)
+  {
+    ESP_LOGE(TAG, "%s:Fail to create analog reader task", __func__);
+    goto fail;
+  }
+
+  adc_continuous_evt_cbs_t callbacks = {
+      .on_conv_done = on_conv_done,
+      .on_pool_ovf = on_pool_ovf,
+  };
+
+  if (adc_continuous_register_event_callbacks(s_adc_handle, &callbacks, NULL) != ESP_OK ||
+      adc_continuous_start(s_adc_handle) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Fail to start continuous adc", __func__);
+    vTaskDelete(s_reader_task);
+    s_reader_task = NULL;
+    goto fail;
+  }
+
+  return ESP_OK;
+
+fail:
+  // Release ADC1 so the oneshot fallback can claim it
+  if (s_adc_handle != NULL)
+  {
+    adc_continuous_deinit(s_adc_handle);
+    s_adc_handle = NULL;
+  }
+
+  free(s_dma_buf);
+  free(s_frame);
+  s_dma_buf = NULL;
+  s_frame = NULL;
+  return ESP_FAIL;
+}
+
+//**************************************************
+// Static Functions
+//**************************************************
+
+/**
+ * @brief Drains completed DMA frames from the driver pool and feeds the pipeline.
+ */
+static void continuous_reader_task(void *args)
+{
+  uint32_t reported_overflows = 0;
+
+  while (true)
+  {
+    // Woken by the conversion-done ISR callback
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    uint32_t len = 0;
+    while (adc_continuous_read(s_adc_handle, s_dma_buf, FRAME_BYTES, &len, 0) == ESP_OK)
+    {
+      demux_frame(s_dma_buf, len, s_frame);
+#if CONFIG_ANALOG_INPUT_SAMPLE_TIME
+      s_frame->time_us = esp_timer_get_time(); // Frames are drained right after the conversion-done ISR
+#endif
+      analog_input_process_frame(s_frame);
+    }
+
+    uint32_t overflows = s_pool_overflows;
+    if (overflows != reported_overflows)
+    {
+      analog_input_report_overrun(overflows - reported_overflows);
+      reported_overflows = overflows;
+    }
+  }
+
+  vTaskDelete(NULL);
+}
+
+/**
+ * @brief ISR callback: a DMA frame is ready in the driver pool.
+ */
+static bool IRAM_ATTR on_conv_done(adc_continuous_handle_t handle, const adc_continuous_evt_data_t *edata, void *user_data)
+{
+  BaseType_t must_yield = pdFALSE;
+  vTaskNotifyGiveFromISR(s_reader_task, &must_yield);
+  return must_yield == pdTRUE;
+}
+
+/**
+ * @brief ISR callback: the driver pool is full and the oldest frame was dropped.
+ */
+static bool IRAM_ATTR on_pool_ovf(adc_continuous_handle_t handle, const adc_continuous_evt_data_t *edata, void *user_data)
+{
+  s_pool_overflows++;
+  return false;
+}
+
+/**
+ * @brief Splits interleaved DMA results into per-channel sample arrays.
+ */
+static void demux_frame(const uint8_t *buf, uint32_t len, analog_input_frame_t *frame)
+{
+  for (int i = 0; i < _ANALOG_INPUT_NUM_MAX; i++)
+  {
+    frame->count[i] = 0;
+  }
+
+  for (uint32_t offset = 0; offset + SOC_ADC_DIGI_RESULT_BYTES <= len; offset += SOC_ADC_DIGI_RESULT_BYTES)
+  {
+    const adc_digi_output_data_t *p_data = (const adc_digi_output_data_t *)&buf[offset];
+    const uint32_t channel = ADC_GET_CHANNEL(p_data);
+
+    for (int i = 0; i < _ANALOG_INPUT_NUM_MAX; i++)
+    {
+      if (analog_input_adc_channel_map[i] != channel)
+      {
+        continue;
+      }
+
+      if (frame->count[i] < ANALOG_INPUT_CHANNEL_FRAME_SAMPLES)
+      {
+        frame->samples[i][frame->count[i]++] = ADC_GET_DATA(p_data);
+      }
+      break;
+    }
+  }
+}
@@ -0,0 +1,199 @@
+#include "analog_input_internals.h"
+#include <string.h>
+
+//**************************************************
+// Function Prototypes
+//**************************************************
+
+static uint16_t moving_average_push(analog_input_filter_t *filter, uint16_t sample);
+static uint16_t iir_push(analog_input_filter_t *filter, uint16_t sample);
+static uint16_t median_push(analog_input_filter_t *filter, uint16_t sample);
+
+static uint16_t sorted_find(const uint16_t *sorted, uint16_t len, uint16_t value);
+
+//**************************************************
+// Filter Functions
+//**************************************************
+
+esp_err_t analog_input_filter_init(analog_input_filter_t *filter, const analog_input_filter_config_t *config)
+{
+  if (filter == NULL || config == NULL || config->decimation == 0)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  switch (config->type)
+  {
+  case ANALOG_INPUT_FILTER_NONE:
+    break;
+
+  case ANALOG_INPUT_FILTER_MOVING_AVERAGE:
+  case ANALOG_INPUT_FILTER_MEDIAN:
+    if (config->window == 0 || config->window > ANALOG_INPUT_FILTER_MAX_WINDOW)
+    {
+      return ESP_ERR_INVALID_ARG;
+    }
+    break;
+
+  case ANALOG_INPUT_FILTER_IIR:
+    if (config->iir_alpha_q15 == 0 || config->iir_alpha_q15 > (1 << 15))
+    {
+      return ESP_ERR_INVALID_ARG;
+    }
+    break;
+
+  default:
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  memset(filter, 0, sizeof(analog_input_filter_t));
+  filter->config = *config;
+  filter->iir_q16 = -1; // Not primed
+  return ESP_OK;
+}
+
+bool analog_input_filter_push(analog_input_filter_t *filter, uint16_t sample, uint16_t *out)
+{
+  uint16_t filtered = sample;
+
+  switch (filter->config.type)
+  {
+  case ANALOG_INPUT_FILTER_MOVING_AVERAGE:
+    filtered = moving_average_push(filter, sample);
+    break;
+
+  case ANALOG_INPUT_FILTER_IIR:
+    filtered = iir_push(filter, sample);
+    break;
+
+  case ANALOG_INPUT_FILTER_MEDIAN:
+    filtered = median_push(filter, sample);
+    break;
+
+  default:
+    break;
+  }
+
+  // Decimation: averaging accumulate-and-dump, doubles as anti-aliasing
+  if (filter->config.decimation == 1)
+  {
+    *out = filtered;
+    return true;
+  }
+
+  filter->decimation_sum += filtered;
+  if (++filter->decimation_count < filter->config.decimation)
+  {
+    return false;
+  }
+
+  *out = filter->decimation_sum / filter->decimation_count;
+  filter->decimation_sum = 0;
+  filter->decimation_count = 0;
+  return true;
+}
+
+//**************************************************
+// Static Functions
+//**************************************************
+
+/**
+ * @brief Running-sum moving average. O(1) per sample.
+ */
+static uint16_t moving_average_push(analog_input_filter_t *filter, uint16_t sample)
+{
+  const uint16_t size = filter->config.window;
+
+  if (filter->fill < size)
+  {
+    filter->window[(filter->head + filter->fill) % size] = sample;
+    filter->fill++;
+  }
+  else
+  {
+    filter->sum -= filter->window[filter->head];
+    filter->window[filter->head] = sample;
+    filter->head = (filter->head + 1) % size;
+  }
+
+  filter->sum += sample;
+  return filter->sum / filter->fill;
+}
+
+/**
+ * @brief Single-pole IIR low-pass in Q16. Primed with the first sample.
+ */
+static uint16_t iir_push(analog_input_filter_t *filter, uint16_t sample)
+{
+  const int32_t x_q16 = (int32_t)sample << 16;
+
+  if (filter->iir_q16 < 0)
+  {
+    filter->iir_q16 = x_q16;
+  }
+  else
+  {
+    const int64_t delta = (int64_t)(x_q16 - filter->iir_q16) * filter->config.iir_alpha_q15;
+    filter->iir_q16 += (int32_t)(delta >> 15);
+  }
+
+  // Round to nearest
+  return (filter->iir_q16 + (1 << 15)) >> 16;
+}
+
+/**
+ * @brief Sliding median: the window is mirrored in a sorted array that is
+ *        updated by one removal and one insertion. O(window) per sample.
+ */
+static uint16_t median_push(analog_input_filter_t *filter, uint16_t sample)
+{
+  const uint16_t size = filter->config.window;
+  uint16_t *sorted = filter->sorted;
+
+  if (filter->fill < size)
+  {
+    filter->window[(filter->head + filter->fill) % size] = sample;
+    filter->fill++;
+  }
+  else
+  {
+    // Remove the oldest sample from the sorted view
+    const uint16_t oldest = sorted_find(sorted, filter->fill, filter->window[filter->head]);
+    memmove(&sorted[oldest], &sorted[oldest + 1], (filter->fill - oldest - 1) * sizeof(uint16_t));
+
+    filter->window[filter->head] = sample;
+    filter->head = (filter->head + 1) % size;
+  }
+
+  // Insert the new sample, keeping order
+  const uint16_t len = filter->fill - 1;
+  const uint16_t pos = sorted_find(sorted, len, sample);
+  memmove(&sorted[pos + 1], &sorted[pos], (len - pos) * sizeof(uint16_t));
+  sorted[pos] = sample;
+
+  return sorted[filter->fill / 2];
+}
+
+/**
+ * @brief Lower bound: index of the first element not less than `value`.
+ */
+static uint16_t sorted_find(const uint16_t *sorted, uint16_t len, uint16_t value)
+{
+  uint16_t low = 0;
+  uint16_t high = len;
+
+  while (low < high)
+  {
+    const uint16_t mid = (low + high) / 2;
+    if (sorted[mid] < value)
+    {
+      low = mid + 1;
+    }
+    else
+    {
+      high = mid;
+    }
+  }
+
+  return low;
+}
@@ -0,0 +1,123 @@
+#include "analog_input_internals.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_adc/adc_oneshot.h"
+
+//**************************************************
+// Function Prototypes
+//**************************************************
+
+static void analog_reader_task(void *args);
+
+//**************************************************
+// Globals
+//**************************************************
+
+static const char TAG[] = "analog_input:oneshot";
+
+/**
+ * @brief Maps logical input IDs to physical ADC channels. Shared with the continuous backend.
+ */
+const adc_channel_t analog_input_adc_channel_map[_ANALOG_INPUT_NUM_MAX] = {ADC_CHANNEL_6, ADC_CHANNEL_7};
+
+static adc_oneshot_unit_handle_t s_adc1_handler; /**< Handle for the ADC unit */
+static TickType_t s_period = 0;                  /**< Sampling period in ticks */
+static analog_input_frame_t *s_frame = NULL;     /**< Single-sample frame handed to the pipeline */
+
+//**************************************************
+// Backend Functions
+//**************************************************
+
+esp_err_t analog_input_oneshot_start(const analog_input_config_t *config)
+{
+  // Initialize ADC Unit 1 configuration
+  adc_oneshot_unit_init_cfg_t init_config = {
+      .unit_id = ADC_UNIT_1,
+  };
+
+  if (adc_oneshot_new_unit(&init_config, &s_adc1_handler) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Fail to init oneshot adc1", __func__);
+    return ESP_FAIL;
+  }
+
+  // Configure specific channels with default bitwidth and attenuation
+  adc_oneshot_chan_cfg_t chan_config = {
+      .bitwidth = ADC_BITWIDTH_DEFAULT,
+      .atten = ADC_ATTEN_DB_12,
+  };
+
+  for (int i = 0; i < _ANALOG_INPUT_NUM_MAX; i++)
+  {
+    if (adc_oneshot_config_channel(s_adc1_handler, analog_input_adc_channel_map[i], &chan_config) != ESP_OK)
+    {
+      ESP_LOGE(TAG, "%s:Fail to config channel %d", __func__, i);
+      return ESP_FAIL;
+    }
+  }
+
+  if ((s_frame = calloc(1, sizeof(analog_input_frame_t))) == NULL)
+  {
+    ESP_LOGE(TAG, "%s:Fail to alloc frame", __func__);
+    return ESP_ERR_NO_MEM;
+  }
+
+  s_period = pdMS_TO_TICKS(config->oneshot_period_ms);
+  if (s_period == 0)
+  {
+    s_period = 1;
+  }
+
+  // Create the background task for periodic sampling
+  if (xTaskCreate(analog_reader_task, "analog_reader_task", 2048, NULL, 1, NULL) != pdPASS)
+  {
+    ESP_LOGE(TAG, "%s:Fail to create analog reader task", __func__);
+    return ESP_FAIL;
+  }
+
+  return ESP_OK;
+}
+
+//**************************************************
+// Static Functions
+//**************************************************
+
+/**
+ * @brief Periodic task that samples ADC channels and feeds the pipeline.
+ */
+static void analog_reader_task(void *args)
+{
+  TickType_t last_wake_time = xTaskGetTickCount();
+
+  while (true)
+  {
+    xTaskDelayUntil(&last_wake_time, s_period);
+
+    for (int i = 0; i < _ANALOG_INPUT_NUM_MAX; i++)
+    {
+      int raw = 0;
+      s_frame->count[i] = 0;
+
+      // Only forward if ADC conversion was successful
+      if (adc_oneshot_read(s_adc1_handler, analog_input_adc_channel_map[i], &raw) == ESP_OK)
+      {
+        s_frame->samples[i][0] = raw;
+        s_frame->count[i] = 1;
+      }
+      else
+      {
+        ESP_LOGE(TAG, "%s:Fail to reac adc %d", __func__, i);
+      }
+    }
+
+#if CONFIG_ANALOG_INPUT_SAMPLE_TIME
+    s_frame->time_us = esp_timer_get_time();
+#endif
+
+    analog_input_process_frame(s_frame);
+  }
+
+  vTaskDelete(NULL);
+}
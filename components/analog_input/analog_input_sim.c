@@ -0,0 +1,186 @@
+#include "analog_input_internals.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+//**************************************************
+// Defines
+//**************************************************
+
+#define SIM_ADC_MAX 4095        // 12-bit full scale
+#define SIM_PERIOD_SAMPLES 4096 // Triangle wave period, in samples
+#define SIM_NOISE_MASK 0x1F     // Peak-to-peak noise amplitude
+#define SIM_POOL_FRAMES 4       // Frames buffered before overrun, as in the DMA backend
+
+//**************************************************
+// Function Prototypes
+//**************************************************
+
+static void sim_oneshot_task(void *args);
+static void sim_continuous_task(void *args);
+
+static uint16_t sim_sample(int channel, uint32_t index);
+
+//**************************************************
+// Globals
+//**************************************************
+
+static const char TAG[] = "analog_input:sim";
+
+static analog_input_config_t s_config;       /**< Copy of the requested configuration */
+static analog_input_frame_t *s_frame = NULL; /**< Frame handed to the pipeline */
+static uint32_t s_noise_state = 0x12345678;  /**< LCG state for the simulated noise */
+
+//**************************************************
+// Backend Functions
+//**************************************************
+
+esp_err_t analog_input_oneshot_start(const analog_input_config_t *config)
+{
+  s_config = *config;
+
+  if ((s_frame = calloc(1, sizeof(analog_input_frame_t))) == NULL)
+  {
+    ESP_LOGE(TAG, "%s:Fail to alloc frame", __func__);
+    return ESP_ERR_NO_MEM;
+  }
+
+  if (xTaskCreate(sim_oneshot_task, "analog_reader_task", 4096, NULL, 1, NULL) != pdPASS)
+  {
+    ESP_LOGE(TAG, "%s:Fail to create analog reader task", __func__);
+    return ESP_FAIL;
+  }
+
+  return ESP_OK;
+}
+
+esp_err_t analog_input_continuous_start(const analog_input_config_t *config)
+{
+  if (config->sample_freq_hz == 0)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  s_config = *config;
+
+  if ((s_frame = calloc(1, sizeof(analog_input_frame_t))) == NULL)
+  {
+    ESP_LOGE(TAG, "%s:Fail to alloc frame", __func__);
+    return ESP_ERR_NO_MEM;
+  }
+
+  if (xTaskCreate(sim_continuous_task, "analog_reader_task", 4096, NULL, 4, NULL) != pdPASS)
+  {
+    ESP_LOGE(TAG, "%s:Fail to create analog reader task", __func__);
+    return ESP_FAIL;
+  }
+
+  ESP_LOGI(TAG, "%s:Simulated DMA source at %lu Hz", __func__, (unsigned long)config->sample_freq_hz);
+  return ESP_OK;
+}
+
+//**************************************************
+// Static Functions
+//**************************************************
+
+/**
+ * @brief Stand-in for the oneshot reader: one synthetic sample per channel per period.
+ */
+static void sim_oneshot_task(void *args)
+{
+  TickType_t last_wake_time = xTaskGetTickCount();
+  TickType_t period = pdMS_TO_TICKS(s_config.oneshot_period_ms);
+  uint32_t index = 0;
+
+  while (true)
+  {
+    xTaskDelayUntil(&last_wake_time, period > 0 ? period : 1);
+
+    for (int i = 0; i < _ANALOG_INPUT_NUM_MAX; i++)
+    {
+      s_frame->samples[i][0] = sim_sample(i, index);
+      s_frame->count[i] = 1;
+    }
+
+    index++;
+#if CONFIG_ANALOG_INPUT_SAMPLE_TIME
+    s_frame->time_us = esp_timer_get_time();
+#endif
+    analog_input_process_frame(s_frame);
+  }
+
+  vTaskDelete(NULL);
+}
+
+/**
+ * @brief Stand-in for the DMA engine: produces as many frames as the configured
+ *        conversion rate owes since the last tick, so throughput matches hardware.
+ */
+static void sim_continuous_task(void *args)
+{
+  TickType_t last_wake_time = xTaskGetTickCount();
+  const TickType_t start_time = last_wake_time;
+  uint64_t produced = 0; // Conversions already delivered (all channels)
+  uint32_t channel = 0;  // Next channel in the scan pattern
+
+  while (true)
+  {
+    xTaskDelayUntil(&last_wake_time, 1);
+
+    const uint64_t elapsed = (uint64_t)(last_wake_time - start_time);
+    const uint64_t owed = elapsed * s_config.sample_freq_hz / configTICK_RATE_HZ;
+
+    // A real DMA pool only holds a few frames: drop the oldest ones like the driver would
+    const uint64_t backlog = (owed - produced) / ANALOG_INPUT_FRAME_SAMPLES;
+    if (backlog > SIM_POOL_FRAMES)
+    {
+      analog_input_report_overrun(backlog - SIM_POOL_FRAMES);
+      produced += (backlog - SIM_POOL_FRAMES) * ANALOG_INPUT_FRAME_SAMPLES;
+    }
+
+    // Emit whole frames only, exactly like the DMA engine does
+    while (owed - produced >= ANALOG_INPUT_FRAME_SAMPLES)
+    {
+      for (int i = 0; i < _ANALOG_INPUT_NUM_MAX; i++)
+      {
+        s_frame->count[i] = 0;
+      }
+
+      for (uint32_t n = 0; n < ANALOG_INPUT_FRAME_SAMPLES; n++)
+      {
+        if (s_frame->count[channel] < ANALOG_INPUT_CHANNEL_FRAME_SAMPLES)
+        {
+          const uint32_t index = (produced + n) / _ANALOG_INPUT_NUM_MAX;
+          s_frame->samples[channel][s_frame->count[channel]++] = sim_sample(channel, index);
+        }
+
+        channel = (channel + 1) % _ANALOG_INPUT_NUM_MAX;
+      }
+
+      produced += ANALOG_INPUT_FRAME_SAMPLES;
+#if CONFIG_ANALOG_INPUT_SAMPLE_TIME
+      s_frame->time_us = esp_timer_get_time();
+#endif
+      analog_input_process_frame(s_frame);
+    }
+  }
+
+  vTaskDelete(NULL);
+}
+
+/**
+ * @brief Integer-only synthetic signal: phase-shifted triangle wave plus noise.
+ */
+static uint16_t sim_sample(int channel, uint32_t index)
+{
+  const uint32_t phase = (index + channel * (SIM_PERIOD_SAMPLES / 4)) % SIM_PERIOD_SAMPLES;
+  const uint32_t half = SIM_PERIOD_SAMPLES / 2;
+  uint32_t value = phase < half ? phase : SIM_PERIOD_SAMPLES - phase;
+  value = value * (SIM_ADC_MAX - SIM_NOISE_MASK) / half;
+
+  s_noise_state = s_noise_state * 1664525u + 1013904223u;
+  value += (s_noise_state >> 24) & SIM_NOISE_MASK;
+
+  return value > SIM_ADC_MAX ? SIM_ADC_MAX : value;
+}
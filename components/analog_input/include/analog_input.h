@@ -2,6 +2,48 @@
 
 #include "esp_err.h"
 #include "stdbool.h"
+#include "sdkconfig.h"
+
+//**************************************************
+// Defines
+//**************************************************
+
+#if CONFIG_ANALOG_INPUT_DEFAULT_MODE_ONESHOT
+#define ANALOG_INPUT_DEFAULT_MODE ANALOG_INPUT_MODE_ONESHOT
+#else
+#define ANALOG_INPUT_DEFAULT_MODE ANALOG_INPUT_MODE_CONTINUOUS
+#endif
+
+/**
+ * @brief Default configuration, taken from menuconfig.
+ */
+#define ANALOG_INPUT_DEFAULT_CONFIG()                               \
+  {                                                                 \
+      .mode = ANALOG_INPUT_DEFAULT_MODE,                            \
+      .sample_freq_hz = CONFIG_ANALOG_INPUT_SAMPLE_FREQ_HZ,         \
+      .oneshot_period_ms = CONFIG_ANALOG_INPUT_ONESHOT_PERIOD_MS,   \
+  }
+
+/**
+ * @brief Identity filter: every sample is forwarded unchanged.
+ */
+#define ANALOG_INPUT_FILTER_DEFAULT_CONFIG() \
+  {                                          \
+      .type = ANALOG_INPUT_FILTER_NONE,      \
+      .window = 1,                           \
+      .iir_alpha_q15 = 32768,                \
+      .decimation = 1,                       \
+  }
+
+/**
+ * @brief Default notification policy, taken from menuconfig.
+ */
+#define ANALOG_INPUT_REPORT_DEFAULT_CONFIG()                            \
+  {                                                                     \
+      .deadband = CONFIG_ANALOG_INPUT_REPORT_DEADBAND,                  \
+      .min_interval_ms = CONFIG_ANALOG_INPUT_REPORT_MIN_INTERVAL_MS,    \
+      .max_interval_ms = CONFIG_ANALOG_INPUT_REPORT_MAX_INTERVAL_MS,    \
+  }
 
 //**************************************************
 // Typedefs
@@ -18,13 +60,89 @@ typedef enum
   _ANALOG_INPUT_NUM_MAX,
 } analog_input_num_t;
 
+/**
+ * @brief Sampling backends.
+ */
+typedef enum
+{
+  ANALOG_INPUT_MODE_ONESHOT = 0, /**< One conversion per channel every `oneshot_period_ms` */
+  ANALOG_INPUT_MODE_CONTINUOUS,  /**< DMA-driven conversions at `sample_freq_hz` */
+} analog_input_mode_t;
+
+/**
+ * @brief Analog input component configuration.
+ */
+typedef struct
+{
+  analog_input_mode_t mode;   /**< Sampling backend */
+  uint32_t sample_freq_hz;    /**< Continuous mode: total conversion rate shared by all channels */
+  uint32_t oneshot_period_ms; /**< Oneshot mode: sampling period */
+} analog_input_config_t;
+
+/**
+ * @brief Filter applied to every raw sample of a channel, before decimation.
+ */
+typedef enum
+{
+  ANALOG_INPUT_FILTER_NONE = 0,       /**< Pass-through */
+  ANALOG_INPUT_FILTER_MOVING_AVERAGE, /**< Mean of the last `window` samples */
+  ANALOG_INPUT_FILTER_IIR,            /**< Single-pole low-pass: y += alpha * (x - y) */
+  ANALOG_INPUT_FILTER_MEDIAN,         /**< Median of the last `window` samples */
+} analog_input_filter_type_t;
+
+/**
+ * @brief Per-channel filter and decimation stage configuration.
+ *        The stage runs in fixed point inside the sampling task.
+ */
+typedef struct
+{
+  analog_input_filter_type_t type; /**< Filter applied to each raw sample */
+  uint16_t window;                 /**< Moving average / median: samples in the window (1..CONFIG_ANALOG_INPUT_FILTER_MAX_WINDOW) */
+  uint16_t iir_alpha_q15;          /**< IIR: smoothing factor in Q15 (1..32768, 32768 = no smoothing) */
+  uint32_t decimation;             /**< Observers get the mean of every `decimation` filtered samples (1 = every sample) */
+} analog_input_filter_config_t;
+
+/**
+ * @brief Per-channel notification policy, applied after the filter stage.
+ *        A value is reported when it moves more than `deadband` away from the
+ *        last reported value, or when `max_interval_ms` elapsed without a report.
+ */
+typedef struct
+{
+  uint16_t deadband;        /**< Change (in ADC counts) that must be exceeded to report */
+  uint32_t min_interval_ms; /**< Minimum time between reports; changes inside it are deferred (0 = none) */
+  uint32_t max_interval_ms; /**< Heartbeat: report anyway after this long (0 = never) */
+} analog_input_report_config_t;
+
+/**
+ * @brief Sampling statistics.
+ */
+typedef struct
+{
+  analog_input_mode_t mode;                      /**< Backend actually running (after fallback) */
+  uint32_t frames;                               /**< Frames delivered to the pipeline */
+  uint32_t samples;                              /**< Samples delivered to the pipeline (all channels) */
+  uint32_t overruns;                             /**< Frames lost because the pipeline did not keep up */
+  uint32_t delivered[_ANALOG_INPUT_NUM_MAX];     /**< Values notified to the observers, per channel */
+  uint32_t suppressed[_ANALOG_INPUT_NUM_MAX];    /**< Filter outputs held back by the notification policy */
+  uint32_t ring_overruns[_ANALOG_INPUT_NUM_MAX]; /**< Values lost because the observers did not keep up */
+} analog_input_stats_t;
+
 /**
  * @brief Callback function type for analog input events.
  * @param num   The logical channel number that triggered the event.
- * @param value The raw ADC value (digital) sampled from the hardware.
+ * @param value The ADC value (digital) after the channel filter and decimation stage.
  */
 typedef void (*analog_input_event_handler_t)(const analog_input_num_t num, const uint16_t value);
 
+/**
+ * @brief Callback function type for whole frames of raw samples.
+ * @param num     The logical channel number the samples belong to.
+ * @param samples Raw ADC values, oldest first. Only valid during the call.
+ * @param count   Number of samples in the frame.
+ */
+typedef void (*analog_input_frame_handler_t)(const analog_input_num_t num, const uint16_t *samples, const size_t count);
+
 //**************************************************
 // Function Prototypes
 //**************************************************
@@ -32,25 +150,121 @@ typedef void (*analog_input_event_handler_t)(const analog_input_num_t num, const
 /**
  * @brief Initializes the analog input component.
  *        This function sets up the ADC hardware, creates the synchronization mutex,
- *        and spawns the background sampling task.
+ *        and spawns the background sampling task of the selected backend.
+ *        If the continuous backend cannot be started, oneshot mode is used instead.
+ * @param config Component configuration, see ANALOG_INPUT_DEFAULT_CONFIG().
  * @return - ESP_OK: Success.
  *
+ *         - ESP_ERR_INVALID_ARG: Provided config was NULL.
+ *
  *         - ESP_FAIL: Hardware initialization or task creation failed.
  */
-esp_err_t analog_input_initialize(void);
+esp_err_t analog_input_initialize(const analog_input_config_t *config);
 
 /**
  * @brief Registers a new callback function to be notified on every ADC sample.
  *        The system uses an Observer pattern. Every registered handler will be called
- *        sequentially for each active analog channel.
+ *        sequentially for each active analog channel, from a dispatcher task fed by
+ *        per-channel rings, so handlers may block without delaying the sampling.
  * @note This function is thread-safe and prevents duplicate registrations.
+ *       It must not be called from a handler.
  * @param handler The function pointer to be registered.
  * @return - ESP_OK: Handler registered successfully.
  *
  *         - ESP_ERR_INVALID_ARG: Provided handler was NULL.
  *
- *         - ESP_ERR_NO_MEM: Failed to allocate memory for the new observer node.
+ *         - ESP_ERR_INVALID_STATE: Component not initialized.
  *
- *         - ESP_FAIL: Mutex timeout or other internal error.
+ *         - ESP_ERR_NO_MEM: Failed to allocate memory for the new handler array.
  */
 esp_err_t analog_input_add_event_handler(analog_input_event_handler_t handler);
+
+/**
+ * @brief Unregisters a value handler. Once this returns the handler will not be called again.
+ * @note Must not be called from a handler.
+ * @param handler The function pointer to be removed.
+ * @return - ESP_OK: Handler removed.
+ *
+ *         - ESP_ERR_INVALID_ARG: Provided handler was NULL.
+ *
+ *         - ESP_ERR_INVALID_STATE: Component not initialized.
+ *
+ *         - ESP_ERR_NOT_FOUND: Handler was not registered.
+ */
+esp_err_t analog_input_remove_event_handler(analog_input_event_handler_t handler);
+
+/**
+ * @brief Registers a callback to receive every raw frame, one call per channel.
+ * @note Frame handlers run in the sampling task and must not block.
+ * @param handler The function pointer to be registered.
+ * @return - ESP_OK: Handler registered successfully.
+ *
+ *         - ESP_ERR_INVALID_ARG: Provided handler was NULL.
+ *
+ *         - ESP_ERR_INVALID_STATE: Component not initialized.
+ *
+ *         - ESP_ERR_NO_MEM: Failed to allocate memory for the new handler array.
+ */
+esp_err_t analog_input_add_frame_handler(analog_input_frame_handler_t handler);
+
+/**
+ * @brief Unregisters a frame handler. Once this returns the handler will not be called again.
+ * @note Must not be called from a handler.
+ * @param handler The function pointer to be removed.
+ * @return - ESP_OK: Handler removed.
+ *
+ *         - ESP_ERR_INVALID_ARG: Provided handler was NULL.
+ *
+ *         - ESP_ERR_INVALID_STATE: Component not initialized.
+ *
+ *         - ESP_ERR_NOT_FOUND: Handler was not registered.
+ */
+esp_err_t analog_input_remove_frame_handler(analog_input_frame_handler_t handler);
+
+/**
+ * @brief Replaces the filter and decimation stage of a channel. The stage state is reset.
+ *        Until configured, continuous mode decimates each channel to one value per frame
+ *        and oneshot mode forwards every sample.
+ * @param num    The logical channel number.
+ * @param config New stage configuration, see ANALOG_INPUT_FILTER_DEFAULT_CONFIG().
+ * @return - ESP_OK: Stage replaced.
+ *
+ *         - ESP_ERR_INVALID_ARG: Invalid channel, NULL config or out-of-range parameter.
+ *
+ *         - ESP_ERR_INVALID_STATE: Component not initialized.
+ */
+esp_err_t analog_input_set_filter(analog_input_num_t num, const analog_input_filter_config_t *config);
+
+/**
+ * @brief Replaces the notification policy (deadband and report intervals) of a channel.
+ *        The next filter output is always reported.
+ * @param num    The logical channel number.
+ * @param config New policy, see ANALOG_INPUT_REPORT_DEFAULT_CONFIG().
+ * @return - ESP_OK: Policy replaced.
+ *
+ *         - ESP_ERR_INVALID_ARG: Invalid channel, NULL config, or `max_interval_ms`
+ *           shorter than `min_interval_ms`.
+ *
+ *         - ESP_ERR_INVALID_STATE: Component not initialized.
+ */
+esp_err_t analog_input_set_report(analog_input_num_t num, const analog_input_report_config_t *config);
+
+/**
+ * @brief Retrieves the sampling statistics.
+ * @param stats Output structure.
+ * @return - ESP_OK: Success.
+ *
+ *         - ESP_ERR_INVALID_ARG: Provided stats was NULL.
+ */
+esp_err_t analog_input_get_stats(analog_input_stats_t *stats);
+
+#if CONFIG_ANALOG_INPUT_SAMPLE_TIME
+/**
+ * @brief Acquisition time of the value being notified, for latency tracing.
+ *        Only meaningful inside an event handler, which the dispatcher task
+ *        calls one value at a time.
+ * @return esp_timer time, in us, at which the backend got the frame the
+ *         value was filtered from.
+ */
+int64_t analog_input_get_sample_time(void);
+#endif
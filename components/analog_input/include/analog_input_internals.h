@@ -0,0 +1,124 @@
+#pragma once
+
+#include "analog_input.h"
+#include "sdkconfig.h"
+
+#if !CONFIG_IDF_TARGET_LINUX
+#include "hal/adc_types.h"
+#endif
+
+//**************************************************
+// Defines
+//**************************************************
+
+/**
+ * @brief Conversions (all channels together) delivered by one DMA frame.
+ */
+#define ANALOG_INPUT_FRAME_SAMPLES CONFIG_ANALOG_INPUT_FRAME_SAMPLES
+
+/**
+ * @brief Samples a single channel can hold in one frame.
+ *        The scan pattern alternates channels, so each gets an equal share.
+ */
+#define ANALOG_INPUT_CHANNEL_FRAME_SAMPLES ((ANALOG_INPUT_FRAME_SAMPLES + _ANALOG_INPUT_NUM_MAX - 1) / _ANALOG_INPUT_NUM_MAX)
+
+/**
+ * @brief Capacity of the moving average and median windows.
+ */
+#define ANALOG_INPUT_FILTER_MAX_WINDOW CONFIG_ANALOG_INPUT_FILTER_MAX_WINDOW
+
+//**************************************************
+// Typedefs
+//**************************************************
+
+/**
+ * @brief Demultiplexed block of samples handed by a backend to the pipeline.
+ */
+typedef struct
+{
+  uint16_t samples[_ANALOG_INPUT_NUM_MAX][ANALOG_INPUT_CHANNEL_FRAME_SAMPLES];
+  uint16_t count[_ANALOG_INPUT_NUM_MAX];
+#if CONFIG_ANALOG_INPUT_SAMPLE_TIME
+  int64_t time_us; /**< esp_timer time at which the backend got the frame */
+#endif
+} analog_input_frame_t;
+
+/**
+ * @brief Fixed-point state of a channel filter and decimation stage.
+ */
+typedef struct
+{
+  analog_input_filter_config_t config;
+  uint16_t window[ANALOG_INPUT_FILTER_MAX_WINDOW]; /**< Last samples, in arrival order (ring) */
+  uint16_t sorted[ANALOG_INPUT_FILTER_MAX_WINDOW]; /**< Same samples kept sorted (median) */
+  uint16_t head;                                   /**< Ring index of the oldest sample */
+  uint16_t fill;                                   /**< Samples currently in the window */
+  uint32_t sum;                                    /**< Running sum of the window (moving average) */
+  int32_t iir_q16;                                 /**< IIR output in Q16 */
+  uint32_t decimation_sum;                         /**< Accumulated filtered samples */
+  uint32_t decimation_count;                       /**< Samples accumulated so far */
+} analog_input_filter_t;
+
+//**************************************************
+// Globals
+//**************************************************
+
+#if !CONFIG_IDF_TARGET_LINUX
+/**
+ * @brief Maps logical input IDs to physical ADC1 channels.
+ */
+extern const adc_channel_t analog_input_adc_channel_map[_ANALOG_INPUT_NUM_MAX];
+#endif
+
+//**************************************************
+// Backend Functions
+//**************************************************
+
+/**
+ * @brief Starts the oneshot backend (one sample per channel per period).
+ * @return - ESP_OK: Backend running.
+ *
+ *         - ESP_FAIL: Hardware initialization or task creation failed.
+ */
+esp_err_t analog_input_oneshot_start(const analog_input_config_t *config);
+
+/**
+ * @brief Starts the continuous (DMA) backend.
+ * @return - ESP_OK: Backend running.
+ *
+ *         - ESP_FAIL: Hardware initialization or task creation failed.
+ */
+esp_err_t analog_input_continuous_start(const analog_input_config_t *config);
+
+//**************************************************
+// Pipeline Functions
+//**************************************************
+
+/**
+ * @brief Hands a frame to the pipeline. Called from the backend sampling task.
+ */
+void analog_input_process_frame(const analog_input_frame_t *frame);
+
+/**
+ * @brief Accounts frames the backend had to drop.
+ */
+void analog_input_report_overrun(uint32_t frames);
+
+//**************************************************
+// Filter Functions
+//**************************************************
+
+/**
+ * @brief Validates a configuration and resets the filter state with it.
+ * @return - ESP_OK: Filter ready.
+ *
+ *         - ESP_ERR_INVALID_ARG: Out-of-range parameter.
+ */
+esp_err_t analog_input_filter_init(analog_input_filter_t *filter, const analog_input_filter_config_t *config);
+
+/**
+ * @brief Pushes a raw sample through the filter and decimation stage.
+ * @param out Receives the stage output when one is produced.
+ * @return true when `out` holds a new value for the observers.
+ */
+bool analog_input_filter_push(analog_input_filter_t *filter, uint16_t sample, uint16_t *out);
@@ -0,0 +1,273 @@
+#include "digital_input.h"
+#include "digital_input_internals.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+//**************************************************
+// Defines
+//**************************************************
+
+#define COUNTER_PERIOD_MS CONFIG_DIGITAL_INPUT_COUNTER_PERIOD_MS
+#define COUNTER_WINDOW_SLOTS CONFIG_DIGITAL_INPUT_COUNTER_WINDOW_SLOTS
+
+//**************************************************
+// Typedefs
+//**************************************************
+
+/**
+ * @brief Pulse counter state of an input.
+ */
+typedef struct
+{
+  bool enabled;
+  digital_input_counter_config_t config;
+  uint32_t last_raw;                      /**< Backend count at the last sample */
+  uint64_t total;                         /**< Pulses since the counter was enabled */
+  uint32_t rate_mhz;                      /**< Rate over the window at the last sample */
+  uint64_t totals[COUNTER_WINDOW_SLOTS];  /**< Totals of the last samples (ring) */
+  int64_t times_us[COUNTER_WINDOW_SLOTS]; /**< Times of the last samples (ring) */
+  uint16_t slots;                         /**< Ring slots used, the window spans slots - 1 periods */
+  uint16_t head;                          /**< Ring index of the next sample */
+  uint16_t fill;                          /**< Samples currently in the ring */
+  int64_t last_report_us;                 /**< Time of the last rate event */
+} counter_state_t;
+
+//**************************************************
+// Function Prototypes
+//**************************************************
+
+static void counter_task(void *args);
+
+static void counter_reset(counter_state_t *counter, const uint32_t raw, const int64_t now_us);
+static void counter_update(counter_state_t *counter, const uint32_t raw, const int64_t now_us);
+
+//**************************************************
+// Globals
+//**************************************************
+
+static const char TAG[] = "digital_input:counter";
+
+static SemaphoreHandle_t s_counter_mutex = NULL; /**< Protection for the counter states */
+static TaskHandle_t s_counter_task = NULL;       /**< Task sampling the counters, created on first use */
+
+static counter_state_t s_counters[_DIGITAL_INPUT_NUM_MAX]; /**< Per-input pulse counter state */
+
+//**************************************************
+// Public Functions
+//**************************************************
+
+esp_err_t digital_input_counter_enable(digital_input_num_t num, const digital_input_counter_config_t *config)
+{
+  if (num >= _DIGITAL_INPUT_NUM_MAX || config == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  // The window must be a whole number of periods held by the ring
+  const uint32_t periods = config->window_ms / COUNTER_PERIOD_MS;
+  if (periods == 0 || periods >= COUNTER_WINDOW_SLOTS)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  if (s_counter_mutex == NULL)
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  if (xSemaphoreTake(s_counter_mutex, portMAX_DELAY) != pdTRUE)
+  {
+    return ESP_FAIL;
+  }
+
+  esp_err_t err = ESP_OK;
+  counter_state_t *counter = &s_counters[num];
+
+  if (counter->enabled)
+  {
+    err = ESP_ERR_INVALID_STATE;
+  }
+  else if (digital_input_capture_release(num) != ESP_OK || digital_input_pulse_start(num, config) != ESP_OK)
+  {
+    // The input goes back to edge capture rather than to neither
+    ESP_LOGE(TAG, "%s:Fail to start counter %d", __func__, num);
+    digital_input_capture_acquire(num);
+    err = ESP_FAIL;
+  }
+  else if (s_counter_task == NULL &&
+           xTaskCreate(counter_task, "counter_task", 2048, NULL, 2, &s_counter_task) != pdPASS)
+  {
+    ESP_LOGE(TAG, "%s:Fail to create counter task", __func__);
+    s_counter_task = NULL;
+    digital_input_pulse_stop(num);
+    digital_input_capture_acquire(num);
+    err = ESP_FAIL;
+  }
+  else
+  {
+    counter->config = *config;
+    counter->slots = periods + 1;
+    counter_reset(counter, digital_input_pulse_read(num), esp_timer_get_time());
+    counter->enabled = true;
+  }
+
+  xSemaphoreGive(s_counter_mutex);
+  return err;
+}
+
+esp_err_t digital_input_counter_get(digital_input_num_t num, uint64_t *count, uint32_t *rate_mhz)
+{
+  if (num >= _DIGITAL_INPUT_NUM_MAX || count == NULL || rate_mhz == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  if (s_counter_mutex == NULL)
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  if (xSemaphoreTake(s_counter_mutex, portMAX_DELAY) != pdTRUE)
+  {
+    return ESP_FAIL;
+  }
+
+  esp_err_t err = ESP_ERR_INVALID_STATE;
+  if (s_counters[num].enabled)
+  {
+    *count = s_counters[num].total;
+    *rate_mhz = s_counters[num].rate_mhz;
+    err = ESP_OK;
+  }
+
+  xSemaphoreGive(s_counter_mutex);
+  return err;
+}
+
+//**************************************************
+// Pulse Counter Functions
+//**************************************************
+
+esp_err_t digital_input_counter_setup(void)
+{
+  if ((s_counter_mutex = xSemaphoreCreateMutex()) == NULL)
+  {
+    ESP_LOGE(TAG, "%s:Fail to create counter mutex", __func__);
+    return ESP_FAIL;
+  }
+
+  return ESP_OK;
+}
+
+//**************************************************
+// Static Functions
+//**************************************************
+
+/**
+ * @brief Samples every counting input each period, updates its rate and
+ *        publishes the rate events that are due.
+ */
+static void counter_task(void *args)
+{
+  TickType_t last_wake_time = xTaskGetTickCount();
+  digital_input_event_t events[_DIGITAL_INPUT_NUM_MAX];
+
+  while (true)
+  {
+    xTaskDelayUntil(&last_wake_time, pdMS_TO_TICKS(COUNTER_PERIOD_MS));
+
+    if (xSemaphoreTake(s_counter_mutex, portMAX_DELAY) != pdTRUE)
+    {
+      continue;
+    }
+
+    size_t event_count = 0;
+
+    for (int i = 0; i < _DIGITAL_INPUT_NUM_MAX; i++)
+    {
+      counter_state_t *counter = &s_counters[i];
+      if (!counter->enabled)
+      {
+        continue;
+      }
+
+      // The hardware keeps counting, only the read time matters for the rate
+      const uint32_t raw = digital_input_pulse_read(i);
+      const int64_t now_us = esp_timer_get_time();
+      counter_update(counter, raw, now_us);
+
+      const uint32_t report_period_ms = counter->config.report_period_ms;
+      if (report_period_ms == 0 || now_us - counter->last_report_us < (int64_t)report_period_ms * 1000)
+      {
+        continue;
+      }
+
+      counter->last_report_us = now_us;
+      events[event_count++] = (digital_input_event_t){
+          .type = DIGITAL_INPUT_EVENT_RATE,
+          .num = i,
+          .timestamp_us = now_us,
+          .count = counter->total,
+          .rate_mhz = counter->rate_mhz,
+      };
+    }
+
+    xSemaphoreGive(s_counter_mutex);
+
+    // Observers run without the counter lock held
+    for (size_t i = 0; i < event_count; i++)
+    {
+      digital_input_publish(&events[i]);
+    }
+  }
+
+  vTaskDelete(NULL);
+}
+
+/**
+ * @brief Restarts the total and the window from the current backend count.
+ */
+static void counter_reset(counter_state_t *counter, const uint32_t raw, const int64_t now_us)
+{
+  counter->last_raw = raw;
+  counter->total = 0;
+  counter->rate_mhz = 0;
+  counter->totals[0] = 0;
+  counter->times_us[0] = now_us;
+  counter->head = 1;
+  counter->fill = 1;
+  counter->last_report_us = now_us;
+}
+
+/**
+ * @brief Accumulates the pulses since the last sample and measures the rate
+ *        between the oldest and the newest sample of the window.
+ */
+static void counter_update(counter_state_t *counter, const uint32_t raw, const int64_t now_us)
+{
+  // Unsigned difference stays correct across a wrap of the backend count
+  counter->total += (uint32_t)(raw - counter->last_raw);
+  counter->last_raw = raw;
+
+  counter->totals[counter->head] = counter->total;
+  counter->times_us[counter->head] = now_us;
+  counter->head = (counter->head + 1) % counter->slots;
+  if (counter->fill < counter->slots)
+  {
+    counter->fill++;
+  }
+
+  // Until the ring is full the oldest sample is the first one
+  const uint16_t oldest = counter->fill < counter->slots ? 0 : counter->head;
+  const int64_t elapsed_us = now_us - counter->times_us[oldest];
+  if (elapsed_us <= 0)
+  {
+    return;
+  }
+
+  const uint64_t rate_mhz = (counter->total - counter->totals[oldest]) * 1000000000ULL / (uint64_t)elapsed_us;
+  counter->rate_mhz = rate_mhz > UINT32_MAX ? UINT32_MAX : (uint32_t)rate_mhz;
+}
@@ -0,0 +1,154 @@
+#include "digital_input_internals.h"
+
+//**************************************************
+// Function Prototypes
+//**************************************************
+
+static bool update_integrator(digital_input_debouncer_t *debouncer, const bool level, const int64_t now_us);
+static bool update_consecutive(digital_input_debouncer_t *debouncer, const bool level, const int64_t now_us);
+static bool update_lockout(digital_input_debouncer_t *debouncer, const bool level, const int64_t now_us);
+
+//**************************************************
+// Debounce Functions
+//**************************************************
+
+esp_err_t digital_input_debounce_init(digital_input_debouncer_t *debouncer, const digital_input_debounce_config_t *config, bool state)
+{
+  switch (config->mode)
+  {
+  case DIGITAL_INPUT_DEBOUNCE_NONE:
+  case DIGITAL_INPUT_DEBOUNCE_LOCKOUT:
+    break;
+
+  case DIGITAL_INPUT_DEBOUNCE_INTEGRATOR:
+  case DIGITAL_INPUT_DEBOUNCE_CONSECUTIVE:
+    if (config->samples == 0)
+    {
+      return ESP_ERR_INVALID_ARG;
+    }
+    break;
+
+  default:
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  *debouncer = (digital_input_debouncer_t){
+      .config = *config,
+      .state = state,
+  };
+
+  // The integrator rests on the rail matching the state
+  if (config->mode == DIGITAL_INPUT_DEBOUNCE_INTEGRATOR && state)
+  {
+    debouncer->counter = config->samples;
+  }
+
+  return ESP_OK;
+}
+
+bool digital_input_debounce_update(digital_input_debouncer_t *debouncer, bool level, int64_t now_us, int64_t *edge_us)
+{
+  bool flipped;
+
+  switch (debouncer->config.mode)
+  {
+  case DIGITAL_INPUT_DEBOUNCE_INTEGRATOR:
+    flipped = update_integrator(debouncer, level, now_us);
+    break;
+
+  case DIGITAL_INPUT_DEBOUNCE_CONSECUTIVE:
+    flipped = update_consecutive(debouncer, level, now_us);
+    break;
+
+  case DIGITAL_INPUT_DEBOUNCE_LOCKOUT:
+    flipped = update_lockout(debouncer, level, now_us);
+    break;
+
+  default:
+    flipped = level != debouncer->state;
+    debouncer->pending_us = now_us;
+    break;
+  }
+
+  if (flipped)
+  {
+    debouncer->state = !debouncer->state;
+    *edge_us = debouncer->pending_us;
+  }
+
+  return flipped;
+}
+
+//**************************************************
+// Static Functions
+//**************************************************
+
+/**
+ * @brief Counter moves one step towards the level on every sample. The state
+ *        flips when it reaches the opposite rail, so isolated glitches only
+ *        delay a change instead of restarting it.
+ */
+static bool update_integrator(digital_input_debouncer_t *debouncer, const bool level, const int64_t now_us)
+{
+  const uint16_t rail = debouncer->state ? debouncer->config.samples : 0;
+
+  // Leaving the rail starts a pending change
+  if (debouncer->counter == rail && level != debouncer->state)
+  {
+    debouncer->pending_us = now_us;
+  }
+
+  if (level && debouncer->counter < debouncer->config.samples)
+  {
+    debouncer->counter++;
+  }
+  else if (!level && debouncer->counter > 0)
+  {
+    debouncer->counter--;
+  }
+
+  return debouncer->state ? debouncer->counter == 0 : debouncer->counter == debouncer->config.samples;
+}
+
+/**
+ * @brief The state flips after `samples` consecutive samples at the new level.
+ *        Any sample at the current level restarts the count.
+ */
+static bool update_consecutive(digital_input_debouncer_t *debouncer, const bool level, const int64_t now_us)
+{
+  if (level == debouncer->state)
+  {
+    debouncer->counter = 0;
+    return false;
+  }
+
+  if (debouncer->counter == 0)
+  {
+    debouncer->pending_us = now_us;
+  }
+
+  if (++debouncer->counter < debouncer->config.samples)
+  {
+    return false;
+  }
+
+  debouncer->counter = 0;
+  return true;
+}
+
+/**
+ * @brief The first change is reported immediately, then the input is ignored
+ *        for `lockout_us`. Lowest latency, relies on the sampling to recover
+ *        from a level that changed during the lock-out.
+ */
+static bool update_lockout(digital_input_debouncer_t *debouncer, const bool level, const int64_t now_us)
+{
+  if (now_us < debouncer->lockout_until_us || level == debouncer->state)
+  {
+    return false;
+  }
+
+  debouncer->pending_us = now_us;
+  debouncer->lockout_until_us = now_us + debouncer->config.lockout_us;
+  return true;
+}
@@ -0,0 +1,301 @@
+#include "digital_input_internals.h"
+#include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "driver/gpio.h"
+
+//**************************************************
+// Defines
+//**************************************************
+
+#define GET_BIT(val, bit) (((val) >> (bit)) & 0x01)
+#define SET_BIT(val, bit) ((val) |= (1U << (bit)))
+#define CLEAR_BIT(val, bit) ((val) &= ~(1U << (bit)))
+
+//**************************************************
+// Funtion Prototypes
+//**************************************************
+
+static void sample_timer_callback(void *args);
+static void input_isr_handler(void *args);
+
+static esp_err_t start_interrupt_capture(void);
+static esp_err_t start_sampling(const uint32_t period_us);
+
+//**************************************************
+// Globals
+//**************************************************
+
+static const char TAG[] = "digital_input:gpio";
+
+const gpio_num_t digital_input_gpio_map[_DIGITAL_INPUT_NUM_MAX] = {GPIO_NUM_25, GPIO_NUM_26, GPIO_NUM_27};
+
+static uint16_t s_captured_levels = 0;           /**< Interrupt mode: levels last seen by the ISR */
+static uint16_t s_released_inputs = 0;           /**< Inputs handed to the pulse counter */
+static digital_input_mode_t s_mode;              /**< Active capture backend */
+static esp_timer_handle_t s_sample_timer = NULL; /**< Polling mode sampling timer */
+
+static digital_input_debouncer_t s_debouncers[_DIGITAL_INPUT_NUM_MAX]; /**< Polling mode per-input debounce state */
+static portMUX_TYPE s_debounce_lock = portMUX_INITIALIZER_UNLOCKED;     /**< Protection for the debouncers and released inputs */
+
+//**************************************************
+// Capture Backend Functions
+//**************************************************
+
+esp_err_t digital_input_capture_start(const digital_input_config_t *config)
+{
+  // Hardware configuration: Inputs with Internal Pull-up
+  gpio_config_t io_conf = {
+      .intr_type = GPIO_INTR_DISABLE,
+      .mode = GPIO_MODE_INPUT,
+      .pin_bit_mask = 0,
+      .pull_up_en = GPIO_PULLUP_ENABLE,
+      .pull_down_en = GPIO_PULLDOWN_DISABLE,
+  };
+
+  for (uint16_t i = 0; i < _DIGITAL_INPUT_NUM_MAX; i++)
+  {
+    io_conf.pin_bit_mask |= 1ULL << digital_input_gpio_map[i];
+  }
+
+  if (gpio_config(&io_conf) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Fail to config inputs", __func__);
+    return ESP_FAIL;
+  }
+
+  s_mode = config->mode;
+
+  if (config->mode == DIGITAL_INPUT_MODE_INTERRUPT)
+  {
+    return start_interrupt_capture();
+  }
+
+  return start_sampling(config->sample_period_us);
+}
+
+esp_err_t digital_input_capture_set_debounce(digital_input_num_t num, const digital_input_debounce_config_t *config)
+{
+  if (s_mode != DIGITAL_INPUT_MODE_POLLING)
+  {
+    return ESP_ERR_NOT_SUPPORTED;
+  }
+
+  // The sampling callback runs in the esp_timer task, keep the swap atomic
+  portENTER_CRITICAL(&s_debounce_lock);
+  esp_err_t err = digital_input_debounce_init(&s_debouncers[num], config, s_debouncers[num].state);
+  portEXIT_CRITICAL(&s_debounce_lock);
+
+  return err;
+}
+
+esp_err_t digital_input_capture_release(digital_input_num_t num)
+{
+  if (s_mode == DIGITAL_INPUT_MODE_INTERRUPT)
+  {
+    if (gpio_isr_handler_remove(digital_input_gpio_map[num]) != ESP_OK ||
+        gpio_set_intr_type(digital_input_gpio_map[num], GPIO_INTR_DISABLE) != ESP_OK)
+    {
+      ESP_LOGE(TAG, "%s:Fail to remove isr handler %d", __func__, num);
+      return ESP_FAIL;
+    }
+
+    return ESP_OK;
+  }
+
+  portENTER_CRITICAL(&s_debounce_lock);
+  SET_BIT(s_released_inputs, num);
+  portEXIT_CRITICAL(&s_debounce_lock);
+
+  return ESP_OK;
+}
+
+esp_err_t digital_input_capture_acquire(digital_input_num_t num)
+{
+  if (s_mode == DIGITAL_INPUT_MODE_INTERRUPT)
+  {
+    // Only the ISRs push edges, so the level is resynced without reporting
+    // the change. The next edge of the input is reported as usual
+    portENTER_CRITICAL(&s_debounce_lock);
+    if (!gpio_get_level(digital_input_gpio_map[num]))
+    {
+      SET_BIT(s_captured_levels, num);
+    }
+    else
+    {
+      CLEAR_BIT(s_captured_levels, num);
+    }
+    portEXIT_CRITICAL(&s_debounce_lock);
+
+    if (gpio_set_intr_type(digital_input_gpio_map[num], GPIO_INTR_ANYEDGE) != ESP_OK ||
+        gpio_isr_handler_add(digital_input_gpio_map[num], input_isr_handler, (void *)(uintptr_t)num) != ESP_OK)
+    {
+      ESP_LOGE(TAG, "%s:Fail to add isr handler %d", __func__, num);
+      return ESP_FAIL;
+    }
+
+    return ESP_OK;
+  }
+
+  // The debouncer kept its state, a level change while released shows up as one edge
+  portENTER_CRITICAL(&s_debounce_lock);
+  CLEAR_BIT(s_released_inputs, num);
+  portEXIT_CRITICAL(&s_debounce_lock);
+
+  return ESP_OK;
+}
+
+//**************************************************
+// Static Funtions
+//**************************************************
+
+/**
+ * @brief Installs the GPIO ISR on every input. Inputs already active at boot
+ *        are reported as an edge, as the polling reader would do.
+ */
+static esp_err_t start_interrupt_capture(void)
+{
+  // Another component may have installed the service already
+  esp_err_t err = gpio_install_isr_service(0);
+  if (err != ESP_OK && err != ESP_ERR_INVALID_STATE)
+  {
+    ESP_LOGE(TAG, "%s:Fail to install isr service", __func__);
+    return ESP_FAIL;
+  }
+
+  // Seed the capture state before any interrupt is enabled (single producer)
+  for (uint16_t i = 0; i < _DIGITAL_INPUT_NUM_MAX; i++)
+  {
+    if (!gpio_get_level(digital_input_gpio_map[i]))
+    {
+      SET_BIT(s_captured_levels, i);
+      digital_input_push_edge(i, true, esp_timer_get_time());
+    }
+  }
+
+  digital_input_wake_dispatcher();
+
+  for (uint16_t i = 0; i < _DIGITAL_INPUT_NUM_MAX; i++)
+  {
+    if (gpio_set_intr_type(digital_input_gpio_map[i], GPIO_INTR_ANYEDGE) != ESP_OK ||
+        gpio_isr_handler_add(digital_input_gpio_map[i], input_isr_handler, (void *)(uintptr_t)i) != ESP_OK)
+    {
+      ESP_LOGE(TAG, "%s:Fail to add isr handler %d", __func__, i);
+      return ESP_FAIL;
+    }
+  }
+
+  return ESP_OK;
+}
+
+/**
+ * @brief Starts the periodic sampling timer. Every input starts inactive, so
+ *        inputs already active at boot are reported once debounced.
+ */
+static esp_err_t start_sampling(const uint32_t period_us)
+{
+  const digital_input_debounce_config_t debounce_config = DIGITAL_INPUT_DEBOUNCE_DEFAULT_CONFIG();
+
+  for (uint16_t i = 0; i < _DIGITAL_INPUT_NUM_MAX; i++)
+  {
+    if (digital_input_debounce_init(&s_debouncers[i], &debounce_config, false) != ESP_OK)
+    {
+      ESP_LOGE(TAG, "%s:Invalid default debounce config", __func__);
+      return ESP_FAIL;
+    }
+  }
+
+  const esp_timer_create_args_t timer_args = {
+      .callback = sample_timer_callback,
+      .dispatch_method = ESP_TIMER_TASK,
+      .name = "digital_input",
+      .skip_unhandled_events = true,
+  };
+
+  if (esp_timer_create(&timer_args, &s_sample_timer) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Fail to create sample timer", __func__);
+    return ESP_FAIL;
+  }
+
+  if (esp_timer_start_periodic(s_sample_timer, period_us) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Fail to start sample timer", __func__);
+    return ESP_FAIL;
+  }
+
+  return ESP_OK;
+}
+
+/**
+ * @brief GPIO ISR: timestamps the edge and pushes it to the edge ring.
+ *        If the level already returned to the previous state, a pulse shorter
+ *        than the interrupt latency occurred and both edges are reported.
+ */
+static void IRAM_ATTR input_isr_handler(void *args)
+{
+  const digital_input_num_t num = (digital_input_num_t)(uintptr_t)args;
+  const int64_t timestamp_us = esp_timer_get_time();
+
+  // Read hardware (inverted because of internal Pull-up)
+  const bool level = !gpio_get_level(digital_input_gpio_map[num]);
+  const bool previous = GET_BIT(s_captured_levels, num);
+
+  if (level == previous)
+  {
+    digital_input_push_edge(num, !previous, timestamp_us);
+  }
+
+  digital_input_push_edge(num, level, timestamp_us);
+
+  if (level)
+  {
+    SET_BIT(s_captured_levels, num);
+  }
+  else
+  {
+    CLEAR_BIT(s_captured_levels, num);
+  }
+
+  digital_input_wake_dispatcher_from_isr();
+}
+
+/**
+ * @brief Sampling timer callback: Reads every input, runs its debouncer and
+ *        pushes the debounced edges to the edge ring. Runs in the esp_timer task,
+ *        which is the single producer in polling mode.
+ */
+static void sample_timer_callback(void *args)
+{
+  const int64_t now_us = esp_timer_get_time();
+  bool pushed = false;
+
+  portENTER_CRITICAL(&s_debounce_lock);
+
+  for (uint16_t i = 0; i < _DIGITAL_INPUT_NUM_MAX; i++)
+  {
+    // Inputs handed to the pulse counter are not sampled
+    if (GET_BIT(s_released_inputs, i))
+    {
+      continue;
+    }
+
+    // Read hardware (inverted because of internal Pull-up)
+    const bool level = !gpio_get_level(digital_input_gpio_map[i]);
+
+    int64_t edge_us;
+    if (digital_input_debounce_update(&s_debouncers[i], level, now_us, &edge_us))
+    {
+      digital_input_push_edge(i, s_debouncers[i].state, edge_us);
+      pushed = true;
+    }
+  }
+
+  portEXIT_CRITICAL(&s_debounce_lock);
+
+  if (pushed)
+  {
+    digital_input_wake_dispatcher();
+  }
+}
@@ -0,0 +1,147 @@
+#include "digital_input_internals.h"
+#include "esp_log.h"
+#include "driver/pulse_cnt.h"
+
+//**************************************************
+// Defines
+//**************************************************
+
+#define PCNT_HIGH_LIMIT 32767 // Hardware counter range, extended by accumulation
+#define PCNT_LOW_LIMIT -1     // Counting only goes up
+
+//**************************************************
+// Globals
+//**************************************************
+
+static const char TAG[] = "digital_input:pcnt";
+
+static pcnt_unit_handle_t s_units[_DIGITAL_INPUT_NUM_MAX] = {NULL};       /**< One PCNT unit per counting input */
+static pcnt_channel_handle_t s_channels[_DIGITAL_INPUT_NUM_MAX] = {NULL}; /**< Edge channel of each unit */
+static bool s_enabled[_DIGITAL_INPUT_NUM_MAX] = {false};                  /**< Unit enabled, it must be disabled before deletion */
+static int s_counts[_DIGITAL_INPUT_NUM_MAX] = {0};                        /**< Last successful read of each unit */
+
+//**************************************************
+// Pulse Counter Backend Functions
+//**************************************************
+
+esp_err_t digital_input_pulse_start(digital_input_num_t num, const digital_input_counter_config_t *config)
+{
+  // The driver accumulates overflows at the watch point, so reads never wrap at 16 bits
+  const pcnt_unit_config_t unit_config = {
+      .low_limit = PCNT_LOW_LIMIT,
+      .high_limit = PCNT_HIGH_LIMIT,
+      .flags.accum_count = true,
+  };
+
+  if (pcnt_new_unit(&unit_config, &s_units[num]) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Fail to create unit %d", __func__, num);
+    s_units[num] = NULL;
+    return ESP_FAIL;
+  }
+
+  if (config->glitch_ns != 0)
+  {
+    const pcnt_glitch_filter_config_t filter_config = {
+        .max_glitch_ns = config->glitch_ns,
+    };
+
+    if (pcnt_unit_set_glitch_filter(s_units[num], &filter_config) != ESP_OK)
+    {
+      ESP_LOGE(TAG, "%s:Fail to set glitch filter %d", __func__, num);
+      goto fail;
+    }
+  }
+
+  const pcnt_chan_config_t channel_config = {
+      .edge_gpio_num = digital_input_gpio_map[num],
+      .level_gpio_num = -1,
+  };
+
+  if (pcnt_new_channel(s_units[num], &channel_config, &s_channels[num]) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Fail to create channel %d", __func__, num);
+    s_channels[num] = NULL;
+    goto fail;
+  }
+
+  // Inputs are active low: an active edge is a falling pin edge
+  pcnt_channel_edge_action_t pin_rising = PCNT_CHANNEL_EDGE_ACTION_HOLD;
+  pcnt_channel_edge_action_t pin_falling = PCNT_CHANNEL_EDGE_ACTION_HOLD;
+
+  if (config->edge == DIGITAL_INPUT_COUNT_RISING || config->edge == DIGITAL_INPUT_COUNT_BOTH)
+  {
+    pin_falling = PCNT_CHANNEL_EDGE_ACTION_INCREASE;
+  }
+
+  if (config->edge == DIGITAL_INPUT_COUNT_FALLING || config->edge == DIGITAL_INPUT_COUNT_BOTH)
+  {
+    pin_rising = PCNT_CHANNEL_EDGE_ACTION_INCREASE;
+  }
+
+  if (pcnt_channel_set_edge_action(s_channels[num], pin_rising, pin_falling) != ESP_OK ||
+      pcnt_unit_add_watch_point(s_units[num], PCNT_HIGH_LIMIT) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Fail to config channel %d", __func__, num);
+    goto fail;
+  }
+
+  if (pcnt_unit_enable(s_units[num]) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Fail to enable unit %d", __func__, num);
+    goto fail;
+  }
+  s_enabled[num] = true;
+
+  if (pcnt_unit_clear_count(s_units[num]) != ESP_OK ||
+      pcnt_unit_start(s_units[num]) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Fail to start unit %d", __func__, num);
+    goto fail;
+  }
+
+  return ESP_OK;
+
+fail:
+  digital_input_pulse_stop(num);
+  return ESP_FAIL;
+}
+
+void digital_input_pulse_stop(digital_input_num_t num)
+{
+  if (s_units[num] == NULL)
+  {
+    return;
+  }
+
+  // Stopping a unit that never started is harmless, it must only be enabled
+  if (s_enabled[num])
+  {
+    pcnt_unit_stop(s_units[num]);
+    pcnt_unit_disable(s_units[num]);
+    s_enabled[num] = false;
+  }
+
+  if (s_channels[num] != NULL)
+  {
+    pcnt_del_channel(s_channels[num]);
+    s_channels[num] = NULL;
+  }
+
+  if (pcnt_del_unit(s_units[num]) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Fail to delete unit %d", __func__, num);
+  }
+  s_units[num] = NULL;
+}
+
+uint32_t digital_input_pulse_read(digital_input_num_t num)
+{
+  // On failure the previous count is kept, the pulses show up on the next read
+  if (pcnt_unit_get_count(s_units[num], &s_counts[num]) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Fail to read unit %d", __func__, num);
+  }
+
+  return (uint32_t)s_counts[num];
+}
@@ -0,0 +1,137 @@
+#include "digital_input_internals.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+//**************************************************
+// Typedefs
+//**************************************************
+
+/**
+ * @brief Simulated pulse train of an input.
+ */
+typedef struct
+{
+  uint32_t rate_mhz;      /**< Pulses per second, in mHz */
+  uint64_t base_count;    /**< Pulses generated before the rate was last set */
+  uint32_t base_fraction; /**< Part of a pulse generated on top of base_count, in billionths */
+  int64_t base_us;        /**< Time the rate was last set */
+} pulse_train_t;
+
+//**************************************************
+// Function Prototypes
+//**************************************************
+
+static uint64_t pulse_train_count(const pulse_train_t *train, const int64_t now_us, uint32_t *fraction);
+
+//**************************************************
+// Globals
+//**************************************************
+
+static digital_input_debouncer_t s_debouncers[_DIGITAL_INPUT_NUM_MAX]; /**< Debounce settings, kept for the API only */
+static pulse_train_t s_trains[_DIGITAL_INPUT_NUM_MAX];                  /**< Per-input pulse generator */
+static portMUX_TYPE s_train_lock = portMUX_INITIALIZER_UNLOCKED;        /**< Protection for the pulse generators */
+
+//**************************************************
+// Capture Backend Functions
+//**************************************************
+
+esp_err_t digital_input_capture_start(const digital_input_config_t *config)
+{
+  // Host stand-in: the inputs stay inactive, no edge is ever captured
+  const digital_input_debounce_config_t debounce_config = DIGITAL_INPUT_DEBOUNCE_DEFAULT_CONFIG();
+
+  for (int i = 0; i < _DIGITAL_INPUT_NUM_MAX; i++)
+  {
+    digital_input_debounce_init(&s_debouncers[i], &debounce_config, false);
+  }
+
+  return ESP_OK;
+}
+
+esp_err_t digital_input_capture_set_debounce(digital_input_num_t num, const digital_input_debounce_config_t *config)
+{
+  return digital_input_debounce_init(&s_debouncers[num], config, false);
+}
+
+esp_err_t digital_input_capture_release(digital_input_num_t num)
+{
+  return ESP_OK;
+}
+
+esp_err_t digital_input_capture_acquire(digital_input_num_t num)
+{
+  return ESP_OK;
+}
+
+//**************************************************
+// Pulse Counter Backend Functions
+//**************************************************
+
+esp_err_t digital_input_pulse_start(digital_input_num_t num, const digital_input_counter_config_t *config)
+{
+  return ESP_OK;
+}
+
+void digital_input_pulse_stop(digital_input_num_t num)
+{
+}
+
+uint32_t digital_input_pulse_read(digital_input_num_t num)
+{
+  const int64_t now_us = esp_timer_get_time();
+
+  portENTER_CRITICAL(&s_train_lock);
+  const uint64_t count = pulse_train_count(&s_trains[num], now_us, NULL);
+  portEXIT_CRITICAL(&s_train_lock);
+
+  // Truncated like a hardware counter, the counter service handles the wrap
+  return (uint32_t)count;
+}
+
+void digital_input_sim_set_pulse_rate(digital_input_num_t num, uint32_t rate_mhz)
+{
+  if (num >= _DIGITAL_INPUT_NUM_MAX)
+  {
+    return;
+  }
+
+  const int64_t now_us = esp_timer_get_time();
+  uint32_t fraction;
+
+  // Keep the pulses already generated at the previous rate, the partial one
+  // too unless the train stops
+  portENTER_CRITICAL(&s_train_lock);
+  s_trains[num].base_count = pulse_train_count(&s_trains[num], now_us, &fraction);
+  s_trains[num].base_fraction = rate_mhz != 0 ? fraction : 0;
+  s_trains[num].base_us = now_us;
+  s_trains[num].rate_mhz = rate_mhz;
+  portEXIT_CRITICAL(&s_train_lock);
+}
+
+//**************************************************
+// Static Functions
+//**************************************************
+
+/**
+ * @brief Whole pulses generated by a train up to `now_us`.
+ * @param fraction Part of the next pulse generated so far, in billionths,
+ *        or NULL.
+ */
+static uint64_t pulse_train_count(const pulse_train_t *train, const int64_t now_us, uint32_t *fraction)
+{
+  const uint64_t elapsed_us = now_us > train->base_us ? (uint64_t)(now_us - train->base_us) : 0;
+
+  // Split in whole seconds and remainder to keep the products in 64 bits, the
+  // thousandths of a pulse left by the whole seconds carry into the remainder
+  const uint64_t seconds = elapsed_us / 1000000;
+  const uint64_t remainder_us = elapsed_us % 1000000;
+  const uint64_t whole = seconds * train->rate_mhz;
+  const uint64_t partial = (whole % 1000) * 1000000ULL + remainder_us * train->rate_mhz + train->base_fraction;
+
+  if (fraction != NULL)
+  {
+    *fraction = (uint32_t)(partial % 1000000000ULL);
+  }
+
+  return train->base_count + whole / 1000 + partial / 1000000000ULL;
+}
@@ -0,0 +1,242 @@
+#include "digital_input_internals.h"
+#include "unity.h"
+
+//**************************************************
+// Defines
+//**************************************************
+
+#define SAMPLE_US 1000 // 1 ms sampling, the menuconfig default
+#define SAMPLES 5
+#define LOCKOUT_US 20000
+#define BOUNCED_EDGES 500
+
+//**************************************************
+// Function Prototypes
+//**************************************************
+
+void debounce_tests_run(void);
+static size_t feed(digital_input_debouncer_t *debouncer, const bool *levels, size_t count, int64_t *edges_us);
+static void init(digital_input_debouncer_t *debouncer, digital_input_debounce_mode_t mode, bool state);
+static uint32_t random_next(void);
+
+//**************************************************
+// Globals
+//**************************************************
+
+static int64_t s_time_us; /**< Time of the next sample */
+static uint32_t s_seed = 7;
+
+//**************************************************
+// Tests
+//**************************************************
+
+/**
+ * @brief Unknown modes and zero sample counts are rejected, an integrator
+ *        settled active needs a full run of samples to flip.
+ */
+static void test_init(void)
+{
+  digital_input_debouncer_t debouncer;
+  const digital_input_debounce_config_t zero = {.mode = DIGITAL_INPUT_DEBOUNCE_INTEGRATOR, .samples = 0};
+  const digital_input_debounce_config_t zero_run = {.mode = DIGITAL_INPUT_DEBOUNCE_CONSECUTIVE, .samples = 0};
+  const digital_input_debounce_config_t unknown = {.mode = DIGITAL_INPUT_DEBOUNCE_CONSECUTIVE + 1, .samples = 1};
+  const digital_input_debounce_config_t lockout = {.mode = DIGITAL_INPUT_DEBOUNCE_LOCKOUT, .lockout_us = 0};
+
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, digital_input_debounce_init(&debouncer, &zero, false));
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, digital_input_debounce_init(&debouncer, &zero_run, false));
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, digital_input_debounce_init(&debouncer, &unknown, false));
+  TEST_ASSERT_EQUAL(ESP_OK, digital_input_debounce_init(&debouncer, &lockout, false));
+
+  static const bool low[SAMPLES] = {false, false, false, false, false};
+  int64_t edges_us[SAMPLES];
+  init(&debouncer, DIGITAL_INPUT_DEBOUNCE_INTEGRATOR, true);
+  TEST_ASSERT_EQUAL(0, feed(&debouncer, low, SAMPLES - 1, edges_us));
+  TEST_ASSERT_EQUAL(1, feed(&debouncer, low, 1, edges_us));
+  TEST_ASSERT_FALSE(debouncer.state);
+}
+
+/**
+ * @brief A clean edge is reported once by every mode, with the time of the
+ *        first sample at the new level.
+ */
+static void test_clean_edge(void)
+{
+  static const bool levels[] = {false, false, true, true, true, true, true, true, true, true};
+  static const struct
+  {
+    digital_input_debounce_mode_t mode;
+    size_t reported_at; /**< Sample that flips the state */
+  } modes[] = {
+      {DIGITAL_INPUT_DEBOUNCE_NONE, 2},
+      {DIGITAL_INPUT_DEBOUNCE_LOCKOUT, 2},
+      {DIGITAL_INPUT_DEBOUNCE_INTEGRATOR, 2 + SAMPLES - 1},
+      {DIGITAL_INPUT_DEBOUNCE_CONSECUTIVE, 2 + SAMPLES - 1},
+  };
+
+  for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); i++)
+  {
+    digital_input_debouncer_t debouncer;
+    int64_t edges_us[2];
+    init(&debouncer, modes[i].mode, false);
+    const int64_t start_us = s_time_us;
+
+    TEST_ASSERT_EQUAL(0, feed(&debouncer, levels, modes[i].reported_at, edges_us));
+    TEST_ASSERT_EQUAL(1, feed(&debouncer, &levels[modes[i].reported_at], 1, edges_us));
+    TEST_ASSERT_EQUAL_INT64(start_us + 2 * SAMPLE_US, edges_us[0]);
+
+    const size_t rest = sizeof(levels) / sizeof(levels[0]) - modes[i].reported_at - 1;
+    TEST_ASSERT_EQUAL(0, feed(&debouncer, &levels[modes[i].reported_at + 1], rest, edges_us));
+    TEST_ASSERT_TRUE(debouncer.state);
+  }
+}
+
+/**
+ * @brief Single-sample glitches never flip a filtering debouncer. The
+ *        integrator only slows down on them, the consecutive count restarts.
+ */
+static void test_glitches(void)
+{
+  // Settled low, a glitch every third sample
+  static const bool glitchy[] = {false, true, false, false, true, false, false, true, false, false, true, false};
+  // Rising edge with a glitch back low after three samples
+  static const bool edge[] = {true, true, true, false, true, true, true, true, true, true};
+  int64_t edges_us[8];
+  digital_input_debouncer_t debouncer;
+
+  init(&debouncer, DIGITAL_INPUT_DEBOUNCE_INTEGRATOR, false);
+  TEST_ASSERT_EQUAL(0, feed(&debouncer, glitchy, sizeof(glitchy), edges_us));
+  int64_t start_us = s_time_us;
+  TEST_ASSERT_EQUAL(1, feed(&debouncer, edge, sizeof(edge), edges_us));
+  TEST_ASSERT_EQUAL_INT64(start_us, edges_us[0]); // 3 up, 1 down, 3 up: flips on sample 7
+
+  init(&debouncer, DIGITAL_INPUT_DEBOUNCE_CONSECUTIVE, false);
+  TEST_ASSERT_EQUAL(0, feed(&debouncer, glitchy, sizeof(glitchy), edges_us));
+  start_us = s_time_us;
+  TEST_ASSERT_EQUAL(1, feed(&debouncer, edge, sizeof(edge), edges_us));
+  TEST_ASSERT_EQUAL_INT64(start_us + 4 * SAMPLE_US, edges_us[0]); // The run restarts after the glitch
+
+  init(&debouncer, DIGITAL_INPUT_DEBOUNCE_NONE, false);
+  TEST_ASSERT_EQUAL(8, feed(&debouncer, glitchy, sizeof(glitchy), edges_us));
+}
+
+/**
+ * @brief Lock-out reports the first change at once, ignores the bounces for
+ *        lockout_us, then catches up with a level that changed meanwhile.
+ */
+static void test_lockout(void)
+{
+  bool levels[3 * LOCKOUT_US / SAMPLE_US];
+  int64_t edges_us[8];
+  digital_input_debouncer_t debouncer;
+
+  init(&debouncer, DIGITAL_INPUT_DEBOUNCE_LOCKOUT, false);
+  const int64_t start_us = s_time_us;
+
+  // Bounces for 5 ms, then settles high; falls back low for good after 15 ms
+  for (size_t i = 0; i < sizeof(levels); i++)
+  {
+    levels[i] = i < 5 ? i % 2 == 0 : i < 15;
+  }
+
+  TEST_ASSERT_EQUAL(2, feed(&debouncer, levels, sizeof(levels), edges_us));
+  TEST_ASSERT_EQUAL_INT64(start_us, edges_us[0]);
+  TEST_ASSERT_EQUAL_INT64(start_us + LOCKOUT_US, edges_us[1]);
+  TEST_ASSERT_FALSE(debouncer.state);
+}
+
+/**
+ * @brief Edges bouncing for fewer samples than the filter length come out
+ *        as exactly one change each, dated within the bounce.
+ */
+static void test_bounced_edges(void)
+{
+  static const digital_input_debounce_mode_t modes[] = {DIGITAL_INPUT_DEBOUNCE_INTEGRATOR,
+                                                        DIGITAL_INPUT_DEBOUNCE_CONSECUTIVE};
+  static bool levels[64];
+  int64_t edges_us[64];
+
+  for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++)
+  {
+    digital_input_debouncer_t debouncer;
+    init(&debouncer, modes[m], false);
+
+    for (int n = 0; n < BOUNCED_EDGES; n++)
+    {
+      const bool target = !debouncer.state;
+      size_t count = 0;
+
+      // Up to four runs of one or two samples, so fewer than SAMPLES at the
+      // new level before it settles
+      const size_t bounces = random_next() % 5;
+      for (size_t b = 0; b < bounces; b++)
+      {
+        const size_t run = 1 + random_next() % 2;
+        for (size_t r = 0; r < run; r++)
+        {
+          levels[count++] = b % 2 == 0 ? target : !target;
+        }
+      }
+      const size_t bounce_len = count;
+      while (count < sizeof(levels))
+      {
+        levels[count++] = target;
+      }
+
+      const int64_t start_us = s_time_us;
+      TEST_ASSERT_EQUAL(1, feed(&debouncer, levels, count, edges_us));
+      TEST_ASSERT_EQUAL(target, debouncer.state);
+      TEST_ASSERT_TRUE(start_us <= edges_us[0]);
+      TEST_ASSERT_TRUE(edges_us[0] <= start_us + (int64_t)bounce_len * SAMPLE_US);
+    }
+  }
+}
+
+void debounce_tests_run(void)
+{
+  RUN_TEST(test_init);
+  RUN_TEST(test_clean_edge);
+  RUN_TEST(test_glitches);
+  RUN_TEST(test_lockout);
+  RUN_TEST(test_bounced_edges);
+}
+
+//**************************************************
+// Static Functions
+//**************************************************
+
+/**
+ * @brief Feeds samples one period apart.
+ * @return State changes, their times are stored in edges_us.
+ */
+static size_t feed(digital_input_debouncer_t *debouncer, const bool *levels, size_t count, int64_t *edges_us)
+{
+  size_t edges = 0;
+
+  for (size_t i = 0; i < count; i++)
+  {
+    if (digital_input_debounce_update(debouncer, levels[i], s_time_us, &edges_us[edges]))
+    {
+      edges++;
+    }
+    s_time_us += SAMPLE_US;
+  }
+
+  return edges;
+}
+
+static void init(digital_input_debouncer_t *debouncer, digital_input_debounce_mode_t mode, bool state)
+{
+  const digital_input_debounce_config_t config = {.mode = mode, .samples = SAMPLES, .lockout_us = LOCKOUT_US};
+  TEST_ASSERT_EQUAL(ESP_OK, digital_input_debounce_init(debouncer, &config, state));
+}
+
+/**
+ * @brief xorshift32, the sequence is the same on every run.
+ */
+static uint32_t random_next(void)
+{
+  s_seed ^= s_seed << 13;
+  s_seed ^= s_seed >> 17;
+  s_seed ^= s_seed << 5;
+  return s_seed;
+}
@@ -0,0 +1,195 @@
+#include "digital_input_internals.h"
+#include "unity.h"
+#include <stdlib.h>
+
+//**************************************************
+// Defines
+//**************************************************
+
+#define NANO_PULSES_PER_PULSE 1000000000ULL // Microseconds times mHz
+#define RANDOM_READS 20000
+#define RATE_CHANGES 2000
+
+//**************************************************
+// Function Prototypes
+//**************************************************
+
+int64_t __wrap_esp_timer_get_time(void);
+void debounce_tests_run(void);
+static uint32_t read_since(digital_input_num_t num, uint32_t start);
+static uint32_t random_next(void);
+
+//**************************************************
+// Globals
+//**************************************************
+
+static int64_t s_now_us; /**< Clock of the pulse trains, set by the tests */
+static uint32_t s_seed = 1;
+
+//**************************************************
+// Tests
+//**************************************************
+
+void setUp(void)
+{
+  // Every test starts a fresh train on the first input
+  s_now_us += 1000000;
+  digital_input_sim_set_pulse_rate(DIGITAL_INPUT_NUM_1, 0);
+}
+
+void tearDown(void)
+{
+}
+
+/**
+ * @brief Counts at fractional seconds include the pulses of the whole
+ *        seconds that end between two pulses.
+ */
+static void test_fractional_seconds(void)
+{
+  const uint32_t start = digital_input_pulse_read(DIGITAL_INPUT_NUM_1);
+  const int64_t origin_us = s_now_us;
+  digital_input_sim_set_pulse_rate(DIGITAL_INPUT_NUM_1, 1500);
+
+  s_now_us = origin_us + 700000;
+  TEST_ASSERT_EQUAL_UINT32(1, read_since(DIGITAL_INPUT_NUM_1, start));
+  s_now_us = origin_us + 1400000;
+  TEST_ASSERT_EQUAL_UINT32(2, read_since(DIGITAL_INPUT_NUM_1, start));
+  s_now_us = origin_us + 1999999;
+  TEST_ASSERT_EQUAL_UINT32(2, read_since(DIGITAL_INPUT_NUM_1, start));
+  s_now_us = origin_us + 2000000;
+  TEST_ASSERT_EQUAL_UINT32(3, read_since(DIGITAL_INPUT_NUM_1, start));
+  s_now_us = origin_us + 2500000;
+  TEST_ASSERT_EQUAL_UINT32(3, read_since(DIGITAL_INPUT_NUM_1, start));
+  s_now_us = origin_us + 3100000;
+  TEST_ASSERT_EQUAL_UINT32(4, read_since(DIGITAL_INPUT_NUM_1, start));
+}
+
+/**
+ * @brief The count at any time is the floor of elapsed time times rate, for
+ *        rates from below 1 Hz to 10 kHz.
+ */
+static void test_random_times(void)
+{
+  for (int i = 0; i < RANDOM_READS; i++)
+  {
+    const uint32_t rate_mhz = 1 + random_next() % 10000000;
+    const int64_t elapsed_us = random_next() % 100000000;
+
+    s_now_us += 1000000;
+    digital_input_sim_set_pulse_rate(DIGITAL_INPUT_NUM_1, 0);
+    const uint32_t start = digital_input_pulse_read(DIGITAL_INPUT_NUM_1);
+    digital_input_sim_set_pulse_rate(DIGITAL_INPUT_NUM_1, rate_mhz);
+
+    s_now_us += elapsed_us;
+    TEST_ASSERT_EQUAL_UINT32((uint64_t)elapsed_us * rate_mhz / NANO_PULSES_PER_PULSE,
+                             read_since(DIGITAL_INPUT_NUM_1, start));
+  }
+}
+
+/**
+ * @brief A rate change neither drops nor adds pulses: the count right after
+ *        it is the count right before, and the partial pulse carries over
+ *        unless the train stops.
+ */
+static void test_rate_change_continuity(void)
+{
+  const uint32_t start = digital_input_pulse_read(DIGITAL_INPUT_NUM_1);
+  uint64_t expected_np = 0; // Pulses in billionths, summed over every rate
+  uint32_t rate_mhz = 0;
+
+  for (int i = 0; i < RATE_CHANGES; i++)
+  {
+    const int64_t step_us = 1 + random_next() % 3000000;
+    s_now_us += step_us;
+    expected_np += (uint64_t)step_us * rate_mhz;
+
+    const uint32_t before = read_since(DIGITAL_INPUT_NUM_1, start);
+    TEST_ASSERT_EQUAL_UINT32(expected_np / NANO_PULSES_PER_PULSE, before);
+
+    rate_mhz = random_next() % 5000000;
+    if (rate_mhz == 0)
+    {
+      expected_np -= expected_np % NANO_PULSES_PER_PULSE; // A stopped train drops its partial pulse
+    }
+    digital_input_sim_set_pulse_rate(DIGITAL_INPUT_NUM_1, rate_mhz);
+    TEST_ASSERT_EQUAL_UINT32(before, read_since(DIGITAL_INPUT_NUM_1, start));
+  }
+
+  // A rate changed every 100 ms, below one pulse per period, still adds up
+  s_now_us += 1;
+  digital_input_sim_set_pulse_rate(DIGITAL_INPUT_NUM_1, 0);
+  const uint32_t slow_start = digital_input_pulse_read(DIGITAL_INPUT_NUM_1);
+  for (int i = 0; i < 100; i++)
+  {
+    digital_input_sim_set_pulse_rate(DIGITAL_INPUT_NUM_1, 5000);
+    s_now_us += 100000;
+  }
+  TEST_ASSERT_EQUAL_UINT32(50, read_since(DIGITAL_INPUT_NUM_1, slow_start));
+}
+
+/**
+ * @brief Trains of different inputs are independent, a stopped train holds
+ *        its count.
+ */
+static void test_inputs_independent(void)
+{
+  s_now_us += 1000000;
+  digital_input_sim_set_pulse_rate(DIGITAL_INPUT_NUM_2, 0);
+  const uint32_t start_1 = digital_input_pulse_read(DIGITAL_INPUT_NUM_1);
+  const uint32_t start_2 = digital_input_pulse_read(DIGITAL_INPUT_NUM_2);
+
+  digital_input_sim_set_pulse_rate(DIGITAL_INPUT_NUM_1, 2000);
+  s_now_us += 10000000;
+  TEST_ASSERT_EQUAL_UINT32(20, read_since(DIGITAL_INPUT_NUM_1, start_1));
+  TEST_ASSERT_EQUAL_UINT32(0, read_since(DIGITAL_INPUT_NUM_2, start_2));
+
+  digital_input_sim_set_pulse_rate(DIGITAL_INPUT_NUM_1, 0);
+  s_now_us += 10000000;
+  TEST_ASSERT_EQUAL_UINT32(20, read_since(DIGITAL_INPUT_NUM_1, start_1));
+
+  // Out of range inputs are ignored
+  digital_input_sim_set_pulse_rate(_DIGITAL_INPUT_NUM_MAX, 1000);
+}
+
+void app_main(void)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_fractional_seconds);
+  RUN_TEST(test_random_times);
+  RUN_TEST(test_rate_change_continuity);
+  RUN_TEST(test_inputs_independent);
+  debounce_tests_run();
+  exit(UNITY_END());
+}
+
+//**************************************************
+// Static Functions
+//**************************************************
+
+/**
+ * @brief Clock of the pulse trains, linked in place of esp_timer_get_time.
+ */
+int64_t __wrap_esp_timer_get_time(void)
+{
+  return s_now_us;
+}
+
+/**
+ * @brief Pulses of an input since an earlier read.
+ */
+static uint32_t read_since(digital_input_num_t num, uint32_t start)
+{
+  return digital_input_pulse_read(num) - start;
+}
+
+/**
+ * @brief xorshift32, the sequence is the same on every run.
+ */
+static uint32_t random_next(void)
+{
+  s_seed ^= s_seed << 13;
+  s_seed ^= s_seed >> 17;
+  s_seed ^= s_seed << 5;
+  return s_seed;
+}
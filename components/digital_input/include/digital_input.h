@@ -2,6 +2,57 @@
 
 #include "esp_err.h"
 #include "stdbool.h"
+#include "sdkconfig.h"
+
+//**************************************************
+// Defines
+//**************************************************
+
+#if CONFIG_DIGITAL_INPUT_DEFAULT_MODE_POLLING
+#define DIGITAL_INPUT_DEFAULT_MODE DIGITAL_INPUT_MODE_POLLING
+#else
+#define DIGITAL_INPUT_DEFAULT_MODE DIGITAL_INPUT_MODE_INTERRUPT
+#endif
+
+#if CONFIG_DIGITAL_INPUT_DEFAULT_DEBOUNCE_NONE
+#define DIGITAL_INPUT_DEFAULT_DEBOUNCE DIGITAL_INPUT_DEBOUNCE_NONE
+#elif CONFIG_DIGITAL_INPUT_DEFAULT_DEBOUNCE_LOCKOUT
+#define DIGITAL_INPUT_DEFAULT_DEBOUNCE DIGITAL_INPUT_DEBOUNCE_LOCKOUT
+#elif CONFIG_DIGITAL_INPUT_DEFAULT_DEBOUNCE_CONSECUTIVE
+#define DIGITAL_INPUT_DEFAULT_DEBOUNCE DIGITAL_INPUT_DEBOUNCE_CONSECUTIVE
+#else
+#define DIGITAL_INPUT_DEFAULT_DEBOUNCE DIGITAL_INPUT_DEBOUNCE_INTEGRATOR
+#endif
+
+/**
+ * @brief Default configuration, taken from menuconfig.
+ */
+#define DIGITAL_INPUT_DEFAULT_CONFIG()                            \
+  {                                                               \
+      .mode = DIGITAL_INPUT_DEFAULT_MODE,                         \
+      .sample_period_us = CONFIG_DIGITAL_INPUT_SAMPLE_PERIOD_US,  \
+  }
+
+/**
+ * @brief Default debounce settings, taken from menuconfig.
+ */
+#define DIGITAL_INPUT_DEBOUNCE_DEFAULT_CONFIG()                   \
+  {                                                               \
+      .mode = DIGITAL_INPUT_DEFAULT_DEBOUNCE,                     \
+      .samples = CONFIG_DIGITAL_INPUT_DEBOUNCE_SAMPLES,           \
+      .lockout_us = CONFIG_DIGITAL_INPUT_DEBOUNCE_LOCKOUT_US,     \
+  }
+
+/**
+ * @brief Default pulse counter settings, taken from menuconfig.
+ */
+#define DIGITAL_INPUT_COUNTER_DEFAULT_CONFIG()                           \
+  {                                                                      \
+      .edge = DIGITAL_INPUT_COUNT_RISING,                                \
+      .window_ms = CONFIG_DIGITAL_INPUT_COUNTER_WINDOW_MS,               \
+      .report_period_ms = CONFIG_DIGITAL_INPUT_COUNTER_REPORT_PERIOD_MS, \
+      .glitch_ns = CONFIG_DIGITAL_INPUT_COUNTER_GLITCH_NS,               \
+  }
 
 //**************************************************
 // Typedefs
@@ -19,12 +70,94 @@ typedef enum
   _DIGITAL_INPUT_NUM_MAX,
 } digital_input_num_t;
 
+/**
+ * @brief Edge capture backends.
+ */
+typedef enum
+{
+  DIGITAL_INPUT_MODE_INTERRUPT = 0, /**< Every edge captured by a GPIO ISR */
+  DIGITAL_INPUT_MODE_POLLING,       /**< Levels sampled every `sample_period_us` and debounced */
+} digital_input_mode_t;
+
+/**
+ * @brief Digital input component configuration.
+ */
+typedef struct
+{
+  digital_input_mode_t mode; /**< Edge capture backend */
+  uint32_t sample_period_us; /**< Polling mode: sampling timer period */
+} digital_input_config_t;
+
+/**
+ * @brief Debounce algorithms, run on every sample in polling mode.
+ */
+typedef enum
+{
+  DIGITAL_INPUT_DEBOUNCE_NONE = 0,    /**< Any level change is reported */
+  DIGITAL_INPUT_DEBOUNCE_INTEGRATOR,  /**< Counter follows the level; state flips at 0 and at `samples` */
+  DIGITAL_INPUT_DEBOUNCE_LOCKOUT,     /**< First change is reported, then changes are ignored for `lockout_us` */
+  DIGITAL_INPUT_DEBOUNCE_CONSECUTIVE, /**< State flips after `samples` consecutive samples at the new level */
+} digital_input_debounce_mode_t;
+
+/**
+ * @brief Per-input debounce settings.
+ */
+typedef struct
+{
+  digital_input_debounce_mode_t mode; /**< Algorithm */
+  uint16_t samples;                   /**< Integrator ceiling / consecutive sample count */
+  uint32_t lockout_us;                /**< Lock-out time after a reported change */
+} digital_input_debounce_config_t;
+
+/**
+ * @brief Edges counted in pulse counter mode. Rising is the inactive to active
+ *        transition (the pin falls, inputs are active low).
+ */
+typedef enum
+{
+  DIGITAL_INPUT_COUNT_RISING = 0,
+  DIGITAL_INPUT_COUNT_FALLING,
+  DIGITAL_INPUT_COUNT_BOTH,
+} digital_input_count_edge_t;
+
+/**
+ * @brief Pulse counter mode settings.
+ */
+typedef struct
+{
+  digital_input_count_edge_t edge; /**< Edges to count */
+  uint32_t window_ms;              /**< Sliding window the rate is measured over */
+  uint32_t report_period_ms;       /**< Period of the rate events, 0 disables them */
+  uint32_t glitch_ns;              /**< Pulses shorter than this are ignored, 0 disables the filter */
+} digital_input_counter_config_t;
+
+/**
+ * @brief Kinds of events reported to the observers.
+ */
+typedef enum
+{
+  DIGITAL_INPUT_EVENT_EDGE = 0, /**< State change of an input in edge capture mode */
+  DIGITAL_INPUT_EVENT_RATE,     /**< Periodic report of an input in pulse counter mode */
+} digital_input_event_type_t;
+
+/**
+ * @brief Event reported to the observers.
+ */
+typedef struct
+{
+  digital_input_event_type_t type; /**< Kind of event, selects the valid fields */
+  digital_input_num_t num;         /**< The logical input number that triggered the event */
+  bool state;                      /**< Edge: the new state of the input (true for active/ON, false for inactive/OFF) */
+  int64_t timestamp_us;            /**< esp_timer time of the edge (first sample at the new level when debounced) or of the count */
+  uint64_t count;                  /**< Rate: pulses counted since the counter was enabled */
+  uint32_t rate_mhz;               /**< Rate: pulses per second over the window, in mHz */
+} digital_input_event_t;
+
 /**
  * @brief Callback function type for digital input state change events.
- * @param num   The logical input number that triggered the event.
- * @param state The new state of the input (true for active/ON, false for inactive/OFF).
+ * @param event The captured edge. Only valid during the call.
  */
-typedef void (*digital_input_event_handler_t)(const digital_input_num_t num, const bool state);
+typedef void (*digital_input_event_handler_t)(const digital_input_event_t *event);
 
 /**
  * @brief Possible states of a digital input, including error handling.
@@ -43,26 +176,48 @@ typedef enum
 /**
  * @brief Initializes the digital input component.
  *        Sets up GPIOs, creates synchronization primitives (mutexes), initializes
- *        the event queue, and spawns the reader and dispatcher tasks.
+ *        the edge ring, and spawns the dispatcher task. In interrupt mode the GPIO
+ *        ISR captures the edges; in polling mode a periodic esp_timer callback
+ *        samples the inputs and runs the debounce engine.
+ * @param config Component configuration, see DIGITAL_INPUT_DEFAULT_CONFIG().
  * @return - ESP_OK: Success.
  *
+ *         - ESP_ERR_INVALID_ARG: Provided config was NULL.
+ *
  *         - ESP_FAIL: Initialization of hardware or OS resources failed.
  */
-esp_err_t digital_input_initialize();
+esp_err_t digital_input_initialize(const digital_input_config_t *config);
 
 /**
  * @brief Registers a handler to be notified whenever a digital input state changes.
- *        This implements the Observer pattern using an internal linked list of handlers.
+ *        This implements the Observer pattern using a copy-on-write handler registry.
  * @note This function is thread-safe and prevents duplicate registrations.
+ *       It must not be called from a handler.
  * @param handler The callback function to be registered.
  * @return - ESP_OK: Successfully added.
  *
  *         - ESP_ERR_INVALID_ARG: Handler was NULL.
  *
- *         - ESP_ERR_NO_MEM: Failed to allocate memory for the new observer node.
+ *         - ESP_ERR_INVALID_STATE: Component not initialized.
+ *
+ *         - ESP_ERR_NO_MEM: Failed to allocate memory for the new handler array.
  */
 esp_err_t digital_input_add_event_handler(digital_input_event_handler_t handler);
 
+/**
+ * @brief Unregisters a handler. Once this returns the handler will not be called again.
+ * @note Must not be called from a handler.
+ * @param handler The callback function to be removed.
+ * @return - ESP_OK: Successfully removed.
+ *
+ *         - ESP_ERR_INVALID_ARG: Handler was NULL.
+ *
+ *         - ESP_ERR_INVALID_STATE: Component not initialized.
+ *
+ *         - ESP_ERR_NOT_FOUND: Handler was not registered.
+ */
+esp_err_t digital_input_remove_event_handler(digital_input_event_handler_t handler);
+
 /**
  * @brief Retrieves the current state of a specific digital input.
  *        Accesses the internal state bitmask in a thread-safe manner.
@@ -73,4 +228,53 @@ esp_err_t digital_input_add_event_handler(digital_input_event_handler_t handler)
  *
  *         - DIGITAL_INPUT_STATE_FAIL: Could not access state (mutex timeout).
  */
-digital_input_state_t digital_input_get_state(digital_input_num_t num);
\ No newline at end of file
+digital_input_state_t digital_input_get_state(digital_input_num_t num);
+
+/**
+ * @brief Replaces the debounce settings of an input. The debounce state is reset
+ *        to the current reported state.
+ * @param num    The logical input number.
+ * @param config New settings, see DIGITAL_INPUT_DEBOUNCE_DEFAULT_CONFIG().
+ * @return - ESP_OK: Settings applied.
+ *
+ *         - ESP_ERR_INVALID_ARG: Invalid input, NULL config or zero sample count.
+ *
+ *         - ESP_ERR_INVALID_STATE: Component not initialized.
+ *
+ *         - ESP_ERR_NOT_SUPPORTED: Debouncing requires polling mode.
+ */
+esp_err_t digital_input_set_debounce(digital_input_num_t num, const digital_input_debounce_config_t *config);
+
+/**
+ * @brief Switches an input to pulse counter mode, using the PCNT peripheral.
+ *        The input stops reporting edges; its total and rate are sampled every
+ *        CONFIG_DIGITAL_INPUT_COUNTER_PERIOD_MS and reported as rate events.
+ * @param num    The logical input number.
+ * @param config Counter settings, see DIGITAL_INPUT_COUNTER_DEFAULT_CONFIG().
+ * @return - ESP_OK: Counter running.
+ *
+ *         - ESP_ERR_INVALID_ARG: Invalid input, NULL config or window not covered by the sample slots.
+ *
+ *         - ESP_ERR_INVALID_STATE: Component not initialized or counter already enabled.
+ *
+ *         - ESP_FAIL: Counter hardware or task setup failed.
+ */
+esp_err_t digital_input_counter_enable(digital_input_num_t num, const digital_input_counter_config_t *config);
+
+/**
+ * @brief Retrieves the last sampled total and rate of a counting input.
+ * @param num      The logical input number.
+ * @param count    Pulses counted since the counter was enabled.
+ * @param rate_mhz Pulses per second over the window, in mHz.
+ * @return - ESP_OK: Values retrieved.
+ *
+ *         - ESP_ERR_INVALID_ARG: Invalid input or NULL output.
+ *
+ *         - ESP_ERR_INVALID_STATE: Input is not in pulse counter mode.
+ */
+esp_err_t digital_input_counter_get(digital_input_num_t num, uint64_t *count, uint32_t *rate_mhz);
+
+/**
+ * @brief Number of edges lost because the edge ring was full.
+ */
+uint32_t digital_input_get_overruns(void);
@@ -0,0 +1,164 @@
+#pragma once
+
+#include "digital_input.h"
+#include "sdkconfig.h"
+
+#if !CONFIG_IDF_TARGET_LINUX
+#include "driver/gpio.h"
+#endif
+
+//**************************************************
+// Typedefs
+//**************************************************
+
+/**
+ * @brief Debounce state of one input.
+ */
+typedef struct
+{
+  digital_input_debounce_config_t config;
+  bool state;               /**< Debounced state */
+  uint16_t counter;         /**< Integrator value, or length of the run at the other level */
+  int64_t pending_us;       /**< Time of the first sample of the pending change */
+  int64_t lockout_until_us; /**< Lock-out mode: changes are ignored until this time */
+} digital_input_debouncer_t;
+
+//**************************************************
+// Globals
+//**************************************************
+
+#if !CONFIG_IDF_TARGET_LINUX
+/**
+ * @brief Maps logical inputs to physical GPIOs.
+ */
+extern const gpio_num_t digital_input_gpio_map[_DIGITAL_INPUT_NUM_MAX];
+#endif
+
+//**************************************************
+// Core Functions
+//**************************************************
+
+/**
+ * @brief Pushes a captured edge to the edge ring. Capture context only (single producer), ISR safe.
+ */
+void digital_input_push_edge(digital_input_num_t num, bool state, int64_t timestamp_us);
+
+/**
+ * @brief Wakes the dispatcher task after edges were pushed from a task.
+ */
+void digital_input_wake_dispatcher(void);
+
+/**
+ * @brief Wakes the dispatcher task after edges were pushed from an ISR.
+ */
+void digital_input_wake_dispatcher_from_isr(void);
+
+/**
+ * @brief Notifies every observer of an event. Task context only.
+ */
+void digital_input_publish(const digital_input_event_t *event);
+
+//**************************************************
+// Capture Backend Functions
+//**************************************************
+
+/**
+ * @brief Configures the inputs and starts edge capture in the requested mode.
+ * @return - ESP_OK: Capture running.
+ *
+ *         - ESP_FAIL: Hardware, ISR or timer setup failed.
+ */
+esp_err_t digital_input_capture_start(const digital_input_config_t *config);
+
+/**
+ * @brief Applies new debounce settings to an input.
+ * @return - ESP_OK: Settings applied.
+ *
+ *         - ESP_ERR_INVALID_ARG: Invalid settings.
+ *
+ *         - ESP_ERR_NOT_SUPPORTED: Active mode does not debounce.
+ */
+esp_err_t digital_input_capture_set_debounce(digital_input_num_t num, const digital_input_debounce_config_t *config);
+
+/**
+ * @brief Stops edge capture on an input, before handing it to the pulse counter.
+ */
+esp_err_t digital_input_capture_release(digital_input_num_t num);
+
+/**
+ * @brief Resumes edge capture on a released input, when the pulse counter
+ *        could not take it over. Safe after a partly failed release.
+ * @return - ESP_OK: Capture running.
+ *
+ *         - ESP_FAIL: Interrupt setup failed.
+ */
+esp_err_t digital_input_capture_acquire(digital_input_num_t num);
+
+//**************************************************
+// Pulse Counter Backend Functions
+//**************************************************
+
+/**
+ * @brief Starts counting pulses on an input. On failure nothing is left
+ *        allocated.
+ * @return - ESP_OK: Counter running.
+ *
+ *         - ESP_FAIL: Counter setup failed.
+ */
+esp_err_t digital_input_pulse_start(digital_input_num_t num, const digital_input_counter_config_t *config);
+
+/**
+ * @brief Stops counting pulses on an input and frees the counter. No-op if
+ *        it is not counting.
+ */
+void digital_input_pulse_stop(digital_input_num_t num);
+
+/**
+ * @brief Free-running pulse count of an input. Wraps around, callers use the
+ *        difference between two reads.
+ */
+uint32_t digital_input_pulse_read(digital_input_num_t num);
+
+#if CONFIG_IDF_TARGET_LINUX
+/**
+ * @brief Sets the rate of the simulated pulse train of an input.
+ * @param rate_mhz Pulses per second, in mHz. 0 stops the train.
+ */
+void digital_input_sim_set_pulse_rate(digital_input_num_t num, uint32_t rate_mhz);
+#endif
+
+//**************************************************
+// Pulse Counter Functions
+//**************************************************
+
+/**
+ * @brief Creates the pulse counter service resources. Called once by digital_input_initialize().
+ * @return - ESP_OK: Service ready.
+ *
+ *         - ESP_FAIL: Mutex creation failed.
+ */
+esp_err_t digital_input_counter_setup(void);
+
+//**************************************************
+// Debounce Functions
+//**************************************************
+
+/**
+ * @brief Configures a debouncer and resets it to a settled state.
+ * @param debouncer Debouncer to initialize.
+ * @param config    Algorithm and parameters.
+ * @param state     Initial debounced state.
+ * @return - ESP_OK: Debouncer ready.
+ *
+ *         - ESP_ERR_INVALID_ARG: Unknown mode or zero sample count.
+ */
+esp_err_t digital_input_debounce_init(digital_input_debouncer_t *debouncer, const digital_input_debounce_config_t *config, bool state);
+
+/**
+ * @brief Feeds one raw sample. Does not block or allocate.
+ * @param level   Raw level (true for active).
+ * @param now_us  Sample time.
+ * @param edge_us Set to the time of the change when the state flips.
+ * @return true if the debounced state flipped, the new state is `debouncer->state`.
+ */
+bool digital_input_debounce_update(digital_input_debouncer_t *debouncer, bool level, int64_t now_us, int64_t *edge_us);
@@ -1,7 +1,11 @@
 #include "digital_output.h"
+#include "digital_output_internals.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
 #include "esp_log.h"
+#include "soc/soc.h"
+#include "soc/soc_caps.h"
+#include "soc/gpio_reg.h"
 
 //**************************************************
 // Globals
@@ -12,12 +16,20 @@ static const char TAG[] = "digital_output";
 /**
  * @brief Map logical output IDs to physical GPIO numbers
  */
-static const uint32_t s_output_pins[_DIGITAL_OUTPUT_NUM_MAX] = {
+const gpio_num_t digital_output_gpio_map[_DIGITAL_OUTPUT_NUM_MAX] = {
     GPIO_NUM_13,
     GPIO_NUM_19,
     GPIO_NUM_21,
     GPIO_NUM_18};
 
+static portMUX_TYPE s_mask_lock = portMUX_INITIALIZER_UNLOCKED; /**< Keeps the W1TC/W1TS pair together */
+
+//**************************************************
+// Function Prototypes
+//**************************************************
+
+static void pins_from_mask(uint32_t mask, uint32_t *low_pins, uint32_t *high_pins);
+
 //**************************************************
 // Public Functions
 //**************************************************
@@ -35,7 +47,7 @@ esp_err_t digital_output_initialize()
   // Build bit mask from the pin map
   for (int i = 0; i < _DIGITAL_OUTPUT_NUM_MAX; i++)
   {
-    io_conf.pin_bit_mask |= (1ULL << s_output_pins[i]);
+    io_conf.pin_bit_mask |= (1ULL << digital_output_gpio_map[i]);
   }
 
   if (gpio_config(&io_conf) != ESP_OK)
@@ -47,7 +59,19 @@ esp_err_t digital_output_initialize()
   // Set all low
   for (int i = 0; i < _DIGITAL_OUTPUT_NUM_MAX; i++)
   {
-    gpio_set_level(s_output_pins[i], 0);
+    gpio_set_level(digital_output_gpio_map[i], 0);
+  }
+
+  if (digital_output_schedule_init() != ESP_OK)
+  {
+    ESP_LOGE(TAG, "Failed to start the scheduler");
+    return ESP_FAIL;
+  }
+
+  if (digital_output_pwm_init() != ESP_OK)
+  {
+    ESP_LOGE(TAG, "Failed to start the PWM service");
+    return ESP_FAIL;
   }
 
   return ESP_OK;
@@ -60,7 +84,7 @@ digital_output_state_t digital_output_get_state(digital_output_num_t num)
     return DIGITAL_OUTPUT_INVALID_ARG;
   }
 
-  return gpio_get_level(s_output_pins[num]) ? DIGITAL_OUTPUT_ON : DIGITAL_OUTPUT_OFF;
+  return gpio_get_level(digital_output_gpio_map[num]) ? DIGITAL_OUTPUT_ON : DIGITAL_OUTPUT_OFF;
 }
 
 esp_err_t digital_output_set_state(digital_output_num_t num, bool new_state)
@@ -70,5 +94,86 @@ esp_err_t digital_output_set_state(digital_output_num_t num, bool new_state)
     return ESP_ERR_INVALID_ARG;
   }
 
-  return gpio_set_level(s_output_pins[num], new_state);
+  if (digital_output_pwm_outputs() & DIGITAL_OUTPUT_BIT(num))
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  return gpio_set_level(digital_output_gpio_map[num], new_state);
+}
+
+esp_err_t digital_output_set_mask(uint32_t set_mask, uint32_t clear_mask)
+{
+  if (((set_mask | clear_mask) & ~DIGITAL_OUTPUT_MASK_ALL) != 0 || (set_mask & clear_mask) != 0)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  if ((set_mask | clear_mask) & digital_output_pwm_outputs())
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  uint32_t set_low, set_high, clear_low, clear_high;
+  pins_from_mask(set_mask, &set_low, &set_high);
+  pins_from_mask(clear_mask, &clear_low, &clear_high);
+
+  portENTER_CRITICAL(&s_mask_lock);
+
+  REG_WRITE(GPIO_OUT_W1TC_REG, clear_low);
+  REG_WRITE(GPIO_OUT_W1TS_REG, set_low);
+#if SOC_GPIO_PIN_COUNT > 32
+  REG_WRITE(GPIO_OUT1_W1TC_REG, clear_high);
+  REG_WRITE(GPIO_OUT1_W1TS_REG, set_high);
+#endif
+
+  portEXIT_CRITICAL(&s_mask_lock);
+
+  return ESP_OK;
+}
+
+uint32_t digital_output_get_mask()
+{
+  const uint32_t pwm = digital_output_pwm_outputs();
+  uint32_t mask = 0;
+
+  for (int i = 0; i < _DIGITAL_OUTPUT_NUM_MAX; i++)
+  {
+    if ((pwm & DIGITAL_OUTPUT_BIT(i)) == 0 && gpio_get_level(digital_output_gpio_map[i]))
+    {
+      mask |= DIGITAL_OUTPUT_BIT(i);
+    }
+  }
+
+  return mask;
+}
+
+//**************************************************
+// Static Functions
+//**************************************************
+
+/**
+ * @brief Translates an output mask to GPIO register bits: pins 0-31 and 32-63.
+ */
+static void pins_from_mask(uint32_t mask, uint32_t *low_pins, uint32_t *high_pins)
+{
+  *low_pins = 0;
+  *high_pins = 0;
+
+  for (int i = 0; i < _DIGITAL_OUTPUT_NUM_MAX; i++)
+  {
+    if ((mask & DIGITAL_OUTPUT_BIT(i)) == 0)
+    {
+      continue;
+    }
+
+    if (digital_output_gpio_map[i] < 32)
+    {
+      *low_pins |= 1U << digital_output_gpio_map[i];
+    }
+    else
+    {
+      *high_pins |= 1U << (digital_output_gpio_map[i] - 32);
+    }
+  }
 }
\ No newline at end of file
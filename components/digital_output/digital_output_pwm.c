@@ -0,0 +1,299 @@
+#include "digital_output.h"
+#include "digital_output_internals.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "driver/ledc.h"
+
+//**************************************************
+// Defines
+//**************************************************
+
+#define PWM_SPEED_MODE LEDC_LOW_SPEED_MODE
+
+// Output n runs on timer n and channel n, so every output has its own frequency
+#define PWM_TIMER(num) ((ledc_timer_t)(LEDC_TIMER_0 + (num)))
+#define PWM_CHANNEL(num) ((ledc_channel_t)(LEDC_CHANNEL_0 + (num)))
+
+//**************************************************
+// Function Prototypes
+//**************************************************
+
+static bool is_pwm(digital_output_num_t num);
+
+//**************************************************
+// Globals
+//**************************************************
+
+static const char TAG[] = "digital_output:pwm";
+
+static _Atomic uint32_t s_pwm_mask = 0; /**< DIGITAL_OUTPUT_BIT() of the outputs in PWM mode */
+
+static digital_output_pwm_config_t s_configs[_DIGITAL_OUTPUT_NUM_MAX]; /**< Settings of the PWM outputs */
+
+static SemaphoreHandle_t s_mutex = NULL; /**< Serializes mode changes and the LEDC calls */
+
+//**************************************************
+// Public Functions
+//**************************************************
+
+esp_err_t digital_output_pwm_init(void)
+{
+  _Static_assert((int)_DIGITAL_OUTPUT_NUM_MAX <= (int)LEDC_TIMER_MAX, "One LEDC timer per output");
+
+  if ((s_mutex = xSemaphoreCreateMutex()) == NULL)
+  {
+    ESP_LOGE(TAG, "%s:Fail to create mutex", __func__);
+    return ESP_FAIL;
+  }
+
+  if (ledc_fade_func_install(0) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Fail to install fade service", __func__);
+    return ESP_FAIL;
+  }
+
+  return ESP_OK;
+}
+
+uint32_t digital_output_pwm_outputs(void)
+{
+  return s_pwm_mask;
+}
+
+esp_err_t digital_output_pwm_enable(digital_output_num_t num, const digital_output_pwm_config_t *config)
+{
+  if (num >= _DIGITAL_OUTPUT_NUM_MAX || config == NULL || config->frequency_hz == 0 ||
+      config->resolution_bits == 0 || config->resolution_bits >= LEDC_TIMER_BIT_MAX)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  if (s_mutex == NULL)
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+  const bool was_pwm = is_pwm(num);
+  if (was_pwm)
+  {
+    ledc_fade_stop(PWM_SPEED_MODE, PWM_CHANNEL(num));
+  }
+
+  // Claim the output first, digital writes are refused from here on
+  s_pwm_mask |= DIGITAL_OUTPUT_BIT(num);
+
+  const ledc_timer_config_t timer_conf = {
+      .speed_mode = PWM_SPEED_MODE,
+      .duty_resolution = (ledc_timer_bit_t)config->resolution_bits,
+      .timer_num = PWM_TIMER(num),
+      .freq_hz = config->frequency_hz,
+      .clk_cfg = LEDC_AUTO_CLK,
+  };
+
+  if (ledc_timer_config(&timer_conf) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Fail to configure timer for %lu Hz at %u bits", __func__,
+             (unsigned long)config->frequency_hz, config->resolution_bits);
+
+    if (!was_pwm)
+    {
+      s_pwm_mask &= ~DIGITAL_OUTPUT_BIT(num);
+    }
+
+    xSemaphoreGive(s_mutex);
+    return ESP_FAIL;
+  }
+
+  const ledc_channel_config_t channel_conf = {
+      .gpio_num = digital_output_gpio_map[num],
+      .speed_mode = PWM_SPEED_MODE,
+      .channel = PWM_CHANNEL(num),
+      .intr_type = LEDC_INTR_DISABLE,
+      .timer_sel = PWM_TIMER(num),
+      .duty = 0,
+      .hpoint = 0,
+  };
+
+  if (ledc_channel_config(&channel_conf) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Fail to configure channel", __func__);
+    xSemaphoreGive(s_mutex);
+    digital_output_pwm_disable(num);
+    return ESP_FAIL;
+  }
+
+  s_configs[num] = *config;
+
+  xSemaphoreGive(s_mutex);
+
+  return ESP_OK;
+}
+
+esp_err_t digital_output_pwm_disable(digital_output_num_t num)
+{
+  if (num >= _DIGITAL_OUTPUT_NUM_MAX)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  if (s_mutex == NULL)
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+  if (!is_pwm(num))
+  {
+    xSemaphoreGive(s_mutex);
+    return ESP_OK;
+  }
+
+  ledc_fade_stop(PWM_SPEED_MODE, PWM_CHANNEL(num));
+  ledc_stop(PWM_SPEED_MODE, PWM_CHANNEL(num), 0);
+
+  // Routes the pin back to the GPIO output register, away from the LEDC
+  const gpio_config_t io_conf = {
+      .intr_type = GPIO_INTR_DISABLE,
+      .mode = GPIO_MODE_INPUT_OUTPUT,
+      .pull_down_en = GPIO_PULLDOWN_DISABLE,
+      .pull_up_en = GPIO_PULLUP_DISABLE,
+      .pin_bit_mask = 1ULL << digital_output_gpio_map[num]};
+
+  gpio_set_level(digital_output_gpio_map[num], 0);
+  esp_err_t err = gpio_config(&io_conf);
+  if (err != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Fail to restore the GPIO", __func__);
+  }
+
+  s_pwm_mask &= ~DIGITAL_OUTPUT_BIT(num);
+
+  xSemaphoreGive(s_mutex);
+
+  return err;
+}
+
+esp_err_t digital_output_pwm_set_duty(digital_output_num_t num, uint32_t duty)
+{
+  if (num >= _DIGITAL_OUTPUT_NUM_MAX)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  if (s_mutex == NULL)
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+  esp_err_t err = ESP_OK;
+  if (!is_pwm(num))
+  {
+    err = ESP_ERR_INVALID_STATE;
+  }
+  else if (duty > (1UL << s_configs[num].resolution_bits))
+  {
+    err = ESP_ERR_INVALID_ARG;
+  }
+  else
+  {
+    // A running fade would hold the channel until it ends
+    ledc_fade_stop(PWM_SPEED_MODE, PWM_CHANNEL(num));
+    err = ledc_set_duty_and_update(PWM_SPEED_MODE, PWM_CHANNEL(num), duty, 0);
+  }
+
+  xSemaphoreGive(s_mutex);
+
+  return err;
+}
+
+esp_err_t digital_output_pwm_fade(digital_output_num_t num, uint32_t target_duty, uint32_t duration_ms)
+{
+  if (num >= _DIGITAL_OUTPUT_NUM_MAX)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  if (s_mutex == NULL)
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+  esp_err_t err = ESP_OK;
+  if (!is_pwm(num))
+  {
+    err = ESP_ERR_INVALID_STATE;
+  }
+  else if (target_duty > (1UL << s_configs[num].resolution_bits))
+  {
+    err = ESP_ERR_INVALID_ARG;
+  }
+  else
+  {
+    // The LEDC steps the duty by itself, the call returns once the fade is armed
+    ledc_fade_stop(PWM_SPEED_MODE, PWM_CHANNEL(num));
+    if (ledc_set_fade_time_and_start(PWM_SPEED_MODE, PWM_CHANNEL(num), target_duty, duration_ms, LEDC_FADE_NO_WAIT) != ESP_OK)
+    {
+      ESP_LOGE(TAG, "%s:Fail to start fade", __func__);
+      err = ESP_FAIL;
+    }
+  }
+
+  xSemaphoreGive(s_mutex);
+
+  return err;
+}
+
+esp_err_t digital_output_pwm_get(digital_output_num_t num, digital_output_pwm_config_t *config, uint32_t *duty)
+{
+  if (num >= _DIGITAL_OUTPUT_NUM_MAX)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  if (s_mutex == NULL)
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+  if (!is_pwm(num))
+  {
+    xSemaphoreGive(s_mutex);
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  if (config != NULL)
+  {
+    *config = s_configs[num];
+  }
+
+  if (duty != NULL)
+  {
+    *duty = ledc_get_duty(PWM_SPEED_MODE, PWM_CHANNEL(num));
+  }
+
+  xSemaphoreGive(s_mutex);
+
+  return ESP_OK;
+}
+
+//**************************************************
+// Static Functions
+//**************************************************
+
+/**
+ * @brief Whether an output is in PWM mode.
+ */
+static bool is_pwm(digital_output_num_t num)
+{
+  return (s_pwm_mask & DIGITAL_OUTPUT_BIT(num)) != 0;
+}
@@ -0,0 +1,355 @@
+#include "digital_output.h"
+#include "digital_output_internals.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+//**************************************************
+// Defines
+//**************************************************
+
+#define MIN_PERIOD_US 100 // Shortest periodic toggle, keeps the timer task from spinning
+#define MIN_WIDTH_US 50   // Shortest pulse, below the timer task dispatch latency the width is not kept
+
+#define ID_INDEX_BITS 16
+#define ID_INDEX_MASK ((1U << ID_INDEX_BITS) - 1)
+
+//**************************************************
+// Typedefs
+//**************************************************
+
+/**
+ * @brief A scheduled action, from the fixed pool.
+ */
+typedef struct
+{
+  digital_output_wheel_entry_t entry; /**< Wheel timer, first so the wheel entry is the record */
+  digital_output_num_t num;
+  digital_output_action_t action;
+  uint32_t period_us;  /**< Repeat period, 0 for a one-shot */
+  uint16_t generation; /**< Bumped on every release, stale ids never match */
+  bool used;
+} action_t;
+
+//**************************************************
+// Function Prototypes
+//**************************************************
+
+static esp_err_t queue_action(digital_output_num_t num, digital_output_action_t action, uint64_t delay_us,
+                              uint32_t period_us, const bool *start_level, digital_output_schedule_id_t *id);
+static void timer_callback(void *arg);
+static void expire_actions(int64_t now_us);
+static void arm_timer(void);
+static action_t *find_action(digital_output_schedule_id_t id);
+static digital_output_schedule_id_t action_id(const action_t *action);
+static action_t *alloc_action(void);
+static void free_action(action_t *action);
+
+//**************************************************
+// Globals
+//**************************************************
+
+static const char TAG[] = "digital_output:schedule";
+
+static action_t s_actions[CONFIG_DIGITAL_OUTPUT_SCHEDULE_MAX_ACTIONS]; /**< Action pool */
+static uint16_t s_free[CONFIG_DIGITAL_OUTPUT_SCHEDULE_MAX_ACTIONS];    /**< Free pool indexes, used as a stack */
+static size_t s_free_count = 0;
+
+static digital_output_wheel_t s_wheel;
+static esp_timer_handle_t s_timer = NULL;
+static int64_t s_armed_us = INT64_MAX; /**< Expiry the timer is armed for, INT64_MAX when stopped */
+
+static SemaphoreHandle_t s_mutex = NULL; /**< Protects the pool, the wheel and the timer state */
+
+//**************************************************
+// Public Functions
+//**************************************************
+
+esp_err_t digital_output_schedule_init(void)
+{
+  _Static_assert(CONFIG_DIGITAL_OUTPUT_SCHEDULE_MAX_ACTIONS <= ID_INDEX_MASK, "Pool index must fit the id");
+
+  if ((s_mutex = xSemaphoreCreateMutex()) == NULL)
+  {
+    ESP_LOGE(TAG, "%s:Fail to create mutex", __func__);
+    return ESP_FAIL;
+  }
+
+  const esp_timer_create_args_t timer_args = {
+      .callback = timer_callback,
+      .dispatch_method = ESP_TIMER_TASK,
+      .name = "digital_output",
+      .skip_unhandled_events = true,
+  };
+
+  if (esp_timer_create(&timer_args, &s_timer) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Fail to create schedule timer", __func__);
+    return ESP_FAIL;
+  }
+
+  for (size_t i = 0; i < CONFIG_DIGITAL_OUTPUT_SCHEDULE_MAX_ACTIONS; i++)
+  {
+    s_free[i] = CONFIG_DIGITAL_OUTPUT_SCHEDULE_MAX_ACTIONS - 1 - i;
+  }
+  s_free_count = CONFIG_DIGITAL_OUTPUT_SCHEDULE_MAX_ACTIONS;
+
+  digital_output_wheel_init(&s_wheel, esp_timer_get_time());
+
+  return ESP_OK;
+}
+
+esp_err_t digital_output_schedule(digital_output_num_t num, digital_output_action_t action,
+                                  uint64_t delay_us, uint32_t period_us, digital_output_schedule_id_t *id)
+{
+  if (num >= _DIGITAL_OUTPUT_NUM_MAX || action > DIGITAL_OUTPUT_ACTION_TOGGLE ||
+      delay_us >= DIGITAL_OUTPUT_WHEEL_RANGE_US || (period_us != 0 && period_us < MIN_PERIOD_US))
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  return queue_action(num, action, delay_us, period_us, NULL, id);
+}
+
+esp_err_t digital_output_pulse(digital_output_num_t num, bool level, uint32_t width_us, digital_output_schedule_id_t *id)
+{
+  if (num >= _DIGITAL_OUTPUT_NUM_MAX || width_us < MIN_WIDTH_US)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  return queue_action(num, level ? DIGITAL_OUTPUT_ACTION_CLEAR : DIGITAL_OUTPUT_ACTION_SET, width_us, 0, &level, id);
+}
+
+esp_err_t digital_output_cancel(digital_output_schedule_id_t id)
+{
+  if (s_mutex == NULL)
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+  action_t *action = find_action(id);
+  if (action == NULL)
+  {
+    xSemaphoreGive(s_mutex);
+    return ESP_ERR_NOT_FOUND;
+  }
+
+  digital_output_wheel_remove(&s_wheel, &action->entry);
+  free_action(action);
+
+  // The timer is left armed, an early expiry with nothing due only re-arms
+
+  xSemaphoreGive(s_mutex);
+
+  return ESP_OK;
+}
+
+//**************************************************
+// Static Functions
+//**************************************************
+
+/**
+ * @brief Queues an action delay_us from now. For a pulse, start_level is
+ *        driven under the same lock, so the timer cannot apply the end of
+ *        the pulse before its start however short it is.
+ * @return As digital_output_schedule(), the output is left untouched on error.
+ */
+static esp_err_t queue_action(digital_output_num_t num, digital_output_action_t action, uint64_t delay_us,
+                              uint32_t period_us, const bool *start_level, digital_output_schedule_id_t *id)
+{
+  if (s_mutex == NULL || (digital_output_pwm_outputs() & DIGITAL_OUTPUT_BIT(num)))
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+  action_t *scheduled = alloc_action();
+  if (scheduled == NULL)
+  {
+    xSemaphoreGive(s_mutex);
+    return ESP_ERR_NO_MEM;
+  }
+
+  // The wheel time only moves when the timer fires, and stays behind after
+  // a long idle spell. Bring it to now so the deadline falls in its range
+  const int64_t now_us = esp_timer_get_time();
+  expire_actions(now_us);
+
+  scheduled->num = num;
+  scheduled->action = action;
+  scheduled->period_us = period_us;
+  scheduled->entry.deadline_us = now_us + (int64_t)delay_us;
+
+  esp_err_t err = digital_output_wheel_insert(&s_wheel, &scheduled->entry);
+  if (err != ESP_OK)
+  {
+    free_action(scheduled);
+    xSemaphoreGive(s_mutex);
+    return err;
+  }
+
+  if (start_level != NULL)
+  {
+    digital_output_set_state(num, *start_level);
+  }
+
+  if (id != NULL)
+  {
+    *id = action_id(scheduled);
+  }
+
+  arm_timer();
+
+  xSemaphoreGive(s_mutex);
+
+  return ESP_OK;
+}
+
+/**
+ * @brief Applies the due actions and re-arms the timer.
+ */
+static void timer_callback(void *arg)
+{
+  xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+  s_armed_us = INT64_MAX;
+  expire_actions(esp_timer_get_time());
+  arm_timer();
+
+  xSemaphoreGive(s_mutex);
+}
+
+/**
+ * @brief Advances the wheel to now_us and applies the expired actions in
+ *        deadline order. The resulting levels of all outputs go out in one
+ *        masked write, so actions due together switch together. Mutex held.
+ */
+static void expire_actions(int64_t now_us)
+{
+  const uint32_t before = digital_output_get_mask();
+  uint32_t after = before;
+
+  digital_output_wheel_entry_t *entry = digital_output_wheel_advance(&s_wheel, now_us);
+  while (entry != NULL)
+  {
+    digital_output_wheel_entry_t *next = entry->next;
+    action_t *action = (action_t *)entry;
+    const uint32_t bit = DIGITAL_OUTPUT_BIT(action->num);
+
+    switch (action->action)
+    {
+    case DIGITAL_OUTPUT_ACTION_SET:
+      after |= bit;
+      break;
+
+    case DIGITAL_OUTPUT_ACTION_CLEAR:
+      after &= ~bit;
+      break;
+
+    case DIGITAL_OUTPUT_ACTION_TOGGLE:
+      after ^= bit;
+      break;
+    }
+
+    if (action->period_us != 0)
+    {
+      // Next period from the deadline, not from now, so the period does not drift
+      action->entry.deadline_us += action->period_us;
+      digital_output_wheel_insert(&s_wheel, &action->entry);
+    }
+    else
+    {
+      free_action(action);
+    }
+
+    entry = next;
+  }
+
+  // Outputs switched to PWM since the action was scheduled keep their duty
+  const uint32_t changed = (after ^ before) & ~digital_output_pwm_outputs();
+  if (changed != 0)
+  {
+    digital_output_set_mask(after & changed, before & changed);
+  }
+}
+
+/**
+ * @brief Arms the timer for the next time the wheel must advance, unless it
+ *        is already armed for that time or earlier. Mutex held.
+ */
+static void arm_timer(void)
+{
+  int64_t next_us;
+  if (!digital_output_wheel_next(&s_wheel, &next_us) || next_us >= s_armed_us)
+  {
+    return;
+  }
+
+  esp_timer_stop(s_timer);
+
+  const int64_t delay_us = next_us - esp_timer_get_time();
+  if (esp_timer_start_once(s_timer, delay_us > 0 ? delay_us : 0) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Fail to start schedule timer", __func__);
+    return;
+  }
+
+  s_armed_us = next_us;
+}
+
+/**
+ * @brief Resolves an id to its pending action. Mutex held.
+ * @return The action, or NULL if the id is unknown or already done.
+ */
+static action_t *find_action(digital_output_schedule_id_t id)
+{
+  const uint32_t index = (id & ID_INDEX_MASK) - 1;
+  if (index >= CONFIG_DIGITAL_OUTPUT_SCHEDULE_MAX_ACTIONS)
+  {
+    return NULL;
+  }
+
+  action_t *action = &s_actions[index];
+  return action->used && action->generation == id >> ID_INDEX_BITS ? action : NULL;
+}
+
+/**
+ * @brief Id of an action: generation in the high half, pool index + 1 in the
+ *        low half, so 0 is never a valid id.
+ */
+static digital_output_schedule_id_t action_id(const action_t *action)
+{
+  return ((uint32_t)action->generation << ID_INDEX_BITS) | (uint32_t)(action - s_actions + 1);
+}
+
+/**
+ * @brief Takes an action from the pool. Mutex held.
+ * @return The action, or NULL if the pool is exhausted.
+ */
+static action_t *alloc_action(void)
+{
+  if (s_free_count == 0)
+  {
+    return NULL;
+  }
+
+  action_t *action = &s_actions[s_free[--s_free_count]];
+  action->used = true;
+  action->entry.queued = false;
+  return action;
+}
+
+/**
+ * @brief Returns an action to the pool. Mutex held.
+ */
+static void free_action(action_t *action)
+{
+  action->used = false;
+  action->generation++;
+  s_free[s_free_count++] = action - s_actions;
+}
@@ -0,0 +1,211 @@
+#include "digital_output_internals.h"
+#include <string.h>
+
+//**************************************************
+// Defines
+//**************************************************
+
+#define LEVEL_SHIFT(level) ((level) * DIGITAL_OUTPUT_WHEEL_SLOT_BITS)
+#define SLOT_MASK (DIGITAL_OUTPUT_WHEEL_SLOTS - 1)
+
+//**************************************************
+// Function Prototypes
+//**************************************************
+
+static void link(digital_output_wheel_t *wheel, digital_output_wheel_entry_t *entry);
+static bool next_slot(const digital_output_wheel_t *wheel, int *level, int *slot, int64_t *time_us);
+
+//**************************************************
+// Wheel Functions
+//**************************************************
+
+void digital_output_wheel_init(digital_output_wheel_t *wheel, int64_t now_us)
+{
+  memset(wheel, 0, sizeof(*wheel));
+  wheel->now_us = now_us;
+}
+
+esp_err_t digital_output_wheel_insert(digital_output_wheel_t *wheel, digital_output_wheel_entry_t *entry)
+{
+  if (wheel == NULL || entry == NULL || entry->deadline_us - wheel->now_us >= DIGITAL_OUTPUT_WHEEL_RANGE_US)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  if (entry->queued)
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  // The wheel has no slot for the current tick, a past deadline fires next
+  if (entry->deadline_us <= wheel->now_us)
+  {
+    entry->deadline_us = wheel->now_us + 1;
+  }
+
+  link(wheel, entry);
+  wheel->count++;
+  return ESP_OK;
+}
+
+void digital_output_wheel_remove(digital_output_wheel_t *wheel, digital_output_wheel_entry_t *entry)
+{
+  if (wheel == NULL || entry == NULL || !entry->queued)
+  {
+    return;
+  }
+
+  if (entry->prev != NULL)
+  {
+    entry->prev->next = entry->next;
+  }
+  else
+  {
+    wheel->slots[entry->level][entry->slot] = entry->next;
+  }
+
+  if (entry->next != NULL)
+  {
+    entry->next->prev = entry->prev;
+  }
+
+  if (wheel->slots[entry->level][entry->slot] == NULL)
+  {
+    wheel->occupied[entry->level] &= ~(1ULL << entry->slot);
+  }
+
+  entry->prev = NULL;
+  entry->next = NULL;
+  entry->queued = false;
+  wheel->count--;
+}
+
+bool digital_output_wheel_next(const digital_output_wheel_t *wheel, int64_t *next_us)
+{
+  int level, slot;
+  return next_slot(wheel, &level, &slot, next_us);
+}
+
+digital_output_wheel_entry_t *digital_output_wheel_advance(digital_output_wheel_t *wheel, int64_t now_us)
+{
+  digital_output_wheel_entry_t *expired = NULL;
+  digital_output_wheel_entry_t **tail = &expired;
+  int level, slot;
+  int64_t slot_us;
+
+  // Visit the occupied slots in time order, never skipping one that is due
+  while (next_slot(wheel, &level, &slot, &slot_us) && slot_us <= now_us)
+  {
+    wheel->now_us = slot_us;
+
+    digital_output_wheel_entry_t *entry = wheel->slots[level][slot];
+    wheel->slots[level][slot] = NULL;
+    wheel->occupied[level] &= ~(1ULL << slot);
+
+    while (entry != NULL)
+    {
+      digital_output_wheel_entry_t *next = entry->next;
+
+      if (entry->deadline_us <= slot_us)
+      {
+        // Level 0 slots are single ticks, their entries are all due
+        entry->prev = NULL;
+        entry->next = NULL;
+        entry->queued = false;
+        wheel->count--;
+
+        *tail = entry;
+        tail = &entry->next;
+      }
+      else
+      {
+        // Cascade, the entry lands on a lower level
+        link(wheel, entry);
+      }
+
+      entry = next;
+    }
+  }
+
+  if (now_us > wheel->now_us)
+  {
+    wheel->now_us = now_us;
+  }
+
+  return expired;
+}
+
+//**************************************************
+// Static Functions
+//**************************************************
+
+/**
+ * @brief Links an entry at the level of the highest 6-bit group where its
+ *        deadline differs from the wheel time. Deadlines past the top level
+ *        rotation wrap into its slots at or before the current one.
+ */
+static void link(digital_output_wheel_t *wheel, digital_output_wheel_entry_t *entry)
+{
+  const uint64_t diff = (uint64_t)entry->deadline_us ^ (uint64_t)wheel->now_us;
+
+  int level = 0;
+  while (level < DIGITAL_OUTPUT_WHEEL_LEVELS - 1 && (diff >> LEVEL_SHIFT(level + 1)) != 0)
+  {
+    level++;
+  }
+
+  const int slot = ((uint64_t)entry->deadline_us >> LEVEL_SHIFT(level)) & SLOT_MASK;
+
+  entry->level = level;
+  entry->slot = slot;
+  entry->prev = NULL;
+  entry->next = wheel->slots[level][slot];
+  entry->queued = true;
+
+  if (entry->next != NULL)
+  {
+    entry->next->prev = entry;
+  }
+
+  wheel->slots[level][slot] = entry;
+  wheel->occupied[level] |= 1ULL << slot;
+}
+
+/**
+ * @brief Finds the earliest occupied slot. Entries always sit after the
+ *        current slot of their level, so the lowest non-empty level holds it.
+ *        Only the top level can hold wrapped slots, which belong to its next
+ *        rotation.
+ */
+static bool next_slot(const digital_output_wheel_t *wheel, int *level, int *slot, int64_t *time_us)
+{
+  for (int l = 0; l < DIGITAL_OUTPUT_WHEEL_LEVELS; l++)
+  {
+    if (wheel->occupied[l] == 0)
+    {
+      continue;
+    }
+
+    const int shift = LEVEL_SHIFT(l);
+    const int current = ((uint64_t)wheel->now_us >> shift) & SLOT_MASK;
+    const uint64_t rotation_us = 1ULL << (shift + DIGITAL_OUTPUT_WHEEL_SLOT_BITS);
+    const uint64_t base_us = (uint64_t)wheel->now_us & ~(rotation_us - 1);
+    const uint64_t later = current == SLOT_MASK ? 0 : wheel->occupied[l] & (~0ULL << (current + 1));
+
+    *level = l;
+    if (later != 0)
+    {
+      *slot = __builtin_ctzll(later);
+      *time_us = base_us + ((uint64_t)*slot << shift);
+    }
+    else
+    {
+      *slot = __builtin_ctzll(wheel->occupied[l]);
+      *time_us = base_us + rotation_us + ((uint64_t)*slot << shift);
+    }
+
+    return true;
+  }
+
+  return false;
+}
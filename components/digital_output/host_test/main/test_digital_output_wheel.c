@@ -0,0 +1,283 @@
+#include "digital_output_internals.h"
+#include "unity.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+//**************************************************
+// Defines
+//**************************************************
+
+#define MODEL_ENTRIES 4096    // Pending timers of the brute-force comparison
+#define MODEL_STEPS 200000    // Random operations checked against the model
+#define BENCH_MAX_ENTRIES 16384
+
+#define HOUR_US (3600LL * 1000000)
+
+//**************************************************
+// Function Prototypes
+//**************************************************
+
+static void expect_expired(digital_output_wheel_entry_t *expired, int64_t now_us);
+static int64_t random_delay(void);
+static uint32_t random_next(void);
+static int64_t clock_ns(void);
+
+//**************************************************
+// Globals
+//**************************************************
+
+static digital_output_wheel_t s_wheel;
+static digital_output_wheel_entry_t s_entries[BENCH_MAX_ENTRIES];
+static uint32_t s_seed = 1;
+
+//**************************************************
+// Tests
+//**************************************************
+
+void setUp(void)
+{
+  s_seed = 1;
+  digital_output_wheel_init(&s_wheel, 0);
+  memset(s_entries, 0, sizeof(s_entries));
+}
+
+void tearDown(void)
+{
+}
+
+/**
+ * @brief An entry expires at its deadline and not a tick before.
+ */
+static void test_expires_at_deadline(void)
+{
+  int64_t next_us;
+
+  s_entries[0].deadline_us = 500000;
+  TEST_ASSERT_EQUAL(ESP_OK, digital_output_wheel_insert(&s_wheel, &s_entries[0]));
+  TEST_ASSERT_TRUE(digital_output_wheel_next(&s_wheel, &next_us));
+  TEST_ASSERT_TRUE(next_us <= 500000);
+
+  TEST_ASSERT_NULL(digital_output_wheel_advance(&s_wheel, 499999));
+  TEST_ASSERT_TRUE(s_entries[0].queued);
+
+  TEST_ASSERT_EQUAL_PTR(&s_entries[0], digital_output_wheel_advance(&s_wheel, 500000));
+  TEST_ASSERT_FALSE(s_entries[0].queued);
+  TEST_ASSERT_FALSE(digital_output_wheel_next(&s_wheel, &next_us));
+  TEST_ASSERT_EQUAL(0, s_wheel.count);
+}
+
+/**
+ * @brief A past deadline fires on the next advance, a removed one never.
+ */
+static void test_past_and_removed(void)
+{
+  digital_output_wheel_advance(&s_wheel, 1000);
+
+  s_entries[0].deadline_us = 10;
+  s_entries[1].deadline_us = 2000;
+  TEST_ASSERT_EQUAL(ESP_OK, digital_output_wheel_insert(&s_wheel, &s_entries[0]));
+  TEST_ASSERT_EQUAL(ESP_OK, digital_output_wheel_insert(&s_wheel, &s_entries[1]));
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, digital_output_wheel_insert(&s_wheel, &s_entries[1]));
+
+  digital_output_wheel_remove(&s_wheel, &s_entries[1]);
+  digital_output_wheel_remove(&s_wheel, &s_entries[1]); // No-op once unlinked
+
+  TEST_ASSERT_EQUAL_PTR(&s_entries[0], digital_output_wheel_advance(&s_wheel, 1001));
+  TEST_ASSERT_NULL(digital_output_wheel_advance(&s_wheel, 3000));
+  TEST_ASSERT_EQUAL(0, s_wheel.count);
+}
+
+/**
+ * @brief The range counts from the wheel time: after a long idle spell the
+ *        owner advances to now and short delays fit again.
+ */
+static void test_range_after_idle(void)
+{
+  const int64_t idle_us = 20 * HOUR_US;
+
+  s_entries[0].deadline_us = DIGITAL_OUTPUT_WHEEL_RANGE_US;
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, digital_output_wheel_insert(&s_wheel, &s_entries[0]));
+
+  s_entries[0].deadline_us = idle_us + 500000;
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, digital_output_wheel_insert(&s_wheel, &s_entries[0]));
+
+  TEST_ASSERT_NULL(digital_output_wheel_advance(&s_wheel, idle_us));
+  TEST_ASSERT_EQUAL(ESP_OK, digital_output_wheel_insert(&s_wheel, &s_entries[0]));
+  TEST_ASSERT_NULL(digital_output_wheel_advance(&s_wheel, idle_us + 499999));
+  TEST_ASSERT_EQUAL_PTR(&s_entries[0], digital_output_wheel_advance(&s_wheel, idle_us + 500000));
+}
+
+/**
+ * @brief Random inserts, removes and advances over thousands of pending
+ *        entries, checked against a brute-force model: each advance returns
+ *        exactly the due entries, in deadline order, and the next wake-up
+ *        never comes after the earliest deadline.
+ */
+static void test_against_model(void)
+{
+  int64_t now_us = 0;
+
+  for (int step = 0; step < MODEL_STEPS; step++)
+  {
+    digital_output_wheel_entry_t *entry = &s_entries[random_next() % MODEL_ENTRIES];
+    const uint32_t op = random_next() % 8;
+
+    if (op < 4 && !entry->queued)
+    {
+      entry->deadline_us = now_us + random_delay();
+      TEST_ASSERT_EQUAL(ESP_OK, digital_output_wheel_insert(&s_wheel, entry));
+    }
+    else if (op < 6)
+    {
+      digital_output_wheel_remove(&s_wheel, entry);
+    }
+    else
+    {
+      // Mostly short steps, now and then a jump across the upper levels
+      now_us += random_next() % 16 == 0 ? random_delay() : random_next() % 4096;
+      expect_expired(digital_output_wheel_advance(&s_wheel, now_us), now_us);
+    }
+  }
+}
+
+/**
+ * @brief Insert, cancel and expire cost per operation for growing numbers
+ *        of pending entries. O(1) shows as a flat cost per operation.
+ */
+static void test_benchmark(void)
+{
+  static const int sizes[] = {1024, 4096, BENCH_MAX_ENTRIES};
+
+  printf("%8s %12s %12s %12s\n", "pending", "insert ns", "cancel ns", "expire ns");
+
+  for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+  {
+    const int count = sizes[i];
+    const int64_t horizon_us = 10 * 1000000; // Pulses and delays up to 10 s
+
+    digital_output_wheel_init(&s_wheel, 0);
+    for (int n = 0; n < count; n++)
+    {
+      s_entries[n].deadline_us = 1 + random_next() % horizon_us;
+    }
+
+    int64_t start = clock_ns();
+    for (int n = 0; n < count; n++)
+    {
+      digital_output_wheel_insert(&s_wheel, &s_entries[n]);
+    }
+    const int64_t insert_ns = clock_ns() - start;
+
+    start = clock_ns();
+    for (int n = 0; n < count; n++)
+    {
+      digital_output_wheel_remove(&s_wheel, &s_entries[n]);
+    }
+    const int64_t cancel_ns = clock_ns() - start;
+
+    for (int n = 0; n < count; n++)
+    {
+      digital_output_wheel_insert(&s_wheel, &s_entries[n]);
+    }
+
+    // Expire in 1 ms steps, as a busy schedule timer would
+    int expired = 0;
+    start = clock_ns();
+    for (int64_t now_us = 1000; expired < count; now_us += 1000)
+    {
+      for (digital_output_wheel_entry_t *entry = digital_output_wheel_advance(&s_wheel, now_us); entry != NULL; entry = entry->next)
+      {
+        expired++;
+      }
+    }
+    const int64_t expire_ns = clock_ns() - start;
+
+    TEST_ASSERT_EQUAL(count, expired);
+    printf("%8d %12.1f %12.1f %12.1f\n", count, (double)insert_ns / count, (double)cancel_ns / count, (double)expire_ns / count);
+  }
+}
+
+void app_main(void)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_expires_at_deadline);
+  RUN_TEST(test_past_and_removed);
+  RUN_TEST(test_range_after_idle);
+  RUN_TEST(test_against_model);
+  RUN_TEST(test_benchmark);
+  exit(UNITY_END());
+}
+
+//**************************************************
+// Static Functions
+//**************************************************
+
+/**
+ * @brief Checks an expired list against the model: every entry still
+ *        queued is due later, every expired one was due, in deadline order.
+ */
+static void expect_expired(digital_output_wheel_entry_t *expired, int64_t now_us)
+{
+  int64_t last_us = INT64_MIN;
+  int64_t earliest_us = INT64_MAX;
+  size_t queued = 0;
+
+  for (digital_output_wheel_entry_t *entry = expired; entry != NULL; entry = entry->next)
+  {
+    TEST_ASSERT_FALSE(entry->queued);
+    TEST_ASSERT_TRUE(entry->deadline_us <= now_us);
+    TEST_ASSERT_TRUE(entry->deadline_us >= last_us);
+    last_us = entry->deadline_us;
+  }
+
+  for (int n = 0; n < MODEL_ENTRIES; n++)
+  {
+    if (s_entries[n].queued)
+    {
+      TEST_ASSERT_TRUE(s_entries[n].deadline_us > now_us);
+      earliest_us = s_entries[n].deadline_us < earliest_us ? s_entries[n].deadline_us : earliest_us;
+      queued++;
+    }
+  }
+
+  TEST_ASSERT_EQUAL(queued, s_wheel.count);
+
+  int64_t next_us;
+  TEST_ASSERT_EQUAL(queued != 0, digital_output_wheel_next(&s_wheel, &next_us));
+  if (queued != 0)
+  {
+    TEST_ASSERT_TRUE(next_us > now_us);
+    TEST_ASSERT_TRUE(next_us <= earliest_us);
+  }
+}
+
+/**
+ * @brief Delay spread evenly over the levels: a random number of bits,
+ *        then a random value of that size, up to the wheel range.
+ */
+static int64_t random_delay(void)
+{
+  const int bits = 1 + random_next() % (DIGITAL_OUTPUT_WHEEL_SLOT_BITS * DIGITAL_OUTPUT_WHEEL_LEVELS - 1);
+  const uint64_t value = ((uint64_t)random_next() << 32) | random_next();
+  return 1 + (int64_t)(value & ((1ULL << bits) - 1));
+}
+
+/**
+ * @brief xorshift32, the sequence is the same on every run.
+ */
+static uint32_t random_next(void)
+{
+  s_seed ^= s_seed << 13;
+  s_seed ^= s_seed >> 17;
+  s_seed ^= s_seed << 5;
+  return s_seed;
+}
+
+static int64_t clock_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
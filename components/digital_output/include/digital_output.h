@@ -4,6 +4,30 @@
 #include "stdbool.h"
 #include "driver/gpio.h"
 
+//**************************************************
+// Defines
+//**************************************************
+
+/**
+ * @brief Bit of an output in the masks of digital_output_set_mask() and
+ *        digital_output_get_mask().
+ */
+#define DIGITAL_OUTPUT_BIT(num) (1U << (num))
+
+/**
+ * @brief Mask holding every output.
+ */
+#define DIGITAL_OUTPUT_MASK_ALL ((1U << _DIGITAL_OUTPUT_NUM_MAX) - 1)
+
+/**
+ * @brief Default PWM settings: 5 kHz with a 10-bit duty, flicker free for LEDs.
+ */
+#define DIGITAL_OUTPUT_PWM_DEFAULT_CONFIG() \
+  {                                         \
+      .frequency_hz = 5000,                 \
+      .resolution_bits = 10,                \
+  }
+
 //**************************************************
 // Typedef
 //**************************************************
@@ -21,6 +45,31 @@ typedef enum
   _DIGITAL_OUTPUT_NUM_MAX
 } digital_output_num_t;
 
+/**
+ * @brief Actions the scheduler can apply to an output.
+ */
+typedef enum
+{
+  DIGITAL_OUTPUT_ACTION_SET = 0, /**< Drive HIGH */
+  DIGITAL_OUTPUT_ACTION_CLEAR,   /**< Drive LOW */
+  DIGITAL_OUTPUT_ACTION_TOGGLE,  /**< Invert the current level */
+} digital_output_action_t;
+
+/**
+ * @brief Handle of a scheduled action, 0 is never a valid id.
+ */
+typedef uint32_t digital_output_schedule_id_t;
+
+/**
+ * @brief PWM settings of an output. Each output has its own LEDC timer, so
+ *        the frequencies are independent.
+ */
+typedef struct
+{
+  uint32_t frequency_hz;   /**< PWM frequency */
+  uint8_t resolution_bits; /**< Duty resolution, the duty ranges 0 to 2^bits */
+} digital_output_pwm_config_t;
+
 /**
  * @brief Possible states for a digital output, including error status.
  */
@@ -64,5 +113,142 @@ digital_output_state_t digital_output_get_state(digital_output_num_t num);
  * @return - ESP_OK: Output set successfully.
  *
  *         - ESP_ERR_INVALID_ARG: Provided channel is out of bounds.
+ *
+ *         - ESP_ERR_INVALID_STATE: The output is in PWM mode.
  */
 esp_err_t digital_output_set_state(digital_output_num_t num, bool new_state);
+
+/**
+ * @brief Sets and clears several outputs at once. The levels are written
+ *        through the GPIO W1TS/W1TC registers back to back, with no other
+ *        output write in between, so the switches are not visibly staggered.
+ * @param set_mask   Outputs to drive HIGH, DIGITAL_OUTPUT_BIT() of each.
+ * @param clear_mask Outputs to drive LOW. Outputs in neither mask are kept.
+ * @return - ESP_OK: Outputs updated.
+ *
+ *         - ESP_ERR_INVALID_ARG: A mask holds an unknown output, or both
+ *         masks hold the same output.
+ *
+ *         - ESP_ERR_INVALID_STATE: A mask holds an output in PWM mode.
+ */
+esp_err_t digital_output_set_mask(uint32_t set_mask, uint32_t clear_mask);
+
+/**
+ * @brief Reads the logic state of every output.
+ * @return Mask with DIGITAL_OUTPUT_BIT() set for each output that is HIGH.
+ *         Outputs in PWM mode read as LOW, see digital_output_pwm_get().
+ */
+uint32_t digital_output_get_mask();
+
+/**
+ * @brief Schedules an action on an output. Actions sit in a timing wheel
+ *        driven by a one-shot esp_timer, with 1 us resolution and O(1)
+ *        insert, cancel and expiry. Actions due at the same time are applied
+ *        in one masked write.
+ * @param num       The logical output number.
+ * @param action    Action to apply.
+ * @param delay_us  Time until the first application, 0 for as soon as possible.
+ * @param period_us Repeat period, 0 for a one-shot. Repeats keep their phase.
+ * @param id        Optional, handle for digital_output_cancel().
+ * @return - ESP_OK: Action scheduled.
+ *
+ *         - ESP_ERR_INVALID_ARG: Unknown output or action, delay beyond about
+ *         19 hours, or period below 100 us.
+ *
+ *         - ESP_ERR_NO_MEM: CONFIG_DIGITAL_OUTPUT_SCHEDULE_MAX_ACTIONS are pending.
+ *
+ *         - ESP_ERR_INVALID_STATE: Component not initialized, or the output is
+ *         in PWM mode. Actions on an output later switched to PWM are skipped.
+ */
+esp_err_t digital_output_schedule(digital_output_num_t num, digital_output_action_t action,
+                                  uint64_t delay_us, uint32_t period_us, digital_output_schedule_id_t *id);
+
+/**
+ * @brief Drives an output to a level now and back after width_us, timed by
+ *        the scheduler instead of the caller.
+ * @param num      The logical output number.
+ * @param level    Level of the pulse.
+ * @param width_us Pulse width, at least 50 us.
+ * @param id       Optional, handle of the pending end of the pulse.
+ * @return - ESP_OK: Pulse started.
+ *
+ *         - ESP_ERR_INVALID_ARG: Unknown output, or width below 50 us.
+ *
+ *         - Other: As digital_output_schedule(), the output is left untouched.
+ */
+esp_err_t digital_output_pulse(digital_output_num_t num, bool level, uint32_t width_us, digital_output_schedule_id_t *id);
+
+/**
+ * @brief Cancels a pending action. A periodic action stops repeating.
+ * @param id Handle returned when scheduling.
+ * @return - ESP_OK: Action cancelled.
+ *
+ *         - ESP_ERR_NOT_FOUND: Unknown id, or the one-shot action already ran.
+ *
+ *         - ESP_ERR_INVALID_STATE: Component not initialized.
+ */
+esp_err_t digital_output_cancel(digital_output_schedule_id_t id);
+
+/**
+ * @brief Switches an output to PWM mode, driven by the LEDC peripheral, or
+ *        changes its frequency and resolution. The duty starts at 0.
+ * @param num    The logical output number.
+ * @param config PWM settings, see DIGITAL_OUTPUT_PWM_DEFAULT_CONFIG().
+ * @return - ESP_OK: Output in PWM mode.
+ *
+ *         - ESP_ERR_INVALID_ARG: Unknown output or NULL config.
+ *
+ *         - ESP_FAIL: The LEDC cannot reach this frequency at this resolution.
+ */
+esp_err_t digital_output_pwm_enable(digital_output_num_t num, const digital_output_pwm_config_t *config);
+
+/**
+ * @brief Returns an output from PWM mode to a plain digital output, LOW.
+ * @param num The logical output number.
+ * @return - ESP_OK: Output back in digital mode, or was not in PWM mode.
+ *
+ *         - ESP_ERR_INVALID_ARG: Unknown output.
+ */
+esp_err_t digital_output_pwm_disable(digital_output_num_t num);
+
+/**
+ * @brief Sets the duty of a PWM output, stopping any fade in progress.
+ * @param num  The logical output number.
+ * @param duty Duty, 0 to 2^resolution_bits (always on).
+ * @return - ESP_OK: Duty applied.
+ *
+ *         - ESP_ERR_INVALID_ARG: Unknown output or duty out of range.
+ *
+ *         - ESP_ERR_INVALID_STATE: The output is not in PWM mode.
+ */
+esp_err_t digital_output_pwm_set_duty(digital_output_num_t num, uint32_t duty);
+
+/**
+ * @brief Starts a hardware fade of a PWM output. The LEDC ramps the duty
+ *        by itself, no CPU is used once it started.
+ * @param num         The logical output number.
+ * @param target_duty Duty at the end of the fade, 0 to 2^resolution_bits.
+ * @param duration_ms Fade duration.
+ * @return - ESP_OK: Fade started.
+ *
+ *         - ESP_ERR_INVALID_ARG: Unknown output or duty out of range.
+ *
+ *         - ESP_ERR_INVALID_STATE: The output is not in PWM mode.
+ *
+ *         - ESP_FAIL: The LEDC rejected the fade.
+ */
+esp_err_t digital_output_pwm_fade(digital_output_num_t num, uint32_t target_duty, uint32_t duration_ms);
+
+/**
+ * @brief Reads the PWM state of an output. During a fade the duty is the
+ *        one the hardware is currently at.
+ * @param num    The logical output number.
+ * @param config Optional, current settings.
+ * @param duty   Optional, current duty.
+ * @return - ESP_OK: Output in PWM mode, state copied.
+ *
+ *         - ESP_ERR_INVALID_ARG: Unknown output.
+ *
+ *         - ESP_ERR_INVALID_STATE: The output is not in PWM mode.
+ */
+esp_err_t digital_output_pwm_get(digital_output_num_t num, digital_output_pwm_config_t *config, uint32_t *duty);
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "esp_err.h"
+#include "stdbool.h"
+#include <stdint.h>
+#include <stddef.h>
+#include "sdkconfig.h"
+
+#if !CONFIG_IDF_TARGET_LINUX
+#include "digital_output.h"
+#include "driver/gpio.h"
+#endif
+
+//**************************************************
+// Defines
+//**************************************************
+
+#define DIGITAL_OUTPUT_WHEEL_SLOT_BITS 6 // 64 slots per level, one 64-bit occupancy word
+#define DIGITAL_OUTPUT_WHEEL_SLOTS (1 << DIGITAL_OUTPUT_WHEEL_SLOT_BITS)
+#define DIGITAL_OUTPUT_WHEEL_LEVELS 6
+
+/**
+ * @brief Longest delay the wheel accepts: 2^36 us, about 19 hours.
+ */
+#define DIGITAL_OUTPUT_WHEEL_RANGE_US (1LL << (DIGITAL_OUTPUT_WHEEL_SLOT_BITS * DIGITAL_OUTPUT_WHEEL_LEVELS))
+
+//**************************************************
+// Typedefs
+//**************************************************
+
+/**
+ * @brief Timer of the wheel. Embedded as the first member of the owner's
+ *        record, the wheel only links it.
+ */
+typedef struct digital_output_wheel_entry_t
+{
+  struct digital_output_wheel_entry_t *prev;
+  struct digital_output_wheel_entry_t *next;
+  int64_t deadline_us; /**< Expiry time, set before inserting */
+  uint8_t level;       /**< Level holding the entry */
+  uint8_t slot;        /**< Slot holding the entry */
+  bool queued;         /**< Linked in the wheel */
+} digital_output_wheel_entry_t;
+
+/**
+ * @brief Hierarchical timing wheel with a 1 us tick. Level n slots span
+ *        64^n us. An entry sits at the level of the highest 6-bit group where
+ *        its deadline differs from the wheel time, and moves down one level or
+ *        more each time its slot comes up, so insert, cancel and expire are
+ *        O(1) and empty slots are skipped through the occupancy words.
+ */
+typedef struct
+{
+  digital_output_wheel_entry_t *slots[DIGITAL_OUTPUT_WHEEL_LEVELS][DIGITAL_OUTPUT_WHEEL_SLOTS];
+  uint64_t occupied[DIGITAL_OUTPUT_WHEEL_LEVELS]; /**< Bit n set while slot n holds entries */
+  int64_t now_us;                                 /**< Time the wheel was advanced to */
+  size_t count;                                   /**< Entries queued */
+} digital_output_wheel_t;
+
+//**************************************************
+// Globals
+//**************************************************
+
+#if !CONFIG_IDF_TARGET_LINUX
+/**
+ * @brief Maps logical outputs to physical GPIOs.
+ */
+extern const gpio_num_t digital_output_gpio_map[_DIGITAL_OUTPUT_NUM_MAX];
+#endif
+
+//**************************************************
+// Wheel Functions
+//**************************************************
+
+/**
+ * @brief Empties a wheel and sets its time. Pure, no OS dependency, so the
+ *        wheel also builds on the host.
+ */
+void digital_output_wheel_init(digital_output_wheel_t *wheel, int64_t now_us);
+
+/**
+ * @brief Queues an entry at its deadline_us. A deadline already past
+ *        expires on the next advance. The range counts from the wheel time,
+ *        which only moves on advance: advance to the current time first.
+ * @return - ESP_OK: Entry queued.
+ *
+ *         - ESP_ERR_INVALID_ARG: NULL pointer, or deadline beyond DIGITAL_OUTPUT_WHEEL_RANGE_US.
+ *
+ *         - ESP_ERR_INVALID_STATE: Entry already queued.
+ */
+esp_err_t digital_output_wheel_insert(digital_output_wheel_t *wheel, digital_output_wheel_entry_t *entry);
+
+/**
+ * @brief Unlinks a queued entry. No-op if it is not queued.
+ */
+void digital_output_wheel_remove(digital_output_wheel_t *wheel, digital_output_wheel_entry_t *entry);
+
+/**
+ * @brief Time the wheel next needs to be advanced to: the earliest deadline,
+ *        or an earlier slot boundary where entries move down a level.
+ * @return false if the wheel is empty.
+ */
+bool digital_output_wheel_next(const digital_output_wheel_t *wheel, int64_t *next_us);
+
+/**
+ * @brief Moves the wheel time to now_us and unlinks every entry that expired.
+ * @return The expired entries in deadline order, linked through next, or NULL.
+ */
+digital_output_wheel_entry_t *digital_output_wheel_advance(digital_output_wheel_t *wheel, int64_t now_us);
+
+//**************************************************
+// Scheduler Functions
+//**************************************************
+
+/**
+ * @brief Creates the scheduler timer and lock. Called by digital_output_initialize().
+ * @return - ESP_OK: Scheduler ready.
+ *
+ *         - ESP_FAIL: Timer or mutex creation failed.
+ */
+esp_err_t digital_output_schedule_init(void);
+
+//**************************************************
+// PWM Functions
+//**************************************************
+
+/**
+ * @brief Installs the LEDC fade service. Called by digital_output_initialize().
+ * @return - ESP_OK: PWM mode available.
+ *
+ *         - ESP_FAIL: Fade service installation failed.
+ */
+esp_err_t digital_output_pwm_init(void);
+
+/**
+ * @brief Outputs currently in PWM mode, lock-free.
+ * @return Mask with DIGITAL_OUTPUT_BIT() set for each PWM output.
+ */
+uint32_t digital_output_pwm_outputs(void);
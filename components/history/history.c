@@ -0,0 +1,241 @@
+#include "history.h"
+#include "history_internals.h"
+#include "analog_input.h"
+#include "sensor.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <math.h>
+#include <string.h>
+
+//**************************************************
+// Defines
+//**************************************************
+
+#define SECOND_MS 1000
+#define MINUTE_MS 60000
+#define TICK_US 1000000 // Closes the buckets of channels that went quiet
+
+#define SENSOR_SCALE 100.0f // Sensor values are stored in hundredths
+
+//**************************************************
+// Typedefs
+//**************************************************
+
+/**
+ * @brief Tiers of a channel and the buckets being filled for them.
+ */
+typedef struct
+{
+  history_tier_t tiers[_HISTORY_RES_MAX];
+  history_acc_t second;
+  history_acc_t minute;
+} channel_t;
+
+//**************************************************
+// Function Prototypes
+//**************************************************
+
+static void analog_input_event_handler(const analog_input_num_t num, const uint16_t value);
+static void sensor_event_handler(float humidity, float temperature);
+static void timer_callback(void *arg);
+static void record(history_ch_t ch, int64_t now_ms, int32_t value);
+static int16_t clamp(int32_t value);
+
+//**************************************************
+// Globals
+//**************************************************
+
+static const char TAG[] = "history";
+
+static channel_t s_channels[_HISTORY_CH_MAX];
+
+// Fixed storage, the whole history is sized here by menuconfig
+static history_raw_record_t s_raw[_HISTORY_CH_MAX][CONFIG_HISTORY_RAW_RECORDS];
+static history_bucket_record_t s_seconds[_HISTORY_CH_MAX][CONFIG_HISTORY_SECOND_RECORDS];
+static history_bucket_record_t s_minutes[_HISTORY_CH_MAX][CONFIG_HISTORY_MINUTE_RECORDS];
+
+static esp_timer_handle_t s_timer = NULL;
+static SemaphoreHandle_t s_mutex = NULL; /**< Protects the channels */
+
+//**************************************************
+// Public Functions
+//**************************************************
+
+esp_err_t history_initialize(void)
+{
+  _Static_assert(HISTORY_CH_ANALOG_1 == (int)ANALOG_INPUT_NUM_1 && HISTORY_CH_TEMPERATURE == (int)_ANALOG_INPUT_NUM_MAX,
+                 "Analog channels must come first, numbered as the analog inputs");
+
+  if (s_mutex != NULL)
+  {
+    return ESP_OK;
+  }
+
+  for (size_t ch = 0; ch < _HISTORY_CH_MAX; ch++)
+  {
+    channel_t *channel = &s_channels[ch];
+    history_tier_init_raw(&channel->tiers[HISTORY_RES_RAW], s_raw[ch], CONFIG_HISTORY_RAW_RECORDS);
+    history_tier_init_buckets(&channel->tiers[HISTORY_RES_SECOND], s_seconds[ch], CONFIG_HISTORY_SECOND_RECORDS, SECOND_MS);
+    history_tier_init_buckets(&channel->tiers[HISTORY_RES_MINUTE], s_minutes[ch], CONFIG_HISTORY_MINUTE_RECORDS, MINUTE_MS);
+  }
+
+  if ((s_mutex = xSemaphoreCreateMutex()) == NULL)
+  {
+    ESP_LOGE(TAG, "%s:Fail to create mutex", __func__);
+    return ESP_FAIL;
+  }
+
+  const esp_timer_create_args_t timer_args = {
+      .callback = timer_callback,
+      .dispatch_method = ESP_TIMER_TASK,
+      .name = "history",
+      .skip_unhandled_events = true,
+  };
+
+  if (esp_timer_create(&timer_args, &s_timer) != ESP_OK || esp_timer_start_periodic(s_timer, TICK_US) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Fail to start tick timer", __func__);
+    return ESP_FAIL;
+  }
+
+  if (analog_input_add_event_handler(analog_input_event_handler) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Fail to add analog input handler", __func__);
+    return ESP_FAIL;
+  }
+
+  if (sensor_add_event_handler(sensor_event_handler) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Fail to add sensor handler", __func__);
+    return ESP_FAIL;
+  }
+
+  ESP_LOGI(TAG, "%s:%u bytes of history", __func__,
+           (unsigned)(sizeof(s_raw) + sizeof(s_seconds) + sizeof(s_minutes)));
+
+  return ESP_OK;
+}
+
+void history_cursor_init(history_cursor_t *cursor, int64_t from_ms)
+{
+  memset(cursor, 0, sizeof(*cursor));
+  cursor->from_ms = from_ms;
+}
+
+esp_err_t history_read(history_ch_t ch, history_res_t res, history_cursor_t *cursor,
+                       history_point_t *points, size_t max, size_t *count)
+{
+  if (ch >= _HISTORY_CH_MAX || res >= _HISTORY_RES_MAX || cursor == NULL || points == NULL || count == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  if (s_mutex == NULL)
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  xSemaphoreTake(s_mutex, portMAX_DELAY);
+  *count = history_tier_read(&s_channels[ch].tiers[res], cursor, points, max);
+  xSemaphoreGive(s_mutex);
+
+  return ESP_OK;
+}
+
+uint32_t history_period_ms(history_res_t res)
+{
+  switch (res)
+  {
+  case HISTORY_RES_SECOND:
+    return SECOND_MS;
+
+  case HISTORY_RES_MINUTE:
+    return MINUTE_MS;
+
+  default:
+    return 0;
+  }
+}
+
+//**************************************************
+// Static Functions
+//**************************************************
+
+/**
+ * @brief Records every value reported by the analog input module.
+ */
+static void analog_input_event_handler(const analog_input_num_t num, const uint16_t value)
+{
+  record((history_ch_t)num, esp_timer_get_time() / 1000, value);
+}
+
+/**
+ * @brief Records every sensor reading, in hundredths.
+ */
+static void sensor_event_handler(float humidity, float temperature)
+{
+  const int64_t now_ms = esp_timer_get_time() / 1000;
+
+  record(HISTORY_CH_TEMPERATURE, now_ms, lroundf(temperature * SENSOR_SCALE));
+  record(HISTORY_CH_HUMIDITY, now_ms, lroundf(humidity * SENSOR_SCALE));
+}
+
+/**
+ * @brief Closes the buckets that ended and drops the raw values past the raw
+ *        span, for channels that stopped reporting as well.
+ */
+static void timer_callback(void *arg)
+{
+  const int64_t now_ms = esp_timer_get_time() / 1000;
+
+  xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+  for (size_t ch = 0; ch < _HISTORY_CH_MAX; ch++)
+  {
+    channel_t *channel = &s_channels[ch];
+    history_acc_flush(&channel->second, &channel->tiers[HISTORY_RES_SECOND], now_ms);
+    history_acc_flush(&channel->minute, &channel->tiers[HISTORY_RES_MINUTE], now_ms);
+    history_tier_expire(&channel->tiers[HISTORY_RES_RAW], now_ms - CONFIG_HISTORY_RAW_SPAN_S * 1000LL);
+  }
+
+  xSemaphoreGive(s_mutex);
+}
+
+/**
+ * @brief Stores a value in the raw tier and adds it to the open buckets.
+ */
+static void record(history_ch_t ch, int64_t now_ms, int32_t value)
+{
+  channel_t *channel = &s_channels[ch];
+  const int16_t stored = clamp(value);
+  const history_point_t point = {.time_ms = now_ms, .min = stored, .avg = stored, .max = stored};
+
+  xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+  history_tier_append(&channel->tiers[HISTORY_RES_RAW], &point);
+  history_tier_expire(&channel->tiers[HISTORY_RES_RAW], now_ms - CONFIG_HISTORY_RAW_SPAN_S * 1000LL);
+  history_acc_add(&channel->second, &channel->tiers[HISTORY_RES_SECOND], now_ms, stored);
+  history_acc_add(&channel->minute, &channel->tiers[HISTORY_RES_MINUTE], now_ms, stored);
+
+  xSemaphoreGive(s_mutex);
+}
+
+/**
+ * @brief Brings a value into the stored range, see HISTORY_VALUE_MIN.
+ */
+static int16_t clamp(int32_t value)
+{
+  if (value < HISTORY_VALUE_MIN)
+  {
+    return HISTORY_VALUE_MIN;
+  }
+
+  if (value > HISTORY_VALUE_MAX)
+  {
+    return HISTORY_VALUE_MAX;
+  }
+
+  return (int16_t)value;
+}
@@ -0,0 +1,310 @@
+#include "history_internals.h"
+#include <string.h>
+
+//**************************************************
+// Function Prototypes
+//**************************************************
+
+static void reset(history_tier_t *tier);
+static void evict(history_tier_t *tier);
+static void push(history_tier_t *tier, const history_point_t *point, bool gap);
+static bool decode(const history_tier_t *tier, size_t index, const history_point_t *prev, history_point_t *point);
+
+//**************************************************
+// Tier Functions
+//**************************************************
+
+void history_tier_init_raw(history_tier_t *tier, history_raw_record_t *records, size_t capacity)
+{
+  memset(tier, 0, sizeof(*tier));
+  tier->raw = records;
+  tier->capacity = capacity;
+  tier->empty = true;
+}
+
+void history_tier_init_buckets(history_tier_t *tier, history_bucket_record_t *records, size_t capacity, uint32_t period_ms)
+{
+  memset(tier, 0, sizeof(*tier));
+  tier->buckets = records;
+  tier->capacity = capacity;
+  tier->period_ms = period_ms;
+  tier->empty = true;
+}
+
+void history_tier_append(history_tier_t *tier, const history_point_t *point)
+{
+  if (!tier->empty)
+  {
+    const int64_t elapsed_ms = point->time_ms - tier->last.time_ms;
+
+    if (elapsed_ms <= 0)
+    {
+      return;
+    }
+
+    if (tier->period_ms == 0)
+    {
+      if (elapsed_ms > UINT16_MAX)
+      {
+        reset(tier);
+      }
+    }
+    else
+    {
+      const int64_t missing = elapsed_ms / tier->period_ms - 1;
+      if (missing >= (int64_t)tier->capacity)
+      {
+        reset(tier);
+      }
+      else
+      {
+        for (int64_t i = 0; i < missing && !tier->empty; i++)
+        {
+          history_point_t gap = tier->last;
+          gap.time_ms += tier->period_ms;
+          push(tier, &gap, true);
+        }
+      }
+    }
+  }
+
+  if (tier->empty)
+  {
+    tier->base = *point;
+    tier->last = *point;
+    tier->empty = false;
+    return;
+  }
+
+  push(tier, point, false);
+}
+
+void history_tier_expire(history_tier_t *tier, int64_t before_ms)
+{
+  while (!tier->empty && tier->base.time_ms < before_ms)
+  {
+    evict(tier);
+  }
+}
+
+size_t history_tier_read(const history_tier_t *tier, history_cursor_t *cursor, history_point_t *points, size_t max)
+{
+  size_t n = 0;
+
+  while (n < max && !tier->empty)
+  {
+    history_point_t point;
+    bool gap = false;
+
+    // Not started or fallen behind the base: the base is the next point
+    if (!cursor->started || (int32_t)(cursor->next - tier->first) <= 0)
+    {
+      point = tier->base;
+      cursor->next = tier->first + 1;
+      cursor->started = true;
+    }
+    else
+    {
+      const uint32_t offset = cursor->next - tier->first;
+      if (offset > tier->count)
+      {
+        break;
+      }
+
+      const history_point_t prev = {.time_ms = cursor->time_ms, .avg = cursor->avg};
+      gap = decode(tier, (tier->head + offset - 1) % tier->capacity, &prev, &point);
+      cursor->next++;
+    }
+
+    cursor->time_ms = point.time_ms;
+    cursor->avg = point.avg;
+
+    if (!gap && point.time_ms >= cursor->from_ms)
+    {
+      points[n++] = point;
+    }
+  }
+
+  return n;
+}
+
+void history_acc_add(history_acc_t *acc, history_tier_t *tier, int64_t time_ms, int16_t value)
+{
+  history_acc_flush(acc, tier, time_ms);
+
+  if (acc->count == 0)
+  {
+    acc->start_ms = time_ms - time_ms % tier->period_ms;
+    acc->sum = 0;
+    acc->min = value;
+    acc->max = value;
+  }
+
+  acc->sum += value;
+  acc->count++;
+
+  if (value < acc->min)
+  {
+    acc->min = value;
+  }
+
+  if (value > acc->max)
+  {
+    acc->max = value;
+  }
+}
+
+void history_acc_flush(history_acc_t *acc, history_tier_t *tier, int64_t now_ms)
+{
+  if (acc->count == 0 || now_ms < acc->start_ms + tier->period_ms)
+  {
+    return;
+  }
+
+  // Rounded to nearest, division truncates toward zero
+  const int64_t half = acc->count / 2;
+  const history_point_t bucket = {
+      .time_ms = acc->start_ms,
+      .min = acc->min,
+      .avg = (int16_t)((acc->sum >= 0 ? acc->sum + half : acc->sum - half) / (int64_t)acc->count),
+      .max = acc->max,
+  };
+
+  history_tier_append(tier, &bucket);
+  acc->count = 0;
+}
+
+//**************************************************
+// Static Functions
+//**************************************************
+
+/**
+ * @brief Drops every point. Their sequence numbers are not reused, cursors
+ *        on them restart at the next base.
+ */
+static void reset(history_tier_t *tier)
+{
+  if (!tier->empty)
+  {
+    tier->first += tier->count + 1;
+  }
+
+  tier->head = 0;
+  tier->count = 0;
+  tier->empty = true;
+}
+
+/**
+ * @brief Drops the base and folds the next record into it. Gaps are folded
+ *        too, the base is always a bucket with samples.
+ */
+static void evict(history_tier_t *tier)
+{
+  bool gap;
+
+  do
+  {
+    tier->first++;
+
+    if (tier->count == 0)
+    {
+      tier->empty = true;
+      return;
+    }
+
+    gap = decode(tier, tier->head, &tier->base, &tier->base);
+    tier->head = (tier->head + 1) % tier->capacity;
+    tier->count--;
+  } while (gap);
+}
+
+/**
+ * @brief Stores a point as a record relative to the newest one, evicting the
+ *        base first if the ring is full. Tier not empty.
+ */
+static void push(history_tier_t *tier, const history_point_t *point, bool gap)
+{
+  if (tier->count == tier->capacity)
+  {
+    evict(tier);
+
+    if (tier->empty)
+    {
+      // The whole ring was gaps, a bucket with samples becomes the base
+      if (gap)
+      {
+        return;
+      }
+
+      tier->base = *point;
+      tier->last = *point;
+      tier->empty = false;
+      return;
+    }
+  }
+
+  const size_t index = (tier->head + tier->count) % tier->capacity;
+  const int16_t delta = point->avg - tier->last.avg;
+
+  if (tier->period_ms == 0)
+  {
+    tier->raw[index] = (history_raw_record_t){
+        .dt_ms = (uint16_t)(point->time_ms - tier->last.time_ms),
+        .delta = delta,
+    };
+  }
+  else
+  {
+    tier->buckets[index] = (history_bucket_record_t){
+        .delta = gap ? 0 : delta,
+        .below = gap ? HISTORY_GAP : (uint16_t)(point->avg - point->min),
+        .above = gap ? 0 : (uint16_t)(point->max - point->avg),
+    };
+  }
+
+  tier->count++;
+
+  if (!gap)
+  {
+    tier->last = *point;
+  }
+  else
+  {
+    tier->last.time_ms = point->time_ms;
+  }
+}
+
+/**
+ * @brief Rebuilds the point of a record from the point before it.
+ * @return true if the record is a gap, point then only carries the time.
+ */
+static bool decode(const history_tier_t *tier, size_t index, const history_point_t *prev, history_point_t *point)
+{
+  const int64_t prev_time_ms = prev->time_ms;
+  const int16_t prev_avg = prev->avg;
+
+  if (tier->period_ms == 0)
+  {
+    const history_raw_record_t *record = &tier->raw[index];
+    point->time_ms = prev_time_ms + record->dt_ms;
+    point->avg = prev_avg + record->delta;
+    point->min = point->avg;
+    point->max = point->avg;
+    return false;
+  }
+
+  const history_bucket_record_t *record = &tier->buckets[index];
+  point->time_ms = prev_time_ms + tier->period_ms;
+  point->avg = prev_avg + record->delta;
+
+  if (record->below == HISTORY_GAP)
+  {
+    point->min = point->avg;
+    point->max = point->avg;
+    return true;
+  }
+
+  point->min = point->avg - record->below;
+  point->max = point->avg + record->above;
+  return false;
+}
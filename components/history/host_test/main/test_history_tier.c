@@ -0,0 +1,337 @@
+#include "history_internals.h"
+#include "unity.h"
+#include <stdlib.h>
+#include <string.h>
+
+//**************************************************
+// Defines
+//**************************************************
+
+#define RAW_CAPACITY 512
+#define SMALL_CAPACITY 8
+#define READ_CHUNK 16 // Points per read, as the HTTP handler reads
+#define POINTS_MAX 4096
+
+#define SECOND_MS 1000
+#define MINUTE_MS 60000
+#define SAMPLE_MS 100
+#define ROLLUP_MS (6 * MINUTE_MS)
+
+//**************************************************
+// Function Prototypes
+//**************************************************
+
+static size_t read_all(const history_tier_t *tier, history_cursor_t *cursor, history_point_t *points);
+static size_t expected_buckets(const int64_t *times, const int16_t *values, size_t samples, uint32_t period_ms,
+                               history_point_t *buckets);
+static void expect_points(const history_point_t *expected, size_t expected_count, const history_point_t *points,
+                          size_t count);
+static int16_t random_value(void);
+static uint32_t random_next(void);
+
+//**************************************************
+// Globals
+//**************************************************
+
+static history_raw_record_t s_raw[RAW_CAPACITY];
+static history_bucket_record_t s_seconds[RAW_CAPACITY];
+static history_bucket_record_t s_minutes[SMALL_CAPACITY];
+static history_tier_t s_tier;
+static history_tier_t s_minute_tier;
+static history_point_t s_expected[POINTS_MAX];
+static history_point_t s_points[POINTS_MAX];
+static int64_t s_times[POINTS_MAX];
+static int16_t s_values[POINTS_MAX];
+static uint32_t s_seed = 1;
+
+//**************************************************
+// Tests
+//**************************************************
+
+void setUp(void)
+{
+  history_tier_init_raw(&s_tier, s_raw, RAW_CAPACITY);
+}
+
+void tearDown(void)
+{
+}
+
+/**
+ * @brief Raw points come back exactly, with deltas over the whole value
+ *        range and the longest step a record holds.
+ */
+static void test_raw_round_trip(void)
+{
+  history_cursor_t cursor = {.from_ms = INT64_MIN};
+  int64_t time_ms = 5000;
+
+  for (size_t i = 0; i < RAW_CAPACITY + 1; i++)
+  {
+    time_ms += i == 1 ? UINT16_MAX : 1 + random_next() % 2000;
+    const int16_t value = i % 2 ? HISTORY_VALUE_MIN : i % 3 ? HISTORY_VALUE_MAX : random_value();
+
+    s_expected[i] = (history_point_t){.time_ms = time_ms, .min = value, .avg = value, .max = value};
+    history_tier_append(&s_tier, &s_expected[i]);
+  }
+
+  expect_points(s_expected, RAW_CAPACITY + 1, s_points, read_all(&s_tier, &cursor, s_points));
+
+  // Nothing new, nothing read
+  TEST_ASSERT_EQUAL(0, history_tier_read(&s_tier, &cursor, s_points, READ_CHUNK));
+}
+
+/**
+ * @brief A full ring keeps the newest points, and a cursor left behind by
+ *        the evictions resumes at the oldest point still stored.
+ */
+static void test_raw_eviction(void)
+{
+  history_cursor_t cursor = {.from_ms = INT64_MIN};
+  history_tier_init_raw(&s_tier, s_raw, SMALL_CAPACITY);
+
+  for (size_t i = 0; i < 100; i++)
+  {
+    s_expected[i] = (history_point_t){.time_ms = 1000 + 10 * i, .avg = random_value()};
+    s_expected[i].min = s_expected[i].max = s_expected[i].avg;
+    history_tier_append(&s_tier, &s_expected[i]);
+
+    if (i == 5)
+    {
+      TEST_ASSERT_EQUAL(3, history_tier_read(&s_tier, &cursor, s_points, 3));
+      expect_points(s_expected, 3, s_points, 3);
+    }
+  }
+
+  // The base and SMALL_CAPACITY records
+  expect_points(&s_expected[100 - SMALL_CAPACITY - 1], SMALL_CAPACITY + 1, s_points,
+                read_all(&s_tier, &cursor, s_points));
+
+  history_cursor_t fresh = {.from_ms = INT64_MIN};
+  expect_points(&s_expected[100 - SMALL_CAPACITY - 1], SMALL_CAPACITY + 1, s_points,
+                read_all(&s_tier, &fresh, s_points));
+}
+
+/**
+ * @brief Late points are dropped, a silence longer than a record holds
+ *        restarts the tier, expiry and from_ms trim the oldest points.
+ */
+static void test_raw_restart_and_expiry(void)
+{
+  history_cursor_t cursor = {.from_ms = INT64_MIN};
+  const history_point_t points[] = {
+      {.time_ms = 1000, .min = 10, .avg = 10, .max = 10},
+      {.time_ms = 2000, .min = 20, .avg = 20, .max = 20},
+      {.time_ms = 2000 + UINT16_MAX + 1, .min = 30, .avg = 30, .max = 30},
+      {.time_ms = 2000 + UINT16_MAX + 2, .min = 40, .avg = 40, .max = 40},
+      {.time_ms = 2000 + UINT16_MAX + 3, .min = 50, .avg = 50, .max = 50},
+  };
+  const history_point_t late = {.time_ms = 1500, .min = 99, .avg = 99, .max = 99};
+
+  history_tier_append(&s_tier, &points[0]);
+  history_tier_append(&s_tier, &points[1]);
+  history_tier_append(&s_tier, &late);
+  expect_points(points, 2, s_points, read_all(&s_tier, &cursor, s_points));
+
+  for (size_t i = 2; i < 5; i++)
+  {
+    history_tier_append(&s_tier, &points[i]);
+  }
+  expect_points(&points[2], 3, s_points, read_all(&s_tier, &cursor, s_points));
+
+  history_cursor_t from = {.from_ms = points[3].time_ms};
+  expect_points(&points[3], 2, s_points, read_all(&s_tier, &from, s_points));
+
+  history_tier_expire(&s_tier, points[4].time_ms);
+  history_cursor_t fresh = {.from_ms = INT64_MIN};
+  expect_points(&points[4], 1, s_points, read_all(&s_tier, &fresh, s_points));
+
+  history_tier_expire(&s_tier, INT64_MAX);
+  TEST_ASSERT_EQUAL(0, read_all(&s_tier, &fresh, s_points));
+}
+
+/**
+ * @brief Samples rolled up into 1 s and 1 min buckets give the min, the
+ *        average rounded to nearest and the max of each period, and the
+ *        periods without samples are skipped.
+ */
+static void test_rollup(void)
+{
+  history_acc_t second = {0};
+  history_acc_t minute = {0};
+  history_cursor_t cursor = {.from_ms = INT64_MIN};
+  size_t samples = 0;
+
+  history_tier_init_buckets(&s_tier, s_seconds, RAW_CAPACITY, SECOND_MS);
+  history_tier_init_buckets(&s_minute_tier, s_minutes, SMALL_CAPACITY, MINUTE_MS);
+
+  for (int64_t time_ms = 250; time_ms < ROLLUP_MS; time_ms += SAMPLE_MS)
+  {
+    // Silent for 3.5 s, then for the whole third minute
+    if ((time_ms >= 30000 && time_ms < 33500) || (time_ms >= 2 * MINUTE_MS && time_ms < 3 * MINUTE_MS))
+    {
+      continue;
+    }
+
+    s_times[samples] = time_ms + random_next() % SAMPLE_MS;
+    s_values[samples] = random_next() % 2 ? random_value() : -(int16_t)(random_next() % 3);
+    history_acc_add(&second, &s_tier, s_times[samples], s_values[samples]);
+    history_acc_add(&minute, &s_minute_tier, s_times[samples], s_values[samples]);
+    samples++;
+  }
+
+  history_acc_flush(&second, &s_tier, ROLLUP_MS + SECOND_MS);
+  history_acc_flush(&minute, &s_minute_tier, ROLLUP_MS + MINUTE_MS);
+
+  size_t count = expected_buckets(s_times, s_values, samples, SECOND_MS, s_expected);
+  expect_points(s_expected, count, s_points, read_all(&s_tier, &cursor, s_points));
+
+  cursor = (history_cursor_t){.from_ms = INT64_MIN};
+  count = expected_buckets(s_times, s_values, samples, MINUTE_MS, s_expected);
+  TEST_ASSERT_EQUAL(5, count);
+  expect_points(s_expected, count, s_points, read_all(&s_minute_tier, &cursor, s_points));
+}
+
+/**
+ * @brief Evicting a bucket folds the gaps after it into the base, and a
+ *        silence longer than the tier spans restarts it.
+ */
+static void test_bucket_gaps(void)
+{
+  history_cursor_t cursor = {.from_ms = INT64_MIN};
+  const history_point_t buckets[] = {
+      {.time_ms = 0, .min = -5, .avg = 0, .max = 5},
+      {.time_ms = 4 * SECOND_MS, .min = 10, .avg = 12, .max = 20},
+      {.time_ms = 5 * SECOND_MS, .min = -30, .avg = -20, .max = -10},
+      {.time_ms = 6 * SECOND_MS, .min = 7, .avg = 7, .max = 7},
+      {.time_ms = 7 * SECOND_MS, .min = 1, .avg = 2, .max = 3},
+      {.time_ms = 8 * SECOND_MS, .min = 1, .avg = 4, .max = 9},
+  };
+
+  history_tier_init_buckets(&s_tier, s_seconds, 4, SECOND_MS);
+
+  // Base, three gaps, then a bucket: the ring is full
+  history_tier_append(&s_tier, &buckets[0]);
+  history_tier_append(&s_tier, &buckets[1]);
+  TEST_ASSERT_EQUAL(4, s_tier.count);
+  expect_points(buckets, 2, s_points, read_all(&s_tier, &cursor, s_points));
+
+  // The base goes, its gaps with it, the next bucket with samples is the base
+  history_tier_append(&s_tier, &buckets[2]);
+  TEST_ASSERT_EQUAL(buckets[1].time_ms, s_tier.base.time_ms);
+  TEST_ASSERT_EQUAL(1, s_tier.count);
+
+  for (size_t i = 3; i < 6; i++)
+  {
+    history_tier_append(&s_tier, &buckets[i]);
+  }
+  expect_points(&buckets[2], 4, s_points, read_all(&s_tier, &cursor, s_points));
+
+  history_cursor_t fresh = {.from_ms = INT64_MIN};
+  expect_points(&buckets[1], 5, s_points, read_all(&s_tier, &fresh, s_points));
+
+  // Further apart than the tier spans
+  const history_point_t late = {.time_ms = 20 * SECOND_MS, .min = 0, .avg = 1, .max = 2};
+  history_tier_append(&s_tier, &late);
+  TEST_ASSERT_EQUAL(0, s_tier.count);
+  expect_points(&late, 1, s_points, read_all(&s_tier, &cursor, s_points));
+}
+
+void app_main(void)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_raw_round_trip);
+  RUN_TEST(test_raw_eviction);
+  RUN_TEST(test_raw_restart_and_expiry);
+  RUN_TEST(test_rollup);
+  RUN_TEST(test_bucket_gaps);
+  exit(UNITY_END());
+}
+
+//**************************************************
+// Static Functions
+//**************************************************
+
+/**
+ * @brief Reads a tier to its newest point in chunks.
+ * @return Points read.
+ */
+static size_t read_all(const history_tier_t *tier, history_cursor_t *cursor, history_point_t *points)
+{
+  size_t total = 0;
+  size_t n;
+
+  while ((n = history_tier_read(tier, cursor, &points[total], READ_CHUNK)) > 0)
+  {
+    total += n;
+    TEST_ASSERT_TRUE(total <= POINTS_MAX);
+  }
+
+  return total;
+}
+
+/**
+ * @brief Buckets of a period over sorted samples, computed directly.
+ * @return Buckets with samples.
+ */
+static size_t expected_buckets(const int64_t *times, const int16_t *values, size_t samples, uint32_t period_ms,
+                               history_point_t *buckets)
+{
+  size_t count = 0;
+  size_t i = 0;
+
+  while (i < samples)
+  {
+    const int64_t start_ms = times[i] - times[i] % period_ms;
+    int64_t sum = 0;
+    size_t n = 0;
+    int16_t min = values[i];
+    int16_t max = values[i];
+
+    for (; i < samples && times[i] < start_ms + period_ms; i++, n++)
+    {
+      sum += values[i];
+      min = values[i] < min ? values[i] : min;
+      max = values[i] > max ? values[i] : max;
+    }
+
+    // Nearest, halves away from zero
+    const int64_t avg = sum >= 0 ? (2 * sum + (int64_t)n) / (2 * (int64_t)n) : -((-2 * sum + (int64_t)n) / (2 * (int64_t)n));
+    buckets[count++] = (history_point_t){.time_ms = start_ms, .min = min, .avg = (int16_t)avg, .max = max};
+  }
+
+  return count;
+}
+
+static void expect_points(const history_point_t *expected, size_t expected_count, const history_point_t *points,
+                          size_t count)
+{
+  TEST_ASSERT_EQUAL(expected_count, count);
+
+  for (size_t i = 0; i < count; i++)
+  {
+    TEST_ASSERT_EQUAL_INT64(expected[i].time_ms, points[i].time_ms);
+    TEST_ASSERT_EQUAL_INT16(expected[i].min, points[i].min);
+    TEST_ASSERT_EQUAL_INT16(expected[i].avg, points[i].avg);
+    TEST_ASSERT_EQUAL_INT16(expected[i].max, points[i].max);
+  }
+}
+
+/**
+ * @brief Any storable value.
+ */
+static int16_t random_value(void)
+{
+  return (int16_t)(HISTORY_VALUE_MIN + (int32_t)(random_next() % (HISTORY_VALUE_MAX - HISTORY_VALUE_MIN + 1)));
+}
+
+/**
+ * @brief xorshift32, the sequence is the same on every run.
+ */
+static uint32_t random_next(void)
+{
+  s_seed ^= s_seed << 13;
+  s_seed ^= s_seed >> 17;
+  s_seed ^= s_seed << 5;
+  return s_seed;
+}
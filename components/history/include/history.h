@@ -0,0 +1,113 @@
+#pragma once
+
+#include "esp_err.h"
+#include "stdbool.h"
+#include <stdint.h>
+#include <stddef.h>
+
+//**************************************************
+// Defines
+//**************************************************
+
+/**
+ * @brief Range of a stored value. Every delta between two values fits an
+ *        int16_t, enough for 12-bit ADC counts and for the sensor in
+ *        hundredths of a degree or percent.
+ */
+#define HISTORY_VALUE_MIN (-16384)
+#define HISTORY_VALUE_MAX 16383
+
+//**************************************************
+// Typedefs
+//**************************************************
+
+/**
+ * @brief Recorded channels: the analog inputs, then the sensor.
+ */
+typedef enum
+{
+  HISTORY_CH_ANALOG_1 = 0,
+  HISTORY_CH_ANALOG_2,
+  HISTORY_CH_TEMPERATURE, /**< Hundredths of a degree Celsius */
+  HISTORY_CH_HUMIDITY,    /**< Hundredths of a percent */
+  _HISTORY_CH_MAX,
+} history_ch_t;
+
+/**
+ * @brief Resolution tiers, finest first.
+ */
+typedef enum
+{
+  HISTORY_RES_RAW = 0, /**< Every reported value, for CONFIG_HISTORY_RAW_SPAN_S */
+  HISTORY_RES_SECOND,  /**< 1 s min/avg/max, CONFIG_HISTORY_SECOND_RECORDS buckets */
+  HISTORY_RES_MINUTE,  /**< 1 min min/avg/max, CONFIG_HISTORY_MINUTE_RECORDS buckets */
+  _HISTORY_RES_MAX,
+} history_res_t;
+
+/**
+ * @brief One point of a tier. Raw points have min == avg == max.
+ */
+typedef struct
+{
+  int64_t time_ms; /**< Sample time, or bucket start, in ms since boot */
+  int16_t min;
+  int16_t avg;
+  int16_t max;
+} history_point_t;
+
+/**
+ * @brief Read position in a tier. Stays valid while the tier keeps changing:
+ *        points evicted meanwhile are skipped, new ones are read in turn.
+ */
+typedef struct
+{
+  int64_t from_ms; /**< Points before this time are skipped */
+  int64_t time_ms; /**< Time of the point before next */
+  uint32_t next;   /**< Sequence number of the next point */
+  int16_t avg;     /**< Value of the point before next, the base of the next delta */
+  bool started;    /**< next is set, otherwise reading starts at the oldest point */
+} history_cursor_t;
+
+//**************************************************
+// Function Prototypes
+//**************************************************
+
+/**
+ * @brief Initializes the history and subscribes to the analog input and the
+ *        sensor. Must be called after both components are initialized.
+ * @return - ESP_OK: Recording.
+ *
+ *         - ESP_FAIL: Failed to create OS resources or to subscribe.
+ */
+esp_err_t history_initialize(void);
+
+/**
+ * @brief Sets a cursor to the oldest point of a tier at or after a time.
+ * @param cursor  Cursor to set.
+ * @param from_ms Start time in ms since boot, INT64_MIN for the oldest point.
+ */
+void history_cursor_init(history_cursor_t *cursor, int64_t from_ms);
+
+/**
+ * @brief Copies the points at the cursor and moves it past them. The lock is
+ *        only held for the call, a range is read in as many calls as needed.
+ * @param ch     Channel to read.
+ * @param res    Tier to read.
+ * @param cursor Read position, see history_cursor_init().
+ * @param points Output points, oldest first.
+ * @param max    Capacity of points.
+ * @param count  Points copied, 0 once the cursor reached the newest point.
+ * @return - ESP_OK: Success.
+ *
+ *         - ESP_ERR_INVALID_ARG: Invalid channel or tier, or NULL pointer.
+ *
+ *         - ESP_ERR_INVALID_STATE: Component not initialized.
+ */
+esp_err_t history_read(history_ch_t ch, history_res_t res, history_cursor_t *cursor,
+                       history_point_t *points, size_t max, size_t *count);
+
+/**
+ * @brief Bucket length of a tier.
+ * @return Milliseconds, 0 for the raw tier.
+ */
+uint32_t history_period_ms(history_res_t res);
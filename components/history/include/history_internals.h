@@ -0,0 +1,118 @@
+#pragma once
+
+#include "history.h"
+
+//**************************************************
+// Defines
+//**************************************************
+
+/**
+ * @brief `below` of a bucket record without samples. Never a real offset,
+ *        those are at most HISTORY_VALUE_MAX - HISTORY_VALUE_MIN.
+ */
+#define HISTORY_GAP UINT16_MAX
+
+//**************************************************
+// Typedefs
+//**************************************************
+
+/**
+ * @brief Raw tier record: a sample relative to the one before it.
+ */
+typedef struct
+{
+  uint16_t dt_ms; /**< Time since the previous sample */
+  int16_t delta;  /**< Change from the previous sample */
+} history_raw_record_t;
+
+/**
+ * @brief Bucket tier record: a bucket relative to the one before it, which
+ *        started one period earlier.
+ */
+typedef struct
+{
+  int16_t delta;  /**< Change of the average from the previous bucket */
+  uint16_t below; /**< avg - min, HISTORY_GAP for a bucket without samples */
+  uint16_t above; /**< max - avg */
+} history_bucket_record_t;
+
+/**
+ * @brief Delta-encoded ring of points. The oldest point is kept whole as the
+ *        base, every later one is a record relative to its predecessor. The
+ *        ring overwrites the oldest point when full, folding the next record
+ *        into the base, so the storage is the array given at init and nothing
+ *        else. Points are numbered in arrival order, cursors hold on to those
+ *        numbers across evictions.
+ */
+typedef struct
+{
+  history_raw_record_t *raw;         /**< Raw tier storage, NULL for a bucket tier */
+  history_bucket_record_t *buckets;  /**< Bucket tier storage, NULL for the raw tier */
+  size_t capacity;                   /**< Records in the storage */
+  size_t head;                       /**< Index of the record following the base */
+  size_t count;                      /**< Records after the base */
+  uint32_t period_ms;                /**< Bucket length, 0 for the raw tier */
+  uint32_t first;                    /**< Sequence number of the base, or of the next point while empty */
+  bool empty;                        /**< No base point */
+  history_point_t base;              /**< Oldest point */
+  history_point_t last;              /**< Newest point, the base of the next record */
+} history_tier_t;
+
+/**
+ * @brief Bucket being filled for a bucket tier.
+ */
+typedef struct
+{
+  int64_t start_ms; /**< Start of the bucket, a multiple of the tier period */
+  int64_t sum;
+  uint32_t count;   /**< Samples in the bucket, 0 while no bucket is open */
+  int16_t min;
+  int16_t max;
+} history_acc_t;
+
+//**************************************************
+// Tier Functions
+//**************************************************
+
+/**
+ * @brief Empties a raw tier over its storage. Pure, no OS dependency, so the
+ *        tiers also build on the host.
+ */
+void history_tier_init_raw(history_tier_t *tier, history_raw_record_t *records, size_t capacity);
+
+/**
+ * @brief Empties a bucket tier over its storage.
+ */
+void history_tier_init_buckets(history_tier_t *tier, history_bucket_record_t *records, size_t capacity, uint32_t period_ms);
+
+/**
+ * @brief Appends a point, evicting the oldest one when the tier is full. Raw
+ *        points over 65 s after the previous one, or buckets further apart than
+ *        the tier spans, restart the tier. Points older than the newest one are
+ *        dropped. Buckets skipped since the newest one are stored as gaps.
+ * @param point Raw sample (avg only), or bucket starting at time_ms.
+ */
+void history_tier_append(history_tier_t *tier, const history_point_t *point);
+
+/**
+ * @brief Evicts the points older than a time.
+ */
+void history_tier_expire(history_tier_t *tier, int64_t before_ms);
+
+/**
+ * @brief Decodes the points at a cursor, skipping gaps and points before its
+ *        from_ms, and moves the cursor past them.
+ * @return Points copied, 0 once the cursor reached the newest point.
+ */
+size_t history_tier_read(const history_tier_t *tier, history_cursor_t *cursor, history_point_t *points, size_t max);
+
+/**
+ * @brief Adds a sample to the open bucket. A sample past the end of the
+ *        bucket first closes it into the tier.
+ */
+void history_acc_add(history_acc_t *acc, history_tier_t *tier, int64_t time_ms, int16_t value);
+
+/**
+ * @brief Closes the open bucket into the tier if it ended before now_ms.
+ */
+void history_acc_flush(history_acc_t *acc, history_tier_t *tier, int64_t now_ms);
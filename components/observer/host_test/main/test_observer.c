@@ -0,0 +1,344 @@
+#include "observer.h"
+#include "unity.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+//**************************************************
+// Defines
+//**************************************************
+
+#define HANDLERS_MAX 16
+#define DISPATCHES 200000  // Per benchmark run
+#define READERS 2          // Tasks dispatching to slow handlers
+#define CHANGES 20         // Add and remove pairs timed under load
+#define CHANGES_TIMEOUT_MS 5000
+
+/**
+ * @brief Distinct handlers, each adding its weight to the call total.
+ */
+#define HANDLER(n)                        \
+  static void handler_##n(uint32_t value) \
+  {                                       \
+    s_calls += value * (n + 1);           \
+  }
+
+//**************************************************
+// Typedefs
+//**************************************************
+
+typedef void (*value_handler_t)(uint32_t value);
+
+/**
+ * @brief Node of the mutex-guarded handler list the drivers used before the
+ *        registry, kept as the benchmark baseline.
+ */
+typedef struct list_node_t
+{
+  value_handler_t handler;
+  struct list_node_t *next;
+} list_node_t;
+
+//**************************************************
+// Function Prototypes
+//**************************************************
+
+static void list_add(value_handler_t handler);
+static void list_remove(value_handler_t handler);
+static void list_notify(uint32_t value);
+static void slow_handler(uint32_t value);
+static void registry_reader_task(void *args);
+static void list_reader_task(void *args);
+static int64_t clock_ns(void);
+
+//**************************************************
+// Globals
+//**************************************************
+
+static volatile uint64_t s_calls = 0;
+
+HANDLER(0)
+HANDLER(1)
+HANDLER(2)
+HANDLER(3)
+HANDLER(4)
+HANDLER(5)
+HANDLER(6)
+HANDLER(7)
+HANDLER(8)
+HANDLER(9)
+HANDLER(10)
+HANDLER(11)
+HANDLER(12)
+HANDLER(13)
+HANDLER(14)
+HANDLER(15)
+
+static const value_handler_t s_handlers[HANDLERS_MAX] = {
+    handler_0, handler_1, handler_2, handler_3, handler_4, handler_5, handler_6, handler_7,
+    handler_8, handler_9, handler_10, handler_11, handler_12, handler_13, handler_14, handler_15,
+};
+
+static observer_registry_t s_registry;
+
+static list_node_t *s_list = NULL;
+static SemaphoreHandle_t s_list_mutex = NULL;
+
+static volatile bool s_stop = false;
+static atomic_int s_readers_running = 0;
+
+//**************************************************
+// Tests
+//**************************************************
+
+void setUp(void)
+{
+  s_calls = 0;
+  TEST_ASSERT_EQUAL(ESP_OK, observer_registry_init(&s_registry));
+
+  if (s_list_mutex == NULL)
+  {
+    s_list_mutex = xSemaphoreCreateMutex();
+    TEST_ASSERT_NOT_NULL(s_list_mutex);
+  }
+}
+
+void tearDown(void)
+{
+  for (size_t i = 0; i < HANDLERS_MAX; i++)
+  {
+    observer_registry_remove(&s_registry, (observer_handler_t)s_handlers[i]);
+    list_remove(s_handlers[i]);
+  }
+  observer_registry_remove(&s_registry, (observer_handler_t)slow_handler);
+}
+
+/**
+ * @brief Handlers run once each, in registration order, and a removed one
+ *        is not called again.
+ */
+static void test_add_remove(void)
+{
+  TEST_ASSERT_EQUAL(ESP_OK, observer_registry_add(&s_registry, (observer_handler_t)handler_0));
+  TEST_ASSERT_EQUAL(ESP_OK, observer_registry_add(&s_registry, (observer_handler_t)handler_1));
+  TEST_ASSERT_EQUAL(ESP_OK, observer_registry_add(&s_registry, (observer_handler_t)handler_2));
+  TEST_ASSERT_EQUAL(ESP_OK, observer_registry_add(&s_registry, (observer_handler_t)handler_1)); // Already present
+
+  uint32_t epoch;
+  const observer_array_t *observers = observer_registry_acquire(&s_registry, &epoch);
+  TEST_ASSERT_EQUAL(3, observers->count);
+  TEST_ASSERT_EQUAL_PTR(handler_0, observers->handlers[0]);
+  TEST_ASSERT_EQUAL_PTR(handler_1, observers->handlers[1]);
+  TEST_ASSERT_EQUAL_PTR(handler_2, observers->handlers[2]);
+  observer_registry_release(&s_registry, epoch);
+
+  OBSERVER_NOTIFY(&s_registry, value_handler_t, 1);
+  TEST_ASSERT_EQUAL(1 + 2 + 3, s_calls);
+
+  TEST_ASSERT_EQUAL(ESP_OK, observer_registry_remove(&s_registry, (observer_handler_t)handler_1));
+  TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, observer_registry_remove(&s_registry, (observer_handler_t)handler_1));
+
+  OBSERVER_NOTIFY(&s_registry, value_handler_t, 1);
+  TEST_ASSERT_EQUAL(6 + 1 + 3, s_calls);
+}
+
+/**
+ * @brief Dispatch cost with 1, 4 and 16 handlers, registry against the
+ *        mutex-guarded list, from a single task.
+ */
+static void test_benchmark_dispatch(void)
+{
+  static const size_t counts[] = {1, 4, HANDLERS_MAX};
+
+  printf("%9s %14s %14s\n", "handlers", "registry ns", "mutex list ns");
+
+  for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+  {
+    for (size_t i = 0; i < counts[c]; i++)
+    {
+      TEST_ASSERT_EQUAL(ESP_OK, observer_registry_add(&s_registry, (observer_handler_t)s_handlers[i]));
+      list_add(s_handlers[i]);
+    }
+
+    int64_t start = clock_ns();
+    for (uint32_t n = 0; n < DISPATCHES; n++)
+    {
+      OBSERVER_NOTIFY(&s_registry, value_handler_t, 1);
+    }
+    const int64_t registry_ns = clock_ns() - start;
+
+    start = clock_ns();
+    for (uint32_t n = 0; n < DISPATCHES; n++)
+    {
+      list_notify(1);
+    }
+    const int64_t list_ns = clock_ns() - start;
+
+    printf("%9zu %14.1f %14.1f\n", counts[c], (double)registry_ns / DISPATCHES, (double)list_ns / DISPATCHES);
+
+    for (size_t i = 0; i < counts[c]; i++)
+    {
+      TEST_ASSERT_EQUAL(ESP_OK, observer_registry_remove(&s_registry, (observer_handler_t)s_handlers[i]));
+      list_remove(s_handlers[i]);
+    }
+  }
+}
+
+/**
+ * @brief Add and remove while tasks dispatch back to back to a handler that
+ *        blocks, so some dispatch is always in progress. Changes wait for the
+ *        dispatches already running, never for the later ones: they finish
+ *        in bounded time. The list holds its mutex through the handlers, so
+ *        there a change waits for the mutex instead.
+ */
+static void test_changes_under_load(void)
+{
+  TEST_ASSERT_EQUAL(ESP_OK, observer_registry_add(&s_registry, (observer_handler_t)slow_handler));
+  list_add(slow_handler);
+
+  TaskFunction_t readers[] = {registry_reader_task, list_reader_task};
+  double change_ms[2];
+  int changes[2];
+
+  for (size_t r = 0; r < 2; r++)
+  {
+    s_stop = false;
+    for (int i = 0; i < READERS; i++)
+    {
+      s_readers_running++;
+      TEST_ASSERT_EQUAL(pdPASS, xTaskCreate(readers[r], "reader", 4096, NULL, 5, NULL));
+    }
+    vTaskDelay(pdMS_TO_TICKS(20));
+
+    const TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(CHANGES_TIMEOUT_MS);
+    const int64_t start = clock_ns();
+    changes[r] = 0;
+    for (; changes[r] < CHANGES && xTaskGetTickCount() < deadline; changes[r]++)
+    {
+      if (r == 0)
+      {
+        TEST_ASSERT_EQUAL(ESP_OK, observer_registry_add(&s_registry, (observer_handler_t)handler_0));
+        TEST_ASSERT_EQUAL(ESP_OK, observer_registry_remove(&s_registry, (observer_handler_t)handler_0));
+      }
+      else
+      {
+        list_add(handler_0);
+        list_remove(handler_0);
+      }
+    }
+    change_ms[r] = changes[r] > 0 ? (double)(clock_ns() - start) / 1e6 / (2 * changes[r]) : 0;
+
+    s_stop = true;
+    while (s_readers_running > 0)
+    {
+      vTaskDelay(1);
+    }
+  }
+
+  printf("change under load: registry %d in %.2f ms each, mutex list %d in %.2f ms each\n",
+         changes[0], change_ms[0], changes[1], change_ms[1]);
+
+  // The list may lose the mutex race for a while, the registry must not wait for later dispatches
+  TEST_ASSERT_EQUAL(CHANGES, changes[0]);
+}
+
+void app_main(void)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_add_remove);
+  RUN_TEST(test_benchmark_dispatch);
+  RUN_TEST(test_changes_under_load);
+  exit(UNITY_END());
+}
+
+//**************************************************
+// Static Functions
+//**************************************************
+
+static void list_add(value_handler_t handler)
+{
+  list_node_t *node = malloc(sizeof(list_node_t));
+  TEST_ASSERT_NOT_NULL(node);
+
+  node->handler = handler;
+  node->next = NULL;
+
+  xSemaphoreTake(s_list_mutex, portMAX_DELAY);
+  list_node_t **tail = &s_list;
+  while (*tail != NULL)
+  {
+    tail = &(*tail)->next;
+  }
+  *tail = node;
+  xSemaphoreGive(s_list_mutex);
+}
+
+static void list_remove(value_handler_t handler)
+{
+  xSemaphoreTake(s_list_mutex, portMAX_DELAY);
+  for (list_node_t **node = &s_list; *node != NULL; node = &(*node)->next)
+  {
+    if ((*node)->handler == handler)
+    {
+      list_node_t *removed = *node;
+      *node = removed->next;
+      free(removed);
+      break;
+    }
+  }
+  xSemaphoreGive(s_list_mutex);
+}
+
+/**
+ * @brief Dispatch as the drivers did it: the mutex is held through the handlers.
+ */
+static void list_notify(uint32_t value)
+{
+  xSemaphoreTake(s_list_mutex, portMAX_DELAY);
+  for (list_node_t *node = s_list; node != NULL; node = node->next)
+  {
+    node->handler(value);
+  }
+  xSemaphoreGive(s_list_mutex);
+}
+
+/**
+ * @brief Handler that blocks, as one posting to a full queue does.
+ */
+static void slow_handler(uint32_t value)
+{
+  vTaskDelay(pdMS_TO_TICKS(2));
+}
+
+static void registry_reader_task(void *args)
+{
+  while (!s_stop)
+  {
+    OBSERVER_NOTIFY(&s_registry, value_handler_t, 1);
+  }
+
+  s_readers_running--;
+  vTaskDelete(NULL);
+}
+
+static void list_reader_task(void *args)
+{
+  while (!s_stop)
+  {
+    list_notify(1);
+  }
+
+  s_readers_running--;
+  vTaskDelete(NULL);
+}
+
+static int64_t clock_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
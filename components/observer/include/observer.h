@@ -0,0 +1,120 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdatomic.h>
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+//**************************************************
+// Defines
+//**************************************************
+
+/**
+ * @brief Calls every handler of a registry with the given arguments.
+ *        Lock-free, safe from any task. Handlers are called in registration order.
+ * @param registry Pointer to an observer_registry_t.
+ * @param type     Handler function pointer type of the registry.
+ */
+#define OBSERVER_NOTIFY(registry, type, ...)                                           \
+  do                                                                                   \
+  {                                                                                    \
+    uint32_t _epoch;                                                                   \
+    const observer_array_t *_observers = observer_registry_acquire(registry, &_epoch); \
+    for (size_t _i = 0; _i < _observers->count; _i++)                                  \
+    {                                                                                  \
+      ((type)_observers->handlers[_i])(__VA_ARGS__);                                   \
+    }                                                                                  \
+    observer_registry_release(registry, _epoch);                                       \
+  } while (0)
+
+//**************************************************
+// Typedefs
+//**************************************************
+
+/**
+ * @brief Type-erased handler. Each registry stores a single handler type and
+ *        casts back to it on dispatch.
+ */
+typedef void (*observer_handler_t)(void);
+
+/**
+ * @brief Immutable snapshot of the registered handlers.
+ */
+typedef struct
+{
+  size_t count;                   /**< Number of handlers */
+  observer_handler_t handlers[]; /**< Handlers, in registration order */
+} observer_array_t;
+
+/**
+ * @brief Copy-on-write handler registry. Dispatch reads the current array
+ *        without locking; registration builds a new array and swaps it in.
+ *
+ *        Dispatches are counted per epoch. A writer swaps the array, moves
+ *        to the other epoch and waits for the dispatches of the old one
+ *        only: those started later use the new array, so a steady stream
+ *        of dispatches cannot hold a writer back.
+ */
+typedef struct
+{
+  _Atomic(const observer_array_t *) array; /**< Current snapshot, never NULL once initialized */
+  _Atomic uint32_t epoch;                  /**< Side new dispatches are counted on, 0 or 1 */
+  _Atomic uint32_t readers[2];             /**< Dispatches in progress, per epoch */
+  SemaphoreHandle_t mutex;                 /**< Serializes writers */
+} observer_registry_t;
+
+//**************************************************
+// Public Functions
+//**************************************************
+
+/**
+ * @brief Initializes an empty registry.
+ * @return - ESP_OK: Registry ready.
+ *
+ *         - ESP_ERR_INVALID_ARG: NULL registry.
+ *
+ *         - ESP_FAIL: Failed to create the writer mutex.
+ */
+esp_err_t observer_registry_init(observer_registry_t *registry);
+
+/**
+ * @brief Appends a handler. Adding a handler already present is a no-op.
+ * @note Blocks until the dispatches started before the change are done, so it
+ *       must not be called from a handler of the same registry.
+ * @return - ESP_OK: Handler registered.
+ *
+ *         - ESP_ERR_INVALID_ARG: NULL registry or handler.
+ *
+ *         - ESP_ERR_INVALID_STATE: Registry not initialized.
+ *
+ *         - ESP_ERR_NO_MEM: Failed to allocate the new array.
+ */
+esp_err_t observer_registry_add(observer_registry_t *registry, observer_handler_t handler);
+
+/**
+ * @brief Removes a handler. Once this returns, the handler is not running and
+ *        will not be called again.
+ * @note Same restriction as observer_registry_add().
+ * @return - ESP_OK: Handler removed.
+ *
+ *         - ESP_ERR_INVALID_ARG: NULL registry or handler.
+ *
+ *         - ESP_ERR_INVALID_STATE: Registry not initialized.
+ *
+ *         - ESP_ERR_NOT_FOUND: Handler was not registered.
+ *
+ *         - ESP_ERR_NO_MEM: Failed to allocate the new array.
+ */
+esp_err_t observer_registry_remove(observer_registry_t *registry, observer_handler_t handler);
+
+/**
+ * @brief Pins the current array for a dispatch. Must be paired with observer_registry_release().
+ * @param epoch Set to the epoch the dispatch is counted on, to pass to the release.
+ */
+const observer_array_t *observer_registry_acquire(observer_registry_t *registry, uint32_t *epoch);
+
+/**
+ * @brief Ends a dispatch started by observer_registry_acquire().
+ */
+void observer_registry_release(observer_registry_t *registry, uint32_t epoch);
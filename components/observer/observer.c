@@ -0,0 +1,212 @@
+#include "observer.h"
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "freertos/task.h"
+
+//**************************************************
+// Function Prototypes
+//**************************************************
+
+static void swap_array(observer_registry_t *registry, observer_array_t *array);
+static int find_handler(const observer_array_t *array, observer_handler_t handler);
+
+//**************************************************
+// Globals
+//**************************************************
+
+static const char TAG[] = "observer";
+
+static const observer_array_t s_empty_array = {.count = 0}; /**< Shared by every empty registry */
+
+//**************************************************
+// Public Functions
+//**************************************************
+
+esp_err_t observer_registry_init(observer_registry_t *registry)
+{
+  if (registry == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  if ((registry->mutex = xSemaphoreCreateMutex()) == NULL)
+  {
+    ESP_LOGE(TAG, "%s:Fail to create mutex", __func__);
+    return ESP_FAIL;
+  }
+
+  atomic_init(&registry->array, &s_empty_array);
+  atomic_init(&registry->epoch, 0);
+  atomic_init(&registry->readers[0], 0);
+  atomic_init(&registry->readers[1], 0);
+  return ESP_OK;
+}
+
+esp_err_t observer_registry_add(observer_registry_t *registry, observer_handler_t handler)
+{
+  if (registry == NULL || handler == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  if (registry->mutex == NULL)
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  if (xSemaphoreTake(registry->mutex, portMAX_DELAY) != pdTRUE)
+  {
+    return ESP_FAIL;
+  }
+
+  // Only writers replace the array, so it is stable while the mutex is held
+  const observer_array_t *current = atomic_load(&registry->array);
+  esp_err_t err = ESP_OK;
+
+  if (find_handler(current, handler) >= 0)
+  {
+    ESP_LOGE(TAG, "%s:Handler is already present", __func__);
+  }
+  else
+  {
+    observer_array_t *array = malloc(sizeof(observer_array_t) + (current->count + 1) * sizeof(observer_handler_t));
+    if (array == NULL)
+    {
+      ESP_LOGE(TAG, "%s:Fail to alloc handler array", __func__);
+      err = ESP_ERR_NO_MEM;
+    }
+    else
+    {
+      memcpy(array->handlers, current->handlers, current->count * sizeof(observer_handler_t));
+      array->handlers[current->count] = handler;
+      array->count = current->count + 1;
+      swap_array(registry, array);
+    }
+  }
+
+  xSemaphoreGive(registry->mutex);
+  return err;
+}
+
+esp_err_t observer_registry_remove(observer_registry_t *registry, observer_handler_t handler)
+{
+  if (registry == NULL || handler == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  if (registry->mutex == NULL)
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  if (xSemaphoreTake(registry->mutex, portMAX_DELAY) != pdTRUE)
+  {
+    return ESP_FAIL;
+  }
+
+  const observer_array_t *current = atomic_load(&registry->array);
+  const int index = find_handler(current, handler);
+  esp_err_t err = ESP_OK;
+
+  if (index < 0)
+  {
+    err = ESP_ERR_NOT_FOUND;
+  }
+  else if (current->count == 1)
+  {
+    swap_array(registry, NULL);
+  }
+  else
+  {
+    observer_array_t *array = malloc(sizeof(observer_array_t) + (current->count - 1) * sizeof(observer_handler_t));
+    if (array == NULL)
+    {
+      ESP_LOGE(TAG, "%s:Fail to alloc handler array", __func__);
+      err = ESP_ERR_NO_MEM;
+    }
+    else
+    {
+      memcpy(array->handlers, current->handlers, index * sizeof(observer_handler_t));
+      memcpy(&array->handlers[index], &current->handlers[index + 1], (current->count - index - 1) * sizeof(observer_handler_t));
+      array->count = current->count - 1;
+      swap_array(registry, array);
+    }
+  }
+
+  xSemaphoreGive(registry->mutex);
+  return err;
+}
+
+const observer_array_t *observer_registry_acquire(observer_registry_t *registry, uint32_t *epoch)
+{
+  // Announce the reader before loading the array. If the epoch is unchanged
+  // after the announce, a writer moving off it will wait for this reader;
+  // otherwise the reader counts itself on the new epoch instead
+  while (1)
+  {
+    const uint32_t current = atomic_load(&registry->epoch);
+    atomic_fetch_add(&registry->readers[current], 1);
+
+    if (atomic_load(&registry->epoch) == current)
+    {
+      *epoch = current;
+      return atomic_load(&registry->array);
+    }
+
+    atomic_fetch_sub(&registry->readers[current], 1);
+  }
+}
+
+void observer_registry_release(observer_registry_t *registry, uint32_t epoch)
+{
+  atomic_fetch_sub_explicit(&registry->readers[epoch], 1, memory_order_release);
+}
+
+//**************************************************
+// Static Functions
+//**************************************************
+
+/**
+ * @brief Publishes a new array and frees the previous one once no dispatch
+ *        can still be using it. Writer mutex must be held.
+ * @param array New array, NULL for an empty registry.
+ */
+static void swap_array(observer_registry_t *registry, observer_array_t *array)
+{
+  const observer_array_t *previous = atomic_exchange(&registry->array, array != NULL ? array : &s_empty_array);
+
+  // Only the dispatches of the old epoch can hold the previous array, the
+  // previous writer already waited out those of the epoch before it
+  const uint32_t old = atomic_load(&registry->epoch);
+  atomic_store(&registry->epoch, old ^ 1);
+
+  // Handlers may block, so poll rather than spin until the old epoch drains
+  while (atomic_load_explicit(&registry->readers[old], memory_order_acquire) != 0)
+  {
+    vTaskDelay(1);
+  }
+
+  if (previous != &s_empty_array)
+  {
+    free((void *)previous);
+  }
+}
+
+/**
+ * @brief Index of a handler in an array.
+ * @return The index, or -1 if absent.
+ */
+static int find_handler(const observer_array_t *array, observer_handler_t handler)
+{
+  for (size_t i = 0; i < array->count; i++)
+  {
+    if (array->handlers[i] == handler)
+    {
+      return i;
+    }
+  }
+
+  return -1;
+}
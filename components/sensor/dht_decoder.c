@@ -0,0 +1,111 @@
+#include "sensor_internals.h"
+#include <string.h>
+
+//**************************************************
+// Defines
+//**************************************************
+
+// Generous bounds, the sensor clock drifts with temperature and supply
+#define RESPONSE_MIN_US 40
+#define RESPONSE_MAX_US 120
+#define BIT_LOW_MIN_US 20
+#define BIT_LOW_MAX_US 90
+#define BIT_HIGH_MAX_US 100
+#define BIT_ONE_MIN_US 48 // Threshold between a 0 (~27 us) and a 1 (~70 us)
+
+#define IN_RANGE(val, min, max) ((val) >= (min) && (val) <= (max))
+
+//**************************************************
+// Decoder Functions
+//**************************************************
+
+esp_err_t dht_decode(const dht_pulse_t *pulses, size_t count, uint8_t data[DHT_DATA_BYTES])
+{
+  if (pulses == NULL || data == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  // Skip the end of the start pulse and the wait for the sensor
+  size_t i = 0;
+  while (i + 1 < count &&
+         !(!pulses[i].level && IN_RANGE(pulses[i].duration_us, RESPONSE_MIN_US, RESPONSE_MAX_US) &&
+           pulses[i + 1].level && IN_RANGE(pulses[i + 1].duration_us, RESPONSE_MIN_US, RESPONSE_MAX_US)))
+  {
+    i++;
+  }
+
+  if (i + 1 >= count)
+  {
+    return ESP_ERR_NOT_FOUND;
+  }
+
+  i += 2;
+  if (count - i < DHT_DATA_BITS * 2)
+  {
+    return ESP_ERR_INVALID_SIZE;
+  }
+
+  memset(data, 0, DHT_DATA_BYTES);
+
+  for (int bit = 0; bit < DHT_DATA_BITS; bit++, i += 2)
+  {
+    const dht_pulse_t *low = &pulses[i];
+    const dht_pulse_t *high = &pulses[i + 1];
+
+    if (low->level || !high->level ||
+        !IN_RANGE(low->duration_us, BIT_LOW_MIN_US, BIT_LOW_MAX_US) ||
+        high->duration_us > BIT_HIGH_MAX_US)
+    {
+      return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    // Most significant bit first
+    data[bit / 8] <<= 1;
+    if (high->duration_us >= BIT_ONE_MIN_US)
+    {
+      data[bit / 8] |= 1;
+    }
+  }
+
+  if (((data[0] + data[1] + data[2] + data[3]) & 0xFF) != data[4])
+  {
+    return ESP_ERR_INVALID_CRC;
+  }
+
+  return ESP_OK;
+}
+
+esp_err_t dht_decode_values(dht_decoder_type_t type, const uint8_t data[DHT_DATA_BYTES], int16_t *humidity_x10, int16_t *temperature_x10)
+{
+  if (data == NULL || humidity_x10 == NULL || temperature_x10 == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  switch (type)
+  {
+  case DHT_DECODER_DHT11:
+    // Integer and decimal bytes, bit 7 of the decimal is the temperature sign
+    *humidity_x10 = data[0] * 10 + data[1];
+    *temperature_x10 = data[2] * 10 + (data[3] & 0x7F);
+    if (data[3] & 0x80)
+    {
+      *temperature_x10 = -*temperature_x10;
+    }
+    return ESP_OK;
+
+  case DHT_DECODER_DHT22:
+    // 16-bit tenths, temperature in sign and magnitude
+    *humidity_x10 = (data[0] << 8) | data[1];
+    *temperature_x10 = ((data[2] & 0x7F) << 8) | data[3];
+    if (data[2] & 0x80)
+    {
+      *temperature_x10 = -*temperature_x10;
+    }
+    return ESP_OK;
+
+  default:
+    return ESP_ERR_INVALID_ARG;
+  }
+}
@@ -0,0 +1,290 @@
+#include "sensor_internals.h"
+#include "unity.h"
+#include <stdlib.h>
+#include <string.h>
+
+//**************************************************
+// Defines
+//**************************************************
+
+#define TRACE_MAX_PULSES 96
+
+#define RESPONSE_INDEX 1                // First pulse of the sensor response in a built trace
+#define BIT_INDEX(bit) (3 + 2 * (bit))  // Low pulse of a data bit in a built trace
+
+//**************************************************
+// Typedefs
+//**************************************************
+
+typedef struct
+{
+  dht_pulse_t pulses[TRACE_MAX_PULSES];
+  size_t count;
+} trace_t;
+
+//**************************************************
+// Function Prototypes
+//**************************************************
+
+static void build_trace(trace_t *trace, const uint8_t data[DHT_DATA_BYTES]);
+static void expect_values(dht_decoder_type_t type, const trace_t *trace, int16_t humidity_x10, int16_t temperature_x10);
+static uint16_t jitter(uint16_t min_us, uint16_t max_us);
+
+//**************************************************
+// Globals
+//**************************************************
+
+/**
+ * @brief DHT11 transaction as the RMT captures it, from the release of the
+ *        start pulse to the low after the last bit: 45 %RH, 23.4 C.
+ */
+static const dht_pulse_t s_dht11_capture[] = {
+    {1, 31}, {0, 83}, {1, 86}, {0, 56}, {1, 29}, {0, 56}, {1, 26}, {0, 52},
+    {1, 70}, {0, 56}, {1, 28}, {0, 51}, {1, 69}, {0, 56}, {1, 71}, {0, 51},
+    {1, 23}, {0, 49}, {1, 73}, {0, 55}, {1, 26}, {0, 51}, {1, 27}, {0, 49},
+    {1, 29}, {0, 50}, {1, 23}, {0, 49}, {1, 24}, {0, 52}, {1, 27}, {0, 49},
+    {1, 29}, {0, 56}, {1, 25}, {0, 56}, {1, 27}, {0, 52}, {1, 27}, {0, 52},
+    {1, 28}, {0, 53}, {1, 72}, {0, 49}, {1, 28}, {0, 50}, {1, 72}, {0, 53},
+    {1, 72}, {0, 50}, {1, 74}, {0, 53}, {1, 25}, {0, 52}, {1, 27}, {0, 53},
+    {1, 23}, {0, 50}, {1, 27}, {0, 50}, {1, 26}, {0, 50}, {1, 75}, {0, 53},
+    {1, 26}, {0, 50}, {1, 23}, {0, 49}, {1, 24}, {0, 52}, {1, 69}, {0, 56},
+    {1, 26}, {0, 55}, {1, 26}, {0, 50}, {1, 73}, {0, 52}, {1, 29}, {0, 53},
+    {1, 25}, {0, 50}, {1, 25}, {0, 54},
+};
+
+static uint32_t s_seed = 1;
+
+//**************************************************
+// Tests
+//**************************************************
+
+void setUp(void)
+{
+  s_seed = 1;
+}
+
+void tearDown(void)
+{
+}
+
+/**
+ * @brief The captured DHT11 transaction decodes to its bytes and values.
+ */
+static void test_dht11_capture(void)
+{
+  static const uint8_t expected[DHT_DATA_BYTES] = {45, 0, 23, 4, 72};
+  uint8_t data[DHT_DATA_BYTES];
+  int16_t humidity_x10, temperature_x10;
+
+  TEST_ASSERT_EQUAL(ESP_OK, dht_decode(s_dht11_capture, sizeof(s_dht11_capture) / sizeof(s_dht11_capture[0]), data));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, data, DHT_DATA_BYTES);
+
+  TEST_ASSERT_EQUAL(ESP_OK, dht_decode_values(DHT_DECODER_DHT11, data, &humidity_x10, &temperature_x10));
+  TEST_ASSERT_EQUAL(450, humidity_x10);
+  TEST_ASSERT_EQUAL(234, temperature_x10);
+}
+
+/**
+ * @brief DHT11 frames with a decimal part and a negative temperature.
+ */
+static void test_dht11_values(void)
+{
+  trace_t trace;
+
+  build_trace(&trace, (const uint8_t[]){45, 0, 23, 4, 72});
+  expect_values(DHT_DECODER_DHT11, &trace, 450, 234);
+
+  build_trace(&trace, (const uint8_t[]){90, 0, 0, 0, 90});
+  expect_values(DHT_DECODER_DHT11, &trace, 900, 0);
+
+  build_trace(&trace, (const uint8_t[]){31, 0, 5, 0x83, 31 + 5 + 0x83});
+  expect_values(DHT_DECODER_DHT11, &trace, 310, -53);
+}
+
+/**
+ * @brief DHT22 frames, 16-bit tenths with the temperature in sign and
+ *        magnitude, down to the bottom of the sensor range.
+ */
+static void test_dht22_values(void)
+{
+  trace_t trace;
+
+  // 65.2 %RH, 23.5 C
+  build_trace(&trace, (const uint8_t[]){0x02, 0x8C, 0x00, 0xEB, (0x02 + 0x8C + 0x00 + 0xEB) & 0xFF});
+  expect_values(DHT_DECODER_DHT22, &trace, 652, 235);
+
+  // 40.0 %RH, -10.1 C
+  build_trace(&trace, (const uint8_t[]){0x01, 0x90, 0x80, 0x65, (0x01 + 0x90 + 0x80 + 0x65) & 0xFF});
+  expect_values(DHT_DECODER_DHT22, &trace, 400, -101);
+
+  // 100.0 %RH, -40.0 C
+  build_trace(&trace, (const uint8_t[]){0x03, 0xE8, 0x81, 0x90, (0x03 + 0xE8 + 0x81 + 0x90) & 0xFF});
+  expect_values(DHT_DECODER_DHT22, &trace, 1000, -400);
+
+  // -0.1 C keeps its sign
+  build_trace(&trace, (const uint8_t[]){0x01, 0xF4, 0x80, 0x01, (0x01 + 0xF4 + 0x80 + 0x01) & 0xFF});
+  expect_values(DHT_DECODER_DHT22, &trace, 500, -1);
+}
+
+/**
+ * @brief A capture cut short after the response, and one cut inside it.
+ */
+static void test_truncated(void)
+{
+  trace_t trace;
+  uint8_t data[DHT_DATA_BYTES];
+
+  build_trace(&trace, (const uint8_t[]){45, 0, 23, 4, 72});
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, dht_decode(trace.pulses, BIT_INDEX(DHT_DATA_BITS - 1) + 1, data));
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, dht_decode(trace.pulses, BIT_INDEX(0), data));
+  TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, dht_decode(trace.pulses, RESPONSE_INDEX + 1, data));
+  TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, dht_decode(trace.pulses, 0, data));
+
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, dht_decode(NULL, trace.count, data));
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, dht_decode(trace.pulses, trace.count, NULL));
+}
+
+/**
+ * @brief No response pulse: the sensor stays silent or holds the line low.
+ *        A response outside its window is not taken: the decoder syncs on
+ *        a later pair instead and runs out of bits.
+ */
+static void test_no_response(void)
+{
+  trace_t trace;
+  uint8_t data[DHT_DATA_BYTES];
+
+  // Line left high after the start pulse
+  trace.pulses[0] = (dht_pulse_t){.level = true, .duration_us = 30000};
+  TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, dht_decode(trace.pulses, 1, data));
+
+  // Line held low
+  trace.pulses[1] = (dht_pulse_t){.level = false, .duration_us = 30000};
+  TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, dht_decode(trace.pulses, 2, data));
+
+  // Response low too long, the first 1 bit passes for the response
+  build_trace(&trace, (const uint8_t[]){45, 0, 23, 4, 72});
+  trace.pulses[RESPONSE_INDEX].duration_us = 200;
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, dht_decode(trace.pulses, trace.count, data));
+
+  // Response high too short
+  build_trace(&trace, (const uint8_t[]){45, 0, 23, 4, 72});
+  trace.pulses[RESPONSE_INDEX + 1].duration_us = 20;
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, dht_decode(trace.pulses, trace.count, data));
+}
+
+/**
+ * @brief A bit whose low or high lasts outside the window, or whose levels
+ *        are out of step.
+ */
+static void test_bit_timing(void)
+{
+  trace_t trace;
+  uint8_t data[DHT_DATA_BYTES];
+
+  build_trace(&trace, (const uint8_t[]){45, 0, 23, 4, 72});
+  trace.pulses[BIT_INDEX(12)].duration_us = 120;
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_RESPONSE, dht_decode(trace.pulses, trace.count, data));
+
+  build_trace(&trace, (const uint8_t[]){45, 0, 23, 4, 72});
+  trace.pulses[BIT_INDEX(20)].duration_us = 10;
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_RESPONSE, dht_decode(trace.pulses, trace.count, data));
+
+  build_trace(&trace, (const uint8_t[]){45, 0, 23, 4, 72});
+  trace.pulses[BIT_INDEX(39) + 1].duration_us = 130;
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_RESPONSE, dht_decode(trace.pulses, trace.count, data));
+
+  // A glitch merged two bits: the levels no longer alternate on the bit boundary
+  build_trace(&trace, (const uint8_t[]){45, 0, 23, 4, 72});
+  trace.pulses[BIT_INDEX(5)].level = true;
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_RESPONSE, dht_decode(trace.pulses, trace.count, data));
+}
+
+/**
+ * @brief A flipped data bit, and a checksum byte off by one.
+ */
+static void test_bad_checksum(void)
+{
+  trace_t trace;
+  uint8_t data[DHT_DATA_BYTES];
+
+  // Bit 5 of the temperature byte (0x20) read as a 1
+  build_trace(&trace, (const uint8_t[]){45, 0, 23, 4, 72});
+  trace.pulses[BIT_INDEX(16 + 2) + 1].duration_us = 72;
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_CRC, dht_decode(trace.pulses, trace.count, data));
+
+  build_trace(&trace, (const uint8_t[]){45, 0, 23, 4, 73});
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_CRC, dht_decode(trace.pulses, trace.count, data));
+
+  int16_t humidity_x10, temperature_x10;
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, dht_decode_values(DHT_DECODER_DHT22 + 1, data, &humidity_x10, &temperature_x10));
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, dht_decode_values(DHT_DECODER_DHT22, NULL, &humidity_x10, &temperature_x10));
+}
+
+void app_main(void)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_dht11_capture);
+  RUN_TEST(test_dht11_values);
+  RUN_TEST(test_dht22_values);
+  RUN_TEST(test_truncated);
+  RUN_TEST(test_no_response);
+  RUN_TEST(test_bit_timing);
+  RUN_TEST(test_bad_checksum);
+  exit(UNITY_END());
+}
+
+//**************************************************
+// Static Functions
+//**************************************************
+
+/**
+ * @brief Builds the trace of a transaction in the shape of an RMT capture:
+ *        the released line, the response, then every bit with its timings
+ *        spread over the range seen on real sensors.
+ */
+static void build_trace(trace_t *trace, const uint8_t data[DHT_DATA_BYTES])
+{
+  size_t n = 0;
+
+  trace->pulses[n++] = (dht_pulse_t){.level = true, .duration_us = jitter(20, 40)};
+  trace->pulses[n++] = (dht_pulse_t){.level = false, .duration_us = jitter(75, 85)};
+  trace->pulses[n++] = (dht_pulse_t){.level = true, .duration_us = jitter(75, 88)};
+
+  for (int bit = 0; bit < DHT_DATA_BITS; bit++)
+  {
+    const bool one = data[bit / 8] & (0x80 >> (bit % 8));
+
+    trace->pulses[n++] = (dht_pulse_t){.level = false, .duration_us = jitter(48, 56)};
+    trace->pulses[n++] = (dht_pulse_t){.level = true, .duration_us = one ? jitter(68, 75) : jitter(22, 30)};
+  }
+
+  trace->pulses[n++] = (dht_pulse_t){.level = false, .duration_us = jitter(50, 56)};
+  trace->count = n;
+}
+
+/**
+ * @brief Decodes a trace and checks its values.
+ */
+static void expect_values(dht_decoder_type_t type, const trace_t *trace, int16_t humidity_x10, int16_t temperature_x10)
+{
+  uint8_t data[DHT_DATA_BYTES];
+  int16_t humidity, temperature;
+
+  TEST_ASSERT_EQUAL(ESP_OK, dht_decode(trace->pulses, trace->count, data));
+  TEST_ASSERT_EQUAL(ESP_OK, dht_decode_values(type, data, &humidity, &temperature));
+  TEST_ASSERT_EQUAL(humidity_x10, humidity);
+  TEST_ASSERT_EQUAL(temperature_x10, temperature);
+}
+
+/**
+ * @brief Duration in [min_us, max_us], from an xorshift32 sequence that is
+ *        the same on every run.
+ */
+static uint16_t jitter(uint16_t min_us, uint16_t max_us)
+{
+  s_seed ^= s_seed << 13;
+  s_seed ^= s_seed >> 17;
+  s_seed ^= s_seed << 5;
+  return min_us + s_seed % (max_us - min_us + 1);
+}
@@ -32,11 +32,28 @@ esp_err_t sensor_initialize();
  *        The system follows an Observer pattern. All registered handlers will be
  *        called sequentially every time a valid sample is read from the hardware.
  * @note This function is thread-safe and prevents duplicate handler registration.
+ *       It must not be called from a handler.
  * @param handler The callback function to be registered.
  * @return - ESP_OK: Handler registered successfully.
  *
  *         - ESP_ERR_INVALID_ARG: Provided handler was NULL.
  *
- *         - ESP_ERR_NO_MEM: Memory allocation failed for the observer node.
+ *         - ESP_ERR_INVALID_STATE: Component not initialized.
+ *
+ *         - ESP_ERR_NO_MEM: Memory allocation failed for the handler array.
+ */
+esp_err_t sensor_add_event_handler(sensor_event_handler_t handler);
+
+/**
+ * @brief Unregisters an observer. Once this returns the handler will not be called again.
+ * @note Must not be called from a handler.
+ * @param handler The callback function to be removed.
+ * @return - ESP_OK: Handler removed.
+ *
+ *         - ESP_ERR_INVALID_ARG: Provided handler was NULL.
+ *
+ *         - ESP_ERR_INVALID_STATE: Component not initialized.
+ *
+ *         - ESP_ERR_NOT_FOUND: Handler was not registered.
  */
-esp_err_t sensor_add_event_handler(sensor_event_handler_t handler);
\ No newline at end of file
+esp_err_t sensor_remove_event_handler(sensor_event_handler_t handler);
\ No newline at end of file
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "esp_err.h"
+#include "stdbool.h"
+#include "sdkconfig.h"
+
+#if !CONFIG_IDF_TARGET_LINUX
+#include "driver/gpio.h"
+#endif
+
+//**************************************************
+// Defines
+//**************************************************
+
+#define SENSOR_GPIO GPIO_NUM_4
+#define SENSOR_TYPE DHT_DECODER_DHT11
+
+#define DHT_DATA_BYTES 5 // Humidity (2), temperature (2), checksum (1)
+#define DHT_DATA_BITS (DHT_DATA_BYTES * 8)
+
+//**************************************************
+// Typedefs
+//**************************************************
+
+/**
+ * @brief Supported DHT variants. They share the waveform but encode the values differently.
+ */
+typedef enum
+{
+  DHT_DECODER_DHT11 = 0,
+  DHT_DECODER_DHT22, /**< Also AM2301, AM2302 */
+} dht_decoder_type_t;
+
+/**
+ * @brief One level of the captured data line, as recorded by the RMT.
+ */
+typedef struct
+{
+  bool level;           /**< Line level, false while the line is pulled low */
+  uint16_t duration_us; /**< Time spent at that level */
+} dht_pulse_t;
+
+//**************************************************
+// Decoder Functions
+//**************************************************
+
+/**
+ * @brief Decodes a captured transaction. Pure function: the pulses may come
+ *        from the RMT or from a recorded trace.
+ *        The capture may start anywhere before the sensor response (~80 us low,
+ *        ~80 us high); every bit is a ~50 us low followed by a high whose length
+ *        gives the value (~27 us for 0, ~70 us for 1).
+ * @param pulses Captured levels, alternating, in time order.
+ * @param count  Number of pulses.
+ * @param data   Decoded bytes, checksum included.
+ * @return - ESP_OK: Frame decoded and checksum valid.
+ *
+ *         - ESP_ERR_INVALID_ARG: NULL pulses or data.
+ *
+ *         - ESP_ERR_NOT_FOUND: No sensor response in the capture.
+ *
+ *         - ESP_ERR_INVALID_SIZE: Capture ends before the 40th bit.
+ *
+ *         - ESP_ERR_INVALID_RESPONSE: A bit has out of range timings.
+ *
+ *         - ESP_ERR_INVALID_CRC: Checksum mismatch.
+ */
+esp_err_t dht_decode(const dht_pulse_t *pulses, size_t count, uint8_t data[DHT_DATA_BYTES]);
+
+/**
+ * @brief Converts decoded bytes into tenths of %RH and tenths of degree Celsius.
+ * @return - ESP_OK: Values converted.
+ *
+ *         - ESP_ERR_INVALID_ARG: NULL pointer or unknown type.
+ */
+esp_err_t dht_decode_values(dht_decoder_type_t type, const uint8_t data[DHT_DATA_BYTES], int16_t *humidity_x10, int16_t *temperature_x10);
+
+//**************************************************
+// Backend Functions
+//**************************************************
+
+/**
+ * @brief Prepares the sensor bus.
+ * @return - ESP_OK: Backend ready.
+ *
+ *         - ESP_FAIL: Peripheral or OS resource setup failed.
+ */
+esp_err_t sensor_backend_init(void);
+
+/**
+ * @brief Runs one transaction with the sensor. Blocks the calling task only.
+ * @return - ESP_OK: Valid reading.
+ *
+ *         - Other: Transaction or decoding failed.
+ */
+esp_err_t sensor_backend_read(float *humidity, float *temperature);
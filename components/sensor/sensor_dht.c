@@ -0,0 +1,18 @@
+#include "sensor_internals.h"
+#include <dht.h>
+
+//**************************************************
+// Backend Functions
+//**************************************************
+
+esp_err_t sensor_backend_init(void)
+{
+  return ESP_OK;
+}
+
+esp_err_t sensor_backend_read(float *humidity, float *temperature)
+{
+  // Bit-banged in a critical section by the library
+  const dht_sensor_type_t type = SENSOR_TYPE == DHT_DECODER_DHT11 ? DHT_TYPE_DHT11 : DHT_TYPE_AM2301;
+  return dht_read_float_data(type, SENSOR_GPIO, humidity, temperature);
+}
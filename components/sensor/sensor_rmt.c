@@ -0,0 +1,177 @@
+#include "sensor_internals.h"
+#include "esp_log.h"
+#include "esp_attr.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "driver/rmt_rx.h"
+
+//**************************************************
+// Defines
+//**************************************************
+
+#define RMT_RESOLUTION_HZ 1000000 // 1 tick = 1 us
+#define RMT_SYMBOLS 64            // Response + 40 bits + end, one memory block
+#define RMT_GLITCH_NS 1000        // Shorter pulses are ignored
+#define RMT_IDLE_NS 200000        // Line high this long ends the capture
+#define START_PULSE_MS 20         // Host start signal, DHT11 needs at least 18 ms
+#define RX_TIMEOUT_MS 10          // Full transaction is about 5 ms
+
+//**************************************************
+// Function Prototypes
+//**************************************************
+
+static bool rx_done_callback(rmt_channel_handle_t channel, const rmt_rx_done_event_data_t *edata, void *user_data);
+static size_t symbols_to_pulses(const rmt_symbol_word_t *symbols, size_t count, dht_pulse_t *pulses);
+
+//**************************************************
+// Globals
+//**************************************************
+
+static const char TAG[] = "sensor:rmt";
+
+static rmt_channel_handle_t s_rx_channel = NULL; /**< RMT receiver on the data line */
+static QueueHandle_t s_rx_queue = NULL;          /**< Receive done events, ISR to reader task */
+
+static rmt_symbol_word_t s_symbols[RMT_SYMBOLS];  /**< Capture buffer, filled by the RMT */
+static dht_pulse_t s_pulses[RMT_SYMBOLS * 2];     /**< Capture as a level sequence */
+
+//**************************************************
+// Backend Functions
+//**************************************************
+
+esp_err_t sensor_backend_init(void)
+{
+  if ((s_rx_queue = xQueueCreate(1, sizeof(rmt_rx_done_event_data_t))) == NULL)
+  {
+    ESP_LOGE(TAG, "%s:Fail to create rx queue", __func__);
+    return ESP_FAIL;
+  }
+
+  const rmt_rx_channel_config_t channel_config = {
+      .clk_src = RMT_CLK_SRC_DEFAULT,
+      .resolution_hz = RMT_RESOLUTION_HZ,
+      .mem_block_symbols = RMT_SYMBOLS,
+      .gpio_num = SENSOR_GPIO,
+  };
+
+  if (rmt_new_rx_channel(&channel_config, &s_rx_channel) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Fail to create rx channel", __func__);
+    return ESP_FAIL;
+  }
+
+  const rmt_rx_event_callbacks_t callbacks = {
+      .on_recv_done = rx_done_callback,
+  };
+
+  if (rmt_rx_register_event_callbacks(s_rx_channel, &callbacks, NULL) != ESP_OK ||
+      rmt_enable(s_rx_channel) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Fail to enable rx channel", __func__);
+    return ESP_FAIL;
+  }
+
+  // The host drives the start signal on the same pin: open drain, idle high.
+  // The RMT input stays routed through the GPIO matrix
+  if (gpio_set_direction(SENSOR_GPIO, GPIO_MODE_INPUT_OUTPUT_OD) != ESP_OK ||
+      gpio_set_pull_mode(SENSOR_GPIO, GPIO_PULLUP_ONLY) != ESP_OK ||
+      gpio_set_level(SENSOR_GPIO, 1) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Fail to config data line", __func__);
+    return ESP_FAIL;
+  }
+
+  return ESP_OK;
+}
+
+esp_err_t sensor_backend_read(float *humidity, float *temperature)
+{
+  const rmt_receive_config_t receive_config = {
+      .signal_range_min_ns = RMT_GLITCH_NS,
+      .signal_range_max_ns = RMT_IDLE_NS,
+  };
+
+  // Start signal: the task sleeps instead of busy-waiting. One extra tick
+  // because the first one may be partial
+  gpio_set_level(SENSOR_GPIO, 0);
+  vTaskDelay(pdMS_TO_TICKS(START_PULSE_MS) + 1);
+
+  // Arm the capture before releasing the line, the sensor answers within 40 us
+  if (rmt_receive(s_rx_channel, s_symbols, sizeof(s_symbols), &receive_config) != ESP_OK)
+  {
+    gpio_set_level(SENSOR_GPIO, 1);
+    ESP_LOGE(TAG, "%s:Fail to start receive", __func__);
+    return ESP_FAIL;
+  }
+
+  gpio_set_level(SENSOR_GPIO, 1);
+
+  rmt_rx_done_event_data_t event;
+  if (xQueueReceive(s_rx_queue, &event, pdMS_TO_TICKS(RX_TIMEOUT_MS) + 1) != pdTRUE)
+  {
+    // No answer: restart the channel to abort the pending receive
+    rmt_disable(s_rx_channel);
+    rmt_enable(s_rx_channel);
+    return ESP_ERR_TIMEOUT;
+  }
+
+  const size_t count = symbols_to_pulses(event.received_symbols, event.num_symbols, s_pulses);
+
+  uint8_t data[DHT_DATA_BYTES];
+  esp_err_t err = dht_decode(s_pulses, count, data);
+  if (err != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Fail to decode %u pulses (%s)", __func__, (unsigned)count, esp_err_to_name(err));
+    return err;
+  }
+
+  int16_t humidity_x10, temperature_x10;
+  if ((err = dht_decode_values(SENSOR_TYPE, data, &humidity_x10, &temperature_x10)) != ESP_OK)
+  {
+    return err;
+  }
+
+  *humidity = humidity_x10 / 10.0f;
+  *temperature = temperature_x10 / 10.0f;
+  return ESP_OK;
+}
+
+//**************************************************
+// Static Functions
+//**************************************************
+
+/**
+ * @brief RMT receive done ISR callback: hands the capture to the reader task.
+ */
+static bool IRAM_ATTR rx_done_callback(rmt_channel_handle_t channel, const rmt_rx_done_event_data_t *edata, void *user_data)
+{
+  BaseType_t must_yield = pdFALSE;
+  xQueueSendFromISR(s_rx_queue, edata, &must_yield);
+  return must_yield == pdTRUE;
+}
+
+/**
+ * @brief Flattens RMT symbols (two levels each) into a level sequence,
+ *        dropping the zero-length end marker.
+ * @return Number of pulses written.
+ */
+static size_t symbols_to_pulses(const rmt_symbol_word_t *symbols, size_t count, dht_pulse_t *pulses)
+{
+  size_t written = 0;
+
+  for (size_t i = 0; i < count; i++)
+  {
+    if (symbols[i].duration0 != 0)
+    {
+      pulses[written++] = (dht_pulse_t){.level = symbols[i].level0, .duration_us = symbols[i].duration0};
+    }
+
+    if (symbols[i].duration1 != 0)
+    {
+      pulses[written++] = (dht_pulse_t){.level = symbols[i].level1, .duration_us = symbols[i].duration1};
+    }
+  }
+
+  return written;
+}
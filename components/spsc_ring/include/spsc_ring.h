@@ -0,0 +1,63 @@
+#pragma once
+
+#include "esp_err.h"
+#include "stdbool.h"
+#include <stdatomic.h>
+
+//**************************************************
+// Typedefs
+//**************************************************
+
+/**
+ * @brief Lock-free single-producer/single-consumer ring of fixed-size items.
+ *        The producer may run in an ISR. Head and tail are free-running
+ *        counters, so the capacity must be a power of two.
+ */
+typedef struct
+{
+  uint8_t *buffer;           /**< Storage for `capacity` items */
+  size_t item_size;          /**< Size of one item in bytes */
+  uint32_t mask;             /**< capacity - 1 */
+  _Atomic uint32_t head;     /**< Next write position, owned by the producer */
+  _Atomic uint32_t tail;     /**< Next read position, owned by the consumer */
+  _Atomic uint32_t overruns; /**< Items rejected because the ring was full */
+} spsc_ring_t;
+
+//**************************************************
+// Public Functions
+//**************************************************
+
+/**
+ * @brief Allocates the ring storage.
+ * @param ring      Ring to initialize.
+ * @param item_size Size of one item in bytes.
+ * @param capacity  Number of items, must be a power of two.
+ * @return - ESP_OK: Ring ready.
+ *
+ *         - ESP_ERR_INVALID_ARG: NULL ring, zero item size or capacity not a power of two.
+ *
+ *         - ESP_ERR_NO_MEM: Failed to allocate the storage.
+ */
+esp_err_t spsc_ring_init(spsc_ring_t *ring, size_t item_size, uint32_t capacity);
+
+/**
+ * @brief Copies an item into the ring. Producer side only, ISR safe.
+ * @return true if stored, false if the ring was full (the overrun counter is incremented).
+ */
+bool spsc_ring_push(spsc_ring_t *ring, const void *item);
+
+/**
+ * @brief Copies the oldest item out of the ring. Consumer side only.
+ * @return true if an item was read, false if the ring was empty.
+ */
+bool spsc_ring_pop(spsc_ring_t *ring, void *item);
+
+/**
+ * @brief Number of items waiting to be read. May be called from any context.
+ */
+uint32_t spsc_ring_count(spsc_ring_t *ring);
+
+/**
+ * @brief Number of items rejected since initialization. May be called from any context.
+ */
+uint32_t spsc_ring_overruns(spsc_ring_t *ring);
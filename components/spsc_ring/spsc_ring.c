@@ -0,0 +1,75 @@
+#include "spsc_ring.h"
+#include <string.h>
+#include <stdlib.h>
+#include "esp_attr.h"
+
+//**************************************************
+// Public Functions
+//**************************************************
+
+esp_err_t spsc_ring_init(spsc_ring_t *ring, size_t item_size, uint32_t capacity)
+{
+  if (ring == NULL || item_size == 0 || capacity == 0 || (capacity & (capacity - 1)) != 0)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  if ((ring->buffer = malloc(item_size * capacity)) == NULL)
+  {
+    return ESP_ERR_NO_MEM;
+  }
+
+  ring->item_size = item_size;
+  ring->mask = capacity - 1;
+  atomic_init(&ring->head, 0);
+  atomic_init(&ring->tail, 0);
+  atomic_init(&ring->overruns, 0);
+  return ESP_OK;
+}
+
+bool IRAM_ATTR spsc_ring_push(spsc_ring_t *ring, const void *item)
+{
+  const uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  const uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+  if (head - tail > ring->mask)
+  {
+    atomic_fetch_add_explicit(&ring->overruns, 1, memory_order_relaxed);
+    return false;
+  }
+
+  memcpy(&ring->buffer[(head & ring->mask) * ring->item_size], item, ring->item_size);
+
+  // Publish the item only after it is fully written
+  atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+  return true;
+}
+
+bool spsc_ring_pop(spsc_ring_t *ring, void *item)
+{
+  const uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+  const uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+  if (head == tail)
+  {
+    return false;
+  }
+
+  memcpy(item, &ring->buffer[(tail & ring->mask) * ring->item_size], ring->item_size);
+
+  // Release the slot only after it is fully read
+  atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+  return true;
+}
+
+uint32_t spsc_ring_count(spsc_ring_t *ring)
+{
+  const uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+  const uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+  return head - tail;
+}
+
+uint32_t spsc_ring_overruns(spsc_ring_t *ring)
+{
+  return atomic_load_explicit(&ring->overruns, memory_order_relaxed);
+}
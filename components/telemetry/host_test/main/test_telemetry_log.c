@@ -0,0 +1,282 @@
+#include "telemetry_internals.h"
+#include "unity.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+//**************************************************
+// Defines
+//**************************************************
+
+#define FLASH_PATH "telemetry_host_test.bin"
+
+#define RECORD_PERIOD_MS 100 // Record n is logged at n * RECORD_PERIOD_MS
+#define RECORD_CHANNELS 8
+
+//**************************************************
+// Function Prototypes
+//**************************************************
+
+static void open_flash(size_t sectors);
+static esp_err_t write_block(uint32_t *n);
+static uint32_t read_all(uint32_t *first_n, uint32_t *next_n);
+static int32_t record_value(uint32_t n);
+static int64_t clock_ns(void);
+
+//**************************************************
+// Globals
+//**************************************************
+
+static telemetry_flash_file_t s_file;
+static telemetry_log_t s_log;
+static telemetry_builder_t s_builder;
+static telemetry_block_t s_block;
+
+//**************************************************
+// Tests
+//**************************************************
+
+void setUp(void)
+{
+  remove(FLASH_PATH);
+}
+
+void tearDown(void)
+{
+  telemetry_flash_file_close(&s_file);
+  remove(FLASH_PATH);
+}
+
+/**
+ * @brief Blocks written in one boot read back in order after a remount,
+ *        every record intact.
+ */
+static void test_round_trip(void)
+{
+  uint32_t n = 0, first_n, next_n;
+
+  open_flash(8);
+  for (int i = 0; i < 20; i++)
+  {
+    TEST_ASSERT_EQUAL(ESP_OK, write_block(&n));
+  }
+  telemetry_flash_file_close(&s_file);
+
+  open_flash(8);
+  TEST_ASSERT_EQUAL(1, s_log.stats.boot);
+  TEST_ASSERT_EQUAL(0, s_log.stats.corrupt);
+  TEST_ASSERT_EQUAL(n, read_all(&first_n, &next_n));
+  TEST_ASSERT_EQUAL(0, first_n);
+  TEST_ASSERT_EQUAL(n, next_n);
+}
+
+/**
+ * @brief Bytes programmed per byte of records over three laps, and the
+ *        spread of the erase counts. The block and sector headers are the
+ *        only overhead and every sector wears the same.
+ */
+static void test_write_amplification(void)
+{
+  const size_t sectors = 16;
+  uint32_t n = 0;
+
+  open_flash(sectors);
+  for (size_t i = 0; i < 3 * sectors * TELEMETRY_BLOCKS_PER_SECTOR; i++)
+  {
+    TEST_ASSERT_EQUAL(ESP_OK, write_block(&n));
+  }
+
+  uint32_t erase_min = UINT32_MAX, erase_max = 0;
+  for (size_t sector = 0; sector < sectors; sector++)
+  {
+    telemetry_sector_header_t header;
+    TEST_ASSERT_EQUAL(ESP_OK, s_file.flash.read(s_file.flash.ctx, sector * TELEMETRY_SECTOR_SIZE, &header, sizeof(header)));
+    TEST_ASSERT_EQUAL(TELEMETRY_SECTOR_MAGIC, header.magic);
+    erase_min = header.erase_count < erase_min ? header.erase_count : erase_min;
+    erase_max = header.erase_count > erase_max ? header.erase_count : erase_max;
+  }
+
+  const double amplification = (double)s_file.write_bytes / s_log.stats.payload_bytes;
+  printf("records %" PRIu32 ", payload %.2f B/record, programmed %.2f B/record, amplification %.3f, erase counts %" PRIu32 "..%" PRIu32 "\n",
+         s_log.stats.records, (double)s_log.stats.payload_bytes / s_log.stats.records,
+         (double)s_file.write_bytes / s_log.stats.records, amplification, erase_min, erase_max);
+
+  TEST_ASSERT_EQUAL(s_log.stats.flash_bytes, s_file.write_bytes);
+  TEST_ASSERT_TRUE(amplification < 1.10);
+  TEST_ASSERT_TRUE(erase_max - erase_min <= 1);
+}
+
+/**
+ * @brief Cuts the power at every byte of a block write, and of the sector
+ *        erase and header write before it. After the remount every block
+ *        acknowledged before the cut reads back, the torn one is skipped
+ *        and the next boot appends after it.
+ */
+static void test_power_loss(void)
+{
+  static const uint32_t blocks_before[] = {3, TELEMETRY_BLOCKS_PER_SECTOR};
+  const int64_t cut_max = sizeof(telemetry_sector_header_t) + TELEMETRY_BLOCK_SIZE;
+
+  for (size_t b = 0; b < sizeof(blocks_before) / sizeof(blocks_before[0]); b++)
+  {
+    for (int64_t cut = 0; cut <= cut_max; cut++)
+    {
+      uint32_t n = 0, acked_n, first_n, next_n;
+
+      setUp();
+      open_flash(4);
+      for (uint32_t i = 0; i < blocks_before[b]; i++)
+      {
+        TEST_ASSERT_EQUAL(ESP_OK, write_block(&n));
+      }
+
+      // Write until the power goes
+      telemetry_flash_file_cut_power_after(&s_file, cut);
+      do
+      {
+        acked_n = n;
+      } while (write_block(&n) == ESP_OK);
+      telemetry_flash_file_close(&s_file);
+
+      open_flash(4);
+      read_all(&first_n, &next_n);
+      TEST_ASSERT_EQUAL(0, first_n);
+      TEST_ASSERT_TRUE(next_n == acked_n || next_n == n); // The cut block is whole or gone
+
+      // The next boot goes on after what survived
+      const uint32_t resumed_n = next_n;
+      n = next_n;
+      TEST_ASSERT_EQUAL(ESP_OK, write_block(&n));
+      TEST_ASSERT_EQUAL(ESP_OK, write_block(&n));
+      TEST_ASSERT_EQUAL(n, read_all(&first_n, &next_n));
+      TEST_ASSERT_EQUAL(n, next_n);
+      TEST_ASSERT_TRUE(resumed_n >= acked_n);
+
+      tearDown();
+    }
+  }
+}
+
+/**
+ * @brief Export of a full log: read, check and decode every block, as the
+ *        export handler does, and the bytes read per byte of flash.
+ */
+static void test_export_throughput(void)
+{
+  const size_t sectors = 64; // 256 KB
+  uint32_t n = 0, first_n, next_n;
+
+  open_flash(sectors);
+  for (size_t i = 0; i < sectors * TELEMETRY_BLOCKS_PER_SECTOR + 4; i++)
+  {
+    TEST_ASSERT_EQUAL(ESP_OK, write_block(&n));
+  }
+
+  const uint64_t read_before = s_file.read_bytes;
+  const int64_t start = clock_ns();
+  const uint32_t records = read_all(&first_n, &next_n);
+  const double seconds = (double)(clock_ns() - start) / 1e9;
+  const uint64_t read_bytes = s_file.read_bytes - read_before;
+
+  printf("exported %" PRIu32 " records, %.1f MB/s, %.0f records/s, read %.3f B per flash byte\n",
+         records, read_bytes / seconds / 1e6, records / seconds, (double)read_bytes / s_file.flash.size);
+
+  TEST_ASSERT_EQUAL(n, next_n);
+  TEST_ASSERT_EQUAL(n - first_n, records);
+  TEST_ASSERT_TRUE(read_bytes <= s_file.flash.size);
+}
+
+void app_main(void)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_round_trip);
+  RUN_TEST(test_write_amplification);
+  RUN_TEST(test_power_loss);
+  RUN_TEST(test_export_throughput);
+  exit(UNITY_END());
+}
+
+//**************************************************
+// Static Functions
+//**************************************************
+
+/**
+ * @brief Opens the stand-in, created erased on first use, and mounts it.
+ */
+static void open_flash(size_t sectors)
+{
+  TEST_ASSERT_EQUAL(ESP_OK, telemetry_flash_file_open(&s_file, FLASH_PATH, sectors * TELEMETRY_SECTOR_SIZE));
+  TEST_ASSERT_EQUAL(ESP_OK, telemetry_log_mount(&s_log, &s_file.flash, &s_block));
+}
+
+/**
+ * @brief Fills a block with the records from n on, writes it and moves n
+ *        past them, whether the write succeeded or not.
+ */
+static esp_err_t write_block(uint32_t *n)
+{
+  telemetry_builder_reset(&s_builder);
+  while (telemetry_builder_add(&s_builder, *n % RECORD_CHANNELS, (int64_t)*n * RECORD_PERIOD_MS, record_value(*n)))
+  {
+    (*n)++;
+  }
+
+  return telemetry_log_write(&s_log, &s_builder.block, s_builder.records);
+}
+
+/**
+ * @brief Reads the whole log and checks that it holds consecutive records.
+ * @return Records read, from first_n up to next_n.
+ */
+static uint32_t read_all(uint32_t *first_n, uint32_t *next_n)
+{
+  telemetry_cursor_t cursor = {0};
+  uint32_t records = 0;
+
+  *first_n = *next_n = 0;
+
+  while (telemetry_log_read(&s_log, &cursor, &s_block) == ESP_OK)
+  {
+    telemetry_decoder_t decoder;
+    telemetry_record_t record;
+
+    telemetry_decoder_init(&decoder, &s_block);
+    while (telemetry_decoder_next(&decoder, &record))
+    {
+      const uint32_t n = (uint32_t)(record.time_ms / RECORD_PERIOD_MS);
+
+      if (records == 0)
+      {
+        *first_n = n;
+      }
+      else
+      {
+        TEST_ASSERT_EQUAL(*next_n, n);
+      }
+
+      TEST_ASSERT_EQUAL(n % RECORD_CHANNELS, record.ch);
+      TEST_ASSERT_EQUAL(record_value(n), record.value);
+      *next_n = n + 1;
+      records++;
+    }
+  }
+
+  return records;
+}
+
+/**
+ * @brief Slowly moving values around a mean, as the sampled inputs log them.
+ */
+static int32_t record_value(uint32_t n)
+{
+  return 20000 + (int32_t)((n / RECORD_CHANNELS * 37 + n % RECORD_CHANNELS * 11) % 200) - 100;
+}
+
+static int64_t clock_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
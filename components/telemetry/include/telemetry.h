@@ -0,0 +1,150 @@
+#pragma once
+
+#include "esp_err.h"
+#include "stdbool.h"
+#include <stdint.h>
+#include <stddef.h>
+
+//**************************************************
+// Defines
+//**************************************************
+
+#define TELEMETRY_BLOCK_SIZE 504   // 8 blocks after a 64-byte header fill a 4 KB sector
+#define TELEMETRY_BLOCK_HEADER_SIZE 24
+#define TELEMETRY_BLOCK_PAYLOAD (TELEMETRY_BLOCK_SIZE - TELEMETRY_BLOCK_HEADER_SIZE)
+
+#define TELEMETRY_CHANNELS 16 // Channel numbers fit the low nibble of a record tag
+
+//**************************************************
+// Typedefs
+//**************************************************
+
+/**
+ * @brief Unit of the log: a fixed-size, CRC-checked block of records.
+ *        Records are a tag byte (channel), the time since the previous record
+ *        as a varint, and the change from the previous value of the channel
+ *        in the block as a zigzag varint. Channels start from 0 in each block,
+ *        so every block decodes on its own.
+ */
+typedef struct __attribute__((packed))
+{
+  uint32_t magic;   /**< TELEMETRY_BLOCK_MAGIC, erased flash reads 0xFFFFFFFF */
+  uint32_t seq;     /**< Block number, increasing for the life of the partition */
+  uint32_t crc;     /**< CRC-32 of everything after this field */
+  uint16_t boot;    /**< Boot the block was written in, times restart at each boot */
+  uint16_t used;    /**< Payload bytes holding records */
+  int64_t base_ms;  /**< Time of the first record, in ms since boot */
+  uint8_t payload[TELEMETRY_BLOCK_PAYLOAD];
+} telemetry_block_t;
+
+/**
+ * @brief A decoded record.
+ */
+typedef struct
+{
+  int64_t time_ms; /**< Time in ms since boot */
+  int32_t value;
+  uint8_t ch;
+} telemetry_record_t;
+
+/**
+ * @brief Iterator over the records of a block, see telemetry_decoder_init().
+ */
+typedef struct
+{
+  const telemetry_block_t *block;
+  size_t pos;                         /**< Payload offset of the next record */
+  int64_t time_ms;                    /**< Time of the previous record */
+  int32_t values[TELEMETRY_CHANNELS]; /**< Previous value of each channel */
+} telemetry_decoder_t;
+
+/**
+ * @brief Read position in the log, see telemetry_read().
+ */
+typedef struct
+{
+  uint32_t slot;     /**< Next block slot to look at */
+  uint32_t next_seq; /**< Blocks below this number were already read */
+  bool started;      /**< slot is set, otherwise reading starts at the oldest block */
+} telemetry_cursor_t;
+
+/**
+ * @brief Log statistics.
+ */
+typedef struct
+{
+  uint32_t sectors;         /**< Sectors of the partition */
+  uint32_t blocks;          /**< Blocks written since boot */
+  uint32_t records;         /**< Records written since boot */
+  uint32_t dropped;         /**< Records lost because the writer did not keep up */
+  uint32_t corrupt;         /**< Torn or corrupt blocks skipped when mounting */
+  uint32_t write_errors;    /**< Failed block or sector header writes */
+  uint32_t erases;          /**< Sector erases since boot */
+  uint32_t erase_count_max; /**< Highest erase count of a sector, over the life of the partition */
+  uint64_t payload_bytes;   /**< Encoded record bytes written */
+  uint64_t flash_bytes;     /**< Bytes programmed, blocks and sector headers */
+  uint16_t boot;            /**< Current boot number */
+} telemetry_stats_t;
+
+//**************************************************
+// Function Prototypes
+//**************************************************
+
+/**
+ * @brief Mounts the log partition, recovering the write position after a
+ *        power loss, starts the writer task and subscribes to the analog
+ *        input and the sensor. Must be called after both are initialized.
+ * @return - ESP_OK: Logging.
+ *
+ *         - ESP_ERR_NOT_FOUND: No partition labeled CONFIG_TELEMETRY_PARTITION_LABEL.
+ *
+ *         - ESP_FAIL: Failed to read the partition, create OS resources or subscribe.
+ */
+esp_err_t telemetry_initialize(void);
+
+/**
+ * @brief Writes the records still held in RAM, in a partial block.
+ * @return - ESP_OK: Everything logged is on flash.
+ *
+ *         - ESP_ERR_INVALID_STATE: Component not initialized.
+ *
+ *         - ESP_FAIL: Flash write failed.
+ */
+esp_err_t telemetry_flush(void);
+
+/**
+ * @brief Reads the next valid block, oldest first. The lock is only held for
+ *        one block, the log keeps being written while it is read.
+ * @param cursor Read position, zeroed to start at the oldest block.
+ * @param block  Output block.
+ * @return - ESP_OK: Block read.
+ *
+ *         - ESP_ERR_NOT_FOUND: No more blocks on flash.
+ *
+ *         - ESP_ERR_INVALID_ARG: NULL pointer.
+ *
+ *         - ESP_ERR_INVALID_STATE: Component not initialized.
+ */
+esp_err_t telemetry_read(telemetry_cursor_t *cursor, telemetry_block_t *block);
+
+/**
+ * @brief Retrieves the log statistics.
+ * @param stats Output structure.
+ * @return - ESP_OK: Success.
+ *
+ *         - ESP_ERR_INVALID_ARG: Provided stats was NULL.
+ *
+ *         - ESP_ERR_INVALID_STATE: Component not initialized.
+ */
+esp_err_t telemetry_get_stats(telemetry_stats_t *stats);
+
+/**
+ * @brief Starts decoding a block.
+ */
+void telemetry_decoder_init(telemetry_decoder_t *decoder, const telemetry_block_t *block);
+
+/**
+ * @brief Decodes the next record of the block.
+ * @return false at the end of the block, or on a malformed record.
+ */
+bool telemetry_decoder_next(telemetry_decoder_t *decoder, telemetry_record_t *record);
@@ -0,0 +1,173 @@
+#pragma once
+
+#include "telemetry.h"
+#include <stdio.h>
+#include "sdkconfig.h"
+
+//**************************************************
+// Defines
+//**************************************************
+
+#define TELEMETRY_SECTOR_SIZE 4096
+#define TELEMETRY_SECTOR_HEADER_SIZE 64
+#define TELEMETRY_BLOCKS_PER_SECTOR ((TELEMETRY_SECTOR_SIZE - TELEMETRY_SECTOR_HEADER_SIZE) / TELEMETRY_BLOCK_SIZE)
+
+#define TELEMETRY_BLOCK_MAGIC 0x4B4C4254  // "TBLK"
+#define TELEMETRY_SECTOR_MAGIC 0x43455354 // "TSEC"
+
+#define TELEMETRY_RECORD_MAX_SIZE 11 // Tag, 5-byte time varint, 5-byte value varint
+
+//**************************************************
+// Typedefs
+//**************************************************
+
+/**
+ * @brief NOR flash the log lives on: erase sets whole sectors to 0xFF,
+ *        writes only clear bits. Offsets are relative to the log area.
+ */
+typedef struct
+{
+  esp_err_t (*read)(void *ctx, size_t offset, void *dst, size_t len);
+  esp_err_t (*write)(void *ctx, size_t offset, const void *src, size_t len);
+  esp_err_t (*erase)(void *ctx, size_t offset, size_t len);
+  void *ctx;
+  size_t size; /**< Bytes, a multiple of TELEMETRY_SECTOR_SIZE */
+} telemetry_flash_t;
+
+/**
+ * @brief Written at the start of a sector right after it is erased.
+ */
+typedef struct __attribute__((packed))
+{
+  uint32_t magic;       /**< TELEMETRY_SECTOR_MAGIC */
+  uint32_t erase_count; /**< Erases of the sector, carried over each erase */
+  uint32_t crc;         /**< CRC-32 of magic and erase_count */
+} telemetry_sector_header_t;
+
+/**
+ * @brief Block being filled, with the state its next record is encoded against.
+ */
+typedef struct
+{
+  telemetry_block_t block;
+  int64_t time_ms;                    /**< Time of the previous record */
+  int32_t values[TELEMETRY_CHANNELS]; /**< Previous value of each channel */
+  uint32_t records;                   /**< Records in the block */
+} telemetry_builder_t;
+
+/**
+ * @brief Circular log over the sectors of a flash. Blocks go to consecutive
+ *        slots; entering a sector erases it, dropping the oldest blocks, so
+ *        every sector is erased once per lap and wears evenly. The write
+ *        position is not stored anywhere: mounting finds the block with the
+ *        highest seq, torn blocks after it fail their CRC and are skipped.
+ */
+typedef struct
+{
+  const telemetry_flash_t *flash;
+  uint32_t sectors;
+  uint32_t slots;      /**< Block slots in the flash */
+  uint32_t write_slot; /**< Slot the next block goes to */
+  uint32_t tail_slot;  /**< Slot of the oldest block */
+  uint32_t next_seq;   /**< seq of the next block */
+  bool empty;          /**< No block on flash, tail_slot is meaningless */
+  telemetry_stats_t stats;
+} telemetry_log_t;
+
+/**
+ * @brief Flash stand-in backed by a file, for host builds. Keeps NOR
+ *        semantics, counts every operation and can cut the power after a
+ *        number of programmed bytes, leaving a torn write behind.
+ */
+typedef struct
+{
+  telemetry_flash_t flash; /**< Bound to the file, pass to telemetry_log_mount() */
+  FILE *file;
+  int64_t power_budget;    /**< Bytes that may still be programmed, negative for unlimited */
+  uint64_t read_bytes;
+  uint64_t write_bytes;    /**< Bytes programmed */
+  uint32_t erases;         /**< Sectors erased */
+} telemetry_flash_file_t;
+
+//**************************************************
+// Block Functions
+//**************************************************
+
+/**
+ * @brief Empties a builder. Pure, no OS dependency, like the whole log, so
+ *        it also builds on the host.
+ */
+void telemetry_builder_reset(telemetry_builder_t *builder);
+
+/**
+ * @brief Encodes a record into the block.
+ * @return false if the block is full, it is left unchanged.
+ */
+bool telemetry_builder_add(telemetry_builder_t *builder, uint8_t ch, int64_t time_ms, int32_t value);
+
+/**
+ * @brief CRC-32 (IEEE 802.3), chainable from crc 0.
+ */
+uint32_t telemetry_crc32(uint32_t crc, const void *data, size_t len);
+
+/**
+ * @brief Checks the magic, the length and the CRC of a block.
+ */
+bool telemetry_block_valid(const telemetry_block_t *block);
+
+//**************************************************
+// Log Functions
+//**************************************************
+
+/**
+ * @brief Scans the flash and recovers the write position.
+ * @param scratch Buffer for one block, only used during the call.
+ * @return - ESP_OK: Mounted, blocks of a torn write are counted in stats.corrupt.
+ *
+ *         - ESP_ERR_INVALID_SIZE: Flash smaller than two sectors.
+ *
+ *         - ESP_FAIL: Flash read failed.
+ */
+esp_err_t telemetry_log_mount(telemetry_log_t *log, const telemetry_flash_t *flash, telemetry_block_t *scratch);
+
+/**
+ * @brief Appends a block, erasing the next sector first when one is entered.
+ *        Sets magic, seq, boot and crc of the block.
+ * @return - ESP_OK: Block written.
+ *
+ *         - ESP_FAIL: Erase or write failed, the slot is skipped.
+ */
+esp_err_t telemetry_log_write(telemetry_log_t *log, telemetry_block_t *block, uint32_t records);
+
+/**
+ * @brief Reads the next valid block at or after a cursor.
+ * @return - ESP_OK: Block read.
+ *
+ *         - ESP_ERR_NOT_FOUND: The cursor reached the write position.
+ */
+esp_err_t telemetry_log_read(telemetry_log_t *log, telemetry_cursor_t *cursor, telemetry_block_t *block);
+
+//**************************************************
+// File Flash Functions
+//**************************************************
+
+#if CONFIG_IDF_TARGET_LINUX
+/**
+ * @brief Opens or creates the stand-in. A new file reads as erased flash.
+ * @return - ESP_OK: Ready, file->flash can be mounted.
+ *
+ *         - ESP_FAIL: The file could not be opened or sized.
+ */
+esp_err_t telemetry_flash_file_open(telemetry_flash_file_t *file, const char *path, size_t size);
+
+/**
+ * @brief Closes the file, its content stays for the next open.
+ */
+void telemetry_flash_file_close(telemetry_flash_file_t *file);
+
+/**
+ * @brief Simulates a power loss once `bytes` more bytes are programmed: the
+ *        write in progress stops there and every later operation fails.
+ */
+void telemetry_flash_file_cut_power_after(telemetry_flash_file_t *file, int64_t bytes);
+#endif
@@ -0,0 +1,353 @@
+#include "telemetry.h"
+#include "telemetry_internals.h"
+#include "analog_input.h"
+#include "sensor.h"
+#include "history.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_timer.h"
+#include <math.h>
+#include <string.h>
+
+//**************************************************
+// Defines
+//**************************************************
+
+#define TASK_STACK_SIZE 3072
+#define TASK_PRIORITY (tskIDLE_PRIORITY + 1) // Below every sampling task
+
+#define SENSOR_SCALE 100.0f // Sensor values are logged in hundredths, as in the history
+
+//**************************************************
+// Function Prototypes
+//**************************************************
+
+static void telemetry_task(void *arg);
+static void analog_input_event_handler(const analog_input_num_t num, const uint16_t value);
+static void sensor_event_handler(float humidity, float temperature);
+static void record(uint8_t ch, int64_t now_ms, int32_t value);
+static esp_err_t commit_pending(void);
+static esp_err_t partition_read(void *ctx, size_t offset, void *dst, size_t len);
+static esp_err_t partition_write(void *ctx, size_t offset, const void *src, size_t len);
+static esp_err_t partition_erase(void *ctx, size_t offset, size_t len);
+
+//**************************************************
+// Globals
+//**************************************************
+
+static const char TAG[] = "telemetry";
+
+static telemetry_flash_t s_flash;
+static telemetry_log_t s_log;
+static SemaphoreHandle_t s_log_mutex = NULL; /**< Protects s_log and the flash, taken before s_block_mutex */
+
+/**
+ * @brief Double buffer between the observers and the writer task: records
+ *        go to s_open, a full s_open moves to s_pending for the task to
+ *        write, so the observers never wait for the flash.
+ */
+static telemetry_builder_t s_open;
+static telemetry_builder_t s_pending;
+static bool s_pending_full = false;           /**< s_pending waits to be written, observers leave it alone */
+static uint32_t s_dropped = 0;                /**< Records lost while s_pending was still full */
+static SemaphoreHandle_t s_block_mutex = NULL; /**< Protects s_open and the flags */
+
+static TaskHandle_t s_task = NULL;
+
+//**************************************************
+// Public Functions
+//**************************************************
+
+esp_err_t telemetry_initialize(void)
+{
+  _Static_assert(_HISTORY_CH_MAX <= TELEMETRY_CHANNELS, "Channels must fit a record tag");
+
+  if (s_log_mutex != NULL)
+  {
+    return ESP_OK;
+  }
+
+  const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                                              CONFIG_TELEMETRY_PARTITION_LABEL);
+  if (partition == NULL)
+  {
+    ESP_LOGE(TAG, "%s:No partition '%s'", __func__, CONFIG_TELEMETRY_PARTITION_LABEL);
+    return ESP_ERR_NOT_FOUND;
+  }
+
+  s_flash = (telemetry_flash_t){
+      .read = partition_read,
+      .write = partition_write,
+      .erase = partition_erase,
+      .ctx = (void *)partition,
+      .size = partition->size - partition->size % TELEMETRY_SECTOR_SIZE,
+  };
+
+  // The scratch block is only needed for the scan, s_pending is still free
+  if (telemetry_log_mount(&s_log, &s_flash, &s_pending.block) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Fail to mount log", __func__);
+    return ESP_FAIL;
+  }
+
+  telemetry_builder_reset(&s_open);
+  telemetry_builder_reset(&s_pending);
+
+  ESP_LOGI(TAG, "%s:Boot %u, %lu sectors, next block %lu, %lu torn blocks skipped", __func__,
+           s_log.stats.boot, (unsigned long)s_log.sectors, (unsigned long)s_log.next_seq, (unsigned long)s_log.stats.corrupt);
+
+  SemaphoreHandle_t log_mutex = NULL;
+
+  if ((s_block_mutex = xSemaphoreCreateMutex()) == NULL || (log_mutex = xSemaphoreCreateMutex()) == NULL)
+  {
+    ESP_LOGE(TAG, "%s:Fail to create mutex", __func__);
+    goto fail;
+  }
+
+  // The writer first: the observers notify it as soon as they are added
+  if (xTaskCreate(telemetry_task, "telemetry", TASK_STACK_SIZE, NULL, TASK_PRIORITY, &s_task) != pdPASS)
+  {
+    ESP_LOGE(TAG, "%s:Fail to create task", __func__);
+    goto fail;
+  }
+
+  // The public functions check s_log_mutex, published once the writer runs
+  s_log_mutex = log_mutex;
+
+  if (analog_input_add_event_handler(analog_input_event_handler) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Fail to add analog input handler", __func__);
+    goto fail;
+  }
+
+  if (sensor_add_event_handler(sensor_event_handler) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Fail to add sensor handler", __func__);
+    analog_input_remove_event_handler(analog_input_event_handler);
+    goto fail;
+  }
+
+  return ESP_OK;
+
+fail:
+  // Nothing is left running, a later call starts over
+  s_log_mutex = NULL;
+
+  if (s_task != NULL)
+  {
+    vTaskDelete(s_task);
+    s_task = NULL;
+  }
+
+  if (log_mutex != NULL)
+  {
+    vSemaphoreDelete(log_mutex);
+  }
+
+  if (s_block_mutex != NULL)
+  {
+    vSemaphoreDelete(s_block_mutex);
+    s_block_mutex = NULL;
+  }
+
+  return ESP_FAIL;
+}
+
+esp_err_t telemetry_flush(void)
+{
+  if (s_log_mutex == NULL)
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  // Twice at most: a block already pending, then the open one
+  for (int i = 0; i < 2; i++)
+  {
+    xSemaphoreTake(s_block_mutex, portMAX_DELAY);
+
+    const bool pending = s_pending_full;
+    if (!pending && s_open.records != 0)
+    {
+      s_pending = s_open;
+      s_pending_full = true;
+      telemetry_builder_reset(&s_open);
+    }
+
+    const bool more = pending && s_open.records != 0;
+
+    xSemaphoreGive(s_block_mutex);
+
+    if (commit_pending() != ESP_OK)
+    {
+      return ESP_FAIL;
+    }
+
+    if (!more)
+    {
+      break;
+    }
+  }
+
+  return ESP_OK;
+}
+
+esp_err_t telemetry_read(telemetry_cursor_t *cursor, telemetry_block_t *block)
+{
+  if (cursor == NULL || block == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  if (s_log_mutex == NULL)
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  xSemaphoreTake(s_log_mutex, portMAX_DELAY);
+  esp_err_t err = telemetry_log_read(&s_log, cursor, block);
+  xSemaphoreGive(s_log_mutex);
+
+  return err;
+}
+
+esp_err_t telemetry_get_stats(telemetry_stats_t *stats)
+{
+  if (stats == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  if (s_log_mutex == NULL)
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  xSemaphoreTake(s_log_mutex, portMAX_DELAY);
+  *stats = s_log.stats;
+  xSemaphoreGive(s_log_mutex);
+
+  stats->dropped = s_dropped;
+
+  return ESP_OK;
+}
+
+//**************************************************
+// Static Functions
+//**************************************************
+
+/**
+ * @brief Writes each block filled by the observers, and the partial block
+ *        every CONFIG_TELEMETRY_FLUSH_S, which bounds what a power loss takes.
+ */
+static void telemetry_task(void *arg)
+{
+  for (;;)
+  {
+    if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CONFIG_TELEMETRY_FLUSH_S * 1000)) != 0)
+    {
+      commit_pending();
+    }
+    else
+    {
+      telemetry_flush();
+    }
+  }
+}
+
+/**
+ * @brief Logs every value reported by the analog input module.
+ */
+static void analog_input_event_handler(const analog_input_num_t num, const uint16_t value)
+{
+  record(HISTORY_CH_ANALOG_1 + num, esp_timer_get_time() / 1000, value);
+}
+
+/**
+ * @brief Logs every sensor reading, in hundredths.
+ */
+static void sensor_event_handler(float humidity, float temperature)
+{
+  const int64_t now_ms = esp_timer_get_time() / 1000;
+
+  record(HISTORY_CH_TEMPERATURE, now_ms, lroundf(temperature * SENSOR_SCALE));
+  record(HISTORY_CH_HUMIDITY, now_ms, lroundf(humidity * SENSOR_SCALE));
+}
+
+/**
+ * @brief Encodes a record into the open block. A full block is handed to
+ *        the writer task; if it is still busy with the previous one, the
+ *        record is dropped.
+ */
+static void record(uint8_t ch, int64_t now_ms, int32_t value)
+{
+  xSemaphoreTake(s_block_mutex, portMAX_DELAY);
+
+  if (!telemetry_builder_add(&s_open, ch, now_ms, value))
+  {
+    if (s_pending_full)
+    {
+      s_dropped++;
+      xSemaphoreGive(s_block_mutex);
+      return;
+    }
+
+    s_pending = s_open;
+    s_pending_full = true;
+    telemetry_builder_reset(&s_open);
+    telemetry_builder_add(&s_open, ch, now_ms, value);
+
+    xTaskNotifyGive(s_task);
+  }
+
+  xSemaphoreGive(s_block_mutex);
+}
+
+/**
+ * @brief Writes s_pending if it is full. The observers keep filling s_open
+ *        during the flash write.
+ */
+static esp_err_t commit_pending(void)
+{
+  esp_err_t err = ESP_OK;
+
+  xSemaphoreTake(s_log_mutex, portMAX_DELAY);
+
+  xSemaphoreTake(s_block_mutex, portMAX_DELAY);
+  const bool pending = s_pending_full;
+  xSemaphoreGive(s_block_mutex);
+
+  if (pending)
+  {
+    err = telemetry_log_write(&s_log, &s_pending.block, s_pending.records);
+    if (err != ESP_OK)
+    {
+      ESP_LOGE(TAG, "%s:Fail to write block, %lu records lost", __func__, (unsigned long)s_pending.records);
+    }
+
+    xSemaphoreTake(s_block_mutex, portMAX_DELAY);
+    s_pending_full = false;
+    xSemaphoreGive(s_block_mutex);
+  }
+
+  xSemaphoreGive(s_log_mutex);
+
+  return err;
+}
+
+static esp_err_t partition_read(void *ctx, size_t offset, void *dst, size_t len)
+{
+  return esp_partition_read((const esp_partition_t *)ctx, offset, dst, len);
+}
+
+static esp_err_t partition_write(void *ctx, size_t offset, const void *src, size_t len)
+{
+  return esp_partition_write((const esp_partition_t *)ctx, offset, src, len);
+}
+
+static esp_err_t partition_erase(void *ctx, size_t offset, size_t len)
+{
+  return esp_partition_erase_range((const esp_partition_t *)ctx, offset, len);
+}
@@ -0,0 +1,179 @@
+#include "telemetry_internals.h"
+#include <string.h>
+
+//**************************************************
+// Defines
+//**************************************************
+
+#define TAG_CH_MASK 0x0F // Low nibble of a record tag, the high one is reserved
+
+//**************************************************
+// Function Prototypes
+//**************************************************
+
+static size_t put_varint(uint8_t *dst, uint32_t value);
+static bool get_varint(const uint8_t *src, size_t len, size_t *pos, uint32_t *value);
+
+//**************************************************
+// Globals
+//**************************************************
+
+/**
+ * @brief CRC-32 of every nibble, reflected polynomial 0xEDB88320.
+ */
+static const uint32_t s_crc_nibbles[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+};
+
+//**************************************************
+// Block Functions
+//**************************************************
+
+void telemetry_builder_reset(telemetry_builder_t *builder)
+{
+  memset(builder, 0, sizeof(*builder));
+}
+
+bool telemetry_builder_add(telemetry_builder_t *builder, uint8_t ch, int64_t time_ms, int32_t value)
+{
+  telemetry_block_t *block = &builder->block;
+
+  ch &= TAG_CH_MASK;
+
+  if (builder->records == 0)
+  {
+    block->base_ms = time_ms;
+    builder->time_ms = time_ms;
+  }
+
+  // A clock going back or a gap past the varint range starts a new block
+  const int64_t dt_ms = time_ms - builder->time_ms;
+  if (dt_ms < 0 || dt_ms > UINT32_MAX || block->used + TELEMETRY_RECORD_MAX_SIZE > TELEMETRY_BLOCK_PAYLOAD)
+  {
+    return false;
+  }
+
+  const int32_t delta = (int32_t)((uint32_t)value - (uint32_t)builder->values[ch]);
+  uint8_t *dst = &block->payload[block->used];
+  size_t len = 0;
+
+  dst[len++] = ch;
+  len += put_varint(&dst[len], (uint32_t)dt_ms);
+  len += put_varint(&dst[len], ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31));
+
+  block->used += len;
+  builder->time_ms = time_ms;
+  builder->values[ch] = value;
+  builder->records++;
+
+  return true;
+}
+
+uint32_t telemetry_crc32(uint32_t crc, const void *data, size_t len)
+{
+  const uint8_t *bytes = data;
+
+  crc = ~crc;
+  for (size_t i = 0; i < len; i++)
+  {
+    crc ^= bytes[i];
+    crc = (crc >> 4) ^ s_crc_nibbles[crc & 0x0F];
+    crc = (crc >> 4) ^ s_crc_nibbles[crc & 0x0F];
+  }
+
+  return ~crc;
+}
+
+bool telemetry_block_valid(const telemetry_block_t *block)
+{
+  const size_t covered = sizeof(*block) - offsetof(telemetry_block_t, boot);
+
+  return block->magic == TELEMETRY_BLOCK_MAGIC && block->used <= TELEMETRY_BLOCK_PAYLOAD &&
+         block->crc == telemetry_crc32(0, &block->boot, covered);
+}
+
+void telemetry_decoder_init(telemetry_decoder_t *decoder, const telemetry_block_t *block)
+{
+  memset(decoder, 0, sizeof(*decoder));
+  decoder->block = block;
+  decoder->time_ms = block->base_ms;
+}
+
+bool telemetry_decoder_next(telemetry_decoder_t *decoder, telemetry_record_t *record)
+{
+  const telemetry_block_t *block = decoder->block;
+  size_t pos = decoder->pos;
+  uint32_t dt_ms, zigzag;
+
+  if (pos >= block->used)
+  {
+    return false;
+  }
+
+  const uint8_t ch = block->payload[pos++] & TAG_CH_MASK;
+
+  if (!get_varint(block->payload, block->used, &pos, &dt_ms) ||
+      !get_varint(block->payload, block->used, &pos, &zigzag))
+  {
+    decoder->pos = block->used;
+    return false;
+  }
+
+  const int32_t delta = (int32_t)((zigzag >> 1) ^ (0U - (zigzag & 1)));
+
+  decoder->pos = pos;
+  decoder->time_ms += dt_ms;
+  decoder->values[ch] = (int32_t)((uint32_t)decoder->values[ch] + (uint32_t)delta);
+
+  record->ch = ch;
+  record->time_ms = decoder->time_ms;
+  record->value = decoder->values[ch];
+
+  return true;
+}
+
+//**************************************************
+// Static Functions
+//**************************************************
+
+/**
+ * @brief Writes a LEB128 varint, 7 bits per byte, low bits first.
+ * @return Bytes written, at most 5.
+ */
+static size_t put_varint(uint8_t *dst, uint32_t value)
+{
+  size_t len = 0;
+
+  while (value >= 0x80)
+  {
+    dst[len++] = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+
+  dst[len++] = (uint8_t)value;
+  return len;
+}
+
+/**
+ * @brief Reads a LEB128 varint, moving pos past it.
+ * @return false if it runs past len or over 5 bytes.
+ */
+static bool get_varint(const uint8_t *src, size_t len, size_t *pos, uint32_t *value)
+{
+  uint32_t result = 0;
+
+  for (int shift = 0; shift < 35 && *pos < len; shift += 7)
+  {
+    const uint8_t byte = src[(*pos)++];
+    result |= (uint32_t)(byte & 0x7F) << shift;
+
+    if ((byte & 0x80) == 0)
+    {
+      *value = result;
+      return true;
+    }
+  }
+
+  return false;
+}
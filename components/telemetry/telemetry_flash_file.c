@@ -0,0 +1,174 @@
+#include "telemetry_internals.h"
+#include <string.h>
+
+//**************************************************
+// Defines
+//**************************************************
+
+#define COPY_CHUNK 256
+
+//**************************************************
+// Function Prototypes
+//**************************************************
+
+static esp_err_t file_read(void *ctx, size_t offset, void *dst, size_t len);
+static esp_err_t file_write(void *ctx, size_t offset, const void *src, size_t len);
+static esp_err_t file_erase(void *ctx, size_t offset, size_t len);
+static bool powered(const telemetry_flash_file_t *file);
+
+//**************************************************
+// File Flash Functions
+//**************************************************
+
+esp_err_t telemetry_flash_file_open(telemetry_flash_file_t *file, const char *path, size_t size)
+{
+  memset(file, 0, sizeof(*file));
+  file->power_budget = -1;
+  file->flash = (telemetry_flash_t){
+      .read = file_read,
+      .write = file_write,
+      .erase = file_erase,
+      .ctx = file,
+      .size = size,
+  };
+
+  if ((file->file = fopen(path, "r+b")) == NULL)
+  {
+    // New stand-in, fresh flash reads all ones
+    if ((file->file = fopen(path, "w+b")) == NULL)
+    {
+      return ESP_FAIL;
+    }
+
+    uint8_t ones[COPY_CHUNK];
+    memset(ones, 0xFF, sizeof(ones));
+    for (size_t done = 0; done < size; done += sizeof(ones))
+    {
+      const size_t len = size - done < sizeof(ones) ? size - done : sizeof(ones);
+      if (fwrite(ones, 1, len, file->file) != len)
+      {
+        telemetry_flash_file_close(file);
+        return ESP_FAIL;
+      }
+    }
+  }
+
+  return ESP_OK;
+}
+
+void telemetry_flash_file_close(telemetry_flash_file_t *file)
+{
+  if (file->file != NULL)
+  {
+    fclose(file->file);
+    file->file = NULL;
+  }
+}
+
+void telemetry_flash_file_cut_power_after(telemetry_flash_file_t *file, int64_t bytes)
+{
+  file->power_budget = bytes;
+}
+
+//**************************************************
+// Static Functions
+//**************************************************
+
+static esp_err_t file_read(void *ctx, size_t offset, void *dst, size_t len)
+{
+  telemetry_flash_file_t *file = ctx;
+
+  if (!powered(file) || offset + len > file->flash.size || fseek(file->file, (long)offset, SEEK_SET) != 0 ||
+      fread(dst, 1, len, file->file) != len)
+  {
+    return ESP_FAIL;
+  }
+
+  file->read_bytes += len;
+  return ESP_OK;
+}
+
+/**
+ * @brief Programs bytes as NOR flash does, only clearing bits. With a power
+ *        budget set, the bytes past it are not programmed and the write fails.
+ */
+static esp_err_t file_write(void *ctx, size_t offset, const void *src, size_t len)
+{
+  telemetry_flash_file_t *file = ctx;
+  const uint8_t *bytes = src;
+  esp_err_t err = ESP_OK;
+
+  if (!powered(file) || offset + len > file->flash.size)
+  {
+    return ESP_FAIL;
+  }
+
+  if (file->power_budget >= 0 && (int64_t)len > file->power_budget)
+  {
+    len = (size_t)file->power_budget;
+    err = ESP_FAIL;
+  }
+
+  for (size_t done = 0; done < len; done += COPY_CHUNK)
+  {
+    uint8_t cells[COPY_CHUNK];
+    const size_t chunk = len - done < COPY_CHUNK ? len - done : COPY_CHUNK;
+
+    if (fseek(file->file, (long)(offset + done), SEEK_SET) != 0 || fread(cells, 1, chunk, file->file) != chunk)
+    {
+      return ESP_FAIL;
+    }
+
+    for (size_t i = 0; i < chunk; i++)
+    {
+      cells[i] &= bytes[done + i];
+    }
+
+    if (fseek(file->file, (long)(offset + done), SEEK_SET) != 0 || fwrite(cells, 1, chunk, file->file) != chunk)
+    {
+      return ESP_FAIL;
+    }
+  }
+
+  file->write_bytes += len;
+  if (file->power_budget >= 0)
+  {
+    file->power_budget -= len;
+  }
+
+  fflush(file->file);
+  return err;
+}
+
+static esp_err_t file_erase(void *ctx, size_t offset, size_t len)
+{
+  telemetry_flash_file_t *file = ctx;
+  uint8_t ones[COPY_CHUNK];
+
+  if (!powered(file) || offset % TELEMETRY_SECTOR_SIZE != 0 || len % TELEMETRY_SECTOR_SIZE != 0 ||
+      offset + len > file->flash.size || fseek(file->file, (long)offset, SEEK_SET) != 0)
+  {
+    return ESP_FAIL;
+  }
+
+  memset(ones, 0xFF, sizeof(ones));
+  for (size_t done = 0; done < len; done += sizeof(ones))
+  {
+    if (fwrite(ones, 1, sizeof(ones), file->file) != sizeof(ones))
+    {
+      return ESP_FAIL;
+    }
+  }
+
+  file->erases += len / TELEMETRY_SECTOR_SIZE;
+  fflush(file->file);
+  return ESP_OK;
+}
+
+/**
+ * @brief A spent power budget leaves the flash dead until it is reopened.
+ */
+static bool powered(const telemetry_flash_file_t *file)
+{
+  return file->file != NULL && file->power_budget != 0;
+}
@@ -0,0 +1,290 @@
+#include "telemetry_internals.h"
+#include <string.h>
+
+//**************************************************
+// Defines
+//**************************************************
+
+#define SLOT_SECTOR(slot) ((slot) / TELEMETRY_BLOCKS_PER_SECTOR)
+#define SLOT_OFFSET(slot) ((size_t)SLOT_SECTOR(slot) * TELEMETRY_SECTOR_SIZE + TELEMETRY_SECTOR_HEADER_SIZE + \
+                           (size_t)((slot) % TELEMETRY_BLOCKS_PER_SECTOR) * TELEMETRY_BLOCK_SIZE)
+
+//**************************************************
+// Function Prototypes
+//**************************************************
+
+static esp_err_t read_sector_header(telemetry_log_t *log, uint32_t sector, uint32_t *erase_count);
+static esp_err_t prepare_sector(telemetry_log_t *log, uint32_t sector);
+static bool slot_blank(telemetry_log_t *log, uint32_t slot, telemetry_block_t *scratch);
+static void retire_write_sector(telemetry_log_t *log);
+
+//**************************************************
+// Log Functions
+//**************************************************
+
+esp_err_t telemetry_log_mount(telemetry_log_t *log, const telemetry_flash_t *flash, telemetry_block_t *scratch)
+{
+  _Static_assert(sizeof(telemetry_block_t) == TELEMETRY_BLOCK_SIZE, "Block layout must match its size");
+  _Static_assert(TELEMETRY_SECTOR_HEADER_SIZE + TELEMETRY_BLOCKS_PER_SECTOR * TELEMETRY_BLOCK_SIZE == TELEMETRY_SECTOR_SIZE,
+                 "Blocks must fill the sector");
+
+  memset(log, 0, sizeof(*log));
+  log->flash = flash;
+  log->sectors = flash->size / TELEMETRY_SECTOR_SIZE;
+  log->slots = log->sectors * TELEMETRY_BLOCKS_PER_SECTOR;
+  log->empty = true;
+  log->stats.sectors = log->sectors;
+
+  if (log->sectors < 2)
+  {
+    return ESP_ERR_INVALID_SIZE;
+  }
+
+  for (uint32_t sector = 0; sector < log->sectors; sector++)
+  {
+    uint32_t erase_count;
+    if (read_sector_header(log, sector, &erase_count) == ESP_OK && erase_count > log->stats.erase_count_max)
+    {
+      log->stats.erase_count_max = erase_count;
+    }
+  }
+
+  uint32_t head_slot = 0, head_seq = 0, tail_seq = 0;
+  uint16_t head_boot = 0;
+
+  for (uint32_t slot = 0; slot < log->slots; slot++)
+  {
+    if (flash->read(flash->ctx, SLOT_OFFSET(slot), scratch, sizeof(*scratch)) != ESP_OK)
+    {
+      return ESP_FAIL;
+    }
+
+    if (!telemetry_block_valid(scratch))
+    {
+      if (scratch->magic != UINT32_MAX || scratch->used != UINT16_MAX)
+      {
+        log->stats.corrupt++;
+      }
+      continue;
+    }
+
+    if (log->empty || scratch->seq > head_seq)
+    {
+      head_slot = slot;
+      head_seq = scratch->seq;
+      head_boot = scratch->boot;
+    }
+
+    if (log->empty || scratch->seq < tail_seq)
+    {
+      log->tail_slot = slot;
+      tail_seq = scratch->seq;
+    }
+
+    log->empty = false;
+  }
+
+  if (log->empty)
+  {
+    return ESP_OK;
+  }
+
+  log->next_seq = head_seq + 1;
+  log->stats.boot = head_boot + 1;
+
+  // A torn write after the head leaves its slot dirty, the sector continues after it
+  log->write_slot = (head_slot + 1) % log->slots;
+  while (log->write_slot % TELEMETRY_BLOCKS_PER_SECTOR != 0 && !slot_blank(log, log->write_slot, scratch))
+  {
+    log->write_slot = (log->write_slot + 1) % log->slots;
+  }
+
+  retire_write_sector(log);
+
+  return ESP_OK;
+}
+
+esp_err_t telemetry_log_write(telemetry_log_t *log, telemetry_block_t *block, uint32_t records)
+{
+  const telemetry_flash_t *flash = log->flash;
+  const uint32_t slot = log->write_slot;
+
+  if (slot % TELEMETRY_BLOCKS_PER_SECTOR == 0 && prepare_sector(log, SLOT_SECTOR(slot)) != ESP_OK)
+  {
+    log->stats.write_errors++;
+    return ESP_FAIL;
+  }
+
+  block->magic = TELEMETRY_BLOCK_MAGIC;
+  block->seq = log->next_seq;
+  block->boot = log->stats.boot;
+  block->crc = telemetry_crc32(0, &block->boot, sizeof(*block) - offsetof(telemetry_block_t, boot));
+
+  // The slot is used either way, a failed write may have programmed part of it
+  log->write_slot = (slot + 1) % log->slots;
+  retire_write_sector(log);
+
+  if (flash->write(flash->ctx, SLOT_OFFSET(slot), block, sizeof(*block)) != ESP_OK)
+  {
+    log->stats.write_errors++;
+    return ESP_FAIL;
+  }
+
+  if (log->empty)
+  {
+    log->tail_slot = slot;
+    log->empty = false;
+  }
+
+  log->next_seq++;
+  log->stats.blocks++;
+  log->stats.records += records;
+  log->stats.payload_bytes += block->used;
+  log->stats.flash_bytes += sizeof(*block);
+
+  return ESP_OK;
+}
+
+esp_err_t telemetry_log_read(telemetry_log_t *log, telemetry_cursor_t *cursor, telemetry_block_t *block)
+{
+  const telemetry_flash_t *flash = log->flash;
+
+  if (log->empty)
+  {
+    return ESP_ERR_NOT_FOUND;
+  }
+
+  if (!cursor->started)
+  {
+    cursor->slot = log->tail_slot;
+    cursor->started = true;
+  }
+
+  // Bounded by one lap, torn and erased slots are skipped
+  for (uint32_t n = 0; n < log->slots && cursor->slot != log->write_slot; n++)
+  {
+    const uint32_t slot = cursor->slot;
+    cursor->slot = (slot + 1) % log->slots;
+
+    if (flash->read(flash->ctx, SLOT_OFFSET(slot), block, sizeof(*block)) != ESP_OK)
+    {
+      return ESP_FAIL;
+    }
+
+    // Blocks below next_seq were read before the writer lapped the cursor
+    if (telemetry_block_valid(block) && block->seq >= cursor->next_seq)
+    {
+      cursor->next_seq = block->seq + 1;
+      return ESP_OK;
+    }
+  }
+
+  return ESP_ERR_NOT_FOUND;
+}
+
+//**************************************************
+// Static Functions
+//**************************************************
+
+/**
+ * @brief Reads the erase count of a sector.
+ * @return ESP_ERR_NOT_FOUND if the header is missing or torn.
+ */
+static esp_err_t read_sector_header(telemetry_log_t *log, uint32_t sector, uint32_t *erase_count)
+{
+  telemetry_sector_header_t header;
+
+  if (log->flash->read(log->flash->ctx, (size_t)sector * TELEMETRY_SECTOR_SIZE, &header, sizeof(header)) != ESP_OK)
+  {
+    return ESP_FAIL;
+  }
+
+  if (header.magic != TELEMETRY_SECTOR_MAGIC || header.crc != telemetry_crc32(0, &header, offsetof(telemetry_sector_header_t, crc)))
+  {
+    return ESP_ERR_NOT_FOUND;
+  }
+
+  *erase_count = header.erase_count;
+  return ESP_OK;
+}
+
+/**
+ * @brief Erases a sector and writes its header with the erase count carried
+ *        over. A header lost to a power cut mid-erase, or never written on a
+ *        new partition, is estimated as one below the most worn sector: the
+ *        sector entered next is the least worn, at most one erase behind.
+ */
+static esp_err_t prepare_sector(telemetry_log_t *log, uint32_t sector)
+{
+  const telemetry_flash_t *flash = log->flash;
+  const size_t offset = (size_t)sector * TELEMETRY_SECTOR_SIZE;
+  uint32_t erase_count;
+
+  if (read_sector_header(log, sector, &erase_count) != ESP_OK)
+  {
+    erase_count = log->stats.erase_count_max > 0 ? log->stats.erase_count_max - 1 : 0;
+  }
+
+  if (flash->erase(flash->ctx, offset, TELEMETRY_SECTOR_SIZE) != ESP_OK)
+  {
+    return ESP_FAIL;
+  }
+
+  telemetry_sector_header_t header = {
+      .magic = TELEMETRY_SECTOR_MAGIC,
+      .erase_count = erase_count + 1,
+  };
+  header.crc = telemetry_crc32(0, &header, offsetof(telemetry_sector_header_t, crc));
+
+  log->stats.erases++;
+
+  if (flash->write(flash->ctx, offset, &header, sizeof(header)) != ESP_OK)
+  {
+    return ESP_FAIL;
+  }
+
+  log->stats.flash_bytes += sizeof(header);
+  if (header.erase_count > log->stats.erase_count_max)
+  {
+    log->stats.erase_count_max = header.erase_count;
+  }
+
+  return ESP_OK;
+}
+
+/**
+ * @brief Checks that a slot was not programmed since its sector was erased.
+ */
+static bool slot_blank(telemetry_log_t *log, uint32_t slot, telemetry_block_t *scratch)
+{
+  if (log->flash->read(log->flash->ctx, SLOT_OFFSET(slot), scratch, sizeof(*scratch)) != ESP_OK)
+  {
+    return false;
+  }
+
+  const uint8_t *bytes = (const uint8_t *)scratch;
+  for (size_t i = 0; i < sizeof(*scratch); i++)
+  {
+    if (bytes[i] != 0xFF)
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * @brief When the write position enters the sector holding the oldest
+ *        blocks, they are gone with the next write: the tail moves to the
+ *        following sector now, so readers never run into the erase.
+ */
+static void retire_write_sector(telemetry_log_t *log)
+{
+  const uint32_t sector = SLOT_SECTOR(log->write_slot);
+
+  if (!log->empty && log->write_slot % TELEMETRY_BLOCKS_PER_SECTOR == 0 && SLOT_SECTOR(log->tail_slot) == sector)
+  {
+    log->tail_slot = ((sector + 1) % log->sectors) * TELEMETRY_BLOCKS_PER_SECTOR;
+  }
+}
@@ -54,6 +54,9 @@ void analog_input_event_handler(const analog_input_num_t num, const uint16_t val
           .num = num,
           .value = value,
       },
+#if CONFIG_WEB_SERVER_TRACE
+      .trace.acquire_us = (uint32_t)analog_input_get_sample_time(),
+#endif
   };
 
   // Dispatch the event to connected web clients
@@ -0,0 +1,201 @@
+#include "web_server_internals.h"
+#include "esp_http_server.h"
+#include "esp_log.h"
+#include <string.h>
+
+//**************************************************
+// Defines
+//**************************************************
+
+#define ASSET_HEADER_MAX_LEN 128 // Longer Accept-Encoding or If-None-Match values are ignored
+
+// Names are not versioned, so browsers keep the files but revalidate them
+#define ASSET_CACHE_CONTROL "no-cache"
+
+#define ASSET_INDEX_PATH "/index.html" // Served for "/"
+
+//**************************************************
+// Function Prototypes
+//**************************************************
+
+static esp_err_t get_asset_handler(httpd_req_t *req);
+static const web_asset_t *find_asset(const char *path, size_t len);
+static bool accepts_gzip(httpd_req_t *req);
+static bool etag_matches(httpd_req_t *req, const char *etag);
+
+//**************************************************
+// Globals
+//**************************************************
+
+static const char TAG[] = "web_server:assets";
+
+static const httpd_uri_t s_uri_get_asset = {
+    .uri = "/*",
+    .method = HTTP_GET,
+    .user_ctx = NULL,
+    .handler = get_asset_handler,
+};
+
+//**************************************************
+// Public Functions
+//**************************************************
+
+esp_err_t assets_register(httpd_handle_t server)
+{
+  if (httpd_register_uri_handler(server, &s_uri_get_asset) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Fail to register uri handler", __func__);
+    return ESP_FAIL;
+  }
+
+  ESP_LOGI(TAG, "%u embedded files", (unsigned)web_assets_count);
+
+  return ESP_OK;
+}
+
+//**************************************************
+// Static Functions
+//**************************************************
+
+/**
+ * @brief Handler for every path not claimed by the API. Sends the embedded
+ *        file, gzipped when the client accepts it. A matching If-None-Match
+ *        gets a bodiless 304 instead.
+ */
+static esp_err_t get_asset_handler(httpd_req_t *req)
+{
+  // The query string is not part of the path
+  const char *query = strchr(req->uri, '?');
+  size_t len = query != NULL ? (size_t)(query - req->uri) : strlen(req->uri);
+
+  const web_asset_t *asset = len == 1 ? find_asset(ASSET_INDEX_PATH, strlen(ASSET_INDEX_PATH))
+                                      : find_asset(req->uri, len);
+  if (asset == NULL)
+  {
+    return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Not found");
+  }
+
+  const bool gzip = asset->gz_data != NULL && accepts_gzip(req);
+  const char *etag = gzip ? asset->gz_etag : asset->etag;
+
+  httpd_resp_set_hdr(req, "ETag", etag);
+  httpd_resp_set_hdr(req, "Cache-Control", ASSET_CACHE_CONTROL);
+  if (asset->gz_data != NULL)
+  {
+    httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+  }
+
+  if (etag_matches(req, etag))
+  {
+    httpd_resp_set_status(req, "304 Not Modified");
+    return httpd_resp_send(req, NULL, 0);
+  }
+
+  httpd_resp_set_type(req, asset->type);
+
+  if (gzip)
+  {
+    httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+    return httpd_resp_send(req, (const char *)asset->gz_data, asset->gz_len);
+  }
+
+  return httpd_resp_send(req, (const char *)asset->data, asset->len);
+}
+
+/**
+ * @brief Binary search of the asset table, sorted by path at build time.
+ * @param path Request path, not NUL terminated.
+ * @param len  Path length.
+ * @return The asset, or NULL if no file has this path.
+ */
+static const web_asset_t *find_asset(const char *path, size_t len)
+{
+  size_t low = 0;
+  size_t high = web_assets_count;
+
+  while (low < high)
+  {
+    const size_t mid = low + (high - low) / 2;
+    const char *candidate = web_assets[mid].path;
+
+    int cmp = strncmp(candidate, path, len);
+    if (cmp == 0 && candidate[len] != '\0')
+    {
+      cmp = 1; // Candidate is longer, so it sorts after the path
+    }
+
+    if (cmp == 0)
+    {
+      return &web_assets[mid];
+    }
+
+    if (cmp < 0)
+    {
+      low = mid + 1;
+    }
+    else
+    {
+      high = mid;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief Whether Accept-Encoding lists gzip, without a zero quality.
+ */
+static bool accepts_gzip(httpd_req_t *req)
+{
+  char value[ASSET_HEADER_MAX_LEN];
+  if (httpd_req_get_hdr_value_str(req, "Accept-Encoding", value, sizeof(value)) != ESP_OK)
+  {
+    return false;
+  }
+
+  const char *gzip = strstr(value, "gzip");
+  if (gzip == NULL)
+  {
+    return false;
+  }
+
+  // "gzip;q=0" or "gzip; q=0.0" explicitly refuses it
+  const char *params = gzip + strlen("gzip");
+  while (*params == ' ' || *params == ';')
+  {
+    params++;
+  }
+
+  if (strncmp(params, "q=0", 3) == 0)
+  {
+    const char *digit = params + 3;
+    if (*digit == '.')
+    {
+      digit++;
+    }
+
+    while (*digit == '0')
+    {
+      digit++;
+    }
+
+    return *digit >= '1' && *digit <= '9';
+  }
+
+  return true;
+}
+
+/**
+ * @brief Whether If-None-Match holds the ETag or "*". The ETag is searched
+ *        quotes included, so one tag never matches a longer one.
+ */
+static bool etag_matches(httpd_req_t *req, const char *etag)
+{
+  char value[ASSET_HEADER_MAX_LEN];
+  if (httpd_req_get_hdr_value_str(req, "If-None-Match", value, sizeof(value)) != ESP_OK)
+  {
+    return false;
+  }
+
+  return strcmp(value, "*") == 0 || strstr(value, etag) != NULL;
+}
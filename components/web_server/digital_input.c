@@ -10,7 +10,7 @@
 
 static esp_err_t get_digital_input_handler(httpd_req_t *req);
 
-static void input_event_handler(const digital_input_num_t num, const bool state);
+static void input_event_handler(const digital_input_event_t *input_event);
 
 //**************************************************
 // Globals
@@ -98,14 +98,23 @@ static esp_err_t get_digital_input_handler(httpd_req_t *req)
 /**
  * @brief Observer callback that pushes hardware changes to the web event system (WebSocket/SSE).
  */
-static void input_event_handler(const digital_input_num_t num, const bool state)
+static void input_event_handler(const digital_input_event_t *input_event)
 {
+  // Pulse counter rates are not part of the state stream
+  if (input_event->type != DIGITAL_INPUT_EVENT_EDGE)
+  {
+    return;
+  }
+
   event_t event = {
       .name = EVENT_NAME_DIGITAL_INPUT,
       .payload.digital_input = {
-          .num = num,
-          .value = state,
+          .num = input_event->num,
+          .value = input_event->state,
       },
+#if CONFIG_WEB_SERVER_TRACE
+      .trace.acquire_us = (uint32_t)input_event->timestamp_us,
+#endif
   };
 
   if (events_send(&event) != ESP_OK)
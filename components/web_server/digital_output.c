@@ -3,15 +3,21 @@
 #include "esp_log.h"
 #include "digital_output.h"
 #include "cJSON.h"
+#include <string.h>
 
 //**************************************************
 // Function Prototypes
 //**************************************************
 
 static bool is_id_valid(int id);
+static esp_err_t send_output(httpd_req_t *req, digital_output_num_t num);
 
 static esp_err_t get_digital_output_handler(httpd_req_t *req);
 static esp_err_t post_digital_output_handler(httpd_req_t *req);
+static esp_err_t post_digital_output_mask_handler(httpd_req_t *req);
+static esp_err_t post_digital_output_schedule_handler(httpd_req_t *req);
+static esp_err_t delete_digital_output_schedule_handler(httpd_req_t *req);
+static esp_err_t post_digital_output_pwm_handler(httpd_req_t *req);
 
 //**************************************************
 // Globals
@@ -33,6 +39,34 @@ static const httpd_uri_t s_uri_post_digital_output = {
     .user_ctx = NULL,
 };
 
+static const httpd_uri_t s_uri_post_digital_output_mask = {
+    .uri = "/api/digital-output/mask",
+    .method = HTTP_POST,
+    .handler = post_digital_output_mask_handler,
+    .user_ctx = NULL,
+};
+
+static const httpd_uri_t s_uri_post_digital_output_schedule = {
+    .uri = "/api/digital-output/schedule",
+    .method = HTTP_POST,
+    .handler = post_digital_output_schedule_handler,
+    .user_ctx = NULL,
+};
+
+static const httpd_uri_t s_uri_delete_digital_output_schedule = {
+    .uri = "/api/digital-output/schedule",
+    .method = HTTP_DELETE,
+    .handler = delete_digital_output_schedule_handler,
+    .user_ctx = NULL,
+};
+
+static const httpd_uri_t s_uri_post_digital_output_pwm = {
+    .uri = "/api/digital-output/pwm",
+    .method = HTTP_POST,
+    .handler = post_digital_output_pwm_handler,
+    .user_ctx = NULL,
+};
+
 //**************************************************
 // Public Functions
 //**************************************************
@@ -51,6 +85,25 @@ esp_err_t digital_output_register(httpd_handle_t server)
     return ESP_FAIL;
   }
 
+  if (httpd_register_uri_handler(server, &s_uri_post_digital_output_mask) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Fail to register uri handler", __func__);
+    return ESP_FAIL;
+  }
+
+  if (httpd_register_uri_handler(server, &s_uri_post_digital_output_schedule) != ESP_OK ||
+      httpd_register_uri_handler(server, &s_uri_delete_digital_output_schedule) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Fail to register uri handler", __func__);
+    return ESP_FAIL;
+  }
+
+  if (httpd_register_uri_handler(server, &s_uri_post_digital_output_pwm) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Fail to register uri handler", __func__);
+    return ESP_FAIL;
+  }
+
   return ESP_OK;
 }
 
@@ -63,9 +116,36 @@ static bool is_id_valid(int id)
   return (id >= 0 && id < _DIGITAL_OUTPUT_NUM_MAX);
 }
 
+/**
+ * @brief Responds with the state of an output. PWM outputs also report
+ *        their settings and the duty the hardware is at, mid-fade included.
+ */
+static esp_err_t send_output(httpd_req_t *req, digital_output_num_t num)
+{
+  char resp[128];
+  digital_output_pwm_config_t config;
+  uint32_t duty;
+
+  if (digital_output_pwm_get(num, &config, &duty) == ESP_OK)
+  {
+    snprintf(resp, sizeof(resp),
+             "{\"state\":%d,\"mode\":\"pwm\",\"frequency_hz\":%lu,\"resolution_bits\":%u,\"duty\":%lu,\"max_duty\":%lu}",
+             duty != 0, (unsigned long)config.frequency_hz, config.resolution_bits,
+             (unsigned long)duty, 1UL << config.resolution_bits);
+  }
+  else
+  {
+    snprintf(resp, sizeof(resp), "{\"state\":%d,\"mode\":\"digital\"}",
+             digital_output_get_state(num) == DIGITAL_OUTPUT_ON);
+  }
+
+  httpd_resp_set_type(req, "application/json");
+  return httpd_resp_send(req, resp, HTTPD_RESP_USE_STRLEN);
+}
+
 /**
  * @brief Handles GET requests. Parses the 'id' query parameter and returns 
- *        the hardware state as a JSON object.
+ *        the hardware state as a JSON object, with the duty in PWM mode.
  */
 static esp_err_t get_digital_output_handler(httpd_req_t *req)
 {
@@ -86,12 +166,7 @@ static esp_err_t get_digital_output_handler(httpd_req_t *req)
     return ESP_FAIL;
   }
 
-  digital_output_state_t state = digital_output_get_state((digital_output_num_t)id);
-
-  char resp[32];
-  snprintf(resp, sizeof(resp), "{\"state\":%d}", state == DIGITAL_OUTPUT_ON);
-  httpd_resp_set_type(req, "application/json");
-  return httpd_resp_send(req, resp, HTTPD_RESP_USE_STRLEN);
+  return send_output(req, (digital_output_num_t)id);
 }
 
 /**
@@ -131,4 +206,269 @@ static esp_err_t post_digital_output_handler(httpd_req_t *req)
   }
 
   return httpd_resp_send(req, body, HTTPD_RESP_USE_STRLEN);
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Handles POST requests updating several outputs in one write.
+ *        Expected JSON: {"set": mask, "clear": mask}, bit n for output n.
+ *        Either field may be omitted. Responds with the resulting state mask.
+ */
+static esp_err_t post_digital_output_mask_handler(httpd_req_t *req)
+{
+  char body[128];
+
+  // 1. Read Body
+  int ret = httpd_req_recv(req, body, sizeof(body) - 1);
+  if (ret <= 0)
+  {
+    return ESP_FAIL;
+  }
+  body[ret] = '\0';
+
+  // 2. Parse JSON
+  cJSON *json = cJSON_Parse(body);
+  if (json == NULL)
+  {
+    return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+  }
+
+  const cJSON *set_item = cJSON_GetObjectItemCaseSensitive(json, "set");
+  const cJSON *clear_item = cJSON_GetObjectItemCaseSensitive(json, "clear");
+  const bool valid = (set_item == NULL || cJSON_IsNumber(set_item)) &&
+                     (clear_item == NULL || cJSON_IsNumber(clear_item));
+  const uint32_t set_mask = cJSON_IsNumber(set_item) ? (uint32_t)set_item->valueint : 0;
+  const uint32_t clear_mask = cJSON_IsNumber(clear_item) ? (uint32_t)clear_item->valueint : 0;
+  cJSON_Delete(json);
+
+  // 3. Action
+  if (!valid || digital_output_set_mask(set_mask, clear_mask) != ESP_OK)
+  {
+    return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid mask");
+  }
+
+  char resp[32];
+  snprintf(resp, sizeof(resp), "{\"state\":%lu}", (unsigned long)digital_output_get_mask());
+  httpd_resp_set_type(req, "application/json");
+  return httpd_resp_send(req, resp, HTTPD_RESP_USE_STRLEN);
+}
+
+/**
+ * @brief Handles POST requests scheduling an action on the output in ?id=X.
+ *        Expected JSON: {"action": "set" | "clear" | "toggle" | "pulse",
+ *        "delay_us": n, "period_us": n} or, for a pulse,
+ *        {"action": "pulse", "level": true/false, "width_us": n}, n >= 50.
+ *        Responds with the handle of the action: {"schedule": id}.
+ */
+static esp_err_t post_digital_output_schedule_handler(httpd_req_t *req)
+{
+  char query[64], id_str[8], body[160];
+
+  // 1. Parse Query for ID
+  if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+      httpd_query_key_value(query, "id", id_str, sizeof(id_str)) != ESP_OK)
+  {
+    return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing ID");
+  }
+
+  int id = atoi(id_str);
+  if (!is_id_valid(id))
+  {
+    return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid ID");
+  }
+
+  // 2. Read Body
+  int ret = httpd_req_recv(req, body, sizeof(body) - 1);
+  if (ret <= 0)
+  {
+    return ESP_FAIL;
+  }
+  body[ret] = '\0';
+
+  // 3. Parse JSON
+  cJSON *json = cJSON_Parse(body);
+  if (json == NULL)
+  {
+    return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+  }
+
+  const cJSON *action_item = cJSON_GetObjectItemCaseSensitive(json, "action");
+  const cJSON *delay_item = cJSON_GetObjectItemCaseSensitive(json, "delay_us");
+  const cJSON *period_item = cJSON_GetObjectItemCaseSensitive(json, "period_us");
+  const cJSON *width_item = cJSON_GetObjectItemCaseSensitive(json, "width_us");
+  const cJSON *level_item = cJSON_GetObjectItemCaseSensitive(json, "level");
+
+  const double delay_us = cJSON_IsNumber(delay_item) ? delay_item->valuedouble : 0;
+  const double period_us = cJSON_IsNumber(period_item) ? period_item->valuedouble : 0;
+  const double width_us = cJSON_IsNumber(width_item) ? width_item->valuedouble : 0;
+  const bool level = !cJSON_IsBool(level_item) || cJSON_IsTrue(level_item);
+
+  // 4. Action
+  const char *action = cJSON_IsString(action_item) ? action_item->valuestring : "";
+  digital_output_schedule_id_t schedule_id = 0;
+  esp_err_t err;
+
+  if (delay_us < 0 || period_us < 0 || period_us > UINT32_MAX || width_us < 0 || width_us > UINT32_MAX)
+  {
+    err = ESP_ERR_INVALID_ARG;
+  }
+  else if (strcmp(action, "pulse") == 0)
+  {
+    err = digital_output_pulse(id, level, (uint32_t)width_us, &schedule_id);
+  }
+  else if (strcmp(action, "set") == 0)
+  {
+    err = digital_output_schedule(id, DIGITAL_OUTPUT_ACTION_SET, (uint64_t)delay_us, (uint32_t)period_us, &schedule_id);
+  }
+  else if (strcmp(action, "clear") == 0)
+  {
+    err = digital_output_schedule(id, DIGITAL_OUTPUT_ACTION_CLEAR, (uint64_t)delay_us, (uint32_t)period_us, &schedule_id);
+  }
+  else if (strcmp(action, "toggle") == 0)
+  {
+    err = digital_output_schedule(id, DIGITAL_OUTPUT_ACTION_TOGGLE, (uint64_t)delay_us, (uint32_t)period_us, &schedule_id);
+  }
+  else
+  {
+    err = ESP_ERR_INVALID_ARG;
+  }
+
+  cJSON_Delete(json);
+
+  if (err == ESP_ERR_NO_MEM)
+  {
+    return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Schedule full");
+  }
+
+  if (err != ESP_OK)
+  {
+    return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid action");
+  }
+
+  char resp[32];
+  snprintf(resp, sizeof(resp), "{\"schedule\":%lu}", (unsigned long)schedule_id);
+  httpd_resp_set_type(req, "application/json");
+  return httpd_resp_send(req, resp, HTTPD_RESP_USE_STRLEN);
+}
+
+/**
+ * @brief Handles DELETE requests cancelling a scheduled action.
+ *        Expects query param: ?schedule=X
+ */
+static esp_err_t delete_digital_output_schedule_handler(httpd_req_t *req)
+{
+  char query[64], schedule_str[12];
+
+  if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+      httpd_query_key_value(query, "schedule", schedule_str, sizeof(schedule_str)) != ESP_OK)
+  {
+    return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing schedule");
+  }
+
+  if (digital_output_cancel((digital_output_schedule_id_t)strtoul(schedule_str, NULL, 10)) != ESP_OK)
+  {
+    return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Unknown schedule");
+  }
+
+  httpd_resp_set_type(req, "application/json");
+  return httpd_resp_send(req, "{}", HTTPD_RESP_USE_STRLEN);
+}
+
+/**
+ * @brief Handles POST requests configuring PWM on the output in ?id=X.
+ *        Expected JSON, every field optional:
+ *        {"mode": "pwm" | "digital", "frequency_hz": n, "resolution_bits": n,
+ *        "duty": n, "fade_ms": n}. "mode": "pwm" (re)starts the channel at
+ *        the given or default frequency and resolution, duty 0. "duty" then
+ *        applies at once, or as a hardware fade over "fade_ms".
+ *        Responds with the output state, as GET does.
+ */
+static esp_err_t post_digital_output_pwm_handler(httpd_req_t *req)
+{
+  char query[64], id_str[8], body[160];
+
+  // 1. Parse Query for ID
+  if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+      httpd_query_key_value(query, "id", id_str, sizeof(id_str)) != ESP_OK)
+  {
+    return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing ID");
+  }
+
+  int id = atoi(id_str);
+  if (!is_id_valid(id))
+  {
+    return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid ID");
+  }
+
+  // 2. Read Body
+  int ret = httpd_req_recv(req, body, sizeof(body) - 1);
+  if (ret <= 0)
+  {
+    return ESP_FAIL;
+  }
+  body[ret] = '\0';
+
+  // 3. Parse JSON
+  cJSON *json = cJSON_Parse(body);
+  if (json == NULL)
+  {
+    return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+  }
+
+  const cJSON *mode_item = cJSON_GetObjectItemCaseSensitive(json, "mode");
+  const cJSON *frequency_item = cJSON_GetObjectItemCaseSensitive(json, "frequency_hz");
+  const cJSON *resolution_item = cJSON_GetObjectItemCaseSensitive(json, "resolution_bits");
+  const cJSON *duty_item = cJSON_GetObjectItemCaseSensitive(json, "duty");
+  const cJSON *fade_item = cJSON_GetObjectItemCaseSensitive(json, "fade_ms");
+
+  digital_output_pwm_config_t config = DIGITAL_OUTPUT_PWM_DEFAULT_CONFIG();
+  const double frequency_hz = cJSON_IsNumber(frequency_item) ? frequency_item->valuedouble : config.frequency_hz;
+  const double resolution_bits = cJSON_IsNumber(resolution_item) ? resolution_item->valuedouble : config.resolution_bits;
+  const double duty = cJSON_IsNumber(duty_item) ? duty_item->valuedouble : 0;
+  const double fade_ms = cJSON_IsNumber(fade_item) ? fade_item->valuedouble : 0;
+  const char *mode = cJSON_IsString(mode_item) ? mode_item->valuestring : NULL;
+  const bool has_duty = cJSON_IsNumber(duty_item);
+
+  // 4. Action
+  esp_err_t err = ESP_OK;
+
+  if (frequency_hz < 1 || frequency_hz > UINT32_MAX || resolution_bits < 1 || resolution_bits > UINT8_MAX ||
+      duty < 0 || duty > UINT32_MAX || fade_ms < 0 || fade_ms > UINT32_MAX ||
+      (mode_item != NULL && mode == NULL))
+  {
+    err = ESP_ERR_INVALID_ARG;
+  }
+  else if (mode != NULL && strcmp(mode, "digital") == 0)
+  {
+    err = has_duty ? ESP_ERR_INVALID_ARG : digital_output_pwm_disable(id);
+  }
+  else if (mode != NULL && strcmp(mode, "pwm") == 0)
+  {
+    config.frequency_hz = (uint32_t)frequency_hz;
+    config.resolution_bits = (uint8_t)resolution_bits;
+    err = digital_output_pwm_enable(id, &config);
+  }
+  else if (mode != NULL)
+  {
+    err = ESP_ERR_INVALID_ARG;
+  }
+
+  if (err == ESP_OK && has_duty)
+  {
+    err = fade_ms > 0 ? digital_output_pwm_fade(id, (uint32_t)duty, (uint32_t)fade_ms)
+                      : digital_output_pwm_set_duty(id, (uint32_t)duty);
+  }
+
+  cJSON_Delete(json);
+
+  if (err == ESP_ERR_INVALID_STATE)
+  {
+    return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Output not in PWM mode");
+  }
+
+  if (err != ESP_OK)
+  {
+    return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid PWM settings");
+  }
+
+  return send_output(req, (digital_output_num_t)id);
+}
@@ -2,182 +2,1132 @@
 
 #include "esp_http_server.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "digital_output.h"
 
 #include <time.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <inttypes.h>
 #include <sys/time.h>
+#include <sys/socket.h>
+#include <errno.h>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
 
+//**************************************************
+// Defines
+//**************************************************
+
+/**
+ * @brief Bytes added around an SSE batch by the HTTP chunked framing:
+ *        up to 8 hex digits of length, and two CRLF.
+ */
+#define CHUNK_OVERHEAD (8 + 2 + 2)
+
+/**
+ * @brief Longest Last-Event-ID value accepted, a decimal uint32 and its terminator.
+ */
+#define LAST_EVENT_ID_MAX_LEN 11
+
+/**
+ * @brief Queued to wake the events task without an update, see events_ws_ack().
+ */
+#define EVENT_NAME_WAKE ((event_name_t)0xFF)
+
+#define WS_OPCODE_BINARY 0x2
+#define WS_OPCODE_CLOSE 0x8
+#define WS_OPCODE_PONG 0xA
+#define WS_FIN 0x80
+
 //**************************************************
 // Typedefs
 //**************************************************
 
-typedef struct req_node_t
-{
-  struct req_node_t *prev;
-  httpd_req_t *req;
-  struct req_node_t *next;
-} req_node_t;
+/**
+ * @brief Events collected during one batching window, at most one per channel.
+ */
+typedef struct
+{
+  event_t events[EVENTS_COALESCE_SLOTS]; /**< Latest event of each channel, indexed by slot */
+  uint32_t ids[EVENTS_COALESCE_SLOTS];   /**< Event id of each slot */
+  bool used[EVENTS_COALESCE_SLOTS];      /**< Slot holds an event */
+  uint8_t order[EVENTS_COALESCE_SLOTS];  /**< Used slots, in order of first arrival */
+  size_t count;                          /**< Used slots */
+} batch_t;
+
+/**
+ * @brief Protocol spoken to a client.
+ */
+typedef enum
+{
+  CLIENT_SSE = 0, /**< Text event stream over chunked HTTP, owns an async request */
+  CLIENT_WS,      /**< Binary WebSocket messages, the session is owned by the server */
+} client_transport_t;
+
+/**
+ * @brief Session context of a client. Only its address matters: the
+ *        server frees it when the session closes, so it names the session
+ *        and never a later one on the same socket.
+ */
+typedef struct
+{
+  int fd; /**< Socket of the session, for the logs */
+} client_session_t;
+
+/**
+ * @brief An SSE or WebSocket client. Each one owns its outbound data, so a
+ *        client that cannot keep up only delays itself:
+ *
+ *        - frame: the chunk being written to the socket, sent without blocking
+ *        and resumed at frame_sent on the next pass.
+ *
+ *        - pending: updates that arrived while a frame was in flight, coalesced
+ *        per channel. Only the latest value of a channel is kept, so the memory
+ *        is bounded and the client still converges to the current state.
+ */
+typedef struct req_node_t
+{
+  struct req_node_t *prev;
+  httpd_req_t *req;                                       /**< Async request, NULL for a WebSocket client */
+  client_session_t *session;                              /**< Context of the session, the node is looked up by it */
+  httpd_handle_t handle;                                  /**< Server of the session */
+  int fd;                                                 /**< Client socket */
+  client_transport_t transport;                           /**< Framing of the data written */
+  batch_t pending;                                        /**< Updates waiting for the next frame */
+  ws_ack_t acks[WS_ACK_QUEUE_LEN];                        /**< Command acks waiting for the next frame, WebSocket only */
+  size_t ack_count;                                       /**< Acks queued */
+  uint8_t control[WS_CONTROL_PAYLOAD_MAX_LEN];            /**< Payload of the control reply, WebSocket only */
+  size_t control_len;                                     /**< Bytes in control */
+  uint8_t control_opcode;                                 /**< Control reply waiting for the next frame, 0 if none */
+  bool closing;                                           /**< The CLOSE reply is in flight, the session ends after it */
+  char frame[SSE_ENCODER_BUFFER_SIZE + CHUNK_OVERHEAD]; /**< Chunk in flight */
+  size_t frame_len;                                       /**< Bytes in frame, 0 when idle */
+  size_t frame_sent;                                      /**< Bytes of frame already written */
+  int64_t last_progress_us;                               /**< Last time the client accepted data, or went busy */
+#if CONFIG_WEB_SERVER_TRACE
+  uint32_t frame_start_us;                                /**< Time the frame in flight was encoded, low 32 bits */
+#endif
+  struct req_node_t *next;
+} req_node_t;
+
+/**
+ * @brief Outcome of a non-blocking write attempt to a client.
+ */
+typedef enum
+{
+  CLIENT_IDLE = 0, /**< Nothing left to send */
+  CLIENT_BUSY,     /**< Data outstanding, the socket is full */
+  CLIENT_FAILED,   /**< Socket error or stall timeout, the client must go */
+  CLIENT_CLOSED,   /**< Close handshake done, the client must go */
+} client_state_t;
+
+//**************************************************
+// Function Prototypes
+//**************************************************
+
+static void events_task();
+
+static bool batch_add(batch_t *batch, const event_t *event, uint32_t id);
+static void batch_clear(batch_t *batch);
+static int coalesce_slot(const event_t *event);
+static bool broadcast(const batch_t *batch);
+static client_state_t client_flush(req_node_t *node, sse_encoder_t *encoder);
+static void client_frame(req_node_t *node, sse_encoder_t *encoder);
+static void client_snapshot(req_node_t *node, sse_encoder_t *encoder);
+static void client_chunk(req_node_t *node, const sse_encoder_t *encoder);
+static void client_ws_frame(req_node_t *node, const sse_encoder_t *encoder);
+static void client_ws_control(req_node_t *node);
+static void client_evict(req_node_t **node_ptr);
+static bool client_resume(req_node_t *node, uint32_t last_id);
+static uint32_t history_newest_id();
+static void snapshot_update(events_snapshot_t *snapshot, const event_t *event);
+static void update_stats(const batch_t *batch, uint32_t received, int64_t start_us);
+#if CONFIG_WEB_SERVER_TRACE
+static void trace_dequeue(event_t *event);
+static void trace_send(event_t *event);
+#endif
+
+static esp_err_t events_handler(httpd_req_t *req);
+static esp_err_t events_stats_handler(httpd_req_t *req);
+static esp_err_t session_attach(httpd_req_t *req);
+static void session_closed(void *ctx);
+static void clients_clear(bool complete);
+static req_node_t *find_node(req_node_t *head, int fd);
+static req_node_t *find_session(req_node_t *head, const client_session_t *session);
+static esp_err_t add_node(req_node_t **head, httpd_req_t *req, client_transport_t transport, req_node_t **added);
+static httpd_req_t *pop_node(req_node_t **node);
+
+//**************************************************
+// Globals
+//**************************************************
+
+static const char TAG[] = "web_server:events";
+
+static const httpd_uri_t s_uri_get_events = {
+    .uri = "/api/events",
+    .method = HTTP_GET,
+    .user_ctx = NULL,
+    .handler = events_handler,
+};
+
+static const httpd_uri_t s_uri_get_events_stats = {
+    .uri = "/api/events/stats",
+    .method = HTTP_GET,
+    .user_ctx = NULL,
+    .handler = events_stats_handler,
+};
+
+static req_node_t *s_first_req_node = NULL;
+
+static SemaphoreHandle_t s_req_node_mutex = NULL;
+
+static QueueHandle_t s_events_queue = NULL;
+
+static TaskHandle_t s_events_task = NULL;
+
+static uint32_t s_first_id = 1; /**< Id of the first event since boot */
+static uint32_t s_next_id = 1;  /**< Id of the next event taken from the queue, 0 means no id */
+
+static batch_t s_history = {0}; /**< Latest event of every channel with its id, protected by s_req_node_mutex */
+
+static events_snapshot_t s_snapshot = {0}; /**< Current state of the inputs, protected by s_req_node_mutex */
+
+static _Atomic uint32_t s_snapshot_version = 0; /**< Incremented whenever s_snapshot changes */
+
+static const event_t s_wake = {.name = EVENT_NAME_WAKE}; /**< Queued to have the task write the clients */
+
+static sse_encoder_t s_encoder; /**< Client frame encoder, protected by s_req_node_mutex */
+
+static volatile bool s_clients_busy = false; /**< A client has data outstanding, written with s_req_node_mutex held */
+
+static events_stats_t s_stats = {0};                             /**< Batch statistics */
+static portMUX_TYPE s_stats_lock = portMUX_INITIALIZER_UNLOCKED; /**< Protection for the statistics */
+
+static _Atomic uint32_t s_send_failures = 0; /**< Updated by the producers, outside s_stats_lock */
+static metrics_histogram_t s_latency;        /**< Batch latency, lock-free */
+
+#if CONFIG_WEB_SERVER_TRACE
+static metrics_histogram_t s_trace[_EVENTS_TRACE_STAGE_MAX]; /**< Time spent in each stage, lock-free */
+#endif
+
+//**************************************************
+// Public Functions
+//**************************************************
+
+esp_err_t events_register(httpd_handle_t server)
+{
+  // The server is started again on every reconnect, the task and its
+  // resources are only created the first time
+  if (s_req_node_mutex == NULL && (s_req_node_mutex = xSemaphoreCreateMutex()) == NULL)
+  {
+    ESP_LOGE(TAG, "%s:Fail to create req node mutex", __func__);
+    return ESP_FAIL;
+  }
+
+  if (s_events_queue == NULL)
+  {
+    // Random start, so an id kept by a client across a reboot is recognized
+    s_first_id = s_next_id = (esp_random() >> 1) | 1;
+
+    if ((s_events_queue = xQueueCreate(CONFIG_WEB_SERVER_EVENTS_QUEUE_LENGTH, sizeof(event_t))) == NULL)
+    {
+      ESP_LOGE(TAG, "%s:Fail to create events queue", __func__);
+      return ESP_FAIL;
+    }
+  }
+
+  if (s_events_task == NULL && xTaskCreate(events_task, "events_task", 4096, NULL, 3, &s_events_task) != pdTRUE)
+  {
+    ESP_LOGE(TAG, "%s:Fail to create event task", __func__);
+    s_events_task = NULL;
+    return ESP_FAIL;
+  }
+
+  // Clients of a server stopped without events_unregister(): their sessions
+  // are gone with it, the nodes are only dropped
+  clients_clear(false);
+
+  if (httpd_register_uri_handler(server, &s_uri_get_events) != ESP_OK ||
+      httpd_register_uri_handler(server, &s_uri_get_events_stats) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Fail to register uri handler", __func__);
+    return ESP_FAIL;
+  }
+
+  return ESP_OK;
+}
+
+void events_unregister(void)
+{
+  clients_clear(true);
+}
+
+esp_err_t events_send(event_t *event)
+{
+#if CONFIG_WEB_SERVER_TRACE
+  event->trace.enqueue_us = (uint32_t)esp_timer_get_time();
+#endif
+
+  if (xQueueSend(s_events_queue, event, pdMS_TO_TICKS(250)) != pdTRUE)
+  {
+    atomic_fetch_add_explicit(&s_send_failures, 1, memory_order_relaxed);
+    return ESP_FAIL;
+  }
+
+  return ESP_OK;
+}
+
+esp_err_t events_ws_add(httpd_req_t *req)
+{
+  req_node_t *node = NULL;
+
+  if (s_req_node_mutex == NULL)
+  {
+    return ESP_FAIL;
+  }
+
+  if (session_attach(req) != ESP_OK)
+  {
+    return ESP_ERR_NO_MEM;
+  }
+
+  if (xSemaphoreTake(s_req_node_mutex, portMAX_DELAY) != pdTRUE)
+  {
+    return ESP_FAIL;
+  }
+
+  esp_err_t err = add_node(&s_first_req_node, req, CLIENT_WS, &node);
+  if (err != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Failed to add node to list", __func__);
+  }
+  else
+  {
+    client_snapshot(node, &s_encoder);
+
+    // Sent right away, a busy socket is left to the events task
+    if (client_flush(node, &s_encoder) == CLIENT_BUSY)
+    {
+      s_clients_busy = true;
+    }
+  }
+
+  xSemaphoreGive(s_req_node_mutex);
+
+  return err;
+}
+
+esp_err_t events_ws_ack(httpd_req_t *req, const ws_ack_t *ack)
+{
+  if (s_req_node_mutex == NULL || xSemaphoreTake(s_req_node_mutex, portMAX_DELAY) != pdTRUE)
+  {
+    return ESP_FAIL;
+  }
+
+  req_node_t *node = find_session(s_first_req_node, req->sess_ctx);
+  if (node == NULL || node->transport != CLIENT_WS)
+  {
+    xSemaphoreGive(s_req_node_mutex);
+    return ESP_ERR_NOT_FOUND;
+  }
+
+  if (node->ack_count == WS_ACK_QUEUE_LEN)
+  {
+    memmove(&node->acks[0], &node->acks[1], sizeof(node->acks[0]) * (WS_ACK_QUEUE_LEN - 1));
+    node->ack_count--;
+  }
+  node->acks[node->ack_count++] = *ack;
+
+  xSemaphoreGive(s_req_node_mutex);
+
+  portENTER_CRITICAL(&s_stats_lock);
+  s_stats.ws_commands++;
+  portEXIT_CRITICAL(&s_stats_lock);
+
+  // Ahead of the updates, the ack goes out on the next pass of the task
+  xQueueSendToFront(s_events_queue, &s_wake, 0);
+
+  return ESP_OK;
+}
+
+esp_err_t events_ws_control(httpd_req_t *req, httpd_ws_type_t type, const uint8_t *payload, size_t len)
+{
+  if ((type != HTTPD_WS_TYPE_PING && type != HTTPD_WS_TYPE_CLOSE) || len > WS_CONTROL_PAYLOAD_MAX_LEN)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  if (s_req_node_mutex == NULL || xSemaphoreTake(s_req_node_mutex, portMAX_DELAY) != pdTRUE)
+  {
+    return ESP_FAIL;
+  }
+
+  req_node_t *node = find_session(s_first_req_node, req->sess_ctx);
+  if (node == NULL || node->transport != CLIENT_WS)
+  {
+    xSemaphoreGive(s_req_node_mutex);
+    return ESP_ERR_NOT_FOUND;
+  }
+
+  // Only the latest PING needs its PONG, and nothing follows a CLOSE
+  if (node->control_opcode != WS_OPCODE_CLOSE && !node->closing)
+  {
+    if (type == HTTPD_WS_TYPE_CLOSE)
+    {
+      // The status code is echoed, the reason is not
+      node->control_opcode = WS_OPCODE_CLOSE;
+      node->control_len = len < 2 ? 0 : 2;
+    }
+    else
+    {
+      node->control_opcode = WS_OPCODE_PONG;
+      node->control_len = len;
+    }
+    memcpy(node->control, payload, node->control_len);
+  }
+
+  xSemaphoreGive(s_req_node_mutex);
+
+  xQueueSendToFront(s_events_queue, &s_wake, 0);
+
+  return ESP_OK;
+}
+
+esp_err_t events_get_snapshot(events_snapshot_t *snapshot)
+{
+  if (snapshot == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  if (s_req_node_mutex == NULL || xSemaphoreTake(s_req_node_mutex, portMAX_DELAY) != pdTRUE)
+  {
+    return ESP_FAIL;
+  }
+
+  *snapshot = s_snapshot;
+  snapshot->digital_outputs = 0;
+
+  xSemaphoreGive(s_req_node_mutex);
+
+  return ESP_OK;
+}
+
+uint32_t events_get_snapshot_version()
+{
+  return atomic_load_explicit(&s_snapshot_version, memory_order_acquire);
+}
+
+esp_err_t events_get_stats(events_stats_t *stats)
+{
+  if (stats == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  portENTER_CRITICAL(&s_stats_lock);
+  *stats = s_stats;
+  portEXIT_CRITICAL(&s_stats_lock);
+
+  stats->send_failures = atomic_load_explicit(&s_send_failures, memory_order_relaxed);
+  stats->queue_waiting = s_events_queue != NULL ? uxQueueMessagesWaiting(s_events_queue) : 0;
+  stats->queue_length = CONFIG_WEB_SERVER_EVENTS_QUEUE_LENGTH;
+
+  return ESP_OK;
+}
+
+esp_err_t events_get_latency(metrics_histogram_snapshot_t *latency)
+{
+  if (latency == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  metrics_histogram_read(&s_latency, latency);
+
+  return ESP_OK;
+}
+
+#if CONFIG_WEB_SERVER_TRACE
+esp_err_t events_get_trace(events_trace_stage_t stage, metrics_histogram_snapshot_t *histogram)
+{
+  if (stage >= _EVENTS_TRACE_STAGE_MAX || histogram == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  metrics_histogram_read(&s_trace[stage], histogram);
+
+  return ESP_OK;
+}
+#endif
+
+//**************************************************
+// Static Functions
+//**************************************************
+
+/**
+ * @brief Task that consumes events from the queue and sends them to all
+ *        registered SSE clients. Events arriving within the batching window
+ *        are coalesced per channel and handed to every client. While a client
+ *        still has data outstanding the queue is polled with a timeout, so its
+ *        socket is retried even when no new event arrives.
+ */
+static void events_task()
+{
+  static batch_t batch;
+  const TickType_t window = pdMS_TO_TICKS(CONFIG_WEB_SERVER_EVENTS_BATCH_WINDOW_MS);
+  const TickType_t retry = pdMS_TO_TICKS(CONFIG_WEB_SERVER_EVENTS_CLIENT_RETRY_MS);
+  event_t event;
+
+  while (1)
+  {
+    if (xQueueReceive(s_events_queue, &event, s_clients_busy ? retry : portMAX_DELAY) != pdTRUE ||
+        event.name == EVENT_NAME_WAKE)
+    {
+      // Nothing new, only write what the clients still have outstanding
+      batch_clear(&batch);
+      broadcast(&batch);
+      continue;
+    }
+
+    const int64_t start_us = esp_timer_get_time();
+    const TickType_t start = xTaskGetTickCount();
+    uint32_t received = 0;
+    batch_clear(&batch);
+
+    // 1. Collect until the window closes. The event count is bounded so a
+    //    continuous flood cannot hold the batch open forever
+    TickType_t wait;
+    do
+    {
+      // A wake needs nothing more, the broadcast writes every client
+      if (event.name != EVENT_NAME_WAKE)
+      {
+#if CONFIG_WEB_SERVER_TRACE
+        trace_dequeue(&event);
+#endif
+        received++;
+        if (!batch_add(&batch, &event, s_next_id++))
+        {
+          ESP_LOGE(TAG, "%s:Invalid event", __func__);
+        }
+      }
+
+      const TickType_t elapsed = xTaskGetTickCount() - start;
+      wait = elapsed < window ? window - elapsed : 0;
+    } while (received < CONFIG_WEB_SERVER_EVENTS_QUEUE_LENGTH && xQueueReceive(s_events_queue, &event, wait) == pdTRUE);
+
+    if (batch.count == 0)
+    {
+      continue;
+    }
+
+    // 2. Hand the batch to every client and write what their sockets accept
+    broadcast(&batch);
+
+    update_stats(&batch, received, start_us);
+  }
+
+  vTaskDelete(NULL);
+}
+
+/**
+ * @brief Stores an event in its channel slot, replacing any older update.
+ * @return false if the event does not map to a channel.
+ */
+static bool batch_add(batch_t *batch, const event_t *event, uint32_t id)
+{
+  const int slot = coalesce_slot(event);
+  if (slot < 0)
+  {
+    return false;
+  }
+
+  if (!batch->used[slot])
+  {
+    batch->used[slot] = true;
+    batch->order[batch->count++] = slot;
+  }
+
+  batch->events[slot] = *event;
+  batch->ids[slot] = id;
+  return true;
+}
+
+/**
+ * @brief Empties a batch.
+ */
+static void batch_clear(batch_t *batch)
+{
+  batch->count = 0;
+  memset(batch->used, 0, sizeof(batch->used));
+}
+
+/**
+ * @brief Maps an event to its channel slot: the digital inputs first, then
+ *        the analog inputs, then the sensor.
+ * @return The slot, or -1 for an unknown event or channel.
+ */
+static int coalesce_slot(const event_t *event)
+{
+  switch (event->name)
+  {
+  case EVENT_NAME_DIGITAL_INPUT:
+    return event->payload.digital_input.num < _DIGITAL_INPUT_NUM_MAX ? (int)event->payload.digital_input.num : -1;
+
+  case EVENT_NAME_ANALOG_INPUT:
+    return event->payload.analog_input.num < _ANALOG_INPUT_NUM_MAX ? _DIGITAL_INPUT_NUM_MAX + (int)event->payload.analog_input.num : -1;
+
+  case EVENT_NAME_SENSOR:
+    return _DIGITAL_INPUT_NUM_MAX + _ANALOG_INPUT_NUM_MAX;
+
+  default:
+    return -1;
+  }
+}
+
+/**
+ * @brief Records a batch in the history and merges it into the pending
+ *        updates of every client, then writes to each socket without blocking. Clients whose socket fails,
+ *        or that accept nothing for CONFIG_WEB_SERVER_EVENTS_CLIENT_TIMEOUT_MS,
+ *        are closed and removed from the list.
+ * @return true if a client still has data outstanding.
+ */
+static bool broadcast(const batch_t *batch)
+{
+  uint32_t coalesced = 0;
+  uint32_t stalls = 0;
+  uint32_t evicted = 0;
+  uint32_t clients = 0;
+  bool busy = false;
+
+  if (xSemaphoreTake(s_req_node_mutex, portMAX_DELAY) != pdTRUE)
+  {
+    ESP_LOGE(TAG, "%s:Fail to take req node mutex", __func__);
+    return true;
+  }
+
+  for (size_t i = 0; i < batch->count; i++)
+  {
+    const uint8_t slot = batch->order[i];
+    batch_add(&s_history, &batch->events[slot], batch->ids[slot]);
+    snapshot_update(&s_snapshot, &batch->events[slot]);
+  }
+
+  req_node_t *node = s_first_req_node;
+  while (node != NULL)
+  {
+    // 1. Queue the updates, a channel already pending is only replaced
+    for (size_t i = 0; i < batch->count; i++)
+    {
+      const uint8_t slot = batch->order[i];
+      coalesced += node->pending.used[slot];
+      batch_add(&node->pending, &batch->events[slot], batch->ids[slot]);
+    }
+
+    // 2. Write what the socket accepts
+    switch (client_flush(node, &s_encoder))
+    {
+    case CLIENT_FAILED:
+      evicted++;
+      client_evict(&node);
+      continue; // 'node' was updated by client_evict
+
+    case CLIENT_CLOSED:
+      client_evict(&node);
+      continue;
+
+    case CLIENT_BUSY:
+      stalls++;
+      busy = true;
+      break;
+
+    default:
+      break;
+    }
+
+    clients++;
+    node = node->next;
+  }
+
+  s_clients_busy = busy;
+  xSemaphoreGive(s_req_node_mutex);
+
+  portENTER_CRITICAL(&s_stats_lock);
+  s_stats.clients = clients;
+  s_stats.client_coalesced += coalesced;
+  s_stats.client_stalls += stalls;
+  s_stats.evicted += evicted;
+  portEXIT_CRITICAL(&s_stats_lock);
+
+  return busy;
+}
+
+/**
+ * @brief Writes the outstanding data of a client without blocking. When the
+ *        frame in flight is complete, a queued control reply becomes the next
+ *        one, or else the pending updates.
+ */
+static client_state_t client_flush(req_node_t *node, sse_encoder_t *encoder)
+{
+  const int64_t now_us = esp_timer_get_time();
+
+  while (1)
+  {
+    if (node->frame_sent == node->frame_len)
+    {
+      // Nothing was outstanding, the stall timeout starts over
+      node->last_progress_us = now_us;
+      if (node->closing)
+      {
+        return CLIENT_CLOSED;
+      }
+
+      if (node->control_opcode != 0)
+      {
+        client_ws_control(node);
+      }
+      else if (node->pending.count == 0 && node->ack_count == 0)
+      {
+        return CLIENT_IDLE;
+      }
+      else
+      {
+        client_frame(node, encoder);
+      }
+    }
+
+    const ssize_t sent = send(node->fd, &node->frame[node->frame_sent], node->frame_len - node->frame_sent, MSG_DONTWAIT);
+    if (sent > 0)
+    {
+      node->frame_sent += sent;
+#if CONFIG_WEB_SERVER_TRACE
+      if (node->frame_sent == node->frame_len)
+      {
+        metrics_histogram_observe(&s_trace[EVENTS_TRACE_WRITE], (uint32_t)esp_timer_get_time() - node->frame_start_us);
+      }
+#endif
+      continue;
+    }
+
+    if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+    {
+      ESP_LOGW(TAG, "%s:Client %d send failed, errno %d", __func__, node->fd, errno);
+      return CLIENT_FAILED;
+    }
+
+    if (now_us - node->last_progress_us > (int64_t)CONFIG_WEB_SERVER_EVENTS_CLIENT_TIMEOUT_MS * 1000)
+    {
+      ESP_LOGW(TAG, "%s:Client %d stalled, evicting", __func__, node->fd);
+      return CLIENT_FAILED;
+    }
+
+    return CLIENT_BUSY;
+  }
+}
+
+/**
+ * @brief Encodes the pending updates of a client as one frame, in their
+ *        order of first arrival, and empties the pending set.
+ *
+ *        SSE: one HTTP chunk. Coalescing can reorder the ids, so only the last
+ *        event carries one: the highest of the frame. A client cut off
+ *        mid-frame then resumes from the previous frame and loses nothing.
+ *
+ *        WebSocket: one binary message, the queued acks first, then the
+ *        updates. A reconnecting client starts over from the snapshot.
+ */
+static void client_frame(req_node_t *node, sse_encoder_t *encoder)
+{
+  const size_t updates = node->pending.count;
+  uint32_t last_id = 0;
+
+#if CONFIG_WEB_SERVER_TRACE
+  for (size_t i = 0; i < node->pending.count; i++)
+  {
+    trace_send(&node->pending.events[node->pending.order[i]]);
+  }
+#endif
+
+  if (node->transport == CLIENT_WS)
+  {
+    sse_encoder_reset(encoder);
+    for (size_t i = 0; i < node->ack_count; i++)
+    {
+      ws_protocol_append_ack(encoder, &node->acks[i]);
+    }
+    node->ack_count = 0;
 
-//**************************************************
-// Function Prototypes
-//**************************************************
+    for (size_t i = 0; i < node->pending.count; i++)
+    {
+      if (ws_protocol_append_event(encoder, &node->pending.events[node->pending.order[i]]) != ESP_OK)
+      {
+        ESP_LOGE(TAG, "%s:Fail to encode event", __func__);
+      }
+    }
+    batch_clear(&node->pending);
 
-static void events_task();
+    client_ws_frame(node, encoder);
 
-static esp_err_t events_handler(httpd_req_t *req);
-static esp_err_t is_req_present(req_node_t *head, httpd_req_t *req);
-static esp_err_t add_node(req_node_t **head, httpd_req_t *req);
-static httpd_req_t *pop_node(req_node_t **node);
+    portENTER_CRITICAL(&s_stats_lock);
+    s_stats.ws_updates += updates;
+    s_stats.ws_bytes += node->frame_len;
+    portEXIT_CRITICAL(&s_stats_lock);
+    return;
+  }
 
-//**************************************************
-// Globals
-//**************************************************
+  for (size_t i = 0; i < node->pending.count; i++)
+  {
+    const uint32_t id = node->pending.ids[node->pending.order[i]];
+    last_id = id > last_id ? id : last_id;
+  }
 
-static const char TAG[] = "web_server:events";
+  sse_encoder_reset(encoder);
+  for (size_t i = 0; i < node->pending.count; i++)
+  {
+    const uint32_t id = i == node->pending.count - 1 ? last_id : 0;
+    if (sse_encoder_append(encoder, &node->pending.events[node->pending.order[i]], id) != ESP_OK)
+    {
+      ESP_LOGE(TAG, "%s:Fail to encode event", __func__);
+    }
+  }
+  batch_clear(&node->pending);
 
-static const httpd_uri_t s_uri_get_events = {
-    .uri = "/api/events",
-    .method = HTTP_GET,
-    .user_ctx = NULL,
-    .handler = events_handler,
-};
+  client_chunk(node, encoder);
 
-static req_node_t *s_first_req_node = NULL;
+  portENTER_CRITICAL(&s_stats_lock);
+  s_stats.sse_updates += updates;
+  s_stats.sse_bytes += node->frame_len;
+  portEXIT_CRITICAL(&s_stats_lock);
+}
 
-static SemaphoreHandle_t s_req_node_mutex = NULL;
+/**
+ * @brief Makes the current state snapshot the frame of a client. It carries
+ *        the newest id, so a later reconnect resumes after it. Skipped if a
+ *        frame is already in flight.
+ */
+static void client_snapshot(req_node_t *node, sse_encoder_t *encoder)
+{
+  if (node->frame_sent != node->frame_len)
+  {
+    return;
+  }
 
-static QueueHandle_t s_events_queue = NULL;
+  // Outputs only change on request, their GPIO level is the state
+  s_snapshot.digital_outputs = digital_output_get_mask();
 
-//**************************************************
-// Public Functions
-//**************************************************
+  sse_encoder_reset(encoder);
 
-esp_err_t events_register(httpd_handle_t server)
-{
-  if ((s_req_node_mutex = xSemaphoreCreateMutex()) == NULL)
+  if (node->transport == CLIENT_WS)
   {
-    ESP_LOGE(TAG, "%s:Fail to create req node mutex", __func__);
-    return ESP_FAIL;
+    if (ws_protocol_append_snapshot(encoder, &s_snapshot) != ESP_OK)
+    {
+      ESP_LOGE(TAG, "%s:Fail to encode snapshot", __func__);
+      return;
+    }
+
+    client_ws_frame(node, encoder);
+    return;
   }
 
-  if ((s_events_queue = xQueueCreate(sizeof(event_t), 10)) == NULL)
+  if (sse_encoder_append_snapshot(encoder, &s_snapshot, history_newest_id()) != ESP_OK)
   {
-    ESP_LOGE(TAG, "%s:Fail to create events queue", __func__);
-    return ESP_FAIL;
+    ESP_LOGE(TAG, "%s:Fail to encode snapshot", __func__);
+    return;
   }
 
-  if (xTaskCreate(events_task, "events_task", 4096, NULL, 3, NULL) != pdTRUE)
+  client_chunk(node, encoder);
+}
+
+/**
+ * @brief Wraps the encoded frames as one HTTP chunk, the next data of a client.
+ */
+static void client_chunk(req_node_t *node, const sse_encoder_t *encoder)
+{
+  static const char hex[] = "0123456789abcdef";
+
+  // Chunk size in hex, most significant digit first
+  char *cursor = node->frame;
+  int shift = 28;
+  while (shift > 0 && ((encoder->len >> shift) & 0xF) == 0)
   {
-    ESP_LOGE(TAG, "%s:Fail to create event task", __func__);
-    return ESP_FAIL;
+    shift -= 4;
+  }
+  for (; shift >= 0; shift -= 4)
+  {
+    *cursor++ = hex[(encoder->len >> shift) & 0xF];
   }
 
-  if (httpd_register_uri_handler(server, &s_uri_get_events) != ESP_OK)
+  *cursor++ = '\r';
+  *cursor++ = '\n';
+  memcpy(cursor, encoder->buf, encoder->len);
+  cursor += encoder->len;
+  *cursor++ = '\r';
+  *cursor++ = '\n';
+
+  node->frame_len = cursor - node->frame;
+  node->frame_sent = 0;
+#if CONFIG_WEB_SERVER_TRACE
+  node->frame_start_us = (uint32_t)esp_timer_get_time();
+#endif
+}
+
+/**
+ * @brief Wraps the encoded records as one unmasked binary WebSocket message,
+ *        the next data of a client.
+ */
+static void client_ws_frame(req_node_t *node, const sse_encoder_t *encoder)
+{
+  _Static_assert(SSE_ENCODER_BUFFER_SIZE <= UINT16_MAX, "Frame length must fit the 16-bit extended length");
+  _Static_assert(WS_FRAME_HEADER_MAX_LEN <= CHUNK_OVERHEAD, "Frame must fit the client buffer");
+
+  uint8_t *cursor = (uint8_t *)node->frame;
+  *cursor++ = WS_FIN | WS_OPCODE_BINARY; // Single frame message
+
+  if (encoder->len < 126)
   {
-    ESP_LOGE(TAG, "%s:Fail to register uri handler", __func__);
-    return ESP_FAIL;
+    *cursor++ = encoder->len;
+  }
+  else
+  {
+    *cursor++ = 126;
+    *cursor++ = encoder->len >> 8;
+    *cursor++ = encoder->len & 0xFF;
   }
 
-  return ESP_OK;
+  memcpy(cursor, encoder->buf, encoder->len);
+  cursor += encoder->len;
+
+  node->frame_len = (char *)cursor - node->frame;
+  node->frame_sent = 0;
+#if CONFIG_WEB_SERVER_TRACE
+  node->frame_start_us = (uint32_t)esp_timer_get_time();
+#endif
 }
 
-esp_err_t events_send(event_t *event)
+/**
+ * @brief Makes the queued control reply the next data of a client. Control
+ *        frames go between messages, never inside one. After a CLOSE the
+ *        client is marked closing and gets nothing more.
+ */
+static void client_ws_control(req_node_t *node)
 {
-  return xQueueSend(s_events_queue, event, pdMS_TO_TICKS(250)) == pdTRUE ? ESP_OK : ESP_FAIL;
+  _Static_assert(2 + WS_CONTROL_PAYLOAD_MAX_LEN <= sizeof(((req_node_t *)0)->frame), "Control frame must fit the client buffer");
+
+  uint8_t *cursor = (uint8_t *)node->frame;
+  *cursor++ = WS_FIN | node->control_opcode;
+  *cursor++ = node->control_len;
+
+  memcpy(cursor, node->control, node->control_len);
+  cursor += node->control_len;
+
+  node->frame_len = (char *)cursor - node->frame;
+  node->frame_sent = 0;
+  node->closing = node->control_opcode == WS_OPCODE_CLOSE;
+  node->control_opcode = 0;
+#if CONFIG_WEB_SERVER_TRACE
+  node->frame_start_us = (uint32_t)esp_timer_get_time();
+#endif
 }
 
-//**************************************************
-// Static Functions
-//**************************************************
+/**
+ * @brief Closes the session of a client and removes it from the list.
+ *        Updates the pointer to the next node for iteration safety.
+ */
+static void client_evict(req_node_t **node_ptr)
+{
+  const int fd = (*node_ptr)->fd;
+  const httpd_handle_t handle = (*node_ptr)->handle;
+  httpd_req_t *req = pop_node(node_ptr);
+
+  httpd_sess_trigger_close(handle, fd);
+  if (req != NULL)
+  {
+    httpd_req_async_handler_complete(req);
+  }
+}
 
 /**
- * @brief Task that consumes events from the queue and sends them to all
- *        registered SSE clients. Handles automatic cleanup of dead connections.
+ * @brief Queues what a reconnecting client missed: every channel updated
+ *        after last_id, with its latest value. An id outside the ids of this
+ *        boot comes from before a reboot, nothing is queued then.
+ * @return true if the client needs the full state snapshot instead.
  */
-static void events_task()
+static bool client_resume(req_node_t *node, uint32_t last_id)
 {
-  static char buf[256] = "";
-  event_t event;
+  if (last_id > history_newest_id() || last_id < s_first_id - 1)
+  {
+    return true;
+  }
 
-  while (1)
+  for (size_t i = 0; i < s_history.count; i++)
   {
-    if (xQueueReceive(s_events_queue, &event, portMAX_DELAY) != pdTRUE)
+    const uint8_t slot = s_history.order[i];
+    if (s_history.ids[slot] > last_id)
     {
-      continue;
+      batch_add(&node->pending, &s_history.events[slot], s_history.ids[slot]);
+#if CONFIG_WEB_SERVER_TRACE
+      node->pending.events[slot].trace = (event_trace_t){0}; // Old times would skew the histograms
+#endif
     }
+  }
 
-    if (xSemaphoreTake(s_req_node_mutex, portMAX_DELAY) != pdTRUE)
-    {
-      ESP_LOGE(TAG, "%s:Fail to take req node mutex", __func__);
-      continue;
-    }
+  return false;
+}
 
-    // 1. Format the SSE message based on event type
-    switch (event.name)
-    {
-    case EVENT_NAME_DIGITAL_INPUT:
-      snprintf(buf, sizeof(buf),
-               "event: digital-input\n"
-               "data: {\"num\":%d, \"value\":%d}\n\n",
-               event.payload.digital_input.num, event.payload.digital_input.value);
-      break;
+/**
+ * @brief Id of the newest event in the history, 0 if there is none.
+ */
+static uint32_t history_newest_id()
+{
+  uint32_t newest_id = 0;
 
-    case EVENT_NAME_ANALOG_INPUT:
-      snprintf(buf, sizeof(buf),
-               "event: analog-input\n"
-               "data: {\"num\":%d, \"value\":%d}\n\n",
-               event.payload.analog_input.num, event.payload.analog_input.value);
-      break;
+  for (size_t i = 0; i < s_history.count; i++)
+  {
+    const uint32_t id = s_history.ids[s_history.order[i]];
+    newest_id = id > newest_id ? id : newest_id;
+  }
 
-    case EVENT_NAME_SENSOR:
-      snprintf(buf, sizeof(buf),
-               "event: analog-input\n"
-               "data: {\"num\":%d, \"value\":%f}\n\n"
-               "event: analog-input\n"
-               "data: {\"num\":%d, \"value\":%f}\n\n",
-               2, event.payload.sensor.temperature,
-               3, event.payload.sensor.humidity);
-      break;
+  return newest_id;
+}
 
-    default:
-      ESP_LOGE(TAG, "%s:Invalid event name", __func__);
-      goto end;
-    }
+/**
+ * @brief Applies an event to the state snapshot. Constant time, the
+ *        snapshot is kept current as the events go by. The version only
+ *        moves when a value actually changed.
+ */
+static void snapshot_update(events_snapshot_t *snapshot, const event_t *event)
+{
+  const events_snapshot_t before = *snapshot;
 
-    // 2. Iterate through clients and send the formatted chunk
-    req_node_t *node = s_first_req_node;
-    while (node != NULL)
-    {
-      if (httpd_resp_send_chunk(node->req, buf, HTTPD_RESP_USE_STRLEN) != ESP_OK)
-      {
-        ESP_LOGE(TAG, "%s:Fail to send chunk", __func__);
-        httpd_req_t *req = pop_node(&node);
+  switch (event->name)
+  {
+  case EVENT_NAME_DIGITAL_INPUT:
+  {
+    const uint32_t bit = 1U << event->payload.digital_input.num;
+    snapshot->digital_inputs = event->payload.digital_input.value ? snapshot->digital_inputs | bit
+                                                                  : snapshot->digital_inputs & ~bit;
+    break;
+  }
 
-        httpd_resp_send_chunk(req, NULL, 0);
-        httpd_req_async_handler_complete(req);
-        continue; // 'node' was updated by pop_node
-      }
+  case EVENT_NAME_ANALOG_INPUT:
+    snapshot->analog_inputs[event->payload.analog_input.num] = event->payload.analog_input.value;
+    snapshot->analog_valid |= 1U << event->payload.analog_input.num;
+    break;
 
-      node = node->next;
-    }
+  case EVENT_NAME_SENSOR:
+    snapshot->humidity = event->payload.sensor.humidity;
+    snapshot->temperature = event->payload.sensor.temperature;
+    snapshot->sensor_valid = true;
+    break;
 
-  end:
-    xSemaphoreGive(s_req_node_mutex);
+  default:
+    break;
   }
 
-  vTaskDelete(NULL);
+  if (memcmp(&before, snapshot, sizeof(before)) != 0)
+  {
+    atomic_fetch_add_explicit(&s_snapshot_version, 1, memory_order_release);
+  }
+}
+
+/**
+ * @brief Accounts a sent batch. The latency runs from the first event of
+ *        the batch leaving the queue to the last client write returning.
+ *        Writes never block, so a stalled client does not add to it.
+ */
+static void update_stats(const batch_t *batch, uint32_t received, int64_t start_us)
+{
+  const uint32_t latency_us = (uint32_t)(esp_timer_get_time() - start_us);
+
+  metrics_histogram_observe(&s_latency, latency_us);
+
+  portENTER_CRITICAL(&s_stats_lock);
+
+  s_stats.batches++;
+  s_stats.events += received;
+  s_stats.coalesced += received - batch->count;
+  s_stats.last_batch_size = batch->count;
+  s_stats.last_latency_us = latency_us;
+  s_stats.total_latency_us += latency_us;
+
+  if (batch->count > s_stats.max_batch_size)
+  {
+    s_stats.max_batch_size = batch->count;
+  }
+
+  if (latency_us > s_stats.max_latency_us)
+  {
+    s_stats.max_latency_us = latency_us;
+  }
+
+  portEXIT_CRITICAL(&s_stats_lock);
+}
+
+#if CONFIG_WEB_SERVER_TRACE
+/**
+ * @brief Stamps an event taken from the queue and accounts the stages up
+ *        to here, once per event, coalesced ones included.
+ */
+static void trace_dequeue(event_t *event)
+{
+  const uint32_t now_us = (uint32_t)esp_timer_get_time();
+
+  event->trace.dequeue_us = now_us;
+  metrics_histogram_observe(&s_trace[EVENTS_TRACE_ACQUIRE], event->trace.enqueue_us - event->trace.acquire_us);
+  metrics_histogram_observe(&s_trace[EVENTS_TRACE_QUEUE], now_us - event->trace.enqueue_us);
+}
+
+/**
+ * @brief Stamps an update encoded for a client and accounts the stages up
+ *        to here, once per client. Replayed updates are left out.
+ */
+static void trace_send(event_t *event)
+{
+  const uint32_t now_us = (uint32_t)esp_timer_get_time();
+
+  event->trace.send_us = now_us;
+  if (event->trace.dequeue_us == 0)
+  {
+    return;
+  }
+
+  metrics_histogram_observe(&s_trace[EVENTS_TRACE_BATCH], now_us - event->trace.dequeue_us);
+  metrics_histogram_observe(&s_trace[EVENTS_TRACE_TOTAL], now_us - event->trace.acquire_us);
 }
+#endif
 
 /**
  * @brief Handles incoming GET requests for SSE. Upgrades the connection
- *        to asynchronous and adds it to the list.
+ *        to asynchronous and adds it to the list. A new client first gets
+ *        the state snapshot, a reconnecting client sending Last-Event-ID
+ *        the updates it missed. Both come before any live event.
  */
 static esp_err_t events_handler(httpd_req_t *req)
 {
   httpd_req_t *async_req = NULL;
+  req_node_t *node = NULL;
+  char last_id_str[LAST_EVENT_ID_MAX_LEN];
+  bool resume = false;
+  uint32_t last_id = 0;
+
+  if (httpd_req_get_hdr_value_str(req, "Last-Event-ID", last_id_str, sizeof(last_id_str)) == ESP_OK)
+  {
+    char *end = NULL;
+    last_id = strtoul(last_id_str, &end, 10);
+    resume = end != last_id_str && *end == '\0';
+  }
+
+  if (session_attach(req) != ESP_OK)
+  {
+    return ESP_ERR_NO_MEM;
+  }
 
   httpd_resp_set_type(req, "text/event-stream");
   httpd_resp_set_hdr(req, "Cache-Control", "no-cache, no-transform");
@@ -190,62 +1140,230 @@ static esp_err_t events_handler(httpd_req_t *req)
     return ESP_ERR_NO_MEM;
   }
 
+  // Flushes the response headers, the events are then written straight to
+  // the socket with their own chunk framing
+  if (httpd_resp_send_chunk(async_req, ": connected\n\n", HTTPD_RESP_USE_STRLEN) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Failed to send headers", __func__);
+    goto fail;
+  }
+
   if (xSemaphoreTake(s_req_node_mutex, portMAX_DELAY) != pdTRUE)
   {
     ESP_LOGE(TAG, "%s:Fail to take mutex", __func__);
-    httpd_req_async_handler_complete(async_req);
-    httpd_resp_send_500(req);
-    return ESP_FAIL;
+    goto fail;
   }
 
-  esp_err_t err = add_node(&s_first_req_node, async_req);
-  if (err != ESP_OK)
+  if (add_node(&s_first_req_node, async_req, CLIENT_SSE, &node) != ESP_OK)
   {
     ESP_LOGE(TAG, "%s:Failed to add node to list", __func__);
-    httpd_req_async_handler_complete(async_req);
-    httpd_resp_send_500(req);
+    xSemaphoreGive(s_req_node_mutex);
+    goto fail;
+  }
+
+  const bool snapshot = resume ? client_resume(node, last_id) : true;
+  if (snapshot)
+  {
+    client_snapshot(node, &s_encoder);
+  }
+
+  // Sent right away, a busy socket is left to the events task
+  if (client_flush(node, &s_encoder) == CLIENT_BUSY)
+  {
+    s_clients_busy = true;
   }
 
+  portENTER_CRITICAL(&s_stats_lock);
+  s_stats.resumed += resume;
+  s_stats.resynced += resume && snapshot;
+  portEXIT_CRITICAL(&s_stats_lock);
+
   xSemaphoreGive(s_req_node_mutex);
 
-  return err;
+  return ESP_OK;
+
+fail:
+  // The headers are out, a status can no longer be sent: the stream is cut
+  httpd_sess_trigger_close(req->handle, httpd_req_to_sockfd(req));
+  httpd_req_async_handler_complete(async_req);
+  return ESP_FAIL;
+}
+
+/**
+ * @brief REST API Handler reporting the batch statistics as a JSON object.
+ */
+static esp_err_t events_stats_handler(httpd_req_t *req)
+{
+  events_stats_t stats;
+  events_get_stats(&stats);
+
+  const uint32_t mean_latency_us = stats.batches != 0 ? (uint32_t)(stats.total_latency_us / stats.batches) : 0;
+
+  char response[640];
+  snprintf(response, sizeof(response),
+           "{\"batches\":%" PRIu32 ",\"events\":%" PRIu32 ",\"coalesced\":%" PRIu32
+           ",\"last_batch_size\":%" PRIu32 ",\"max_batch_size\":%" PRIu32
+           ",\"last_latency_us\":%" PRIu32 ",\"max_latency_us\":%" PRIu32 ",\"mean_latency_us\":%" PRIu32
+           ",\"clients\":%" PRIu32 ",\"client_coalesced\":%" PRIu32 ",\"client_stalls\":%" PRIu32 ",\"evicted\":%" PRIu32
+           ",\"resumed\":%" PRIu32 ",\"resynced\":%" PRIu32
+           ",\"sse_updates\":%" PRIu32 ",\"sse_bytes\":%" PRIu64 ",\"ws_updates\":%" PRIu32 ",\"ws_bytes\":%" PRIu64
+           ",\"ws_commands\":%" PRIu32 ",\"send_failures\":%" PRIu32
+           ",\"queue_waiting\":%" PRIu32 ",\"queue_length\":%" PRIu32 "}",
+           stats.batches, stats.events, stats.coalesced,
+           stats.last_batch_size, stats.max_batch_size,
+           stats.last_latency_us, stats.max_latency_us, mean_latency_us,
+           stats.clients, stats.client_coalesced, stats.client_stalls, stats.evicted,
+           stats.resumed, stats.resynced,
+           stats.sse_updates, stats.sse_bytes, stats.ws_updates, stats.ws_bytes,
+           stats.ws_commands, stats.send_failures, stats.queue_waiting, stats.queue_length);
+
+  httpd_resp_set_type(req, "application/json");
+  return httpd_resp_send(req, response, HTTPD_RESP_USE_STRLEN);
+}
+
+/**
+ * @brief Gives the session of a new client its context, freed by the server
+ *        with session_closed() when the session closes. Called from the
+ *        handler, on the request of the session.
+ * @return - ESP_OK: Context set.
+ *
+ *         - ESP_ERR_NO_MEM: Out of memory.
+ */
+static esp_err_t session_attach(httpd_req_t *req)
+{
+  client_session_t *session = malloc(sizeof(client_session_t));
+  if (session == NULL)
+  {
+    ESP_LOGE(TAG, "%s:Fail to alloc session context", __func__);
+    return ESP_ERR_NO_MEM;
+  }
+
+  session->fd = httpd_req_to_sockfd(req);
+  req->sess_ctx = session;
+  req->free_ctx = session_closed;
+  return ESP_OK;
+}
+
+/**
+ * @brief Forgets the client of a session and frees its context. Called
+ *        by the server when the session closes, before its socket can be
+ *        reused. No-op if the client was already evicted.
+ */
+static void session_closed(void *ctx)
+{
+  if (xSemaphoreTake(s_req_node_mutex, portMAX_DELAY) == pdTRUE)
+  {
+    req_node_t *node = find_session(s_first_req_node, ctx);
+    if (node != NULL)
+    {
+      httpd_req_t *req = pop_node(&node);
+      if (req != NULL)
+      {
+        httpd_req_async_handler_complete(req);
+      }
+    }
+
+    xSemaphoreGive(s_req_node_mutex);
+  }
+
+  free(ctx);
+}
+
+/**
+ * @brief Removes every client. The async requests are completed only while
+ *        their server still runs, the sessions then close with it.
+ */
+static void clients_clear(bool complete)
+{
+  if (s_req_node_mutex == NULL || xSemaphoreTake(s_req_node_mutex, portMAX_DELAY) != pdTRUE)
+  {
+    return;
+  }
+
+  while (s_first_req_node != NULL)
+  {
+    req_node_t *node = s_first_req_node;
+    httpd_req_t *req = pop_node(&node);
+    if (complete && req != NULL)
+    {
+      httpd_req_async_handler_complete(req);
+    }
+  }
+  s_clients_busy = false;
+
+  xSemaphoreGive(s_req_node_mutex);
 }
 
 /**
- * @brief Checks if a request is already present in the linked list.
+ * @brief Finds the node of a socket in the linked list.
+ * @return The node, or NULL if the socket is not listed.
  */
-static esp_err_t is_req_present(req_node_t *head, httpd_req_t *req)
+static req_node_t *find_node(req_node_t *head, int fd)
 {
   req_node_t *node = head;
 
   while (node != NULL)
   {
-    if (node->req == req)
+    if (node->fd == fd)
     {
-      return ESP_OK;
+      return node;
     }
 
     node = node->next;
   }
 
-  return ESP_FAIL;
+  return NULL;
+}
+
+/**
+ * @brief Finds the node of a session in the linked list.
+ * @return The node, or NULL if the session has no client.
+ */
+static req_node_t *find_session(req_node_t *head, const client_session_t *session)
+{
+  for (req_node_t *node = head; node != NULL; node = node->next)
+  {
+    if (node->session == session)
+    {
+      return node;
+    }
+  }
+
+  return NULL;
 }
 
 /**
  * @brief Allocates and adds a new node to the head of the doubly linked list.
+ *        The node of the session, new or already listed, is returned in added.
+ *        A node still listed for the socket belongs to an earlier session
+ *        whose close was missed: it is replaced. An SSE node keeps its async
+ *        request, a WebSocket node only the socket, its handshake request
+ *        ends with the handler.
  */
-static esp_err_t add_node(req_node_t **head, httpd_req_t *req)
+static esp_err_t add_node(req_node_t **head, httpd_req_t *req, client_transport_t transport, req_node_t **added)
 {
-  if (req == NULL || head == NULL)
+  if (req == NULL || head == NULL || added == NULL)
   {
     return ESP_ERR_INVALID_ARG;
   }
 
-  if (is_req_present(*head, req) == ESP_OK)
+  if ((*added = find_session(*head, req->sess_ctx)) != NULL)
   {
     return ESP_OK;
   }
 
+  // The socket is the new session's now, the old node goes without closing it
+  req_node_t *stale = find_node(*head, httpd_req_to_sockfd(req));
+  if (stale != NULL)
+  {
+    ESP_LOGW(TAG, "%s:Replacing stale client on socket %d", __func__, stale->fd);
+    httpd_req_t *stale_req = pop_node(&stale);
+    if (stale_req != NULL)
+    {
+      httpd_req_async_handler_complete(stale_req);
+    }
+  }
+
   req_node_t *new_node = malloc(sizeof(req_node_t));
   if (new_node == NULL)
   {
@@ -253,7 +1371,19 @@ static esp_err_t add_node(req_node_t **head, httpd_req_t *req)
     return ESP_ERR_NO_MEM;
   }
 
-  new_node->req = req;
+  new_node->req = transport == CLIENT_SSE ? req : NULL;
+  new_node->session = req->sess_ctx;
+  new_node->handle = req->handle;
+  new_node->fd = httpd_req_to_sockfd(req);
+  new_node->transport = transport;
+  new_node->ack_count = 0;
+  new_node->control_len = 0;
+  new_node->control_opcode = 0;
+  new_node->closing = false;
+  new_node->frame_len = 0;
+  new_node->frame_sent = 0;
+  new_node->last_progress_us = esp_timer_get_time();
+  batch_clear(&new_node->pending);
   new_node->prev = NULL;
   new_node->next = *head;
 
@@ -263,6 +1393,7 @@ static esp_err_t add_node(req_node_t **head, httpd_req_t *req)
   }
 
   *head = new_node;
+  *added = new_node;
   return ESP_OK;
 }
 
@@ -287,6 +1418,10 @@ static httpd_req_t *pop_node(req_node_t **node_ptr)
   {
     prev_node->next = next_node;
   }
+  else if (s_first_req_node == to_remove)
+  {
+    s_first_req_node = next_node;
+  }
 
   if (next_node != NULL)
   {
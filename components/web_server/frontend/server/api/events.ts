@@ -15,6 +15,13 @@ eventsRouter.get("/events", (request, response) => {
     response.write(`data: ${JSON.stringify(data)}\n\n`);
   };
 
+  sendEvent("snapshot", {
+    digital_inputs: randomInt(0, 8),
+    digital_outputs: 0,
+    analog_inputs: [2000, 2000],
+    sensor: { temperature: 25, humidity: 60 }
+  });
+
   const digitalInterval = setInterval(() => {
     sendEvent("digital-input", {
       num: randomInt(0, 4),
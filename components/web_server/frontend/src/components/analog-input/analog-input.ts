@@ -1,10 +1,11 @@
 import "./analog-input.scss";
-import DeviceEvents, { NewAnalogStateEvent } from "../../utils/device-events";
+import DeviceEvents, { NewAnalogStateEvent, SnapshotEvent } from "../../utils/device-events";
 
 export default class AnalogInputElement extends HTMLElement {
   private path: SVGPathElement | null = null;
   private currentText: Element | null = null;
   private records: number[] = [];
+  private pending: number[] | null = null;
 
   private readonly MARGIN_LEFT = 30;
   private readonly MARGIN_RIGHT = 190;
@@ -19,10 +20,13 @@ export default class AnalogInputElement extends HTMLElement {
 
   connectedCallback() {
     this._setupGraph();
+    this._loadHistory();
+    DeviceEvents.getInstance().addEventListener("snapshot", this._handleSnapshotEvent);
     DeviceEvents.getInstance().addEventListener("analog-input", this._handleNewStateEvent);
   }
 
   disconnectedCallback() {
+    DeviceEvents.getInstance().removeEventListener("snapshot", this._handleSnapshotEvent);
     DeviceEvents.getInstance().removeEventListener("analog-input", this._handleNewStateEvent);
   }
 
@@ -61,6 +65,29 @@ export default class AnalogInputElement extends HTMLElement {
     this.appendChild(svg);
   }
 
+  /**
+   * Fills the graph with the last seconds recorded by the device, one point
+   * per second. Values arriving meanwhile are held and drawn after them.
+   */
+  private async _loadHistory() {
+    const seconds = (this.MARGIN_RIGHT - this.MARGIN_LEFT) / this.STEPS;
+    this.pending = [];
+
+    try {
+      const response = await fetch(`/api/history?ch=${this.num}&res=1s&from=-${seconds * 1000}`);
+      if (response.ok) {
+        const history: { scale: number; points: number[][] } = await response.json();
+        history.points.forEach(([, , avg]) => this.addRecord(avg / history.scale));
+      }
+    } catch (e) {
+      console.error("[AnalogInput] History unavailable:", e);
+    }
+
+    const pending = this.pending;
+    this.pending = null;
+    pending.forEach((value) => this.addRecord(value));
+  }
+
   private _createSvgElement(ns: string, tag: string, attrs: Record<string, string>) {
     const el = document.createElementNS(ns, tag);
     for (const key in attrs) el.setAttribute(key, attrs[key]);
@@ -101,8 +128,24 @@ export default class AnalogInputElement extends HTMLElement {
   get max() { return Number(this.getAttribute("max") || 100); }
   get num() { return Number(this.getAttribute("num")); }
 
+  private _handleSnapshotEvent = (data: SnapshotEvent["data"]) => {
+    // The sensor readings follow the analog inputs, temperature then humidity
+    const sensorNum = this.num - data.analog_inputs.length;
+    const value = sensorNum < 0 ? data.analog_inputs[this.num]
+      : sensorNum === 0 ? data.sensor?.temperature
+      : sensorNum === 1 ? data.sensor?.humidity
+      : undefined;
+
+    if (value !== null && value !== undefined) this._addLiveRecord(value);
+  }
+
   private _handleNewStateEvent = (data: NewAnalogStateEvent["data"]) => {
-    if (this.num === data.num) this.addRecord(data.value);
+    if (this.num === data.num) this._addLiveRecord(data.value);
+  }
+
+  private _addLiveRecord(value: number) {
+    if (this.pending) this.pending.push(value);
+    else this.addRecord(value);
   }
 }
 
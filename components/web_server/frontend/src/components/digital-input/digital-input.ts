@@ -1,4 +1,4 @@
-import DeviceEvents, { NewInputStateEvent } from "../../utils/device-events";
+import DeviceEvents, { NewInputStateEvent, SnapshotEvent } from "../../utils/device-events";
 import "./digital-input.scss";
 
 type DigitalInputState = "on" | "off" | "loading" | "warning";
@@ -11,13 +11,21 @@ export default class DigitalInputElement extends HTMLElement {
   }
 
   connectedCallback() {
-    this._loadValue();
+    this.state = "loading";
 
     const deviceEvents = DeviceEvents.getInstance();
 
+    deviceEvents.addEventListener("snapshot", this._handleSnapshotEvent);
     deviceEvents.addEventListener("digital-input", this._handleNewStateEvent);
   }
 
+  disconnectedCallback() {
+    const deviceEvents = DeviceEvents.getInstance();
+
+    deviceEvents.removeEventListener("snapshot", this._handleSnapshotEvent);
+    deviceEvents.removeEventListener("digital-input", this._handleNewStateEvent);
+  }
+
   get num() {
     const num = this.getAttribute("num");
 
@@ -43,24 +51,8 @@ export default class DigitalInputElement extends HTMLElement {
     this._state = newState;
   }
 
-  private async _loadValue() {
-    this.state = "loading";
-
-    try {
-      const result = await fetch(`/api/digital-input?id=${this.num}`);
-
-      if (!result.ok) {
-        this.state = "warning";
-        return;
-      }
-
-      const { state } = await result.json();
-
-      this.state = state ? "on" : "off";
-    } catch (error) {
-      console.error(error);
-      this.state = "warning";
-    }
+  private _handleSnapshotEvent = (data: SnapshotEvent["data"]) => {
+    this.state = data.digital_inputs & (1 << this.num) ? "on" : "off";
   }
 
   private _handleNewStateEvent = (data: NewInputStateEvent["data"]) => {
@@ -1,4 +1,5 @@
 import "./digital-output.scss";
+import DeviceEvents, { SnapshotEvent } from "../../utils/device-events";
 
 type DigitalOutputState = "on" | "off" | "loading" | "warning";
 
@@ -10,12 +11,14 @@ export default class DigitalOutputElement extends HTMLElement {
   }
 
   connectedCallback() {
-    this._loadValue();
+    this.state = "loading";
 
+    DeviceEvents.getInstance().addEventListener("snapshot", this._handleSnapshotEvent);
     this.addEventListener("click", this._handleClick);
   }
 
   disconnectedCallback() {
+    DeviceEvents.getInstance().removeEventListener("snapshot", this._handleSnapshotEvent);
     this.removeEventListener("click", this._handleClick);
   }
 
@@ -44,6 +47,10 @@ export default class DigitalOutputElement extends HTMLElement {
     this._state = newState;
   }
 
+  private _handleSnapshotEvent = (data: SnapshotEvent["data"]) => {
+    this.state = data.digital_outputs & (1 << this.num) ? "on" : "off";
+  }
+
   private _handleClick = async () => {
     switch (this.state) {
       case "on":
@@ -86,20 +93,7 @@ export default class DigitalOutputElement extends HTMLElement {
     this.state = "loading";
 
     try {
-      const result = await fetch(`/api/digital-output?id=${this.num}`, {
-        method: "POST",
-        headers: {
-          "Content-Type": "application/json"
-        },
-        body: JSON.stringify({ state: newState })
-      });
-
-      if (!result.ok) {
-        this.state = "warning";
-        return;
-      }
-
-      const { state } = await result.json();
+      const state = await DeviceEvents.getInstance().setOutput(this.num, newState);
 
       this.state = state ? "on" : "off";
     } catch (error) {
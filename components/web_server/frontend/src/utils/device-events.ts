@@ -5,23 +5,63 @@ type BaseEvent<N extends string, D extends object> = {
 
 export type NewInputStateEvent = BaseEvent<"digital-input", { num: number; value: number }>;
 export type NewAnalogStateEvent = BaseEvent<"analog-input", { num: number; value: number }>;
+export type SnapshotEvent = BaseEvent<"snapshot", {
+  digital_inputs: number;
+  digital_outputs: number;
+  analog_inputs: (number | null)[];
+  sensor: { temperature: number; humidity: number } | null;
+}>;
 
-type Events = NewInputStateEvent | NewAnalogStateEvent;
+type Events = NewInputStateEvent | NewAnalogStateEvent | SnapshotEvent;
 
 type EventData<N extends Events["name"]> = Extract<Events, { name: N }>["data"];
 
+type Listener = (data: any) => void;
+
+export type Transport = "ws" | "http";
+
+export type CommandLatency = { count: number; last_ms: number; mean_ms: number };
+
+type PendingCommand = {
+  resolve: (outputs: number) => void;
+  reject: (error: Error) => void;
+  timer: number;
+};
+
+// Binary message types of /api/ws, see ws_message_t in the firmware
+const MSG_DIGITAL_INPUT = 0x00;
+const MSG_ANALOG_INPUT = 0x01;
+const MSG_SENSOR = 0x02;
+const MSG_SNAPSHOT = 0x40;
+const MSG_ACK = 0x41;
+const CMD_SET_OUTPUT = 0x80;
+
+const STATUS_OK = 0;
+
+// The firmware publishes the sensor as these analog channels, as over SSE
+const SENSOR_TEMPERATURE_NUM = 2;
+const SENSOR_HUMIDITY_NUM = 3;
+
+const COMMAND_TIMEOUT_MS = 2000;
+const RECONNECT_MS = 2000;
+
 export default class DeviceEvents {
   private static instance: DeviceEvents;
-  private eventSource: EventSource;
-  
-  private listeners = new Map<Function, (e: MessageEvent) => void>();
+  private socket: WebSocket | null = null;
+  private eventSource: EventSource | null = null;
+
+  private listeners = new Map<string, Set<Listener>>();
+  private sseHandlers = new Map<string, (e: MessageEvent) => void>();
+
+  private pending = new Map<number, PendingCommand>();
+  private seq = 0;
+  private latency: Record<Transport, { count: number; last: number; total: number }> = {
+    ws: { count: 0, last: 0, total: 0 },
+    http: { count: 0, last: 0, total: 0 },
+  };
 
   private constructor() {
-    this.eventSource = new EventSource("/api/events");
-    
-    this.eventSource.onerror = () => {
-      console.error("EventSource: Connection failed. Retrying...");
-    };
+    this._connectWebSocket();
   }
 
   static getInstance(): DeviceEvents {
@@ -31,31 +71,274 @@ export default class DeviceEvents {
     return DeviceEvents.instance;
   }
 
+  /** Transport the events currently arrive on. */
+  get transport(): Transport {
+    return this.socket ? "ws" : "http";
+  }
+
   addEventListener<N extends Events["name"]>(
     event: N,
     callback: (data: EventData<N>) => void
   ): void {
-    const internalCallback = ({ data }: MessageEvent) => {
+    let callbacks = this.listeners.get(event);
+    if (!callbacks) {
+      callbacks = new Set();
+      this.listeners.set(event, callbacks);
+      this._listenEventSource(event);
+    }
+
+    callbacks.add(callback);
+  }
+
+  removeEventListener<N extends Events["name"]>(
+    event: N,
+    callback: (data: EventData<N>) => void
+  ): void {
+    this.listeners.get(event)?.delete(callback);
+  }
+
+  /**
+   * Switches a digital output, over the WebSocket when it is open, otherwise
+   * with a POST request. Resolves with the resulting state of the output.
+   */
+  async setOutput(num: number, state: boolean): Promise<boolean> {
+    const start = performance.now();
+    let result: boolean;
+
+    if (this.socket) {
+      const outputs = await this._sendCommand([CMD_SET_OUTPUT, 0, num, state ? 1 : 0]);
+      result = (outputs & (1 << num)) !== 0;
+      this._recordLatency("ws", start);
+    } else {
+      const response = await fetch(`/api/digital-output?id=${num}`, {
+        method: "POST",
+        headers: {
+          "Content-Type": "application/json"
+        },
+        body: JSON.stringify({ state })
+      });
+
+      if (!response.ok) {
+        throw new Error(`POST failed: ${response.status}`);
+      }
+
+      result = Boolean((await response.json()).state);
+      this._recordLatency("http", start);
+    }
+
+    return result;
+  }
+
+  /** Command round-trip times, per transport, to compare WebSocket and POST. */
+  getCommandLatency(): Record<Transport, CommandLatency> {
+    const summary = (stats: { count: number; last: number; total: number }) => ({
+      count: stats.count,
+      last_ms: stats.last,
+      mean_ms: stats.count ? stats.total / stats.count : 0,
+    });
+
+    return { ws: summary(this.latency.ws), http: summary(this.latency.http) };
+  }
+
+  private _connectWebSocket() {
+    const protocol = location.protocol === "https:" ? "wss" : "ws";
+    const socket = new WebSocket(`${protocol}://${location.host}/api/ws`);
+    let opened = false;
+
+    socket.binaryType = "arraybuffer";
+
+    socket.onopen = () => {
+      opened = true;
+      this.socket = socket;
+
+      // The socket carries the events now, drop the fallback stream
+      this.eventSource?.close();
+      this.eventSource = null;
+    };
+
+    socket.onmessage = ({ data }: MessageEvent) => {
+      if (data instanceof ArrayBuffer) {
+        this._decode(new DataView(data));
+      }
+    };
+
+    socket.onclose = () => {
+      this.socket = null;
+      this._rejectPending(new Error("WebSocket closed"));
+
+      // Until the socket is back, SSE keeps the page live
+      this._connectEventSource();
+
+      if (opened) {
+        console.error("WebSocket: Connection lost. Retrying...");
+        window.setTimeout(() => this._connectWebSocket(), RECONNECT_MS);
+      }
+    };
+  }
+
+  private _connectEventSource() {
+    if (this.eventSource) {
+      return;
+    }
+
+    this.eventSource = new EventSource("/api/events");
+    this.eventSource.onerror = () => {
+      console.error("EventSource: Connection failed. Retrying...");
+    };
+
+    this.sseHandlers.clear();
+    this.listeners.forEach((_, event) => this._listenEventSource(event));
+  }
+
+  private _listenEventSource(event: string) {
+    if (!this.eventSource || this.sseHandlers.has(event)) {
+      return;
+    }
+
+    const handler = ({ data }: MessageEvent) => {
       try {
-        const parsedData = JSON.parse(data);
-        callback(parsedData);
+        this._dispatch(event, JSON.parse(data));
       } catch (e) {
         console.error(`[DeviceEvents] Parse fail for ${event}:`, e);
       }
     };
 
-    this.listeners.set(callback, internalCallback);
-    this.eventSource.addEventListener(event, internalCallback);
+    this.sseHandlers.set(event, handler);
+    this.eventSource.addEventListener(event, handler);
   }
 
-  removeEventListener<N extends Events["name"]>(
-    event: N,
-    callback: (data: EventData<N>) => void
-  ): void {
-    const internalCallback = this.listeners.get(callback);
-    if (internalCallback) {
-      this.eventSource.removeEventListener(event, internalCallback);
-      this.listeners.delete(callback);
+  private _dispatch(event: string, data: object) {
+    this.listeners.get(event)?.forEach((callback) => callback(data));
+  }
+
+  /**
+   * Decodes a binary message: records back to back, each starting with its
+   * type byte. Multi-byte fields are little-endian.
+   */
+  private _decode(view: DataView) {
+    let offset = 0;
+
+    while (offset < view.byteLength) {
+      const type = view.getUint8(offset++);
+
+      switch (type) {
+        case MSG_DIGITAL_INPUT:
+          this._dispatch("digital-input", { num: view.getUint8(offset), value: view.getUint8(offset + 1) });
+          offset += 2;
+          break;
+
+        case MSG_ANALOG_INPUT:
+          this._dispatch("analog-input", { num: view.getUint8(offset), value: view.getUint16(offset + 1, true) });
+          offset += 3;
+          break;
+
+        case MSG_SENSOR: {
+          const humidity = view.getFloat32(offset, true);
+          const temperature = view.getFloat32(offset + 4, true);
+          this._dispatch("analog-input", { num: SENSOR_TEMPERATURE_NUM, value: round2(temperature) });
+          this._dispatch("analog-input", { num: SENSOR_HUMIDITY_NUM, value: round2(humidity) });
+          offset += 8;
+          break;
+        }
+
+        case MSG_SNAPSHOT: {
+          const digitalInputs = view.getUint32(offset, true);
+          const digitalOutputs = view.getUint32(offset + 4, true);
+          const analogValid = view.getUint32(offset + 8, true);
+          const count = view.getUint8(offset + 12);
+          offset += 13;
+
+          const analogInputs: (number | null)[] = [];
+          for (let i = 0; i < count; i++, offset += 2) {
+            analogInputs.push(analogValid & (1 << i) ? view.getUint16(offset, true) : null);
+          }
+
+          const sensorValid = view.getUint8(offset) !== 0;
+          const humidity = view.getFloat32(offset + 1, true);
+          const temperature = view.getFloat32(offset + 5, true);
+          offset += 9;
+
+          this._dispatch("snapshot", {
+            digital_inputs: digitalInputs,
+            digital_outputs: digitalOutputs,
+            analog_inputs: analogInputs,
+            sensor: sensorValid ? { temperature: round2(temperature), humidity: round2(humidity) } : null,
+          });
+          break;
+        }
+
+        case MSG_ACK: {
+          const seq = view.getUint8(offset);
+          const status = view.getUint8(offset + 1);
+          const outputs = view.getUint32(offset + 2, true);
+          offset += 6;
+          this._settle(seq, status, outputs);
+          break;
+        }
+
+        default:
+          console.error(`[DeviceEvents] Unknown message type ${type}`);
+          return;
+      }
+    }
+  }
+
+  private _sendCommand(bytes: number[]): Promise<number> {
+    const socket = this.socket;
+    if (!socket) {
+      return Promise.reject(new Error("WebSocket closed"));
+    }
+
+    const seq = this.seq;
+    this.seq = (this.seq + 1) & 0xff;
+
+    const frame = new Uint8Array(bytes);
+    frame[1] = seq;
+
+    return new Promise((resolve, reject) => {
+      const timer = window.setTimeout(() => {
+        this.pending.delete(seq);
+        reject(new Error("Command timed out"));
+      }, COMMAND_TIMEOUT_MS);
+
+      this.pending.set(seq, { resolve, reject, timer });
+      socket.send(frame);
+    });
+  }
+
+  private _settle(seq: number, status: number, outputs: number) {
+    const command = this.pending.get(seq);
+    if (!command) {
+      return;
+    }
+
+    window.clearTimeout(command.timer);
+    this.pending.delete(seq);
+
+    if (status === STATUS_OK) {
+      command.resolve(outputs);
+    } else {
+      command.reject(new Error(`Command failed with status ${status}`));
     }
   }
-}
\ No newline at end of file
+
+  private _rejectPending(error: Error) {
+    this.pending.forEach((command) => {
+      window.clearTimeout(command.timer);
+      command.reject(error);
+    });
+    this.pending.clear();
+  }
+
+  private _recordLatency(transport: Transport, start: number) {
+    const stats = this.latency[transport];
+    stats.last = performance.now() - start;
+    stats.total += stats.last;
+    stats.count++;
+    console.debug(`[DeviceEvents] ${transport} command round trip ${stats.last.toFixed(1)} ms`);
+  }
+}
+
+function round2(value: number) {
+  return Math.round(value * 100) / 100;
+}
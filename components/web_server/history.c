@@ -0,0 +1,183 @@
+#include "web_server_internals.h"
+#include "esp_http_server.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "history.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//**************************************************
+// Defines
+//**************************************************
+
+#define READ_POINTS 16      // Points copied per history_read() call
+#define CHUNK_SIZE 512      // Response chunk, flushed before a point could overflow it
+#define POINT_MAX_LEN 64    // Longest encoded point: "[t,min,avg,max],"
+
+//**************************************************
+// Function Prototypes
+//**************************************************
+
+static esp_err_t get_history_handler(httpd_req_t *req);
+static bool parse_res(const char *str, history_res_t *res);
+
+//**************************************************
+// Globals
+//**************************************************
+
+static const char TAG[] = "web_server:history";
+
+static const httpd_uri_t s_uri_get_history = {
+    .uri = "/api/history",
+    .method = HTTP_GET,
+    .user_ctx = NULL,
+    .handler = get_history_handler,
+};
+
+static const char *const s_res_names[_HISTORY_RES_MAX] = {
+    [HISTORY_RES_RAW] = "raw",
+    [HISTORY_RES_SECOND] = "1s",
+    [HISTORY_RES_MINUTE] = "1m",
+};
+
+//**************************************************
+// Public Functions
+//**************************************************
+
+esp_err_t history_register(httpd_handle_t server)
+{
+  if (httpd_register_uri_handler(server, &s_uri_get_history) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Fail to register uri handler", __func__);
+    return ESP_FAIL;
+  }
+
+  return ESP_OK;
+}
+
+//**************************************************
+// Static Functions
+//**************************************************
+
+/**
+ * @brief REST API Handler streaming a range of a history tier.
+ *        Expects query params: ?ch=X, optional &res=raw|1s|1m (default raw)
+ *        and &from=T, in ms since boot, or before now when negative.
+ *        Responds with {"ch":X,"res":"1s","period_ms":1000,"scale":1,
+ *        "now":T,"points":[[t,min,avg,max],...]}, raw points as [t,value].
+ *        Values divided by scale give the unit of the channel. The points
+ *        are read and sent a few at a time, the range is never held whole.
+ */
+static esp_err_t get_history_handler(httpd_req_t *req)
+{
+  char query[96], ch_str[8], res_str[8], from_str[24];
+  history_res_t res = HISTORY_RES_RAW;
+  int64_t from_ms = INT64_MIN;
+
+  if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+      httpd_query_key_value(query, "ch", ch_str, sizeof(ch_str)) != ESP_OK)
+  {
+    return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing channel");
+  }
+
+  const int ch = atoi(ch_str);
+  if (ch < 0 || ch >= _HISTORY_CH_MAX)
+  {
+    return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid channel");
+  }
+
+  if (httpd_query_key_value(query, "res", res_str, sizeof(res_str)) == ESP_OK && !parse_res(res_str, &res))
+  {
+    return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid resolution");
+  }
+
+  const int64_t now_ms = esp_timer_get_time() / 1000;
+  if (httpd_query_key_value(query, "from", from_str, sizeof(from_str)) == ESP_OK)
+  {
+    from_ms = strtoll(from_str, NULL, 10);
+    if (from_ms < 0)
+    {
+      from_ms += now_ms;
+    }
+  }
+
+  history_cursor_t cursor;
+  history_cursor_init(&cursor, from_ms);
+
+  char chunk[CHUNK_SIZE];
+  int len = snprintf(chunk, sizeof(chunk),
+                     "{\"ch\":%d,\"res\":\"%s\",\"period_ms\":%" PRIu32 ",\"scale\":%d,\"now\":%" PRId64 ",\"points\":[",
+                     ch, s_res_names[res], history_period_ms(res), ch >= HISTORY_CH_TEMPERATURE ? 100 : 1, now_ms);
+
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+
+  history_point_t points[READ_POINTS];
+  size_t count;
+  bool first = true;
+
+  do
+  {
+    if (history_read((history_ch_t)ch, res, &cursor, points, READ_POINTS, &count) != ESP_OK)
+    {
+      ESP_LOGE(TAG, "%s:Fail to read history", __func__);
+      break;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+      const history_point_t *point = &points[i];
+
+      if (len > CHUNK_SIZE - POINT_MAX_LEN)
+      {
+        if (httpd_resp_send_chunk(req, chunk, len) != ESP_OK)
+        {
+          return ESP_FAIL;
+        }
+        len = 0;
+      }
+
+      if (res == HISTORY_RES_RAW)
+      {
+        len += snprintf(chunk + len, sizeof(chunk) - len, "%s[%" PRId64 ",%d]",
+                        first ? "" : ",", point->time_ms, point->avg);
+      }
+      else
+      {
+        len += snprintf(chunk + len, sizeof(chunk) - len, "%s[%" PRId64 ",%d,%d,%d]",
+                        first ? "" : ",", point->time_ms, point->min, point->avg, point->max);
+      }
+
+      first = false;
+    }
+  } while (count == READ_POINTS);
+
+  len += snprintf(chunk + len, sizeof(chunk) - len, "]}");
+
+  if (httpd_resp_send_chunk(req, chunk, len) != ESP_OK)
+  {
+    return ESP_FAIL;
+  }
+
+  return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+/**
+ * @brief Maps a resolution name of the query to its tier.
+ * @return false if the name is unknown.
+ */
+static bool parse_res(const char *str, history_res_t *res)
+{
+  for (size_t i = 0; i < _HISTORY_RES_MAX; i++)
+  {
+    if (strcmp(str, s_res_names[i]) == 0)
+    {
+      *res = (history_res_t)i;
+      return true;
+    }
+  }
+
+  return false;
+}
@@ -0,0 +1,337 @@
+#include "web_server_internals.h"
+#include "unity.h"
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+//**************************************************
+// Defines
+//**************************************************
+
+#define ENCODES 200000 // Per benchmark run
+#define BATCHES 20000  // Per batch benchmark run
+#define SENSOR_STEPS 100000
+
+//**************************************************
+// Function Prototypes
+//**************************************************
+
+static size_t snprintf_event(char *buf, size_t size, const event_t *event);
+static void expect_frame(const event_t *event, const char *expected);
+static const char *find_value(const char *frame, const char *after, int num);
+static event_t make_event(event_name_t name, uint32_t n);
+static event_name_t stream_name(uint32_t n);
+static int64_t clock_ns(void);
+
+//**************************************************
+// Globals
+//**************************************************
+
+static sse_encoder_t s_encoder;
+static char s_buf[SSE_ENCODER_BUFFER_SIZE];
+
+//**************************************************
+// Tests
+//**************************************************
+
+void setUp(void)
+{
+  sse_encoder_reset(&s_encoder);
+}
+
+void tearDown(void)
+{
+}
+
+/**
+ * @brief Digital and analog frames match the snprintf output byte for
+ *        byte, with and without an id.
+ */
+static void test_integer_frames(void)
+{
+  const event_t digital = {.name = EVENT_NAME_DIGITAL_INPUT, .payload.digital_input = {.num = 3, .value = true}};
+  const event_t analog = {.name = EVENT_NAME_ANALOG_INPUT, .payload.analog_input = {.num = 1, .value = 65535}};
+  const event_t zero = {.name = EVENT_NAME_ANALOG_INPUT, .payload.analog_input = {.num = 0, .value = 0}};
+
+  expect_frame(&digital, "event: digital-input\ndata: {\"num\":3, \"value\":1}\n\n");
+  expect_frame(&analog, "event: analog-input\ndata: {\"num\":1, \"value\":65535}\n\n");
+  expect_frame(&zero, "event: analog-input\ndata: {\"num\":0, \"value\":0}\n\n");
+
+  sse_encoder_reset(&s_encoder);
+  TEST_ASSERT_EQUAL(ESP_OK, sse_encoder_append(&s_encoder, &digital, 4294967295U));
+  s_encoder.buf[s_encoder.len] = '\0';
+  TEST_ASSERT_EQUAL_STRING("id: 4294967295\nevent: digital-input\ndata: {\"num\":3, \"value\":1}\n\n", s_encoder.buf);
+
+  const event_t invalid = {.name = EVENT_NAME_SENSOR + 1};
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, sse_encoder_append(&s_encoder, &invalid, 0));
+}
+
+/**
+ * @brief Sensor values come out with two decimals, within half a digit of
+ *        the snprintf value, over the whole sensor range and both signs.
+ */
+static void test_sensor_values(void)
+{
+  char expected[32];
+
+  for (int step = 0; step < SENSOR_STEPS; step++)
+  {
+    const float value = -40.0f + step * (165.0f / SENSOR_STEPS) + 0.0013f;
+    const event_t event = {.name = EVENT_NAME_SENSOR, .payload.sensor = {.temperature = value, .humidity = -value}};
+
+    sse_encoder_reset(&s_encoder);
+    TEST_ASSERT_EQUAL(ESP_OK, sse_encoder_append(&s_encoder, &event, 0));
+    s_encoder.buf[s_encoder.len] = '\0';
+
+    const char *temperature = find_value(s_encoder.buf, "\"num\":", 2);
+    const char *humidity = find_value(s_encoder.buf, "\"num\":", 3);
+    TEST_ASSERT_NOT_NULL(temperature);
+    TEST_ASSERT_NOT_NULL(humidity);
+
+    snprintf(expected, sizeof(expected), "%.2f", value);
+    const double error = strtod(temperature, NULL) - strtod(expected, NULL);
+    TEST_ASSERT_TRUE(error <= 0.011 && error >= -0.011);
+    TEST_ASSERT_TRUE(strtod(temperature, NULL) == -strtod(humidity, NULL));
+    TEST_ASSERT_EQUAL('.', strchr(temperature, '.')[0]);
+    TEST_ASSERT_EQUAL('}', strchr(temperature, '.')[3]);
+  }
+}
+
+/**
+ * @brief NaN and infinities come out as null, huge magnitudes clamp, both
+ *        within the frame bound.
+ */
+static void test_sensor_non_finite(void)
+{
+  const event_t nan_event = {.name = EVENT_NAME_SENSOR, .payload.sensor = {.temperature = NAN, .humidity = -INFINITY}};
+  const event_t huge = {.name = EVENT_NAME_SENSOR, .payload.sensor = {.temperature = -1e30f, .humidity = INFINITY}};
+
+  sse_encoder_reset(&s_encoder);
+  TEST_ASSERT_EQUAL(ESP_OK, sse_encoder_append(&s_encoder, &nan_event, 0));
+  s_encoder.buf[s_encoder.len] = '\0';
+  TEST_ASSERT_EQUAL_STRING("event: analog-input\ndata: {\"num\":2, \"value\":null}\n\n"
+                           "event: analog-input\ndata: {\"num\":3, \"value\":null}\n\n",
+                           s_encoder.buf);
+
+  sse_encoder_reset(&s_encoder);
+  TEST_ASSERT_EQUAL(ESP_OK, sse_encoder_append(&s_encoder, &huge, 0));
+  s_encoder.buf[s_encoder.len] = '\0';
+  TEST_ASSERT_EQUAL_STRING("event: analog-input\ndata: {\"num\":2, \"value\":-42949672.95}\n\n"
+                           "event: analog-input\ndata: {\"num\":3, \"value\":null}\n\n",
+                           s_encoder.buf);
+  TEST_ASSERT_TRUE(s_encoder.len <= SSE_ENCODER_EVENT_MAX_LEN);
+}
+
+/**
+ * @brief Cost of one frame, snprintf as the events task formatted it before
+ *        the encoder, against the encoder.
+ */
+static void test_benchmark_event(void)
+{
+  static const event_name_t names[] = {EVENT_NAME_DIGITAL_INPUT, EVENT_NAME_ANALOG_INPUT, EVENT_NAME_SENSOR};
+  static const char *labels[] = {"digital", "analog", "sensor"};
+
+  printf("%8s %14s %14s %8s\n", "event", "snprintf ns", "encoder ns", "speedup");
+
+  for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+  {
+    size_t bytes = 0;
+
+    int64_t start = clock_ns();
+    for (uint32_t n = 0; n < ENCODES; n++)
+    {
+      const event_t event = make_event(names[i], n);
+      bytes += snprintf_event(s_buf, SSE_ENCODER_EVENT_MAX_LEN, &event);
+    }
+    const int64_t snprintf_ns = clock_ns() - start;
+
+    start = clock_ns();
+    for (uint32_t n = 0; n < ENCODES; n++)
+    {
+      const event_t event = make_event(names[i], n);
+      sse_encoder_reset(&s_encoder);
+      sse_encoder_append(&s_encoder, &event, 0);
+      bytes += s_encoder.len;
+    }
+    const int64_t encoder_ns = clock_ns() - start;
+
+    TEST_ASSERT_TRUE(bytes > 0);
+    printf("%8s %14.1f %14.1f %7.1fx\n", labels[i], (double)snprintf_ns / ENCODES, (double)encoder_ns / ENCODES,
+           (double)snprintf_ns / encoder_ns);
+  }
+}
+
+/**
+ * @brief Cost of a full coalesced batch, one frame per slot with its id,
+ *        appended into the client buffer.
+ */
+static void test_benchmark_batch(void)
+{
+  int64_t start = clock_ns();
+  for (uint32_t b = 0; b < BATCHES; b++)
+  {
+    size_t len = 0;
+    for (uint32_t n = 0; n < EVENTS_COALESCE_SLOTS; n++)
+    {
+      const event_t event = make_event(stream_name(b + n), b + n);
+      len += snprintf(&s_buf[len], sizeof(s_buf) - len, "id: %" PRIu32 "\n", b * EVENTS_COALESCE_SLOTS + n + 1);
+      len += snprintf_event(&s_buf[len], sizeof(s_buf) - len, &event);
+    }
+    TEST_ASSERT_TRUE(len < sizeof(s_buf));
+  }
+  const int64_t snprintf_ns = clock_ns() - start;
+
+  start = clock_ns();
+  for (uint32_t b = 0; b < BATCHES; b++)
+  {
+    sse_encoder_reset(&s_encoder);
+    for (uint32_t n = 0; n < EVENTS_COALESCE_SLOTS; n++)
+    {
+      const event_t event = make_event(stream_name(b + n), b + n);
+      TEST_ASSERT_EQUAL(ESP_OK, sse_encoder_append(&s_encoder, &event, b * EVENTS_COALESCE_SLOTS + n + 1));
+    }
+  }
+  const int64_t encoder_ns = clock_ns() - start;
+
+  printf("batch of %d: snprintf %.2f us, encoder %.2f us, %zu bytes, %.1fx\n", EVENTS_COALESCE_SLOTS,
+         (double)snprintf_ns / BATCHES / 1000, (double)encoder_ns / BATCHES / 1000, s_encoder.len,
+         (double)snprintf_ns / encoder_ns);
+}
+
+void app_main(void)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_integer_frames);
+  RUN_TEST(test_sensor_values);
+  RUN_TEST(test_sensor_non_finite);
+  RUN_TEST(test_benchmark_event);
+  RUN_TEST(test_benchmark_batch);
+  exit(UNITY_END());
+}
+
+//**************************************************
+// Static Functions
+//**************************************************
+
+/**
+ * @brief Formats an event as the events task did before the encoder.
+ * @return Bytes written, without the terminator.
+ */
+static size_t snprintf_event(char *buf, size_t size, const event_t *event)
+{
+  int len = 0;
+
+  switch (event->name)
+  {
+  case EVENT_NAME_DIGITAL_INPUT:
+    len = snprintf(buf, size,
+                   "event: digital-input\n"
+                   "data: {\"num\":%d, \"value\":%d}\n\n",
+                   event->payload.digital_input.num, event->payload.digital_input.value);
+    break;
+
+  case EVENT_NAME_ANALOG_INPUT:
+    len = snprintf(buf, size,
+                   "event: analog-input\n"
+                   "data: {\"num\":%d, \"value\":%d}\n\n",
+                   event->payload.analog_input.num, event->payload.analog_input.value);
+    break;
+
+  case EVENT_NAME_SENSOR:
+    len = snprintf(buf, size,
+                   "event: analog-input\n"
+                   "data: {\"num\":%d, \"value\":%f}\n\n"
+                   "event: analog-input\n"
+                   "data: {\"num\":%d, \"value\":%f}\n\n",
+                   2, event->payload.sensor.temperature,
+                   3, event->payload.sensor.humidity);
+    break;
+  }
+
+  return len > 0 ? (size_t)len : 0;
+}
+
+/**
+ * @brief Encodes one event without an id and checks the frame text.
+ */
+static void expect_frame(const event_t *event, const char *expected)
+{
+  char reference[SSE_ENCODER_EVENT_MAX_LEN];
+
+  sse_encoder_reset(&s_encoder);
+  TEST_ASSERT_EQUAL(ESP_OK, sse_encoder_append(&s_encoder, event, 0));
+  s_encoder.buf[s_encoder.len] = '\0';
+
+  snprintf_event(reference, sizeof(reference), event);
+  TEST_ASSERT_EQUAL_STRING(expected, s_encoder.buf);
+  TEST_ASSERT_EQUAL_STRING(reference, s_encoder.buf);
+}
+
+/**
+ * @brief Value field of the frame of an input, or NULL.
+ */
+static const char *find_value(const char *frame, const char *after, int num)
+{
+  char key[32];
+  snprintf(key, sizeof(key), "%s%d, \"value\":", after, num);
+
+  const char *found = strstr(frame, key);
+  return found != NULL ? found + strlen(key) : NULL;
+}
+
+/**
+ * @brief Event of a type with values that change with n.
+ */
+static event_t make_event(event_name_t name, uint32_t n)
+{
+  event_t event = {.name = name};
+
+  switch (name)
+  {
+  case EVENT_NAME_DIGITAL_INPUT:
+    event.payload.digital_input.num = n % _DIGITAL_INPUT_NUM_MAX;
+    event.payload.digital_input.value = n & 1;
+    break;
+
+  case EVENT_NAME_ANALOG_INPUT:
+    event.payload.analog_input.num = n % _ANALOG_INPUT_NUM_MAX;
+    event.payload.analog_input.value = (n * 37) % 4096;
+    break;
+
+  case EVENT_NAME_SENSOR:
+    event.payload.sensor.temperature = 21.5f + (n % 100) * 0.01f;
+    event.payload.sensor.humidity = 45.0f + (n % 300) * 0.1f;
+    break;
+  }
+
+  return event;
+}
+
+/**
+ * @brief Type of event n of a mixed stream: mostly digital and analog
+ *        updates, a sensor reading now and then.
+ */
+static event_name_t stream_name(uint32_t n)
+{
+  switch (n % 8)
+  {
+  case 0:
+    return EVENT_NAME_SENSOR;
+  case 1:
+  case 2:
+  case 3:
+    return EVENT_NAME_DIGITAL_INPUT;
+  default:
+    return EVENT_NAME_ANALOG_INPUT;
+  }
+}
+
+static int64_t clock_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
@@ -1,9 +1,73 @@
 #pragma once
 
 #include "esp_err.h"
-#include "esp_http_server.h"
+#include "sdkconfig.h"
 #include "stdbool.h"
+#include <stdatomic.h>
 #include "digital_input.h"
+#include "analog_input.h"
+
+#if !CONFIG_IDF_TARGET_LINUX
+#include "esp_http_server.h"
+#endif
+
+//**************************************************
+// Defines
+//**************************************************
+
+/**
+ * @brief Upper bound of the "trace" field added to an SSE frame:
+ *        ,"trace":[ then four uint32 and their separators.
+ */
+#if CONFIG_WEB_SERVER_TRACE_SSE
+#define SSE_ENCODER_TRACE_MAX_LEN 56
+#else
+#define SSE_ENCODER_TRACE_MAX_LEN 0
+#endif
+
+/**
+ * @brief Upper bound of the SSE frames produced for any single event,
+ *        the sensor produces two.
+ */
+#define SSE_ENCODER_EVENT_MAX_LEN (160 + 2 * SSE_ENCODER_TRACE_MAX_LEN)
+
+/**
+ * @brief Upper bound of the SSE frame of a state snapshot.
+ */
+#define SSE_ENCODER_SNAPSHOT_MAX_LEN (224 + _ANALOG_INPUT_NUM_MAX * 6)
+
+/**
+ * @brief Distinct channels an event batch can hold after coalescing:
+ *        every digital input, every analog input and the sensor.
+ */
+#define EVENTS_COALESCE_SLOTS (_DIGITAL_INPUT_NUM_MAX + _ANALOG_INPUT_NUM_MAX + 1)
+
+/**
+ * @brief Capacity of an SSE encoder output buffer, a full coalesced batch fits.
+ */
+#define SSE_ENCODER_BUFFER_SIZE (EVENTS_COALESCE_SLOTS * SSE_ENCODER_EVENT_MAX_LEN)
+
+/**
+ * @brief Upper bound of the WebSocket frame header written by the server:
+ *        FIN/opcode byte, length byte and a 16-bit extended length.
+ */
+#define WS_FRAME_HEADER_MAX_LEN 4
+
+/**
+ * @brief Command acknowledgements a WebSocket client can have waiting for
+ *        its next frame. Beyond that the oldest is dropped.
+ */
+#define WS_ACK_QUEUE_LEN 8
+
+/**
+ * @brief Longest payload of a WebSocket control frame, RFC 6455 5.5.
+ */
+#define WS_CONTROL_PAYLOAD_MAX_LEN 125
+
+/**
+ * @brief Buckets of a latency histogram, 100 us to 250 ms and above.
+ */
+#define METRICS_HISTOGRAM_BUCKETS 12
 
 //**************************************************
 // Typedefs
@@ -34,7 +98,7 @@ typedef struct __attribute__((packed))
  */
 typedef struct __attribute__((packed))
 {
-  digital_input_num_t num;
+  analog_input_num_t num;
   uint16_t value;
 } analog_input_payload_t;
 
@@ -47,6 +111,34 @@ typedef struct __attribute__((packed))
   float temperature;
 } sensor_payload_t;
 
+#if CONFIG_WEB_SERVER_TRACE
+/**
+ * @brief Times an event went through each stage, in us, low 32 bits of
+ *        esp_timer: differences stay right across the wrap. An event
+ *        replayed from the history has them all 0 and is not measured.
+ */
+typedef struct __attribute__((packed))
+{
+  uint32_t acquire_us; /**< Driver read the input: GPIO edge, ADC frame or sensor reading */
+  uint32_t enqueue_us; /**< events_send() queued it */
+  uint32_t dequeue_us; /**< The events task took it from the queue */
+  uint32_t send_us;    /**< Encoded in the frame of a client, written right after */
+} event_trace_t;
+
+/**
+ * @brief Stages measured by the trace histograms, see events_get_trace().
+ */
+typedef enum
+{
+  EVENTS_TRACE_ACQUIRE = 0, /**< Acquisition to queued: filters, dispatcher and observers */
+  EVENTS_TRACE_QUEUE,       /**< Queued to taken by the events task */
+  EVENTS_TRACE_BATCH,       /**< Taken to encoded for a client: batching window and busy sockets */
+  EVENTS_TRACE_WRITE,       /**< Client frame encoded to its last byte accepted by the socket */
+  EVENTS_TRACE_TOTAL,       /**< Acquisition to encoded for a client */
+  _EVENTS_TRACE_STAGE_MAX,
+} events_trace_stage_t;
+#endif
+
 /**
  * @brief Unified event structure for the internal broadcast system.
  *        Uses a union to optimize memory usage by overlaying different
@@ -62,12 +154,191 @@ typedef struct __attribute__((packed))
     analog_input_payload_t analog_input;
     sensor_payload_t sensor;
   } payload;
+
+#if CONFIG_WEB_SERVER_TRACE
+  event_trace_t trace; /**< Set by the bridge (acquire_us) and the events module */
+#endif
 } event_t;
 
+/**
+ * @brief State of every channel, sent to a client when it connects.
+ */
+typedef struct
+{
+  uint32_t digital_inputs;                        /**< Bit n set while digital input n is on */
+  uint32_t digital_outputs;                       /**< Bit n set while digital output n is on */
+  uint16_t analog_inputs[_ANALOG_INPUT_NUM_MAX]; /**< Last value of each analog input */
+  uint32_t analog_valid;                          /**< Bit n set once analog input n reported */
+  float humidity;                                 /**< Last sensor humidity */
+  float temperature;                              /**< Last sensor temperature */
+  bool sensor_valid;                              /**< The sensor reported */
+} events_snapshot_t;
+
+/**
+ * @brief Statistics of the SSE broadcast batches.
+ */
+typedef struct
+{
+  uint32_t batches;          /**< Batches sent */
+  uint32_t events;           /**< Events taken from the queue */
+  uint32_t coalesced;        /**< Events replaced by a newer update of the same channel */
+  uint32_t last_batch_size;  /**< Events sent in the last batch */
+  uint32_t max_batch_size;   /**< Largest batch sent */
+  uint32_t last_latency_us;  /**< First event received to batch sent, last batch */
+  uint32_t max_latency_us;   /**< Largest batch latency */
+  uint64_t total_latency_us; /**< Sum of the batch latencies, for the mean */
+  uint32_t clients;          /**< SSE clients connected after the last pass */
+  uint32_t client_coalesced; /**< Updates replaced while waiting on a slow client */
+  uint32_t client_stalls;    /**< Client passes that left data outstanding */
+  uint32_t evicted;          /**< Clients closed after a send error or stall timeout */
+  uint32_t resumed;          /**< Clients reconnected with a Last-Event-ID */
+  uint32_t resynced;         /**< Resumed clients sent the snapshot, their id predates the history */
+  uint32_t sse_updates;      /**< Updates written to SSE clients, one per client */
+  uint64_t sse_bytes;        /**< Bytes of the SSE frames, chunk framing included */
+  uint32_t ws_updates;       /**< Updates written to WebSocket clients, one per client */
+  uint64_t ws_bytes;         /**< Bytes of the WebSocket frames, frame headers included */
+  uint32_t ws_commands;      /**< Commands received over WebSocket */
+  uint32_t send_failures;    /**< events_send() calls that found the queue full */
+  uint32_t queue_waiting;    /**< Events in the queue when the stats were read */
+  uint32_t queue_length;     /**< Capacity of the queue */
+} events_stats_t;
+
+/**
+ * @brief Latency histogram updated lock-free from the hot paths. Bucket n
+ *        counts the observations up to metrics_histogram_bounds_us[n], the
+ *        last one those above every bound.
+ */
+typedef struct
+{
+  _Atomic uint32_t counts[METRICS_HISTOGRAM_BUCKETS];
+  _Atomic uint64_t sum_us;
+  _Atomic uint32_t count;
+} metrics_histogram_t;
+
+/**
+ * @brief Plain copy of a histogram, see metrics_histogram_read().
+ */
+typedef struct
+{
+  uint32_t counts[METRICS_HISTOGRAM_BUCKETS];
+  uint64_t sum_us;
+  uint32_t count;
+} metrics_histogram_snapshot_t;
+
+/**
+ * @brief An embedded frontend file, from the table generated at build time
+ *        by tools/embed_assets.py.
+ */
+typedef struct
+{
+  const char *path;       /**< Request path, "/index.html" */
+  const char *type;       /**< MIME type */
+  const uint8_t *data;    /**< Plain bytes */
+  size_t len;             /**< Plain size */
+  const char *etag;       /**< Strong ETag of the plain bytes, quoted */
+  const uint8_t *gz_data; /**< Gzipped bytes, NULL when gzip does not shrink the file */
+  size_t gz_len;          /**< Gzipped size */
+  const char *gz_etag;    /**< Strong ETag of the gzipped bytes, quoted */
+} web_asset_t;
+
+/**
+ * @brief Type byte of the binary WebSocket messages. Input updates use their
+ *        event_name_t value, so a record mirrors event_t:
+ *
+ *        - digital input: type, num, value (0/1).
+ *
+ *        - analog input: type, num, value (uint16).
+ *
+ *        - sensor: type, humidity (float), temperature (float).
+ *
+ *        Multi-byte fields are little-endian. Commands come from the client
+ *        and each is answered by an ack carrying its sequence number.
+ */
+typedef enum : uint8_t
+{
+  WS_MSG_SNAPSHOT = 0x40,   /**< di mask u32, do mask u32, analog valid u32, count u8, count x u16, sensor valid u8, humidity, temperature */
+  WS_MSG_ACK = 0x41,        /**< seq u8, ws_status_t u8, output mask u32 */
+  WS_CMD_SET_OUTPUT = 0x80, /**< seq u8, num u8, state u8 */
+  WS_CMD_SET_MASK = 0x81,   /**< seq u8, set mask u32, clear mask u32 */
+  WS_CMD_PWM_DUTY = 0x82,   /**< seq u8, num u8, duty u32, fade ms u32 */
+} ws_message_t;
+
+/**
+ * @brief Outcome of a WebSocket command, sent back in its ack.
+ */
+typedef enum : uint8_t
+{
+  WS_STATUS_OK = 0,
+  WS_STATUS_INVALID_ARG,   /**< Malformed command or value out of range */
+  WS_STATUS_INVALID_STATE, /**< Output in the wrong mode for the command */
+  WS_STATUS_FAILED,        /**< The driver rejected the command */
+} ws_status_t;
+
+/**
+ * @brief A decoded WebSocket command.
+ */
+typedef struct
+{
+  ws_message_t type;
+  uint8_t seq; /**< Chosen by the client, echoed in the ack */
+
+  union
+  {
+    struct
+    {
+      uint8_t num;
+      bool state;
+    } set_output;
+
+    struct
+    {
+      uint32_t set;
+      uint32_t clear;
+    } set_mask;
+
+    struct
+    {
+      uint8_t num;
+      uint32_t duty;
+      uint32_t fade_ms;
+    } pwm_duty;
+  };
+} ws_command_t;
+
+/**
+ * @brief Answer to a WebSocket command.
+ */
+typedef struct
+{
+  uint8_t seq;        /**< Sequence number of the command */
+  ws_status_t status; /**< Outcome */
+  uint32_t outputs;   /**< Digital output mask after the command */
+} ws_ack_t;
+
+/**
+ * @brief Reusable output buffer the SSE frames are written into.
+ */
+typedef struct
+{
+  char buf[SSE_ENCODER_BUFFER_SIZE]; /**< Encoded frames, not NUL terminated */
+  size_t len;                        /**< Bytes used */
+} sse_encoder_t;
+
+//**************************************************
+// Globals
+//**************************************************
+
+/**
+ * @brief Embedded frontend files sorted by path, generated at build time.
+ */
+extern const web_asset_t web_assets[];
+extern const size_t web_assets_count;
+
 //**************************************************
 // Public Functions
 //**************************************************
 
+#if !CONFIG_IDF_TARGET_LINUX
 /**
  * @brief Registers the digital output module within the Web Server context.
  *        This function performs the necessary setup for remote output control:
@@ -114,7 +385,11 @@ esp_err_t digital_input_register(httpd_handle_t server);
  *        and transmission to all connected clients.
  *
  *        4. Registers the GET handler (`/api/events`) to allow clients to establish
- *        persistent SSE connections.
+ *        persistent SSE connections, and the GET handler (`/api/events/stats`)
+ *        reporting the batch statistics.
+ *
+ *        Steps 1 to 3 run on the first call only. The server is started again
+ *        on every reconnect, later calls only register the handlers.
  *
  * @param server Handle to the active HTTP server instance.
  * @return - ESP_OK: SSE module initialized and URI registered successfully.
@@ -123,6 +398,13 @@ esp_err_t digital_input_register(httpd_handle_t server);
  */
 esp_err_t events_register(httpd_handle_t server);
 
+/**
+ * @brief Drops every SSE and WebSocket client, completing their async
+ *        requests. Called before the server stops, the next
+ *        events_register() starts with no client.
+ */
+void events_unregister(void);
+
 /**
  * @brief Enqueues an event to be broadcasted to all active SSE web clients.
  *        This function acts as the bridge between hardware drivers (Input, Analog, Sensors)
@@ -135,6 +417,135 @@ esp_err_t events_register(httpd_handle_t server);
  */
 esp_err_t events_send(event_t *event);
 
+/**
+ * @brief Adds a WebSocket client, after its handshake. It gets the state
+ *        snapshot, then the same updates as the SSE clients, as binary
+ *        messages. Gives the session a context that forgets the client
+ *        when the session closes. Called from the server task.
+ * @param req Handshake request of the session.
+ * @return - ESP_OK: Client added.
+ *
+ *         - ESP_ERR_NO_MEM: Out of memory.
+ *
+ *         - ESP_FAIL: Events module not registered.
+ */
+esp_err_t events_ws_add(httpd_req_t *req);
+
+/**
+ * @brief Queues a command ack for a WebSocket client. It is written by the
+ *        events task, like every other frame of the client, so frames never
+ *        interleave on the socket.
+ * @param req Request of the command frame, names the session.
+ * @return - ESP_OK: Ack queued.
+ *
+ *         - ESP_ERR_NOT_FOUND: The session has no WebSocket client.
+ *
+ *         - ESP_FAIL: Events module not registered.
+ */
+esp_err_t events_ws_ack(httpd_req_t *req, const ws_ack_t *ack);
+
+/**
+ * @brief Queues the reply to a WebSocket control frame, written by the events
+ *        task between two messages of the client. A PING is answered with a
+ *        PONG carrying its payload. A CLOSE is answered with a CLOSE echoing
+ *        the status code, then the session is closed.
+ * @param req  Request of the control frame, names the session.
+ * @param type HTTPD_WS_TYPE_PING or HTTPD_WS_TYPE_CLOSE.
+ * @return - ESP_OK: Reply queued.
+ *
+ *         - ESP_ERR_INVALID_ARG: Other frame type, or payload over WS_CONTROL_PAYLOAD_MAX_LEN.
+ *
+ *         - ESP_ERR_NOT_FOUND: The session has no WebSocket client.
+ *
+ *         - ESP_FAIL: Events module not registered.
+ */
+esp_err_t events_ws_control(httpd_req_t *req, httpd_ws_type_t type, const uint8_t *payload, size_t len);
+
+/**
+ * @brief Retrieves the SSE broadcast batch statistics.
+ * @param stats Output statistics.
+ * @return - ESP_OK: Statistics copied.
+ *
+ *         - ESP_ERR_INVALID_ARG: Provided stats was NULL.
+ */
+esp_err_t events_get_stats(events_stats_t *stats);
+
+/**
+ * @brief Copies the histogram of the batch latency, first event of a batch
+ *        leaving the queue to the last client write returning.
+ * @param latency Output histogram.
+ * @return - ESP_OK: Histogram copied.
+ *
+ *         - ESP_ERR_INVALID_ARG: Provided latency was NULL.
+ */
+esp_err_t events_get_latency(metrics_histogram_snapshot_t *latency);
+
+#if CONFIG_WEB_SERVER_TRACE
+/**
+ * @brief Copies the histogram of a traced stage. The stages after the
+ *        queue count one observation per update and client.
+ * @param stage     Stage to read.
+ * @param histogram Output histogram.
+ * @return - ESP_OK: Histogram copied.
+ *
+ *         - ESP_ERR_INVALID_ARG: Invalid stage or NULL histogram.
+ */
+esp_err_t events_get_trace(events_trace_stage_t stage, metrics_histogram_snapshot_t *histogram);
+#endif
+
+/**
+ * @brief Copies the current state snapshot of the inputs. The outputs are
+ *        not tracked, digital_outputs is left 0.
+ * @param snapshot Output snapshot.
+ * @return - ESP_OK: Snapshot copied.
+ *
+ *         - ESP_ERR_INVALID_ARG: Provided snapshot was NULL.
+ *
+ *         - ESP_FAIL: Events module not registered.
+ */
+esp_err_t events_get_snapshot(events_snapshot_t *snapshot);
+
+/**
+ * @brief Version of the state snapshot, lock-free. It changes whenever an
+ *        input value changes, so a cached copy can be checked cheaply. Read
+ *        it before events_get_snapshot(), a change in between is then seen
+ *        on the next check.
+ */
+uint32_t events_get_snapshot_version();
+
+/**
+ * @brief Registers the bulk state endpoint (`/api/state`). It returns every
+ *        digital input, digital output, analog input and sensor value in one
+ *        JSON body, served from a cache rebuilt only when a value changed.
+ * @param server Handle to the running HTTP server instance.
+ * @return - ESP_OK: URI handler registered.
+ *
+ *         - ESP_FAIL: Failed to register the URI handler.
+ */
+esp_err_t state_register(httpd_handle_t server);
+
+/**
+ * @brief Registers the wildcard GET handler serving the embedded frontend
+ *        files. Must be the last GET handler registered, it catches every
+ *        path the others do not.
+ * @param server Handle to the running HTTP server instance.
+ * @return - ESP_OK: URI handler registered.
+ *
+ *         - ESP_FAIL: Failed to register the URI handler.
+ */
+esp_err_t assets_register(httpd_handle_t server);
+
+/**
+ * @brief Registers the WebSocket endpoint (`/api/ws`). It carries the input
+ *        updates as compact binary messages and takes output commands on
+ *        the same socket, see ws_message_t.
+ * @param server Handle to the running HTTP server instance.
+ * @return - ESP_OK: URI handler registered.
+ *
+ *         - ESP_FAIL: Failed to register the URI handler.
+ */
+esp_err_t ws_register(httpd_handle_t server);
+
 /**
  * @brief Registers the web server as an observer of analog input events.
  * @param server Handle to the running HTTP server instance.
@@ -151,4 +562,127 @@ esp_err_t analog_input_register(httpd_handle_t server);
  *
  *         - ESP_FAIL: Failed to register the event handler.
  */
-esp_err_t sensor_register(httpd_handle_t server);
\ No newline at end of file
+esp_err_t sensor_register(httpd_handle_t server);
+
+/**
+ * @brief Registers the REST endpoint streaming the recorded history.
+ * @param server Handle to the running HTTP server instance.
+ * @return - ESP_OK: URI handler registered.
+ *
+ *         - ESP_FAIL: Failed to register the URI handler.
+ */
+esp_err_t history_register(httpd_handle_t server);
+
+/**
+ * @brief Registers the REST endpoints exporting the flash telemetry log and
+ *        its statistics.
+ * @param server Handle to the running HTTP server instance.
+ * @return - ESP_OK: URI handlers registered.
+ *
+ *         - ESP_FAIL: Failed to register a URI handler.
+ */
+esp_err_t telemetry_register(httpd_handle_t server);
+
+/**
+ * @brief Registers the Prometheus text endpoint with the runtime metrics.
+ * @param server Handle to the running HTTP server instance.
+ * @return - ESP_OK: URI handler registered.
+ *
+ *         - ESP_FAIL: Failed to register the URI handler.
+ */
+esp_err_t metrics_register(httpd_handle_t server);
+#endif
+
+/**
+ * @brief Upper bounds of the histogram buckets, in us.
+ */
+extern const uint32_t metrics_histogram_bounds_us[METRICS_HISTOGRAM_BUCKETS - 1];
+
+/**
+ * @brief Records one observation. Lock-free, callable from any task.
+ */
+void metrics_histogram_observe(metrics_histogram_t *histogram, uint32_t value_us);
+
+/**
+ * @brief Copies a histogram. Observations landing during the copy may be
+ *        counted in some fields only.
+ */
+void metrics_histogram_read(const metrics_histogram_t *histogram, metrics_histogram_snapshot_t *snapshot);
+
+/**
+ * @brief Empties an encoder buffer.
+ */
+void sse_encoder_reset(sse_encoder_t *encoder);
+
+/**
+ * @brief Appends the SSE frames of an event. Uses precomputed templates and
+ *        integer/fixed-point formatting, no allocation and no printf.
+ * @param encoder Output buffer.
+ * @param event   Event to encode.
+ * @param id      Event id written on the last frame of the event, 0 for none.
+ * @return - ESP_OK: Frames appended.
+ *
+ *         - ESP_ERR_NO_MEM: Not enough room left, the buffer is unchanged.
+ *
+ *         - ESP_ERR_INVALID_ARG: Unknown event name.
+ */
+esp_err_t sse_encoder_append(sse_encoder_t *encoder, const event_t *event, uint32_t id);
+
+/**
+ * @brief Appends the SSE frame of a state snapshot, a "snapshot" event.
+ *        Channels that never reported are written as null.
+ * @param encoder  Output buffer.
+ * @param snapshot State to encode.
+ * @param id       Event id of the frame, 0 for none.
+ * @return - ESP_OK: Frame appended.
+ *
+ *         - ESP_ERR_NO_MEM: Not enough room left, the buffer is unchanged.
+ */
+esp_err_t sse_encoder_append_snapshot(sse_encoder_t *encoder, const events_snapshot_t *snapshot, uint32_t id);
+
+/**
+ * @brief Appends a state snapshot as a bare JSON object, the same body as the
+ *        data of the "snapshot" event.
+ * @param encoder  Output buffer.
+ * @param snapshot State to encode.
+ * @return - ESP_OK: Object appended.
+ *
+ *         - ESP_ERR_NO_MEM: Not enough room left, the buffer is unchanged.
+ */
+esp_err_t sse_encoder_append_state(sse_encoder_t *encoder, const events_snapshot_t *snapshot);
+
+/**
+ * @brief Appends the binary record of an event. The encoder buffer is
+ *        shared with SSE, binary records are far smaller than SSE frames.
+ * @return - ESP_OK: Record appended.
+ *
+ *         - ESP_ERR_INVALID_ARG: Unknown event.
+ *
+ *         - ESP_ERR_NO_MEM: Not enough space left in the buffer.
+ */
+esp_err_t ws_protocol_append_event(sse_encoder_t *encoder, const event_t *event);
+
+/**
+ * @brief Appends the binary record of a state snapshot, WS_MSG_SNAPSHOT.
+ * @return - ESP_OK: Record appended.
+ *
+ *         - ESP_ERR_NO_MEM: Not enough space left in the buffer.
+ */
+esp_err_t ws_protocol_append_snapshot(sse_encoder_t *encoder, const events_snapshot_t *snapshot);
+
+/**
+ * @brief Appends the binary record of a command ack, WS_MSG_ACK.
+ * @return - ESP_OK: Record appended.
+ *
+ *         - ESP_ERR_NO_MEM: Not enough space left in the buffer.
+ */
+esp_err_t ws_protocol_append_ack(sse_encoder_t *encoder, const ws_ack_t *ack);
+
+/**
+ * @brief Decodes a binary command sent by a client.
+ * @return - ESP_OK: Command decoded.
+ *
+ *         - ESP_ERR_INVALID_ARG: Unknown type or wrong length. The sequence
+ *         number is still decoded when present, so the client can be answered.
+ */
+esp_err_t ws_protocol_parse_command(const uint8_t *data, size_t len, ws_command_t *command);
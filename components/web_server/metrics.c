@@ -0,0 +1,398 @@
+#include "web_server_internals.h"
+#include "esp_http_server.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_wifi.h"
+#include "analog_input.h"
+#include "digital_input.h"
+#include "telemetry.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+//**************************************************
+// Defines
+//**************************************************
+
+#define CHUNK_SIZE 512     // Response chunk, sent when the next text does not fit
+#define TASKS_SPARE 4      // Room for tasks created between counting and listing them
+
+//**************************************************
+// Typedefs
+//**************************************************
+
+/**
+ * @brief Chunked text response being built.
+ */
+typedef struct
+{
+  httpd_req_t *req;
+  char chunk[CHUNK_SIZE];
+  int len;
+  esp_err_t err; /**< First send error, later output is dropped */
+} writer_t;
+
+//**************************************************
+// Function Prototypes
+//**************************************************
+
+static esp_err_t get_metrics_handler(httpd_req_t *req);
+static void emit(writer_t *writer, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+static void emit_tasks(writer_t *writer);
+static void emit_events(writer_t *writer);
+static void emit_inputs(writer_t *writer);
+static void emit_system(writer_t *writer);
+static void emit_histogram(writer_t *writer, const char *name, const char *labels, const metrics_histogram_snapshot_t *histogram);
+
+//**************************************************
+// Globals
+//**************************************************
+
+static const char TAG[] = "web_server:metrics";
+
+static const httpd_uri_t s_uri_get_metrics = {
+    .uri = "/api/metrics",
+    .method = HTTP_GET,
+    .user_ctx = NULL,
+    .handler = get_metrics_handler,
+};
+
+#if CONFIG_WEB_SERVER_TRACE
+/**
+ * @brief Label values of the traced stages, indexed by events_trace_stage_t.
+ */
+static const char *const s_trace_stages[_EVENTS_TRACE_STAGE_MAX] = {
+    [EVENTS_TRACE_ACQUIRE] = "stage=\"acquire\"",
+    [EVENTS_TRACE_QUEUE] = "stage=\"queue\"",
+    [EVENTS_TRACE_BATCH] = "stage=\"batch\"",
+    [EVENTS_TRACE_WRITE] = "stage=\"write\"",
+    [EVENTS_TRACE_TOTAL] = "stage=\"total\"",
+};
+#endif
+
+const uint32_t metrics_histogram_bounds_us[METRICS_HISTOGRAM_BUCKETS - 1] = {
+    100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000,
+};
+
+//**************************************************
+// Public Functions
+//**************************************************
+
+esp_err_t metrics_register(httpd_handle_t server)
+{
+  if (httpd_register_uri_handler(server, &s_uri_get_metrics) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Fail to register uri handler", __func__);
+    return ESP_FAIL;
+  }
+
+  return ESP_OK;
+}
+
+void metrics_histogram_observe(metrics_histogram_t *histogram, uint32_t value_us)
+{
+  size_t bucket = 0;
+  while (bucket < METRICS_HISTOGRAM_BUCKETS - 1 && value_us > metrics_histogram_bounds_us[bucket])
+  {
+    bucket++;
+  }
+
+  atomic_fetch_add_explicit(&histogram->counts[bucket], 1, memory_order_relaxed);
+  atomic_fetch_add_explicit(&histogram->sum_us, value_us, memory_order_relaxed);
+  atomic_fetch_add_explicit(&histogram->count, 1, memory_order_relaxed);
+}
+
+void metrics_histogram_read(const metrics_histogram_t *histogram, metrics_histogram_snapshot_t *snapshot)
+{
+  for (size_t i = 0; i < METRICS_HISTOGRAM_BUCKETS; i++)
+  {
+    snapshot->counts[i] = atomic_load_explicit(&histogram->counts[i], memory_order_relaxed);
+  }
+
+  snapshot->sum_us = atomic_load_explicit(&histogram->sum_us, memory_order_relaxed);
+  snapshot->count = atomic_load_explicit(&histogram->count, memory_order_relaxed);
+}
+
+//**************************************************
+// Static Functions
+//**************************************************
+
+/**
+ * @brief REST API Handler reporting the runtime metrics in the Prometheus
+ *        text format: tasks, the events queue, the clients, the input
+ *        pipelines, latency histograms and the heap and Wi-Fi link.
+ */
+static esp_err_t get_metrics_handler(httpd_req_t *req)
+{
+  writer_t *writer = malloc(sizeof(writer_t));
+  if (writer == NULL)
+  {
+    return httpd_resp_send_500(req);
+  }
+
+  writer->req = req;
+  writer->len = 0;
+  writer->err = ESP_OK;
+
+  httpd_resp_set_type(req, "text/plain; version=0.0.4");
+  httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+
+  emit_tasks(writer);
+  emit_events(writer);
+  emit_inputs(writer);
+  emit_system(writer);
+
+  if (writer->err == ESP_OK && writer->len > 0)
+  {
+    writer->err = httpd_resp_send_chunk(req, writer->chunk, writer->len);
+  }
+
+  esp_err_t err = writer->err == ESP_OK ? httpd_resp_send_chunk(req, NULL, 0) : ESP_FAIL;
+  free(writer);
+
+  return err;
+}
+
+/**
+ * @brief Appends text. When it does not fit, the chunk is sent and the text
+ *        formatted again into the empty chunk, or sent on its own if it is
+ *        longer than a chunk.
+ */
+static void emit(writer_t *writer, const char *fmt, ...)
+{
+  if (writer->err != ESP_OK)
+  {
+    return;
+  }
+
+  const int space = CHUNK_SIZE - writer->len;
+
+  va_list args;
+  va_start(args, fmt);
+  const int len = vsnprintf(writer->chunk + writer->len, space, fmt, args);
+  va_end(args);
+
+  if (len < 0)
+  {
+    return;
+  }
+
+  if (len < space)
+  {
+    writer->len += len;
+    return;
+  }
+
+  if (writer->len > 0)
+  {
+    writer->err = httpd_resp_send_chunk(writer->req, writer->chunk, writer->len);
+    writer->len = 0;
+    if (writer->err != ESP_OK)
+    {
+      return;
+    }
+  }
+
+  char *text = len < CHUNK_SIZE ? writer->chunk : malloc(len + 1);
+  if (text == NULL)
+  {
+    ESP_LOGE(TAG, "%s:Fail to allocate %d bytes", __func__, len + 1);
+    writer->err = ESP_ERR_NO_MEM;
+    return;
+  }
+
+  va_start(args, fmt);
+  vsnprintf(text, len + 1, fmt, args);
+  va_end(args);
+
+  if (text == writer->chunk)
+  {
+    writer->len = len;
+  }
+  else
+  {
+    writer->err = httpd_resp_send_chunk(writer->req, text, len);
+    free(text);
+  }
+}
+
+/**
+ * @brief CPU time and free stack of every task. The run time counter ticks
+ *        in us, so the rate of the counter is the share of one core.
+ */
+static void emit_tasks(writer_t *writer)
+{
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY
+  UBaseType_t count = uxTaskGetNumberOfTasks() + TASKS_SPARE;
+  TaskStatus_t *tasks = malloc(count * sizeof(TaskStatus_t));
+  if (tasks == NULL)
+  {
+    ESP_LOGE(TAG, "%s:Fail to allocate task list", __func__);
+    return;
+  }
+
+  uint32_t total_runtime = 0;
+  count = uxTaskGetSystemState(tasks, count, &total_runtime);
+
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+  emit(writer, "# HELP device_task_cpu_seconds_total CPU time used by the task.\n"
+               "# TYPE device_task_cpu_seconds_total counter\n");
+  for (UBaseType_t i = 0; i < count; i++)
+  {
+    emit(writer, "device_task_cpu_seconds_total{task=\"%s\"} %" PRIu32 ".%06" PRIu32 "\n",
+         tasks[i].pcTaskName, tasks[i].ulRunTimeCounter / 1000000, tasks[i].ulRunTimeCounter % 1000000);
+  }
+#endif
+
+  emit(writer, "# HELP device_task_stack_free_bytes Lowest free stack of the task since it started.\n"
+               "# TYPE device_task_stack_free_bytes gauge\n");
+  for (UBaseType_t i = 0; i < count; i++)
+  {
+    emit(writer, "device_task_stack_free_bytes{task=\"%s\"} %" PRIu32 "\n",
+         tasks[i].pcTaskName, (uint32_t)tasks[i].usStackHighWaterMark);
+  }
+
+  free(tasks);
+#endif
+}
+
+/**
+ * @brief Events queue, push clients and batch latency.
+ */
+static void emit_events(writer_t *writer)
+{
+  events_stats_t stats;
+  metrics_histogram_snapshot_t latency;
+
+  events_get_stats(&stats);
+  events_get_latency(&latency);
+
+  emit(writer, "# TYPE device_events_queue_depth gauge\n"
+               "device_events_queue_depth %" PRIu32 "\n", stats.queue_waiting);
+  emit(writer, "# TYPE device_events_queue_capacity gauge\n"
+               "device_events_queue_capacity %" PRIu32 "\n", stats.queue_length);
+  emit(writer, "# HELP device_events_send_failures_total Events dropped because the queue stayed full.\n"
+               "# TYPE device_events_send_failures_total counter\n"
+               "device_events_send_failures_total %" PRIu32 "\n", stats.send_failures);
+  emit(writer, "# TYPE device_events_total counter\n"
+               "device_events_total %" PRIu32 "\n", stats.events);
+  emit(writer, "# TYPE device_events_coalesced_total counter\n"
+               "device_events_coalesced_total %" PRIu32 "\n", stats.coalesced);
+
+  emit(writer, "# HELP device_clients Push clients connected.\n"
+               "# TYPE device_clients gauge\n"
+               "device_clients %" PRIu32 "\n", stats.clients);
+  emit(writer, "# TYPE device_client_evictions_total counter\n"
+               "device_client_evictions_total %" PRIu32 "\n", stats.evicted);
+  emit(writer, "# TYPE device_client_stalls_total counter\n"
+               "device_client_stalls_total %" PRIu32 "\n", stats.client_stalls);
+  emit(writer, "# TYPE device_client_updates_total counter\n"
+               "device_client_updates_total{transport=\"sse\"} %" PRIu32 "\n"
+               "device_client_updates_total{transport=\"ws\"} %" PRIu32 "\n", stats.sse_updates, stats.ws_updates);
+  emit(writer, "# TYPE device_client_sent_bytes_total counter\n"
+               "device_client_sent_bytes_total{transport=\"sse\"} %" PRIu64 "\n"
+               "device_client_sent_bytes_total{transport=\"ws\"} %" PRIu64 "\n", stats.sse_bytes, stats.ws_bytes);
+
+  emit(writer, "# HELP device_events_batch_latency_seconds First event of a batch leaving the queue to the last client write.\n"
+               "# TYPE device_events_batch_latency_seconds histogram\n");
+  emit_histogram(writer, "device_events_batch_latency_seconds", "", &latency);
+
+#if CONFIG_WEB_SERVER_TRACE
+  emit(writer, "# HELP device_events_stage_latency_seconds Time events spend in each stage, from acquisition to a client.\n"
+               "# TYPE device_events_stage_latency_seconds histogram\n");
+  for (int stage = 0; stage < _EVENTS_TRACE_STAGE_MAX; stage++)
+  {
+    metrics_histogram_snapshot_t histogram;
+    events_get_trace(stage, &histogram);
+    emit_histogram(writer, "device_events_stage_latency_seconds", s_trace_stages[stage], &histogram);
+  }
+#endif
+}
+
+/**
+ * @brief Values lost in the input pipelines and the telemetry log.
+ */
+static void emit_inputs(writer_t *writer)
+{
+  analog_input_stats_t analog;
+  telemetry_stats_t telemetry;
+
+  emit(writer, "# HELP device_digital_input_overruns_total Edges lost because the edge ring was full.\n"
+               "# TYPE device_digital_input_overruns_total counter\n"
+               "device_digital_input_overruns_total %" PRIu32 "\n", digital_input_get_overruns());
+
+  if (analog_input_get_stats(&analog) == ESP_OK)
+  {
+    emit(writer, "# HELP device_analog_input_overruns_total Frames lost by the sampling pipeline.\n"
+                 "# TYPE device_analog_input_overruns_total counter\n"
+                 "device_analog_input_overruns_total %" PRIu32 "\n", analog.overruns);
+    emit(writer, "# HELP device_analog_input_ring_overruns_total Values lost because the observers did not keep up.\n"
+                 "# TYPE device_analog_input_ring_overruns_total counter\n");
+    for (int num = 0; num < _ANALOG_INPUT_NUM_MAX; num++)
+    {
+      emit(writer, "device_analog_input_ring_overruns_total{ch=\"%d\"} %" PRIu32 "\n", num, analog.ring_overruns[num]);
+    }
+  }
+
+  if (telemetry_get_stats(&telemetry) == ESP_OK)
+  {
+    emit(writer, "# TYPE device_telemetry_dropped_total counter\n"
+                 "device_telemetry_dropped_total %" PRIu32 "\n", telemetry.dropped);
+    emit(writer, "# TYPE device_telemetry_flash_bytes_total counter\n"
+                 "device_telemetry_flash_bytes_total %" PRIu64 "\n", telemetry.flash_bytes);
+  }
+}
+
+/**
+ * @brief Heap and Wi-Fi link, the usual suspects when everything lags.
+ */
+static void emit_system(writer_t *writer)
+{
+  wifi_ap_record_t ap;
+
+  emit(writer, "# TYPE device_heap_free_bytes gauge\n"
+               "device_heap_free_bytes %" PRIu32 "\n", esp_get_free_heap_size());
+  emit(writer, "# TYPE device_heap_min_free_bytes gauge\n"
+               "device_heap_min_free_bytes %" PRIu32 "\n", esp_get_minimum_free_heap_size());
+
+  if (esp_wifi_sta_get_ap_info(&ap) == ESP_OK)
+  {
+    emit(writer, "# TYPE device_wifi_rssi_dbm gauge\n"
+                 "device_wifi_rssi_dbm %d\n", ap.rssi);
+  }
+}
+
+/**
+ * @brief Writes the series of a histogram with cumulative buckets, in
+ *        seconds. Labels are empty or a list such as stage="queue".
+ */
+static void emit_histogram(writer_t *writer, const char *name, const char *labels, const metrics_histogram_snapshot_t *histogram)
+{
+  const char *separator = labels[0] != '\0' ? "," : "";
+  uint32_t cumulative = 0;
+
+  for (size_t i = 0; i < METRICS_HISTOGRAM_BUCKETS - 1; i++)
+  {
+    const uint32_t bound_us = metrics_histogram_bounds_us[i];
+    cumulative += histogram->counts[i];
+    emit(writer, "%s_bucket{%s%sle=\"%" PRIu32 ".%06" PRIu32 "\"} %" PRIu32 "\n",
+         name, labels, separator, bound_us / 1000000, bound_us % 1000000, cumulative);
+  }
+
+  cumulative += histogram->counts[METRICS_HISTOGRAM_BUCKETS - 1];
+  emit(writer, "%s_bucket{%s%sle=\"+Inf\"} %" PRIu32 "\n", name, labels, separator, cumulative);
+
+  if (labels[0] != '\0')
+  {
+    emit(writer, "%s_sum{%s} %" PRIu64 ".%06" PRIu64 "\n", name, labels, histogram->sum_us / 1000000, histogram->sum_us % 1000000);
+    emit(writer, "%s_count{%s} %" PRIu32 "\n", name, labels, histogram->count);
+  }
+  else
+  {
+    emit(writer, "%s_sum %" PRIu64 ".%06" PRIu64 "\n", name, histogram->sum_us / 1000000, histogram->sum_us % 1000000);
+    emit(writer, "%s_count %" PRIu32 "\n", name, histogram->count);
+  }
+}
@@ -1,6 +1,7 @@
 #include "web_server_internals.h"
 #include "esp_http_server.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "sensor.h"
 
 //**************************************************
@@ -52,6 +53,9 @@ static void sensor_event_handler(float humidity, float temperature)
           .humidity = humidity,
           .temperature = temperature,
       },
+#if CONFIG_WEB_SERVER_TRACE
+      .trace.acquire_us = (uint32_t)esp_timer_get_time(), // Called by the sensor task right after the reading
+#endif
   };
 
   if (events_send(&event) != ESP_OK)
@@ -0,0 +1,320 @@
+#include "web_server_internals.h"
+#include <math.h>
+#include <string.h>
+
+//**************************************************
+// Defines
+//**************************************************
+
+#define SENSOR_SCALE 100 // Sensor values are written with two decimals
+#define SENSOR_TEMPERATURE_NUM 2
+#define SENSOR_HUMIDITY_NUM 3
+
+/**
+ * @brief Copies a string literal, without its terminator, and advances the cursor.
+ */
+#define APPEND_LITERAL(cursor, literal)               \
+  do                                                  \
+  {                                                   \
+    memcpy((cursor), (literal), sizeof(literal) - 1); \
+    (cursor) += sizeof(literal) - 1;                  \
+  } while (0)
+
+//**************************************************
+// Typedefs
+//**************************************************
+
+/**
+ * @brief Precomputed frame header of an SSE event type, up to the first value.
+ */
+typedef struct
+{
+  const char *header;
+  size_t header_len;
+} sse_template_t;
+
+//**************************************************
+// Function Prototypes
+//**************************************************
+
+static char *append_id(char *cursor, uint32_t id);
+static char *append_state(char *cursor, const events_snapshot_t *snapshot);
+static char *append_template(char *cursor, const event_name_t name);
+static char *append_end(char *cursor, const event_t *event);
+static char *format_uint(char *cursor, uint32_t value);
+static char *format_fixed(char *cursor, float value);
+
+//**************************************************
+// Globals
+//**************************************************
+
+#define TEMPLATE(str) {.header = (str), .header_len = sizeof(str) - 1}
+
+/**
+ * @brief Frame headers indexed by event name. The sensor readings are
+ *        published as analog-input frames, as the frontend expects.
+ */
+static const sse_template_t s_templates[] = {
+    [EVENT_NAME_DIGITAL_INPUT] = TEMPLATE("event: digital-input\ndata: {\"num\":"),
+    [EVENT_NAME_ANALOG_INPUT] = TEMPLATE("event: analog-input\ndata: {\"num\":"),
+    [EVENT_NAME_SENSOR] = TEMPLATE("event: analog-input\ndata: {\"num\":"),
+};
+
+#undef TEMPLATE
+
+//**************************************************
+// Public Functions
+//**************************************************
+
+void sse_encoder_reset(sse_encoder_t *encoder)
+{
+  encoder->len = 0;
+}
+
+esp_err_t sse_encoder_append(sse_encoder_t *encoder, const event_t *event, uint32_t id)
+{
+  if (event->name >= sizeof(s_templates) / sizeof(s_templates[0]))
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  // One bound check per event, the formatters below never overflow it
+  if (sizeof(encoder->buf) - encoder->len < SSE_ENCODER_EVENT_MAX_LEN)
+  {
+    return ESP_ERR_NO_MEM;
+  }
+
+  char *cursor = &encoder->buf[encoder->len];
+
+  switch (event->name)
+  {
+  case EVENT_NAME_DIGITAL_INPUT:
+    cursor = append_id(cursor, id);
+    cursor = append_template(cursor, event->name);
+    cursor = format_uint(cursor, event->payload.digital_input.num);
+    APPEND_LITERAL(cursor, ", \"value\":");
+    cursor = format_uint(cursor, event->payload.digital_input.value);
+    cursor = append_end(cursor, event);
+    break;
+
+  case EVENT_NAME_ANALOG_INPUT:
+    cursor = append_id(cursor, id);
+    cursor = append_template(cursor, event->name);
+    cursor = format_uint(cursor, event->payload.analog_input.num);
+    APPEND_LITERAL(cursor, ", \"value\":");
+    cursor = format_uint(cursor, event->payload.analog_input.value);
+    cursor = append_end(cursor, event);
+    break;
+
+  case EVENT_NAME_SENSOR:
+    cursor = append_template(cursor, event->name);
+    cursor = format_uint(cursor, SENSOR_TEMPERATURE_NUM);
+    APPEND_LITERAL(cursor, ", \"value\":");
+    cursor = format_fixed(cursor, event->payload.sensor.temperature);
+    cursor = append_end(cursor, event);
+
+    cursor = append_id(cursor, id);
+    cursor = append_template(cursor, event->name);
+    cursor = format_uint(cursor, SENSOR_HUMIDITY_NUM);
+    APPEND_LITERAL(cursor, ", \"value\":");
+    cursor = format_fixed(cursor, event->payload.sensor.humidity);
+    cursor = append_end(cursor, event);
+    break;
+
+  default:
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  encoder->len = cursor - encoder->buf;
+  return ESP_OK;
+}
+
+esp_err_t sse_encoder_append_snapshot(sse_encoder_t *encoder, const events_snapshot_t *snapshot, uint32_t id)
+{
+  if (sizeof(encoder->buf) - encoder->len < SSE_ENCODER_SNAPSHOT_MAX_LEN)
+  {
+    return ESP_ERR_NO_MEM;
+  }
+
+  char *cursor = &encoder->buf[encoder->len];
+
+  cursor = append_id(cursor, id);
+  APPEND_LITERAL(cursor, "event: snapshot\ndata: ");
+  cursor = append_state(cursor, snapshot);
+  APPEND_LITERAL(cursor, "\n\n");
+
+  encoder->len = cursor - encoder->buf;
+  return ESP_OK;
+}
+
+esp_err_t sse_encoder_append_state(sse_encoder_t *encoder, const events_snapshot_t *snapshot)
+{
+  if (sizeof(encoder->buf) - encoder->len < SSE_ENCODER_SNAPSHOT_MAX_LEN)
+  {
+    return ESP_ERR_NO_MEM;
+  }
+
+  char *cursor = append_state(&encoder->buf[encoder->len], snapshot);
+
+  encoder->len = cursor - encoder->buf;
+  return ESP_OK;
+}
+
+//**************************************************
+// Static Functions
+//**************************************************
+
+/**
+ * @brief Writes a state snapshot as a JSON object.
+ */
+static char *append_state(char *cursor, const events_snapshot_t *snapshot)
+{
+  APPEND_LITERAL(cursor, "{\"digital_inputs\":");
+  cursor = format_uint(cursor, snapshot->digital_inputs);
+  APPEND_LITERAL(cursor, ",\"digital_outputs\":");
+  cursor = format_uint(cursor, snapshot->digital_outputs);
+
+  APPEND_LITERAL(cursor, ",\"analog_inputs\":[");
+  for (int num = 0; num < _ANALOG_INPUT_NUM_MAX; num++)
+  {
+    if (num != 0)
+    {
+      *cursor++ = ',';
+    }
+
+    if (snapshot->analog_valid & (1U << num))
+    {
+      cursor = format_uint(cursor, snapshot->analog_inputs[num]);
+    }
+    else
+    {
+      APPEND_LITERAL(cursor, "null");
+    }
+  }
+
+  APPEND_LITERAL(cursor, "],\"sensor\":");
+  if (snapshot->sensor_valid)
+  {
+    APPEND_LITERAL(cursor, "{\"temperature\":");
+    cursor = format_fixed(cursor, snapshot->temperature);
+    APPEND_LITERAL(cursor, ",\"humidity\":");
+    cursor = format_fixed(cursor, snapshot->humidity);
+    *cursor++ = '}';
+  }
+  else
+  {
+    APPEND_LITERAL(cursor, "null");
+  }
+  *cursor++ = '}';
+
+  return cursor;
+}
+
+/**
+ * @brief Writes the id field of a frame, nothing for id 0.
+ */
+static char *append_id(char *cursor, uint32_t id)
+{
+  if (id == 0)
+  {
+    return cursor;
+  }
+
+  APPEND_LITERAL(cursor, "id: ");
+  cursor = format_uint(cursor, id);
+  *cursor++ = '\n';
+  return cursor;
+}
+
+/**
+ * @brief Copies the precomputed header of an event type.
+ */
+static char *append_template(char *cursor, const event_name_t name)
+{
+  memcpy(cursor, s_templates[name].header, s_templates[name].header_len);
+  return cursor + s_templates[name].header_len;
+}
+
+/**
+ * @brief Closes the data of an update, with the stage times of the event
+ *        when they are sent: acquire, enqueue, dequeue and send.
+ */
+static char *append_end(char *cursor, const event_t *event)
+{
+#if CONFIG_WEB_SERVER_TRACE_SSE
+  APPEND_LITERAL(cursor, ",\"trace\":[");
+  cursor = format_uint(cursor, event->trace.acquire_us);
+  *cursor++ = ',';
+  cursor = format_uint(cursor, event->trace.enqueue_us);
+  *cursor++ = ',';
+  cursor = format_uint(cursor, event->trace.dequeue_us);
+  *cursor++ = ',';
+  cursor = format_uint(cursor, event->trace.send_us);
+  *cursor++ = ']';
+#else
+  (void)event;
+#endif
+
+  APPEND_LITERAL(cursor, "}\n\n");
+  return cursor;
+}
+
+/**
+ * @brief Writes the decimal digits of an unsigned value.
+ */
+static char *format_uint(char *cursor, uint32_t value)
+{
+  char digits[10];
+  int count = 0;
+
+  // Digits come out least significant first
+  do
+  {
+    digits[count++] = '0' + value % 10;
+    value /= 10;
+  } while (value != 0);
+
+  while (count > 0)
+  {
+    *cursor++ = digits[--count];
+  }
+
+  return cursor;
+}
+
+/**
+ * @brief Writes a float as a fixed-point decimal (SENSOR_SCALE), rounded to
+ *        nearest. Magnitudes beyond the uint32 range are clamped, NaN and
+ *        infinities have no JSON number and are written as null.
+ */
+static char *format_fixed(char *cursor, float value)
+{
+  if (!isfinite(value))
+  {
+    APPEND_LITERAL(cursor, "null");
+    return cursor;
+  }
+
+  if (value < 0)
+  {
+    *cursor++ = '-';
+    value = -value;
+  }
+
+  // Single precision multiply and convert, cheap with the FPU
+  const float scaled = value * SENSOR_SCALE + 0.5f;
+  const uint32_t fixed = scaled >= 4294967040.0f ? UINT32_MAX : (uint32_t)scaled;
+
+  cursor = format_uint(cursor, fixed / SENSOR_SCALE);
+  *cursor++ = '.';
+
+  // Fraction keeps its leading zeros
+  uint32_t fraction = fixed % SENSOR_SCALE;
+  for (uint32_t divisor = SENSOR_SCALE / 10; divisor > 0; divisor /= 10)
+  {
+    *cursor++ = '0' + fraction / divisor;
+    fraction %= divisor;
+  }
+
+  return cursor;
+}
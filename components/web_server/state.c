@@ -0,0 +1,90 @@
+#include "web_server_internals.h"
+#include "esp_http_server.h"
+#include "esp_log.h"
+#include "digital_output.h"
+
+//**************************************************
+// Function Prototypes
+//**************************************************
+
+static esp_err_t get_state_handler(httpd_req_t *req);
+
+//**************************************************
+// Globals
+//**************************************************
+
+static const char TAG[] = "web_server:state";
+
+static const httpd_uri_t s_uri_get_state = {
+    .uri = "/api/state",
+    .method = HTTP_GET,
+    .user_ctx = NULL,
+    .handler = get_state_handler,
+};
+
+/**
+ * @brief Serialized state body. Only touched by the handler, which the
+ *        server runs from its single task.
+ */
+static sse_encoder_t s_cache;
+static bool s_cache_valid = false; /**< s_cache holds a body */
+static uint32_t s_cache_version;   /**< Snapshot version the body was built from */
+static uint32_t s_cache_outputs;   /**< Output bitmask the body was built with */
+
+//**************************************************
+// Public Functions
+//**************************************************
+
+esp_err_t state_register(httpd_handle_t server)
+{
+  if (httpd_register_uri_handler(server, &s_uri_get_state) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Fail to register uri handler", __func__);
+    return ESP_FAIL;
+  }
+
+  return ESP_OK;
+}
+
+//**************************************************
+// Static Functions
+//**************************************************
+
+/**
+ * @brief REST API Handler returning the state of every channel as one JSON
+ *        object. The body is rebuilt only when an input or output changed,
+ *        otherwise the cached bytes are sent as is.
+ */
+static esp_err_t get_state_handler(httpd_req_t *req)
+{
+  const uint32_t version = events_get_snapshot_version();
+  const uint32_t outputs = digital_output_get_mask();
+
+  if (!s_cache_valid || version != s_cache_version || outputs != s_cache_outputs)
+  {
+    events_snapshot_t snapshot;
+    if (events_get_snapshot(&snapshot) != ESP_OK)
+    {
+      httpd_resp_send_500(req);
+      return ESP_FAIL;
+    }
+
+    snapshot.digital_outputs = outputs;
+
+    sse_encoder_reset(&s_cache);
+    if (sse_encoder_append_state(&s_cache, &snapshot) != ESP_OK)
+    {
+      ESP_LOGE(TAG, "%s:Fail to encode state", __func__);
+      s_cache_valid = false;
+      httpd_resp_send_500(req);
+      return ESP_FAIL;
+    }
+
+    s_cache_version = version;
+    s_cache_outputs = outputs;
+    s_cache_valid = true;
+  }
+
+  httpd_resp_set_type(req, "application/json");
+  return httpd_resp_send(req, s_cache.buf, s_cache.len);
+}
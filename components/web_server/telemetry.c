@@ -0,0 +1,231 @@
+#include "web_server_internals.h"
+#include "esp_http_server.h"
+#include "esp_log.h"
+#include "telemetry.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+//**************************************************
+// Defines
+//**************************************************
+
+#define CHUNK_SIZE 512   // Response chunk, flushed before a line could overflow it
+#define LINE_MAX_LEN 48  // Longest CSV line: "65535,9223372036854775807,15,-2147483648\n"
+
+//**************************************************
+// Function Prototypes
+//**************************************************
+
+static esp_err_t get_telemetry_handler(httpd_req_t *req);
+static esp_err_t get_telemetry_stats_handler(httpd_req_t *req);
+static void export_task(void *args);
+static esp_err_t send_csv(httpd_req_t *req);
+static esp_err_t send_blocks(httpd_req_t *req);
+
+//**************************************************
+// Globals
+//**************************************************
+
+static const char TAG[] = "web_server:telemetry";
+
+static const httpd_uri_t s_uri_get_telemetry = {
+    .uri = "/api/telemetry",
+    .method = HTTP_GET,
+    .user_ctx = NULL,
+    .handler = get_telemetry_handler,
+};
+
+static const httpd_uri_t s_uri_get_telemetry_stats = {
+    .uri = "/api/telemetry/stats",
+    .method = HTTP_GET,
+    .user_ctx = NULL,
+    .handler = get_telemetry_stats_handler,
+};
+
+static telemetry_block_t s_block;       /**< Block being exported, owned by the export task */
+static bool s_export_binary;            /**< Format of the running export, raw blocks or CSV */
+static atomic_bool s_exporting = false; /**< An export task is running, only one at a time */
+
+//**************************************************
+// Public Functions
+//**************************************************
+
+esp_err_t telemetry_register(httpd_handle_t server)
+{
+  if (httpd_register_uri_handler(server, &s_uri_get_telemetry) != ESP_OK ||
+      httpd_register_uri_handler(server, &s_uri_get_telemetry_stats) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Fail to register uri handler", __func__);
+    return ESP_FAIL;
+  }
+
+  return ESP_OK;
+}
+
+//**************************************************
+// Static Functions
+//**************************************************
+
+/**
+ * @brief REST API Handler exporting the whole log, oldest first, one block
+ *        in RAM at a time. The records still in RAM are flushed first.
+ *        Optional query param: ?format=csv (default), lines of
+ *        "boot,time_ms,ch,value", or ?format=bin, the raw 504-byte blocks.
+ *
+ *        Reading the whole partition takes seconds, so the request goes
+ *        async and a task streams it while the server keeps serving.
+ */
+static esp_err_t get_telemetry_handler(httpd_req_t *req)
+{
+  char query[32], format[8] = "csv";
+
+  if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK)
+  {
+    httpd_query_key_value(query, "format", format, sizeof(format));
+  }
+
+  if (strcmp(format, "csv") != 0 && strcmp(format, "bin") != 0)
+  {
+    return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid format");
+  }
+
+  bool idle = false;
+  if (!atomic_compare_exchange_strong(&s_exporting, &idle, true))
+  {
+    httpd_resp_set_status(req, "503 Service Unavailable");
+    httpd_resp_set_hdr(req, "Retry-After", "5");
+    return httpd_resp_send(req, "Export in progress", HTTPD_RESP_USE_STRLEN);
+  }
+
+  s_export_binary = strcmp(format, "bin") == 0;
+  httpd_resp_set_type(req, s_export_binary ? "application/octet-stream" : "text/csv");
+  httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+
+  httpd_req_t *async_req = NULL;
+  if (httpd_req_async_handler_begin(req, &async_req) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Failed to create async req", __func__);
+    atomic_store(&s_exporting, false);
+    return httpd_resp_send_500(req);
+  }
+
+  // Below the events task, a long export must not delay the push clients
+  if (xTaskCreate(export_task, "telemetry_export", 3072, async_req, 2, NULL) != pdPASS)
+  {
+    ESP_LOGE(TAG, "%s:Fail to create export task", __func__);
+    httpd_req_async_handler_complete(async_req);
+    atomic_store(&s_exporting, false);
+    return httpd_resp_send_500(req);
+  }
+
+  return ESP_OK;
+}
+
+/**
+ * @brief REST API Handler returning the log statistics as JSON.
+ */
+static esp_err_t get_telemetry_stats_handler(httpd_req_t *req)
+{
+  telemetry_stats_t stats;
+  char resp[320];
+
+  if (telemetry_get_stats(&stats) != ESP_OK)
+  {
+    return httpd_resp_send_500(req);
+  }
+
+  snprintf(resp, sizeof(resp),
+           "{\"boot\":%u,\"sectors\":%" PRIu32 ",\"blocks\":%" PRIu32 ",\"records\":%" PRIu32
+           ",\"dropped\":%" PRIu32 ",\"corrupt\":%" PRIu32 ",\"write_errors\":%" PRIu32 ",\"erases\":%" PRIu32
+           ",\"erase_count_max\":%" PRIu32 ",\"payload_bytes\":%" PRIu64 ",\"flash_bytes\":%" PRIu64 "}",
+           stats.boot, stats.sectors, stats.blocks, stats.records, stats.dropped, stats.corrupt,
+           stats.write_errors, stats.erases, stats.erase_count_max, stats.payload_bytes, stats.flash_bytes);
+
+  httpd_resp_set_type(req, "application/json");
+  return httpd_resp_send(req, resp, HTTPD_RESP_USE_STRLEN);
+}
+
+/**
+ * @brief Streams the log on an async request, then ends the request and
+ *        the task.
+ */
+static void export_task(void *args)
+{
+  httpd_req_t *req = args;
+
+  if (telemetry_flush() != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Fail to flush log", __func__);
+  }
+
+  if ((s_export_binary ? send_blocks(req) : send_csv(req)) != ESP_OK)
+  {
+    ESP_LOGW(TAG, "%s:Export cut short", __func__);
+  }
+
+  httpd_req_async_handler_complete(req);
+  atomic_store(&s_exporting, false);
+
+  vTaskDelete(NULL);
+}
+
+/**
+ * @brief Streams every record as a CSV line.
+ */
+static esp_err_t send_csv(httpd_req_t *req)
+{
+  telemetry_cursor_t cursor = {0};
+  char chunk[CHUNK_SIZE];
+  int len = snprintf(chunk, sizeof(chunk), "boot,time_ms,ch,value\n");
+
+  while (telemetry_read(&cursor, &s_block) == ESP_OK)
+  {
+    telemetry_decoder_t decoder;
+    telemetry_record_t record;
+
+    telemetry_decoder_init(&decoder, &s_block);
+    while (telemetry_decoder_next(&decoder, &record))
+    {
+      if (len > CHUNK_SIZE - LINE_MAX_LEN)
+      {
+        if (httpd_resp_send_chunk(req, chunk, len) != ESP_OK)
+        {
+          return ESP_FAIL;
+        }
+        len = 0;
+      }
+
+      len += snprintf(chunk + len, sizeof(chunk) - len, "%u,%" PRId64 ",%u,%" PRId32 "\n",
+                      s_block.boot, record.time_ms, record.ch, record.value);
+    }
+  }
+
+  if (len > 0 && httpd_resp_send_chunk(req, chunk, len) != ESP_OK)
+  {
+    return ESP_FAIL;
+  }
+
+  return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+/**
+ * @brief Streams the valid blocks as they are on flash.
+ */
+static esp_err_t send_blocks(httpd_req_t *req)
+{
+  telemetry_cursor_t cursor = {0};
+
+  while (telemetry_read(&cursor, &s_block) == ESP_OK)
+  {
+    if (httpd_resp_send_chunk(req, (const char *)&s_block, sizeof(s_block)) != ESP_OK)
+    {
+      return ESP_FAIL;
+    }
+  }
+
+  return httpd_resp_send_chunk(req, NULL, 0);
+}
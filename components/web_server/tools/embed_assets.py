@@ -0,0 +1,124 @@
+#!/usr/bin/env python3
+"""Generates the static asset table of the web server from the frontend build.
+
+usage: embed_assets.py <dist dir> <output .c>
+
+Every file under <dist dir> becomes an entry of web_assets[], sorted by
+request path so the server can binary search it. An entry holds the MIME
+type, the plain bytes and, when it is smaller, a gzipped copy, each with a
+strong ETag. The output only depends on the input bytes, so an unchanged
+frontend keeps its ETags across builds and browsers keep their cache.
+"""
+
+import gzip
+import hashlib
+import os
+import sys
+
+ETAG_DIGEST_LEN = 16  # Hex digits kept from the SHA-256, plenty for a cache key
+BYTES_PER_LINE = 16
+
+MIME_TYPES = {
+    '.html': 'text/html',
+    '.js': 'application/javascript',
+    '.css': 'text/css',
+    '.json': 'application/json',
+    '.map': 'application/json',
+    '.svg': 'image/svg+xml',
+    '.png': 'image/png',
+    '.jpg': 'image/jpeg',
+    '.jpeg': 'image/jpeg',
+    '.gif': 'image/gif',
+    '.ico': 'image/x-icon',
+    '.webp': 'image/webp',
+    '.woff': 'font/woff',
+    '.woff2': 'font/woff2',
+    '.ttf': 'font/ttf',
+    '.txt': 'text/plain',
+    '.webmanifest': 'application/manifest+json',
+}
+DEFAULT_MIME_TYPE = 'application/octet-stream'
+
+
+def etag(data):
+    # A quoted C string holding the quoted ETag, as sent in the header
+    return '"\\"' + hashlib.sha256(data).hexdigest()[:ETAG_DIGEST_LEN] + '\\""'
+
+
+def c_string(text):
+    return '"' + text.replace('\\', '\\\\').replace('"', '\\"') + '"'
+
+
+def c_array(name, data):
+    lines = ['static const uint8_t {}[{}] = {{'.format(name, len(data))]
+    for i in range(0, len(data), BYTES_PER_LINE):
+        lines.append('    ' + ', '.join('0x{:02x}'.format(b) for b in data[i:i + BYTES_PER_LINE]) + ',')
+    lines.append('};')
+    return lines
+
+
+def collect(dist_dir):
+    assets = []
+    for root, dirs, files in os.walk(dist_dir):
+        dirs.sort()
+        for name in files:
+            path = os.path.join(root, name)
+            url = '/' + os.path.relpath(path, dist_dir).replace(os.sep, '/')
+            assets.append((url, path))
+
+    # Byte order, as strcmp() compares on the device
+    return sorted(assets, key=lambda asset: asset[0].encode())
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__)
+
+    dist_dir, output = sys.argv[1], sys.argv[2]
+
+    arrays = []
+    entries = []
+
+    for index, (url, path) in enumerate(collect(dist_dir)):
+        with open(path, 'rb') as f:
+            data = f.read()
+
+        # mtime=0 keeps the archive, and so its ETag, reproducible
+        compressed = gzip.compress(data, compresslevel=9, mtime=0)
+        has_gz = len(compressed) < len(data)
+
+        mime = MIME_TYPES.get(os.path.splitext(url)[1].lower(), DEFAULT_MIME_TYPE)
+
+        arrays += c_array('s_asset_{}'.format(index), data)
+        if has_gz:
+            arrays += c_array('s_asset_{}_gz'.format(index), compressed)
+
+        entries += [
+            '    {',
+            '        .path = {},'.format(c_string(url)),
+            '        .type = "{}",'.format(mime),
+            '        .data = s_asset_{},'.format(index),
+            '        .len = sizeof(s_asset_{}),'.format(index),
+            '        .etag = {},'.format(etag(data)),
+            '        .gz_data = {},'.format('s_asset_{}_gz'.format(index) if has_gz else 'NULL'),
+            '        .gz_len = {},'.format('sizeof(s_asset_{}_gz)'.format(index) if has_gz else 0),
+            '        .gz_etag = {},'.format(etag(compressed) if has_gz else 'NULL'),
+            '    },',
+        ]
+
+        print('{}: {} bytes, {} gzipped'.format(url, len(data), len(compressed) if has_gz else 'not'))
+
+    lines = ['// Generated by embed_assets.py from the frontend build, do not edit', '',
+             '#include "web_server_internals.h"', '']
+    lines += arrays
+    lines += ['', 'const web_asset_t web_assets[] = {']
+    lines += entries
+    lines += ['};', '', 'const size_t web_assets_count = sizeof(web_assets) / sizeof(web_assets[0]);', '']
+
+    os.makedirs(os.path.dirname(os.path.abspath(output)), exist_ok=True)
+    with open(output, 'w') as f:
+        f.write('\n'.join(lines))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,167 @@
+#!/usr/bin/env python3
+"""Checks that a stalled SSE client does not delay the other clients.
+
+usage: sse_stall_test.py <device host> [--clients N] [--seconds S]
+
+Runs two phases against a device serving /api/events. In both, N clients
+read the stream and time every frame they receive. In the second phase one
+more client connects with a tiny receive buffer and never reads, so its
+socket fills and stays full. The batch latency reported by
+/api/events/stats and the frame gaps seen by the reading clients must stay
+the same in both phases, and the stalled client must be evicted once the
+stall timeout (CONFIG_WEB_SERVER_EVENTS_CLIENT_TIMEOUT_MS) has passed.
+
+The inputs must produce events during the run: analog inputs sampling, or
+a signal on a digital input.
+"""
+
+import argparse
+import http.client
+import json
+import socket
+import sys
+import threading
+import time
+
+STALLED_RCVBUF = 1024       # Bytes, the socket is full after a few frames
+LATENCY_SLACK_US = 5000     # Allowed growth of the mean batch latency
+GAP_RATIO_MAX = 1.5         # Allowed growth of the 99th percentile frame gap
+GAP_SLACK_S = 0.050
+
+
+class Reader(threading.Thread):
+    # Reads the stream and records the arrival time of every frame
+
+    def __init__(self, host, port, stop):
+        super().__init__(daemon=True)
+        self.host, self.port, self.stop = host, port, stop
+        self.arrivals = []
+        self.error = None
+
+    def run(self):
+        try:
+            conn = http.client.HTTPConnection(self.host, self.port, timeout=10)
+            conn.request('GET', '/api/events', headers={'Accept': 'text/event-stream'})
+            resp = conn.getresponse()
+            if resp.status != 200:
+                raise RuntimeError('/api/events returned {}'.format(resp.status))
+
+            in_frame = False
+            while not self.stop.is_set():
+                line = resp.readline()
+                if not line:
+                    raise RuntimeError('stream closed by the device')
+                if line.strip():
+                    in_frame = True
+                elif in_frame:
+                    self.arrivals.append(time.monotonic())
+                    in_frame = False
+            conn.close()
+        except Exception as e:
+            self.error = e
+
+    def gaps(self):
+        # Skips the first frame, the snapshot sent on connect
+        return [b - a for a, b in zip(self.arrivals[1:], self.arrivals[2:])]
+
+
+def stalled_client(host, port):
+    # Connects, asks for the stream and never reads it
+    sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, STALLED_RCVBUF)
+    sock.connect((host, port))
+    sock.sendall('GET /api/events HTTP/1.1\r\nHost: {}\r\nAccept: text/event-stream\r\n\r\n'.format(host).encode())
+    return sock
+
+
+def get_stats(host, port):
+    conn = http.client.HTTPConnection(host, port, timeout=10)
+    conn.request('GET', '/api/events/stats')
+    stats = json.loads(conn.getresponse().read())
+    conn.close()
+    return stats
+
+
+def percentile(values, p):
+    if not values:
+        return 0.0
+    values = sorted(values)
+    return values[min(len(values) - 1, int(len(values) * p))]
+
+
+def run_phase(args, stalled):
+    stop = threading.Event()
+    readers = [Reader(args.host, args.port, stop) for _ in range(args.clients)]
+    sock = None
+
+    for reader in readers:
+        reader.start()
+    time.sleep(1)  # Snapshots sent, clients settled
+
+    if stalled:
+        sock = stalled_client(args.host, args.port)
+
+    before = get_stats(args.host, args.port)
+    time.sleep(args.seconds)
+    after = get_stats(args.host, args.port)
+
+    stop.set()
+    for reader in readers:
+        reader.join(timeout=15)
+        if reader.error is not None:
+            sys.exit('reader failed: {}'.format(reader.error))
+    if sock is not None:
+        sock.close()
+
+    batches = after['batches'] - before['batches']
+    latency_sum = after['mean_latency_us'] * after['batches'] - before['mean_latency_us'] * before['batches']
+    gaps = [gap for reader in readers for gap in reader.gaps()]
+
+    return {
+        'batches': batches,
+        'mean_latency_us': latency_sum / batches if batches else 0,
+        'frames': min(len(reader.arrivals) for reader in readers),
+        'gap_p50_s': percentile(gaps, 0.50),
+        'gap_p99_s': percentile(gaps, 0.99),
+        'evicted': after['evicted'] - before['evicted'],
+        'client_stalls': after['client_stalls'] - before['client_stalls'],
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('host')
+    parser.add_argument('--port', type=int, default=80)
+    parser.add_argument('--clients', type=int, default=3, help='reading clients')
+    parser.add_argument('--seconds', type=float, default=20, help='length of each phase, above the stall timeout')
+    args = parser.parse_args()
+
+    baseline = run_phase(args, stalled=False)
+    if baseline['batches'] == 0 or baseline['frames'] < 3:
+        sys.exit('no events during the baseline, drive an input and run again')
+    loaded = run_phase(args, stalled=True)
+
+    print('{:>10} {:>8} {:>16} {:>12} {:>12} {:>8} {:>8}'.format(
+        'phase', 'batches', 'mean latency us', 'gap p50 ms', 'gap p99 ms', 'stalls', 'evicted'))
+    for name, phase in (('baseline', baseline), ('stalled', loaded)):
+        print('{:>10} {:>8} {:>16.0f} {:>12.1f} {:>12.1f} {:>8} {:>8}'.format(
+            name, phase['batches'], phase['mean_latency_us'], phase['gap_p50_s'] * 1000,
+            phase['gap_p99_s'] * 1000, phase['client_stalls'], phase['evicted']))
+
+    failures = []
+    if loaded['mean_latency_us'] > baseline['mean_latency_us'] + LATENCY_SLACK_US:
+        failures.append('batch latency grew with a stalled client')
+    if loaded['gap_p99_s'] > baseline['gap_p99_s'] * GAP_RATIO_MAX + GAP_SLACK_S:
+        failures.append('frame gaps of the reading clients grew with a stalled client')
+    if loaded['evicted'] < 1:
+        failures.append('the stalled client was not evicted')
+
+    for failure in failures:
+        print('FAIL: ' + failure)
+    if failures:
+        sys.exit(1)
+    print('PASS')
+
+
+if __name__ == '__main__':
+    main()
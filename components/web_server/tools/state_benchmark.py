@@ -0,0 +1,89 @@
+#!/usr/bin/env python3
+"""Measures the request rate of /api/state against the per-id endpoints.
+
+usage: state_benchmark.py <device host> [--connections N] [--seconds S]
+
+Each run keeps N keep-alive connections busy for S seconds, first with
+GET /api/state, then cycling through GET /api/digital-input?id= and
+GET /api/digital-output?id= over every channel. It prints the requests per
+second of both, and the full-state reads per second: one request for
+/api/state, one per channel for the per-id endpoints.
+"""
+
+import argparse
+import http.client
+import itertools
+import sys
+import threading
+import time
+
+DIGITAL_INPUTS = 3   # _DIGITAL_INPUT_NUM_MAX
+DIGITAL_OUTPUTS = 4  # _DIGITAL_OUTPUT_NUM_MAX
+
+
+class Client(threading.Thread):
+    # Sends the paths in turn on one connection until the deadline
+
+    def __init__(self, host, port, paths, deadline):
+        super().__init__(daemon=True)
+        self.host, self.port, self.paths, self.deadline = host, port, paths, deadline
+        self.requests = 0
+        self.bytes = 0
+        self.error = None
+
+    def run(self):
+        try:
+            conn = http.client.HTTPConnection(self.host, self.port, timeout=10)
+            for path in itertools.cycle(self.paths):
+                if time.monotonic() >= self.deadline:
+                    break
+                conn.request('GET', path)
+                resp = conn.getresponse()
+                body = resp.read()
+                if resp.status != 200:
+                    raise RuntimeError('{} returned {}'.format(path, resp.status))
+                self.requests += 1
+                self.bytes += len(body)
+            conn.close()
+        except Exception as e:
+            self.error = e
+
+
+def run(args, paths):
+    deadline = time.monotonic() + args.seconds
+    clients = [Client(args.host, args.port, paths, deadline) for _ in range(args.connections)]
+
+    start = time.monotonic()
+    for client in clients:
+        client.start()
+    for client in clients:
+        client.join()
+        if client.error is not None:
+            sys.exit('client failed: {}'.format(client.error))
+    elapsed = time.monotonic() - start
+
+    requests = sum(client.requests for client in clients)
+    return requests / elapsed, sum(client.bytes for client in clients) / max(requests, 1)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('host')
+    parser.add_argument('--port', type=int, default=80)
+    parser.add_argument('--connections', type=int, default=2, help='parallel keep-alive connections')
+    parser.add_argument('--seconds', type=float, default=10, help='length of each run')
+    args = parser.parse_args()
+
+    per_id = (['/api/digital-input?id={}'.format(i) for i in range(DIGITAL_INPUTS)] +
+              ['/api/digital-output?id={}'.format(i) for i in range(DIGITAL_OUTPUTS)])
+
+    state_rate, state_bytes = run(args, ['/api/state'])
+    per_id_rate, per_id_bytes = run(args, per_id)
+
+    print('{:>10} {:>10} {:>14} {:>16}'.format('endpoint', 'req/s', 'bytes/resp', 'full states/s'))
+    print('{:>10} {:>10.0f} {:>14.0f} {:>16.0f}'.format('state', state_rate, state_bytes, state_rate))
+    print('{:>10} {:>10.0f} {:>14.0f} {:>16.0f}'.format('per-id', per_id_rate, per_id_bytes, per_id_rate / len(per_id)))
+
+
+if __name__ == '__main__':
+    main()
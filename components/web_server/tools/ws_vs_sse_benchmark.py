@@ -0,0 +1,314 @@
+#!/usr/bin/env python3
+"""Compares the WebSocket transport against SSE plus POST.
+
+usage: ws_vs_sse_benchmark.py <device host> [--seconds S] [--toggles N] [--output N] [--loopback-input N]
+
+Subscribes to /api/ws and /api/events at the same time and counts the bytes
+each socket receives after its handshake, framing included. Divided by the
+updates the device reports for the transport in /api/events/stats, this
+gives the wire bytes per update of both. No other client should be
+connected during the run, the stats count every client of a transport.
+
+Then toggles a digital output N times over each transport and prints the
+median and 99th percentile round trip: a WS_CMD_SET_OUTPUT command until
+its ack, and a POST /api/digital-output until its response. With
+--loopback-input, the output is wired to that digital input and the POST
+round trip ends at the SSE echo of the input instead, the path a page
+without WebSocket waits on.
+
+The inputs must produce events during the first phase: analog inputs
+sampling, or a signal on a digital input.
+"""
+
+import argparse
+import base64
+import http.client
+import json
+import os
+import socket
+import struct
+import sys
+import threading
+import time
+
+WS_MSG_SNAPSHOT = 0x40
+WS_MSG_ACK = 0x41
+WS_CMD_SET_OUTPUT = 0x80
+WS_OPCODE_BINARY = 0x2
+WS_OPCODE_CLOSE = 0x8
+WS_OPCODE_PING = 0x9
+WS_OPCODE_PONG = 0xA
+
+RECORD_LEN = {0: 3, 1: 4, 2: 9, WS_MSG_ACK: 7}  # Bytes, type byte included
+ROUND_TRIP_TIMEOUT_S = 2
+
+
+def read_headers(sock):
+    # Reads the response head, returns the status and the bytes after it
+    data = b''
+    while b'\r\n\r\n' not in data:
+        chunk = sock.recv(1024)
+        if not chunk:
+            raise RuntimeError('connection closed during the handshake')
+        data += chunk
+    head, rest = data.split(b'\r\n\r\n', 1)
+    return int(head.split(b' ', 2)[1]), head, rest
+
+
+class WsClient(threading.Thread):
+    # Subscribes to /api/ws, counts the received bytes and collects the acks
+
+    def __init__(self, host, port):
+        super().__init__(daemon=True)
+        self.sock = socket.create_connection((host, port), timeout=10)
+        key = base64.b64encode(os.urandom(16)).decode()
+        self.sock.sendall(('GET /api/ws HTTP/1.1\r\nHost: {}\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n'
+                           'Sec-WebSocket-Key: {}\r\nSec-WebSocket-Version: 13\r\n\r\n').format(host, key).encode())
+        status, _, self.buf = read_headers(self.sock)
+        if status != 101:
+            raise RuntimeError('/api/ws returned {}'.format(status))
+        self.sock.settimeout(None)  # Quiet inputs send nothing for a while
+        self.bytes = len(self.buf)
+        self.acks = {}
+        self.acked = threading.Condition()
+        self.send_lock = threading.Lock()
+        self.error = None
+
+    def run(self):
+        try:
+            while True:
+                opcode, payload = self.read_frame()
+                if opcode == WS_OPCODE_CLOSE:
+                    raise RuntimeError('closed by the device')
+                if opcode == WS_OPCODE_PING:
+                    self.send(WS_OPCODE_PONG, payload)
+                elif opcode == WS_OPCODE_BINARY:
+                    self.parse(payload)
+        except Exception as e:
+            self.error = e
+            with self.acked:
+                self.acked.notify_all()
+
+    def recv_exact(self, n):
+        while len(self.buf) < n:
+            chunk = self.sock.recv(4096)
+            if not chunk:
+                raise RuntimeError('stream closed by the device')
+            self.bytes += len(chunk)
+            self.buf += chunk
+        data, self.buf = self.buf[:n], self.buf[n:]
+        return data
+
+    def read_frame(self):
+        first, second = self.recv_exact(2)
+        length = second & 0x7F
+        if length == 126:
+            length = struct.unpack('>H', self.recv_exact(2))[0]
+        elif length == 127:
+            length = struct.unpack('>Q', self.recv_exact(8))[0]
+        return first & 0x0F, self.recv_exact(length)
+
+    def parse(self, payload):
+        # Walks the records of one message, records the arrival of the acks
+        offset = 0
+        while offset < len(payload):
+            kind = payload[offset]
+            if kind == WS_MSG_SNAPSHOT:
+                count = payload[offset + 13]
+                offset += 14 + 2 * count + 9
+                continue
+            if kind not in RECORD_LEN:
+                raise RuntimeError('unknown record type 0x{:02x}'.format(kind))
+            if kind == WS_MSG_ACK:
+                with self.acked:
+                    self.acks[payload[offset + 1]] = (time.monotonic(), payload[offset + 2])
+                    self.acked.notify_all()
+            offset += RECORD_LEN[kind]
+
+    def send(self, opcode, payload):
+        # Client frames are masked
+        mask = os.urandom(4)
+        masked = bytes(b ^ mask[i % 4] for i, b in enumerate(payload))
+        with self.send_lock:
+            self.sock.sendall(bytes([0x80 | opcode, 0x80 | len(payload)]) + mask + masked)
+
+    def set_output(self, seq, num, state):
+        # Returns the round trip of the command until its ack
+        start = time.monotonic()
+        self.send(WS_OPCODE_BINARY, bytes([WS_CMD_SET_OUTPUT, seq, num, int(state)]))
+        with self.acked:
+            if not self.acked.wait_for(lambda: seq in self.acks or self.error is not None, ROUND_TRIP_TIMEOUT_S):
+                raise RuntimeError('no ack for command {}'.format(seq))
+            if self.error is not None:
+                raise self.error
+            arrival, status = self.acks.pop(seq)
+        if status != 0:
+            raise RuntimeError('command {} failed with status {}'.format(seq, status))
+        return arrival - start
+
+
+class SseClient(threading.Thread):
+    # Subscribes to /api/events, counts the received bytes, chunk framing
+    # included, and records the digital input frames
+
+    def __init__(self, host, port):
+        super().__init__(daemon=True)
+        self.sock = socket.create_connection((host, port), timeout=10)
+        self.sock.sendall('GET /api/events HTTP/1.1\r\nHost: {}\r\nAccept: text/event-stream\r\n\r\n'.format(host).encode())
+        status, head, self.buf = read_headers(self.sock)
+        if status != 200:
+            raise RuntimeError('/api/events returned {}'.format(status))
+        self.sock.settimeout(None)
+        self.chunked = b'chunked' in head.lower()
+        self.bytes = len(self.buf)
+        self.inputs = {}
+        self.changed = threading.Condition()
+        self.error = None
+
+    def run(self):
+        try:
+            text = b''
+            while True:
+                text += self.read_body()
+                while b'\n\n' in text:
+                    frame, text = text.split(b'\n\n', 1)
+                    self.parse(frame.decode())
+        except Exception as e:
+            self.error = e
+            with self.changed:
+                self.changed.notify_all()
+
+    def recv_more(self):
+        chunk = self.sock.recv(4096)
+        if not chunk:
+            raise RuntimeError('stream closed by the device')
+        self.bytes += len(chunk)
+        self.buf += chunk
+
+    def read_body(self):
+        # One chunk of the body, or whatever arrived if not chunked
+        if not self.chunked:
+            if not self.buf:
+                self.recv_more()
+            data, self.buf = self.buf, b''
+            return data
+        while b'\r\n' not in self.buf:
+            self.recv_more()
+        size_line, self.buf = self.buf.split(b'\r\n', 1)
+        size = int(size_line.split(b';')[0], 16)
+        while len(self.buf) < size + 2:
+            self.recv_more()
+        data, self.buf = self.buf[:size], self.buf[size + 2:]
+        return data
+
+    def parse(self, frame):
+        event, data = None, None
+        for line in frame.split('\n'):
+            if line.startswith('event: '):
+                event = line[7:]
+            elif line.startswith('data: '):
+                data = line[6:]
+        if event == 'digital-input' and data is not None:
+            fields = json.loads(data)
+            with self.changed:
+                self.inputs[fields['num']] = (time.monotonic(), fields['value'])
+                self.changed.notify_all()
+
+    def wait_input(self, num, value, since):
+        # Returns the arrival of the first frame of the input with the value
+        def echoed():
+            arrival, current = self.inputs.get(num, (0, None))
+            return self.error is not None or (arrival >= since and current == int(value))
+
+        with self.changed:
+            if not self.changed.wait_for(echoed, ROUND_TRIP_TIMEOUT_S):
+                raise RuntimeError('no echo on digital input {}'.format(num))
+            if self.error is not None:
+                raise self.error
+            return self.inputs[num][0]
+
+
+def get_stats(host, port):
+    conn = http.client.HTTPConnection(host, port, timeout=10)
+    conn.request('GET', '/api/events/stats')
+    stats = json.loads(conn.getresponse().read())
+    conn.close()
+    return stats
+
+
+def percentile(values, p):
+    if not values:
+        return 0.0
+    values = sorted(values)
+    return values[min(len(values) - 1, int(len(values) * p))]
+
+
+def post_round_trips(args, sse):
+    conn = http.client.HTTPConnection(args.host, args.port, timeout=10)
+    trips = []
+    for n in range(args.toggles):
+        state = n % 2 == 0
+        start = time.monotonic()
+        conn.request('POST', '/api/digital-output?id={}'.format(args.output),
+                     body=json.dumps({'state': state}), headers={'Content-Type': 'application/json'})
+        resp = conn.getresponse()
+        resp.read()
+        end = time.monotonic()
+        if resp.status != 200:
+            raise RuntimeError('POST returned {}'.format(resp.status))
+        if args.loopback_input is not None:
+            end = sse.wait_input(args.loopback_input, state, start)
+        trips.append(end - start)
+    conn.close()
+    return trips
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('host')
+    parser.add_argument('--port', type=int, default=80)
+    parser.add_argument('--seconds', type=float, default=10, help='length of the bytes per update phase')
+    parser.add_argument('--toggles', type=int, default=200, help='output toggles per transport')
+    parser.add_argument('--output', type=int, default=0, help='digital output to toggle')
+    parser.add_argument('--loopback-input', type=int, help='digital input wired to the output')
+    args = parser.parse_args()
+
+    ws = WsClient(args.host, args.port)
+    sse = SseClient(args.host, args.port)
+    ws.start()
+    sse.start()
+    time.sleep(1)  # Snapshots sent, clients settled
+
+    before = get_stats(args.host, args.port)
+    ws_start, sse_start = ws.bytes, sse.bytes
+    time.sleep(args.seconds)
+    after = get_stats(args.host, args.port)
+    ws_bytes, sse_bytes = ws.bytes - ws_start, sse.bytes - sse_start
+
+    ws_updates = after['ws_updates'] - before['ws_updates']
+    sse_updates = after['sse_updates'] - before['sse_updates']
+    if ws_updates == 0 or sse_updates == 0:
+        sys.exit('no events during the run, drive an input and run again')
+
+    try:
+        ws_trips = [ws.set_output(n % 256, args.output, n % 2 == 0) for n in range(args.toggles)]
+        post_trips = post_round_trips(args, sse)
+    except Exception as e:
+        sys.exit('round trip failed: {}'.format(e))
+
+    for client in (ws, sse):
+        if client.error is not None:
+            sys.exit('client failed: {}'.format(client.error))
+
+    print('{:>10} {:>8} {:>12} {:>14} {:>12} {:>12}'.format(
+        'transport', 'updates', 'wire bytes', 'bytes/update', 'rtt p50 ms', 'rtt p99 ms'))
+    rows = (('ws', ws_updates, ws_bytes, ws_trips),
+            ('sse+post', sse_updates, sse_bytes, post_trips))
+    for name, updates, received, trips in rows:
+        print('{:>10} {:>8} {:>12} {:>14.1f} {:>12.2f} {:>12.2f}'.format(
+            name, updates, received, received / updates,
+            percentile(trips, 0.50) * 1000, percentile(trips, 0.99) * 1000))
+
+
+if __name__ == '__main__':
+    main()
@@ -10,23 +10,18 @@
 #include "lwip/sys.h"
 
 //**************************************************
-// Static Function Prototypes
+// Defines
 //**************************************************
 
-static void wifi_event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data);
-static esp_err_t start();
-static esp_err_t stop();
-static esp_err_t get_index_html_handler(httpd_req_t *req);
-static esp_err_t get_bundle_js_handler(httpd_req_t *req);
+#define WEB_SERVER_MAX_URI_HANDLERS 24 // The default of 8 is below what the modules register
 
 //**************************************************
-// Files
+// Static Function Prototypes
 //**************************************************
 
-extern const uint8_t s_index_html_start[] asm("_binary_index_html_start");
-extern const uint8_t s_index_html_end[] asm("_binary_index_html_end");
-extern const uint8_t s_bundle_js_start[] asm("_binary_bundle_js_start");
-extern const uint8_t s_bundle_js_end[] asm("_binary_bundle_js_end");
+static void wifi_event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data);
+static esp_err_t start();
+static esp_err_t stop();
 
 //**************************************************
 // Globals
@@ -36,20 +31,6 @@ static char TAG[] = "web-server";
 
 static httpd_handle_t s_server = NULL;
 
-// ##### Endpoints #####
-
-static const httpd_uri_t s_uri_get_index_html = {
-    .uri = "/",
-    .method = HTTP_GET,
-    .handler = get_index_html_handler,
-    .user_ctx = NULL};
-
-static const httpd_uri_t s_uri_get_bundle_js = {
-    .uri = "/bundle.js",
-    .method = HTTP_GET,
-    .handler = get_bundle_js_handler,
-    .user_ctx = NULL};
-
 //**************************************************
 // Public Functions
 //**************************************************
@@ -114,6 +95,8 @@ static esp_err_t start()
 
   httpd_config_t config = HTTPD_DEFAULT_CONFIG();
   config.lru_purge_enable = true;
+  config.max_uri_handlers = WEB_SERVER_MAX_URI_HANDLERS;
+  config.uri_match_fn = httpd_uri_match_wildcard; // For the "/*" asset handler
 
   if (httpd_start(&s_server, &config) != ESP_OK)
   {
@@ -121,10 +104,6 @@ static esp_err_t start()
     return ESP_FAIL;
   }
 
-  // Registering Core Web Content
-  httpd_register_uri_handler(s_server, &s_uri_get_index_html);
-  httpd_register_uri_handler(s_server, &s_uri_get_bundle_js);
-
   // Registering Application Modules
   digital_output_register(s_server);
   digital_input_register(s_server);
@@ -132,6 +111,16 @@ static esp_err_t start()
   analog_input_register(s_server);
   sensor_register(s_server);
   sensor_register(s_server);
+  state_register(s_server);
+  history_register(s_server);
+  telemetry_register(s_server);
+  metrics_register(s_server);
+#if CONFIG_WEB_SERVER_WS
+  ws_register(s_server);
+#endif
+
+  // Registering Core Web Content, last so the API paths match first
+  assets_register(s_server);
 
   return ESP_OK;
 }
@@ -144,26 +133,10 @@ static esp_err_t stop()
 {
   if (s_server)
   {
+    // Clients first, their async requests need the running server
+    events_unregister();
     httpd_stop(s_server);
     s_server = NULL;
   }
   return ESP_OK;
 }
-
-/**
- * @brief Handler for the root path. Serves the embedded 'index.html' file.
- */
-static esp_err_t get_index_html_handler(httpd_req_t *req)
-{
-  httpd_resp_set_type(req, "text/html");
-  return httpd_resp_send(req, (const char *)s_index_html_start, s_index_html_end - s_index_html_start);
-}
-
-/**
- * @brief Handler for the JavaScript bundle. Serves the embedded 'bundle.js' file.
- */
-static esp_err_t get_bundle_js_handler(httpd_req_t *req)
-{
-  httpd_resp_set_type(req, "application/javascript");
-  return httpd_resp_send(req, (const char *)s_bundle_js_start, s_bundle_js_end - s_bundle_js_start);
-}
@@ -0,0 +1,175 @@
+#include "web_server_internals.h"
+#include "esp_http_server.h"
+#include "esp_log.h"
+#include "digital_output.h"
+
+//**************************************************
+// Defines
+//**************************************************
+
+#define WS_COMMAND_MAX_LEN 16 // Longest command is WS_CMD_PWM_DUTY, 11 bytes
+
+//**************************************************
+// Function Prototypes
+//**************************************************
+
+static esp_err_t ws_handler(httpd_req_t *req);
+static ws_status_t apply_command(const ws_command_t *command);
+static ws_status_t status_from_err(esp_err_t err);
+
+//**************************************************
+// Globals
+//**************************************************
+
+static const char TAG[] = "web_server:ws";
+
+static const httpd_uri_t s_uri_ws = {
+    .uri = "/api/ws",
+    .method = HTTP_GET,
+    .handler = ws_handler,
+    .user_ctx = NULL,
+    .is_websocket = true,
+    .handle_ws_control_frames = true, // Replies go out from the events task, see events_ws_control()
+};
+
+//**************************************************
+// Public Functions
+//**************************************************
+
+esp_err_t ws_register(httpd_handle_t server)
+{
+  if (httpd_register_uri_handler(server, &s_uri_ws) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "%s:Fail to register uri handler", __func__);
+    return ESP_FAIL;
+  }
+
+  return ESP_OK;
+}
+
+//**************************************************
+// Static Functions
+//**************************************************
+
+/**
+ * @brief WebSocket handler. Called once with HTTP_GET after the handshake,
+ *        the session then joins the events clients. Every later call is a
+ *        frame from the client: a binary command, applied and answered with
+ *        an ack on the same socket, or a control frame. The events task owns
+ *        the socket writes, so acks and control replies are queued to it.
+ */
+static esp_err_t ws_handler(httpd_req_t *req)
+{
+  if (req->method == HTTP_GET)
+  {
+    return events_ws_add(req);
+  }
+
+  uint8_t buf[WS_COMMAND_MAX_LEN];
+  httpd_ws_frame_t frame = {
+      .type = HTTPD_WS_TYPE_BINARY,
+      .payload = NULL,
+  };
+
+  // Length first, then the payload
+  esp_err_t err = httpd_ws_recv_frame(req, &frame, 0);
+  if (err != ESP_OK)
+  {
+    ESP_LOGW(TAG, "%s:Fail to read frame length", __func__);
+    return err;
+  }
+
+  if (frame.type == HTTPD_WS_TYPE_PING || frame.type == HTTPD_WS_TYPE_PONG || frame.type == HTTPD_WS_TYPE_CLOSE)
+  {
+    uint8_t control[WS_CONTROL_PAYLOAD_MAX_LEN];
+
+    frame.payload = control;
+    if (frame.len > sizeof(control) || (err = httpd_ws_recv_frame(req, &frame, sizeof(control))) != ESP_OK)
+    {
+      ESP_LOGW(TAG, "%s:Fail to read control frame, type %d", __func__, frame.type);
+      return ESP_FAIL;
+    }
+
+    return frame.type == HTTPD_WS_TYPE_PONG ? ESP_OK : events_ws_control(req, frame.type, control, frame.len);
+  }
+
+  if (frame.type != HTTPD_WS_TYPE_BINARY || frame.len > sizeof(buf))
+  {
+    ESP_LOGW(TAG, "%s:Unexpected frame, type %d, %u bytes", __func__, frame.type, (unsigned)frame.len);
+    return ESP_FAIL; // Closes the session
+  }
+
+  frame.payload = buf;
+  if ((err = httpd_ws_recv_frame(req, &frame, sizeof(buf))) != ESP_OK)
+  {
+    ESP_LOGW(TAG, "%s:Fail to read frame", __func__);
+    return err;
+  }
+
+  ws_command_t command;
+  ws_status_t status = ws_protocol_parse_command(buf, frame.len, &command) == ESP_OK ? apply_command(&command)
+                                                                                        : WS_STATUS_INVALID_ARG;
+
+  const ws_ack_t ack = {
+      .seq = command.seq,
+      .status = status,
+      .outputs = digital_output_get_mask(),
+  };
+
+  return events_ws_ack(req, &ack);
+}
+
+/**
+ * @brief Applies a decoded command to the outputs.
+ */
+static ws_status_t apply_command(const ws_command_t *command)
+{
+  switch (command->type)
+  {
+  case WS_CMD_SET_OUTPUT:
+    if (command->set_output.num >= _DIGITAL_OUTPUT_NUM_MAX)
+    {
+      return WS_STATUS_INVALID_ARG;
+    }
+    return status_from_err(digital_output_set_state(command->set_output.num, command->set_output.state));
+
+  case WS_CMD_SET_MASK:
+    return status_from_err(digital_output_set_mask(command->set_mask.set, command->set_mask.clear));
+
+  case WS_CMD_PWM_DUTY:
+    if (command->pwm_duty.num >= _DIGITAL_OUTPUT_NUM_MAX)
+    {
+      return WS_STATUS_INVALID_ARG;
+    }
+
+    if (command->pwm_duty.fade_ms > 0)
+    {
+      return status_from_err(digital_output_pwm_fade(command->pwm_duty.num, command->pwm_duty.duty, command->pwm_duty.fade_ms));
+    }
+    return status_from_err(digital_output_pwm_set_duty(command->pwm_duty.num, command->pwm_duty.duty));
+
+  default:
+    return WS_STATUS_INVALID_ARG;
+  }
+}
+
+/**
+ * @brief Maps a driver result to the status sent in an ack.
+ */
+static ws_status_t status_from_err(esp_err_t err)
+{
+  switch (err)
+  {
+  case ESP_OK:
+    return WS_STATUS_OK;
+
+  case ESP_ERR_INVALID_ARG:
+    return WS_STATUS_INVALID_ARG;
+
+  case ESP_ERR_INVALID_STATE:
+    return WS_STATUS_INVALID_STATE;
+
+  default:
+    return WS_STATUS_FAILED;
+  }
+}
@@ -0,0 +1,198 @@
+#include "web_server_internals.h"
+#include <string.h>
+
+//**************************************************
+// Defines
+//**************************************************
+
+#define EVENT_RECORD_MAX_LEN (1 + 4 + 4) // Sensor: type and two floats
+#define ACK_RECORD_LEN (1 + 1 + 1 + 4)
+#define SNAPSHOT_RECORD_LEN (1 + 4 + 4 + 4 + 1 + _ANALOG_INPUT_NUM_MAX * 2 + 1 + 4 + 4)
+
+#define SET_OUTPUT_LEN (1 + 1 + 1 + 1)
+#define SET_MASK_LEN (1 + 1 + 4 + 4)
+#define PWM_DUTY_LEN (1 + 1 + 1 + 4 + 4)
+
+//**************************************************
+// Function Prototypes
+//**************************************************
+
+static uint8_t *put_u16(uint8_t *cursor, uint16_t value);
+static uint8_t *put_u32(uint8_t *cursor, uint32_t value);
+static uint8_t *put_float(uint8_t *cursor, float value);
+static uint32_t get_u32(const uint8_t *data);
+
+//**************************************************
+// Public Functions
+//**************************************************
+
+esp_err_t ws_protocol_append_event(sse_encoder_t *encoder, const event_t *event)
+{
+  if (sizeof(encoder->buf) - encoder->len < EVENT_RECORD_MAX_LEN)
+  {
+    return ESP_ERR_NO_MEM;
+  }
+
+  uint8_t *cursor = (uint8_t *)&encoder->buf[encoder->len];
+  *cursor++ = event->name;
+
+  switch (event->name)
+  {
+  case EVENT_NAME_DIGITAL_INPUT:
+    *cursor++ = event->payload.digital_input.num;
+    *cursor++ = event->payload.digital_input.value;
+    break;
+
+  case EVENT_NAME_ANALOG_INPUT:
+    *cursor++ = event->payload.analog_input.num;
+    cursor = put_u16(cursor, event->payload.analog_input.value);
+    break;
+
+  case EVENT_NAME_SENSOR:
+    cursor = put_float(cursor, event->payload.sensor.humidity);
+    cursor = put_float(cursor, event->payload.sensor.temperature);
+    break;
+
+  default:
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  encoder->len = (char *)cursor - encoder->buf;
+  return ESP_OK;
+}
+
+esp_err_t ws_protocol_append_snapshot(sse_encoder_t *encoder, const events_snapshot_t *snapshot)
+{
+  if (sizeof(encoder->buf) - encoder->len < SNAPSHOT_RECORD_LEN)
+  {
+    return ESP_ERR_NO_MEM;
+  }
+
+  uint8_t *cursor = (uint8_t *)&encoder->buf[encoder->len];
+  *cursor++ = WS_MSG_SNAPSHOT;
+  cursor = put_u32(cursor, snapshot->digital_inputs);
+  cursor = put_u32(cursor, snapshot->digital_outputs);
+  cursor = put_u32(cursor, snapshot->analog_valid);
+
+  *cursor++ = _ANALOG_INPUT_NUM_MAX;
+  for (int i = 0; i < _ANALOG_INPUT_NUM_MAX; i++)
+  {
+    cursor = put_u16(cursor, snapshot->analog_inputs[i]);
+  }
+
+  *cursor++ = snapshot->sensor_valid;
+  cursor = put_float(cursor, snapshot->humidity);
+  cursor = put_float(cursor, snapshot->temperature);
+
+  encoder->len = (char *)cursor - encoder->buf;
+  return ESP_OK;
+}
+
+esp_err_t ws_protocol_append_ack(sse_encoder_t *encoder, const ws_ack_t *ack)
+{
+  if (sizeof(encoder->buf) - encoder->len < ACK_RECORD_LEN)
+  {
+    return ESP_ERR_NO_MEM;
+  }
+
+  uint8_t *cursor = (uint8_t *)&encoder->buf[encoder->len];
+  *cursor++ = WS_MSG_ACK;
+  *cursor++ = ack->seq;
+  *cursor++ = ack->status;
+  cursor = put_u32(cursor, ack->outputs);
+
+  encoder->len = (char *)cursor - encoder->buf;
+  return ESP_OK;
+}
+
+esp_err_t ws_protocol_parse_command(const uint8_t *data, size_t len, ws_command_t *command)
+{
+  if (data == NULL || command == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  memset(command, 0, sizeof(*command));
+  if (len < 2)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  command->type = data[0];
+  command->seq = data[1];
+
+  switch (command->type)
+  {
+  case WS_CMD_SET_OUTPUT:
+    if (len != SET_OUTPUT_LEN)
+    {
+      return ESP_ERR_INVALID_ARG;
+    }
+    command->set_output.num = data[2];
+    command->set_output.state = data[3] != 0;
+    return ESP_OK;
+
+  case WS_CMD_SET_MASK:
+    if (len != SET_MASK_LEN)
+    {
+      return ESP_ERR_INVALID_ARG;
+    }
+    command->set_mask.set = get_u32(&data[2]);
+    command->set_mask.clear = get_u32(&data[6]);
+    return ESP_OK;
+
+  case WS_CMD_PWM_DUTY:
+    if (len != PWM_DUTY_LEN)
+    {
+      return ESP_ERR_INVALID_ARG;
+    }
+    command->pwm_duty.num = data[2];
+    command->pwm_duty.duty = get_u32(&data[3]);
+    command->pwm_duty.fade_ms = get_u32(&data[7]);
+    return ESP_OK;
+
+  default:
+    return ESP_ERR_INVALID_ARG;
+  }
+}
+
+//**************************************************
+// Static Functions
+//**************************************************
+
+/**
+ * @brief Writes a little-endian uint16 and advances the cursor.
+ */
+static uint8_t *put_u16(uint8_t *cursor, uint16_t value)
+{
+  *cursor++ = value;
+  *cursor++ = value >> 8;
+  return cursor;
+}
+
+/**
+ * @brief Writes a little-endian uint32 and advances the cursor.
+ */
+static uint8_t *put_u32(uint8_t *cursor, uint32_t value)
+{
+  cursor = put_u16(cursor, value);
+  return put_u16(cursor, value >> 16);
+}
+
+/**
+ * @brief Writes an IEEE 754 float, little-endian, and advances the cursor.
+ */
+static uint8_t *put_float(uint8_t *cursor, float value)
+{
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return put_u32(cursor, bits);
+}
+
+/**
+ * @brief Reads a little-endian uint32.
+ */
+static uint32_t get_u32(const uint8_t *data)
+{
+  return (uint32_t)data[0] | (uint32_t)data[1] << 8 | (uint32_t)data[2] << 16 | (uint32_t)data[3] << 24;
+}
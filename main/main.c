@@ -6,6 +6,10 @@
 #include "digital_input.h"
 #include "analog_input.h"
 #include "sensor.h"
+#include "history.h"
+#include "telemetry.h"
+
+static const char TAG[] = "main";
 
 void app_main(void)
 {
@@ -19,7 +23,19 @@ void app_main(void)
 	ESP_ERROR_CHECK(wifi_initialize());
 	ESP_ERROR_CHECK(web_server_initialize());
 	ESP_ERROR_CHECK(digital_output_initialize());
-	ESP_ERROR_CHECK(digital_input_initialize());
-	ESP_ERROR_CHECK(analog_input_initialize());
+
+	digital_input_config_t digital_input_config = DIGITAL_INPUT_DEFAULT_CONFIG();
+	ESP_ERROR_CHECK(digital_input_initialize(&digital_input_config));
+
+	analog_input_config_t analog_input_config = ANALOG_INPUT_DEFAULT_CONFIG();
+	ESP_ERROR_CHECK(analog_input_initialize(&analog_input_config));
+
 	ESP_ERROR_CHECK(sensor_initialize());
+	ESP_ERROR_CHECK(history_initialize());
+
+	// The log is a diagnostic aid, the device runs without it
+	if (telemetry_initialize() != ESP_OK)
+	{
+		ESP_LOGE(TAG, "%s:Fail to initialize telemetry, continuing without it", __func__);
+	}
 }